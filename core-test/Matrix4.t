@@ -22,9 +22,13 @@ describe('A 4x4 matrix')
             ENGINE.CreateMatrix4:reset()
             ENGINE.CopyMatrix4:reset()
             ENGINE.Matrix4Op:reset()
+            ENGINE.MultiplyMatrix4InPlace:reset()
             ENGINE.TranslateMatrix4:reset()
+            ENGINE.TranslateMatrix4InPlace:reset()
             ENGINE.ScaleMatrix4:reset()
+            ENGINE.ScaleMatrix4InPlace:reset()
             ENGINE.RotateMatrix4:reset()
+            ENGINE.RotateMatrix4InPlace:reset()
             ENGINE.Matrix4TransformVector:reset()
             ENGINE.MakeRotationMatrix:reset()
         end
@@ -86,6 +90,13 @@ describe('A 4x4 matrix')
         ENGINE.Matrix4Op:assertCallCount(4)
     end)
 
+    :it('can be multiplied in place.', function()
+        ENGINE.MultiplyMatrix4InPlace:canBeCalled{with={'handle a', 'handle b'}}
+        assert(a:multiplyInPlace(b) == a)
+        assert(a.handle == 'handle a')
+        ENGINE.MultiplyMatrix4InPlace:assertCallCount(1)
+    end)
+
     :beforeEach(function()
         ResetMocks()
         ENGINE.CreateMatrix4:canBeCalled{thenReturn={'handle a'}}
@@ -116,6 +127,23 @@ describe('A 4x4 matrix')
         ENGINE.RotateMatrix4:assertCallCount(1)
     end)
 
+    :it('can be translated, scaled and rotated in place.', function()
+        ENGINE.TranslateMatrix4InPlace:canBeCalled{with={'handle a', 10, 20, 30}}
+        ENGINE.ScaleMatrix4InPlace:canBeCalled{with={'handle a', 1, 2, 3}}
+        ENGINE.ScaleMatrix4InPlace:canBeCalled{with={'handle a', 2, 2, 2}}
+        ENGINE.RotateMatrix4InPlace:canBeCalled{with={'handle a', 45, 10, 20, 30}}
+
+        assert(a:translateInPlace(Vec(10, 20, 30)) == a)
+        assert(a:scaleInPlace(Vec(1, 2, 3)) == a)
+        assert(a:scaleInPlace(2) == a)
+        assert(a:rotateInPlace(45, Vec(10, 20, 30)) == a)
+        assert(a.handle == 'handle a')
+
+        ENGINE.TranslateMatrix4InPlace:assertCallCount(1)
+        ENGINE.ScaleMatrix4InPlace:assertCallCount(2)
+        ENGINE.RotateMatrix4InPlace:assertCallCount(1)
+    end)
+
     :it('can transform a vector.', function()
         ENGINE.Matrix4TransformVector:canBeCalled{with={'handle a', 1, 2, 3, 4},
                                                   thenReturn={10, 20, 30, 40}}
@@ -87,5 +87,38 @@ describe('A vector')
         assert(tostring(v) == '1,2')
     end)
 
+    :it('can be assigned.', function()
+        local v = Vector(1, 2, 3)
+        assert(v:set(4, 5) == v)
+        assert(v == Vector(4, 5))
+        assert(#v == 2)
+
+        local source = Vector(6, 7, 8)
+        v:set(source)
+        assert(v == source)
+        assert(#v == 3)
+        source[1] = 0
+        assert(v[1] == 6) -- Copies the components.
+    end)
+
+    :it('can use arithmetic operations in place.', function()
+        local v = Vector(1, 2)
+        assert(v:addInPlace(Vector(3, 4, 5)) == v)
+        assert(v == Vector(4, 6, 5))
+        assert(v:mulInPlace(2) == v)
+        assert(v == Vector(8, 12, 10))
+        assert(v:subInPlace(Vector(3, 4, 5)) == v)
+        assert(v == Vector(5, 8, 5))
+        assert(v:divInPlace(2) == v)
+        assert(v == Vector(2.5, 4, 2.5))
+    end)
+
+    :it('can be normalized in place.', function()
+        local v = Vector(3, 4)
+        assert(v:inverseLength() == 1/5)
+        assert(v:normalizeInPlace() == v)
+        assert(v == Vector(0.6, 0.8))
+    end)
+
 
 bdd.runTests()
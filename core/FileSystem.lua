@@ -3,7 +3,9 @@
 
 
 local engine = require 'engine'
+local rawengine = require 'rawengine'
 local Config = require 'core/Config'
+local Scheduler = require 'core/Scheduler'
 
 
 local function assertIsPackageName( packageName )
@@ -75,6 +77,35 @@ function FileSystem.writeFile( filePath, content, mode )
     engine.WriteFile(filePath, content, mode or 'w')
 end
 
+--- Like @{readFile}, but the file is read by a background job.
+--
+-- Must be called from a scheduled coroutine, which is suspended till the file
+-- has been read.
+--
+-- @return[type=string]
+function FileSystem.readFileAsync( filePath )
+    assertIsFilePath(filePath)
+    local job = Scheduler.awaitCall(rawengine.BeginReadFile, filePath)
+    return Scheduler.awaitJob(job, rawengine.CompleteFileJob)
+end
+
+--- Like @{writeFile}, but the file is written by a background job.
+--
+-- Must be called from a scheduled coroutine, which is suspended till the file
+-- has been written.  Files which are still being written, when the engine
+-- shuts down, are completed before it exits.
+--
+-- @param filePath
+-- @param[type=string] content
+-- @param[type=string] mode
+-- See @{writeFile}.
+function FileSystem.writeFileAsync( filePath, content, mode )
+    assertIsFilePath(filePath)
+    assert(type(content) == 'string', 'File content must be a string.')
+    local job = Scheduler.awaitCall(rawengine.BeginWriteFile, filePath, content, mode or 'w')
+    Scheduler.awaitJob(job, rawengine.CompleteFileJob)
+end
+
 --- Delete a file.
 --
 -- This works only for files in the user directory, not for mounted modules.
@@ -39,4 +39,23 @@ function Json.decodeFromFile( fileName )
     return Json.decodeFromString(fileData)
 end
 
+--- Like @{encodeToFile}, but the file is written by a background job.
+-- Must be called from a scheduled coroutine.
+-- @return
+-- Whether the operation succeeded.
+function Json.encodeToFileAsync( fileName, value )
+    local json = Json.encodeToString(value)
+    FS.writeFileAsync(fileName, json)
+    return true
+end
+
+--- Like @{decodeFromFile}, but the file is read by a background job.
+-- Must be called from a scheduled coroutine.
+-- @return
+-- The decoded JSON object or `nil` it failed.
+function Json.decodeFromFileAsync( fileName )
+    local fileData = FS.readFileAsync(fileName)
+    return Json.decodeFromString(fileData)
+end
+
 return Json
@@ -42,6 +42,14 @@ function Matrix4:__mul( other )
     return Matrix4(engine.Matrix4Op(self.handle, other.handle, '*'))
 end
 
+--- Multiply with another matrix in place.
+-- @return self
+function Matrix4:multiplyInPlace( other )
+    assert(Object.isInstanceOf(other, Matrix4), 'Must be called with a matrix.')
+    engine.MultiplyMatrix4InPlace(self.handle, other.handle)
+    return self
+end
+
 --- Translate along the given vector.
 -- @param[type=core.Vector] v
 function Matrix4:translate( v )
@@ -52,6 +60,14 @@ function Matrix4:translate( v )
                                            v[3]))
 end
 
+--- Like @{translate}, but modifies this matrix.
+-- @return self
+function Matrix4:translateInPlace( v )
+    assert(Vec:isInstance(v), 'Must be called with a vector.')
+    engine.TranslateMatrix4InPlace(self.handle, v[1], v[2], v[3])
+    return self
+end
+
 --- Scale by the given vector.
 -- @param[type=core.Vector] v
 function Matrix4:scale( v )
@@ -66,6 +82,19 @@ function Matrix4:scale( v )
                                        v[3]))
 end
 
+--- Like @{scale}, but modifies this matrix.
+-- @return self
+function Matrix4:scaleInPlace( v )
+    assert(Vec:isInstance(v) or type(v) == 'number',
+           'Must be called with a vector or a number.')
+    if type(v) == 'number' then
+        engine.ScaleMatrix4InPlace(self.handle, v, v, v)
+    else
+        engine.ScaleMatrix4InPlace(self.handle, v[1], v[2], v[3])
+    end
+    return self
+end
+
 --- Rotate around the given vector by `angle` radians.
 -- @param angle
 -- @param[type=core.Vector] vec
@@ -78,6 +107,14 @@ function Matrix4:rotate( angle, vec )
                                         vec[3]))
 end
 
+--- Like @{rotate}, but modifies this matrix.
+-- @return self
+function Matrix4:rotateInPlace( angle, vec )
+    assert(Vec:isInstance(vec), 'Must be called with a vector.')
+    engine.RotateMatrix4InPlace(self.handle, angle, vec[1], vec[2], vec[3])
+    return self
+end
+
 --- Transform the given vector.
 -- @return[type=core.Vector] The transformed vector.
 function Matrix4:transform( vec )
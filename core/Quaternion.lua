@@ -74,6 +74,13 @@ function Quat:normalize()
     return Quat(engine.NormalizeQuaternion(self.handle))
 end
 
+--- Like @{normalize}, but modifies this quaternion.
+-- @return self
+function Quat:normalizeInPlace()
+    engine.NormalizeQuaternionInPlace(self.handle)
+    return self
+end
+
 --- Get the quaternion conjugate.
 function Quat:conjugate()
     return Quat(engine.QuaternionConjugate(self.handle))
@@ -90,6 +97,14 @@ function Quat:__mul( other )
     return Quat(engine.MultiplyQuaternion(self.handle, other.handle))
 end
 
+--- Multiply with another quaternion in place.
+-- @return self
+function Quat:multiplyInPlace( other )
+    assert(Object.isInstanceOf(other, Quat), 'Must be called with a quaternion.')
+    engine.MultiplyQuaternionInPlace(self.handle, other.handle)
+    return self
+end
+
 --- Multiply with a vector.
 --
 -- One parameter must be an vector and one a quaternion.
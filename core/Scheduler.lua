@@ -64,6 +64,41 @@ local function awaitCall(fn, ...)
     end
 end
 
+--- Suspends the running coroutine until an engine job has completed.
+-- The job status can only be queried in the serial phase, so it's polled once
+-- per update.  The coroutine continues in the phase it was suspended in.
+-- @param job
+-- @param[opt] fn
+-- Called with the job in the serial phase, once it has completed.  Use it to
+-- retrieve the job results.
+-- @return
+-- Whatever `fn` returned.
+local function awaitJob(job, fn)
+    local wasInParallelPhase = not inSerialPhase
+    awaitSerialPhase()
+    while not engine.JobIsComplete(job) do
+        awaitQueueExecution(parallelQueue)
+        awaitQueueExecution(serialQueue)
+    end
+
+    local results = {true}
+    if fn then
+        results = {pcall(fn, job)}
+    end
+
+    if wasInParallelPhase then
+        awaitParallelPhase()
+    end
+
+    local success = results[1]
+    if success then
+        return table.unpack(results, 2)
+    else
+        local err = results[2]
+        error(err)
+    end
+end
+
 local function blindCall(fn, ...)
     if inSerialPhase then
         return fn(...)
@@ -72,8 +107,15 @@ local function blindCall(fn, ...)
     end
 end
 
-engine.SetCallback('serial', function()
+local messageHandler = nil
+
+engine.SetCallback('serial', function(messages)
     inSerialPhase = true
+    if messageHandler then
+        for _, message in ipairs(messages) do
+            messageHandler(table.unpack(message))
+        end
+    end
     serialQueue:execute()
 end)
 
@@ -91,7 +133,13 @@ local function run(coro)
     parallelQueue:enqueue(coro.call, coro)
 end
 
+local function setMessageHandler(fn)
+    messageHandler = fn
+end
+
 return {awaitCall = awaitCall,
+        awaitJob = awaitJob,
         blindCall = blindCall,
         createScheduledCoroutine = Coroutine,
-        _run = run}
+        _run = run,
+        _setMessageHandler = setMessageHandler}
@@ -1,5 +1,15 @@
 --- @classmod core.Vector
---- n-dimensional vectors!
+--- Vectors with up to 4 components.
+--
+-- Inside the engine vectors are native user data with up to 4 components.
+-- Creating a vector with more components, @{set}ting more or assigning
+-- `v[5]` raises an error there.
+-- They don't need a table per vector and their operators are implemented in
+-- C, so they produce much less garbage.  Use the in-place methods (like
+-- `v:addInPlace(other)`) in hot loops to avoid allocations altogether.
+--
+-- Without the engine (e.g. in unit tests) vectors are tables, which don't
+-- enforce the limit.  Don't rely on that.
 
 
 local setmetatable = setmetatable
@@ -10,6 +20,46 @@ local sqrt         = math.sqrt
 local unpack       = table.unpack
 
 
+local hasEngine, engine = pcall(require, 'engine')
+if hasEngine and engine.CreateVector then
+    local CreateVector = engine.CreateVector
+    local mt = getmetatable(CreateVector())
+
+    -- Methods are looked up in the metatable:
+    local NativeVector =
+    {
+        mt = mt,
+        prototype = mt
+    }
+
+    setmetatable(NativeVector, {
+        __call = function( _, ... )
+            return CreateVector(...)
+        end
+    })
+
+    function NativeVector:isInstance( v )
+        return getmetatable(v) == mt
+    end
+
+    function mt:operate( other, operationFn )
+        local r = CreateVector()
+        if getmetatable(other) == mt then
+            for i = 1, max(#self, #other) do
+                r[i] = operationFn(self[i], other[i])
+            end
+        else -- treat as single value
+            for i = 1, #self do
+                r[i] = operationFn(self[i], other)
+            end
+        end
+        return r
+    end
+
+    return NativeVector
+end
+
+
 local Vector =
 {
     mt = {},
@@ -99,13 +149,11 @@ end
 --
 -- `v:inverseLength() == 1/v:length()`
 --
+-- Until the native vectors were added, this returned the squared length
+-- instead.  Use `v:dot(v)` for that.
+--
 function Vector.prototype:inverseLength()
-    local result = 0
-    for i = 1, #self do
-        local component = self[i]
-        result = result + component*component
-    end
-    return result
+    return 1 / self:length()
 end
 
 --- Vector length.
@@ -115,7 +163,7 @@ end
 -- provides the vectors mathematical/geometrical length.
 --
 function Vector.prototype:length()
-    return sqrt(self:inverseLength())
+    return sqrt(self:dot(self))
 end
 
 --- Computes the unit vector.
@@ -208,6 +256,60 @@ function Vector.mt:__div( other )
     return self:operate(other, function(a,b) return a/b end)
 end
 
+--- Assign components or copy another vector.
+--
+-- Native vectors take at most 4 components.
+--
+-- @return self
+--
+function Vector.prototype:set( ... )
+    local source = ...
+    if not Vector:isInstance(source) then
+        source = {...}
+    end
+    for i = #self, 1, -1 do
+        rawset(self, i, nil)
+    end
+    for i = 1, #source do
+        rawset(self, i, source[i])
+    end
+    return self
+end
+
+function Vector.prototype:operateInPlace( other, operationFn )
+    return self:set(self:operate(other, operationFn))
+end
+
+--- Like `+`, but modifies this vector instead of creating a new one.
+-- @return self
+function Vector.prototype:addInPlace( other )
+    return self:operateInPlace(other, function(a,b) return a+b end)
+end
+
+--- Like `-`, but modifies this vector instead of creating a new one.
+-- @return self
+function Vector.prototype:subInPlace( other )
+    return self:operateInPlace(other, function(a,b) return a-b end)
+end
+
+--- Like `*`, but modifies this vector instead of creating a new one.
+-- @return self
+function Vector.prototype:mulInPlace( other )
+    return self:operateInPlace(other, function(a,b) return a*b end)
+end
+
+--- Like `/`, but modifies this vector instead of creating a new one.
+-- @return self
+function Vector.prototype:divInPlace( other )
+    return self:operateInPlace(other, function(a,b) return a/b end)
+end
+
+--- Like @{normalize}, but modifies this vector.
+-- @return self
+function Vector.prototype:normalizeInPlace()
+    return self:set(self:normalize())
+end
+
 -- Invert vector.
 function Vector.mt:__unm()
     local r = Vector()
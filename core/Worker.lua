@@ -0,0 +1,57 @@
+--- @module core.Worker
+--- Information about the Lua worker, which runs this script, and messages
+--- between workers.
+--
+-- Each worker has its own Lua state and runs in parallel to the other
+-- workers, so they can't share values.  Scenarios can partition their work
+-- (e.g. by region or by system) using @{Worker.index}.
+--
+-- Messages are delivered during the next serial phase of the receiver.  They
+-- arrive ordered by sender and - for each sender - in the order in which
+-- they were sent.
+--
+-- @usage
+-- Worker.setMessageHandler(function( sender, name, ... )
+--     print('Worker '..sender..' sent '..name)
+-- end)
+-- Worker.send(0, 'ready', Worker.index)
+
+
+local engine    = require 'engine'
+local Scheduler = require 'core/Scheduler'
+
+
+local Worker = {}
+
+--- Index of this worker, starting at zero.
+Worker.index = engine.GetLuaWorkerIndex()
+
+--- Number of workers.
+Worker.count = engine.GetLuaWorkerCount()
+
+--- Sends a message to another worker.
+--
+-- Values are copied, so they may only be `nil`, booleans, numbers, strings
+-- or tables thereof.  Only the sequence of a table is copied.
+--
+-- @param[type=number] receiver
+-- Index of the receiving worker.  May be @{Worker.index} too.
+--
+-- @param ...
+-- Message values.
+--
+function Worker.send( receiver, ... )
+    engine.SendLuaMessage(receiver, ...)
+end
+
+--- Sets the function which receives messages.
+--
+-- It is called with the index of the sending worker, followed by the message
+-- values.  Messages are dropped while no handler is set.
+--
+function Worker.setMessageHandler( handler )
+    Scheduler._setMessageHandler(handler)
+end
+
+
+return Worker
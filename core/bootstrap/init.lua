@@ -43,15 +43,11 @@ function dofile( fileName )
     error('dofile is not available in Konstrukt, you must use Lua modules instead.')
 end
 
-local ReadFile = engine.ReadFile.fn
-
-local function _loadfile( fileName, ... )
-    local data = ReadFile(fileName)
-    return load(data, '@'..fileName, ...)
-end
+-- Uses the bytecode cache of the engine:
+local LoadScript = engine.LoadScript.fn
 
 local function _dofile( fileName, ... )
-    local chunk = assert(_loadfile(fileName))
+    local chunk = assert(LoadScript(fileName))
     return chunk(...)
 end
 
@@ -63,6 +63,12 @@ Texture:include(Resource)
 --
 -- Defaults to **linear**.
 --
+-- @param[type=boolean] stream
+-- Upload 2d textures over multiple frames, instead of blocking the current one.
+-- The texture is refined from the smallest mipmap to the full resolution.
+--
+-- Defaults to **false**.
+--
 function Texture.static:_load( options )
     local texture = Texture(options)
     return { value=texture, destructor=texture.destroy }
@@ -77,12 +83,30 @@ Texture.static.defaultOptions =
     wrapMode = 'repeat',
     mipmap = true,
     colorSpace = 'linear',
-    multiplyRgbByAlpha = true
+    multiplyRgbByAlpha = true,
+    stream = false
 }
 
 function Texture:initialize( options )
     setmetatable(options, { __index=Texture.defaultOptions })
 
+    local flags = Texture:_createFlags(options)
+    if options.target == '2d' then
+        local image = Texture:_loadImage(options.fileName, options)
+        self.handle = Scheduler.awaitCall(engine.Create2dTexture, image.handle, table.unpack(flags))
+    elseif options.target == 'cube' then
+        local images = {}
+        for i,v in ipairs(cubeMapSides) do
+            local image = Texture:_loadImage(string.format(options.fileName, v), options)
+            images[i] = image.handle
+        end
+        self.handle = Scheduler.awaitCall(engine.CreateCubeTexture, images, table.unpack(flags))
+    else
+        error('Unknown type: '..options.target)
+    end
+end
+
+function Texture.static:_createFlags( options )
     local flags = {}
     if options.mipmap == true then
         table.insert(flags, 'mipmap')
@@ -98,23 +122,13 @@ function Texture:initialize( options )
     else
         assert(options.colorSpace == 'linear')
     end
-
-    if options.target == '2d' then
-        local image = self:_loadImage(options.fileName, options)
-        self.handle = Scheduler.awaitCall(engine.Create2dTexture, image.handle, table.unpack(flags))
-    elseif options.target == 'cube' then
-        local images = {}
-        for i,v in ipairs(cubeMapSides) do
-            local image = self:_loadImage(string.format(options.fileName, v), options)
-            images[i] = image.handle
-        end
-        self.handle = Scheduler.awaitCall(engine.CreateCubeTexture, images, table.unpack(flags))
-    else
-        error('Unknown type: '..options.target)
+    if options.stream == true then
+        table.insert(flags, 'stream')
     end
+    return flags
 end
 
-function Texture:_loadImage( fileName, options )
+function Texture.static:_loadImage( fileName, options )
     local image = Image:load(fileName)
     if options.multiplyRgbByAlpha then
         image:multiplyRgbByAlpha()
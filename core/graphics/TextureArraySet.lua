@@ -0,0 +1,77 @@
+--- @classmod core.graphics.TextureArraySet
+--- Packs images into as few texture arrays as possible.
+--
+-- Geometry selects its image using the layer index, which is stored in its
+-- vertices.  So voxel meshes with different images can share a material - and
+-- thus a single mesh and draw call per chunk.  Just pass the placement of the
+-- image as `texturePlacement` to the voxel mesh.
+--
+-- Images are grouped by channel count and their size rounded up to the next
+-- power of two.  Images which don't fill their layer must not repeat their
+-- texture coordinates.
+
+
+local engine    = require 'engine'
+local class     = require 'middleclass'
+local Scheduler = require 'core/Scheduler'
+local Texture   = require 'core/graphics/Texture'
+
+
+local TextureArraySet = class('core/graphics/TextureArraySet')
+
+---
+-- @param[type=table] fileNames
+-- Images which shall be packed.
+--
+-- @param[type=table] options
+-- Same as @{core.graphics.Texture}, except that `target` and `stream` are
+-- ignored.
+function TextureArraySet:initialize( fileNames, options )
+    options = setmetatable(options or {}, { __index=Texture.defaultOptions })
+
+    local images = {}
+    for i, fileName in ipairs(fileNames) do
+        images[i] = Texture:_loadImage(fileName, options).handle
+    end
+
+    local handles, placements =
+        Scheduler.awaitCall(engine.CreateTextureArrays,
+                            images,
+                            table.unpack(Texture:_createFlags(options)))
+
+    self.textures = {}
+    for i, handle in ipairs(handles) do
+        local texture = Texture:allocate()
+        texture.handle = handle
+        self.textures[i] = texture
+    end
+
+    self.placements = {}
+    for i, fileName in ipairs(fileNames) do
+        self.placements[fileName] = placements[i]
+    end
+end
+
+function TextureArraySet:destroy()
+    for _, texture in ipairs(self.textures) do
+        texture:destroy()
+    end
+    self.textures = nil
+    self.placements = nil
+end
+
+--- Texture array which contains the image.
+-- @return[type=core.graphics.Texture]
+function TextureArraySet:getTexture( fileName )
+    local placement = assert(self.placements[fileName], 'Unknown image.')
+    return self.textures[placement[1]]
+end
+
+--- Where the image is stored in its texture array.
+-- Can be passed to voxel meshes.
+function TextureArraySet:getPlacement( fileName )
+    return assert(self.placements[fileName], 'Unknown image.')
+end
+
+
+return TextureArraySet
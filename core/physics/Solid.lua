@@ -173,31 +173,23 @@ end
 -- @param[type=number] impulse
 -- @param[type=core.physics.Solid] other
 -- @param[type=core.Vector] contactPoint
-local function CollisionHandler( solidAHandle,
-                                 solidBHandle,
-                                 pointOnAX, pointOnAY, pointOnAZ,
-                                 pointOnBX, pointOnBY, pointOnBZ,
-                                 normalOnBX, normalOnBY, normalOnBZ,
-                                 impulse )
-
-    local pointOnA  = Vec(pointOnAX, pointOnAY, pointOnAZ)
-    local pointOnB  = Vec(pointOnBX, pointOnBY, pointOnBZ)
-    --local normalOnB = Vec(normalOnBX, normalOnBY, normalOnBZ)
-
-    local solidA = SolidHandlesToSolids[solidAHandle]
-    local solidB = SolidHandlesToSolids[solidBHandle]
+local function CollisionHandler( count, values )
+    -- values is a packed array.  Contacts of the same pair of solids are
+    -- accumulated, so points are averaged and impulses are summed up.
+    local solidA = SolidHandlesToSolids[values[1]]
+    local solidB = SolidHandlesToSolids[values[2]]
 
     assert(solidA and solidB)
 
-    print(string.format('%s and %s collide with %f N/s',
-                        solidAHandle,
-                        solidBHandle,
-                        impulse))
+    local pointOnA = Vec(values:unpack(3, 5)) / count
+    local pointOnB = Vec(values:unpack(9, 11)) / count
+    local impulse  = values[15]
 
-    solidA:fireEvent('collision', impulse, solidB, pointOnA, pointOnB )
-    solidB:fireEvent('collision', impulse, solidA, pointOnB, pointOnA )
+    -- The engine sends a separate event for the other solid:
+    solidA:fireEvent('collision', impulse, solidB, pointOnA, pointOnB)
 end
 Scheduler.blindCall(engine.SetEventCallback, 'Collision', CollisionHandler)
+Scheduler.blindCall(engine.SetEventPolicy, 'SolidCollision', 'accumulate', 2)
 
 
 return Solid
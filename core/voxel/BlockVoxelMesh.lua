@@ -58,7 +58,8 @@ function BlockVoxelMesh:_addToGenerator( generator )
         self.bitConditions,
         self.isTransparent,
         self.meshBuffers,
-        self.meshBufferTransformations)
+        self.meshBufferTransformations,
+        self.texturePlacement)
 end
 
 --- Define the geometry used for a cube side.
@@ -17,14 +17,18 @@ local VoxelMesh = class('core/voxel/VoxelMesh')
 -- `material`.
 -- Must contain the associated @{core.voxel.Voxel} class in the key
 -- `voxelClass`.
+-- May contain a placement of a @{core.graphics.TextureArraySet} in the key
+-- `texturePlacement`.  Voxel meshes of one material, which use different
+-- images of the same texture array, are then merged into one mesh.
 function VoxelMesh:initialize( t )
     assert(Object.isInstanceOf(t.material, Material),
            'Must be called with a material.')
     assert(Object.isSubclassOf(t.voxelClass, Voxel),
            'Must be called with a voxel class.')
-    self.material      = t.material
-    self.voxelClass    = t.voxelClass
-    self.bitConditions = {}
+    self.material         = t.material
+    self.voxelClass       = t.voxelClass
+    self.texturePlacement = t.texturePlacement
+    self.bitConditions    = {}
 
     assert(self.voxelClass.id, 'Voxel class has no id yet.  Forgot to register it?')
     self:addAttributeCondition('id', self.voxelClass.id)
@@ -97,7 +97,7 @@ void RemoveFromArray( Array<T>* array, int pos, int amount )
 
     T* dst = array->data + pos;
     T* src = array->data + pos + amount;
-    const size_t count = array->length - pos;
+    const size_t count = array->length - pos - amount;
     memmove(dst, src, count*sizeof(T));
     array->length -= amount;
 }
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <math.h> // tanf
 #include <string.h> // memset
 
 #include "Common.h"
@@ -11,12 +12,27 @@
 #include "Camera.h"
 
 
+static const uint32_t VIEW_UNIFORM                                    = CalcConstShaderVariableNameHash("View");
+static const uint32_t PROJECTION_UNIFORM                              = CalcConstShaderVariableNameHash("Projection");
+static const uint32_t INVERSE_PROJECTION_UNIFORM                      = CalcConstShaderVariableNameHash("InverseProjection");
+static const uint32_t INVERSE_TRANSPOSE_PROJECTION_UNIFORM            = CalcConstShaderVariableNameHash("InverseTransposeProjection");
+static const uint32_t MODEL_UNIFORM                                   = CalcConstShaderVariableNameHash("Model");
+static const uint32_t MODEL_VIEW_UNIFORM                              = CalcConstShaderVariableNameHash("ModelView");
+static const uint32_t MODEL_VIEW_PROJECTION_UNIFORM                   = CalcConstShaderVariableNameHash("ModelViewProjection");
+static const uint32_t INVERSE_MODEL_VIEW_UNIFORM                      = CalcConstShaderVariableNameHash("InverseModelView");
+static const uint32_t INVERSE_MODEL_VIEW_PROJECTION_UNIFORM           = CalcConstShaderVariableNameHash("InverseModelViewProjection");
+static const uint32_t INVERSE_TRANSPOSE_MODEL_VIEW_UNIFORM            = CalcConstShaderVariableNameHash("InverseTransposeModelView");
+static const uint32_t INVERSE_TRANSPOSE_MODEL_VIEW_PROJECTION_UNIFORM = CalcConstShaderVariableNameHash("InverseTransposeModelViewProjection");
+static const char* CAMERA_UNIFORM_BLOCK_NAME = "Camera";
+
+
 struct Camera
 {
     ReferenceCounter refCounter;
     ModelWorld* modelWorld;
     LightWorld* lightWorld;
     ShaderVariableSet* shaderVariableSet;
+    UniformBuffer* uniformBuffer;
     AttachmentTarget attachmentTarget;
     Mat4 modelTransformation;
     Mat4 viewTransformation;
@@ -47,6 +63,11 @@ Camera* CreateCamera( ModelWorld* modelWorld,
     if(camera->lightWorld)
         ReferenceLightWorld(lightWorld);
     camera->shaderVariableSet = CreateShaderVariableSet();
+    camera->uniformBuffer = CreateUniformBuffer(camera->shaderVariableSet);
+    ReferenceUniformBuffer(camera->uniformBuffer);
+    SetUniformBuffer(camera->shaderVariableSet,
+                     CAMERA_UNIFORM_BLOCK_NAME,
+                     camera->uniformBuffer);
     InitAttachmentTarget(&camera->attachmentTarget);
 
     camera->modelTransformation = Mat4Identity;
@@ -72,6 +93,7 @@ static void FreeCamera( Camera* camera )
         ReleaseLightWorld(camera->lightWorld);
     DestroyAttachmentTarget(&camera->attachmentTarget);
     FreeShaderVariableSet(camera->shaderVariableSet);
+    ReleaseUniformBuffer(camera->uniformBuffer);
     delete camera;
 }
 
@@ -188,20 +210,22 @@ static const Mat4 GetCameraModelTransformation( const Camera* camera )
 
 static void UpdateCameraShaderVariables( const Camera* camera )
 {
-    SetMat4Uniform(camera->shaderVariableSet,
-                   "View",
-                   camera->viewTransformation);
+    SetMat4UniformByHash(camera->shaderVariableSet,
+                         VIEW_UNIFORM,
+                         camera->viewTransformation);
 
     const Mat4* projection = &camera->projectionTransformation;
-    SetMat4Uniform(camera->shaderVariableSet,
-                   "Projection",
-                   *projection);
-    SetMat4Uniform(camera->shaderVariableSet,
-                   "InverseProjection",
-                   InverseMat4(*projection));
-    SetMat4Uniform(camera->shaderVariableSet,
-                   "InverseTransposeProjection",
-                   InverseMat4(TransposeMat4(*projection)));
+    SetMat4UniformByHash(camera->shaderVariableSet,
+                         PROJECTION_UNIFORM,
+                         *projection);
+    SetMat4UniformByHash(camera->shaderVariableSet,
+                         INVERSE_PROJECTION_UNIFORM,
+                         InverseMat4(*projection));
+    SetMat4UniformByHash(camera->shaderVariableSet,
+                         INVERSE_TRANSPOSE_PROJECTION_UNIFORM,
+                         InverseMat4(TransposeMat4(*projection)));
+
+    UpdateUniformBuffer(camera->uniformBuffer);
 }
 
 ShaderVariableSet* GetCameraShaderVariableSet( const Camera* camera )
@@ -214,37 +238,90 @@ LightWorld* GetCameraLightWorld( const Camera* camera )
     return camera->lightWorld;
 }
 
-void GenerateCameraModelShaderVariables( const Camera* camera,
-                                         ShaderVariableSet* variableSet,
-                                         const ShaderProgram* program,
-                                         Mat4 modelTransformation,
-                                         float modelRadius )
+void CalcCameraModelTransformations( const Camera* camera,
+                                     Mat4 modelTransformation,
+                                     Mat4* modelView,
+                                     Mat4* modelViewProjection )
 {
     const Mat4* projection = &camera->projectionTransformation;
     const Mat4* view       = &camera->viewTransformation;
     const Mat4  model      =
         MulMat4(GetCameraModelTransformation(camera), modelTransformation);
 
-    const Mat4 modelView = MulMat4(*view, model);
-    const Mat4 modelViewProjection = MulMat4(*projection, modelView);
+    *modelView = MulMat4(*view, model);
+    *modelViewProjection = MulMat4(*projection, *modelView);
+}
 
-    SetMat4Uniform(variableSet, "Model", modelTransformation); // TODO
-    SetMat4Uniform(variableSet, "ModelView", modelView);
-    SetMat4Uniform(variableSet, "ModelViewProjection", modelViewProjection);
+float CalcCameraProjectedSize( const Camera* camera,
+                               Mat4 modelTransformation,
+                               float modelRadius )
+{
+    const Mat4 modelView =
+        MulMat4(camera->viewTransformation,
+                MulMat4(GetCameraModelTransformation(camera),
+                        modelTransformation));
+
+    // Use the largest scale of the model view transformation:
+    float scale = 0;
+    REPEAT(3, i)
+    {
+        const Vec3 axis = {{MAT4_AT(modelView,i,0),
+                            MAT4_AT(modelView,i,1),
+                            MAT4_AT(modelView,i,2)}};
+        const float axisScale = Vec3Length(axis);
+        if(axisScale > scale)
+            scale = axisScale;
+    }
+    const float radius = modelRadius * scale;
 
-#define CALC_MAT4(NAME, CALCULATION) \
-    if(HasUniform(program, (NAME))) \
-        SetMat4Uniform(variableSet, (NAME), (CALCULATION));
+    switch(camera->projectionType)
+    {
+        case CAMERA_PERSPECTIVE_PROJECTION:
+        {
+            const Vec3 center = MulMat4ByVec3(modelView, Vec3Zero);
+            const float distance = Vec3Length(center);
+            if(distance <= radius)
+                return 1;
+            return radius / (distance * tanf(camera->fieldOfView * 0.5f));
+        }
+
+        case CAMERA_ORTHOGRAPHIC_PROJECTION:
+            return radius * 2.0f / camera->scale;
+    }
+    return 1;
+}
+
+void GenerateCameraModelShaderVariables( const Camera* camera,
+                                         ShaderVariableSet* variableSet,
+                                         ShaderVariableSet* lightVariableSet,
+                                         const ShaderProgram* program,
+                                         Mat4 modelTransformation,
+                                         float modelRadius )
+{
+    Mat4 modelView;
+    Mat4 modelViewProjection;
+    CalcCameraModelTransformations(camera,
+                                   modelTransformation,
+                                   &modelView,
+                                   &modelViewProjection);
+
+    SetMat4UniformByHash(variableSet, MODEL_UNIFORM, modelTransformation); // TODO
+    SetMat4UniformByHash(variableSet, MODEL_VIEW_UNIFORM, modelView);
+    SetMat4UniformByHash(variableSet, MODEL_VIEW_PROJECTION_UNIFORM, modelViewProjection);
+
+#define CALC_MAT4(NAME_HASH, CALCULATION) \
+    if(HasUniformByHash(program, (NAME_HASH))) \
+        SetMat4UniformByHash(variableSet, (NAME_HASH), (CALCULATION));
     // Same set, but inversed:
-    CALC_MAT4("InverseModelView",
+    CALC_MAT4(INVERSE_MODEL_VIEW_UNIFORM,
               InverseMat4(modelView));
-    CALC_MAT4("InverseModelViewProjection",
+    CALC_MAT4(INVERSE_MODEL_VIEW_PROJECTION_UNIFORM,
               InverseMat4(modelViewProjection));
 
     // Same set, but inversed and transposed:
-    CALC_MAT4("InverseTransposeModelView",
+    CALC_MAT4(INVERSE_TRANSPOSE_MODEL_VIEW_UNIFORM,
               InverseMat4(TransposeMat4(modelView)));
-    CALC_MAT4("InverseTransposeModelViewProjection",
+    CALC_MAT4(INVERSE_TRANSPOSE_MODEL_VIEW_PROJECTION_UNIFORM,
               InverseMat4(TransposeMat4(modelViewProjection)));
 #undef CALC_MAT4
 
@@ -252,12 +329,20 @@ void GenerateCameraModelShaderVariables( const Camera* camera,
     {
         const Vec3 position = MulMat4ByVec3(modelTransformation, Vec3Zero); // TODO
         GenerateLightShaderVariables(camera->lightWorld,
-                                     variableSet,
+                                     lightVariableSet,
                                      position,
                                      modelRadius);
     }
 }
 
+bool ProgramUsesInverseModelTransformations( const ShaderProgram* program )
+{
+    return HasUniformByHash(program, INVERSE_MODEL_VIEW_UNIFORM) ||
+           HasUniformByHash(program, INVERSE_MODEL_VIEW_PROJECTION_UNIFORM) ||
+           HasUniformByHash(program, INVERSE_TRANSPOSE_MODEL_VIEW_UNIFORM) ||
+           HasUniformByHash(program, INVERSE_TRANSPOSE_MODEL_VIEW_PROJECTION_UNIFORM);
+}
+
 void DrawCameraView( Camera* camera, ShaderProgramSet* set )
 {
     // TODO: Light world could be used by multiple cameras, so UpdateLights
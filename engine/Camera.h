@@ -38,14 +38,55 @@ void SetCameraProjectionType( Camera* camera, CameraProjectionType type );
 void SetCameraFieldOfView( Camera* camera, float fov );
 void SetCameraScale( Camera* camera, float scale );
 
+/**
+ * Contains the view and projection matrices.
+ *
+ * They're also provided to the uniform block `Camera`.  The buffer is
+ * updated once per frame by #DrawCameraView.
+ */
 ShaderVariableSet* GetCameraShaderVariableSet( const Camera* camera );
 LightWorld* GetCameraLightWorld( const Camera* camera );
+
+/**
+ * Calculates the model view and model view projection matrix for a model,
+ * which is seen through the camera.
+ */
+void CalcCameraModelTransformations( const Camera* camera,
+                                     Mat4 modelTransformation,
+                                     Mat4* modelView,
+                                     Mat4* modelViewProjection );
+/**
+ * Estimates which fraction of the viewport height is covered by a model.
+ *
+ * @param modelRadius
+ * Radius of the models bounding sphere, which is centered at its origin.
+ *
+ * @return
+ * One if the camera is inside the bounding sphere.
+ */
+float CalcCameraProjectedSize( const Camera* camera,
+                               Mat4 modelTransformation,
+                               float modelRadius );
+
+/**
+ * @param lightVariableSet
+ * Receives the lights which affect the model.  They're kept apart from the
+ * transformations, because instanced draws pass those per instance, but
+ * need to share the lights.
+ */
 void GenerateCameraModelShaderVariables( const Camera* camera,
                                          ShaderVariableSet* variableSet,
+                                         ShaderVariableSet* lightVariableSet,
                                          const ShaderProgram* program,
                                          Mat4 modelTransformation,
                                          float modelRadius );
 
+/**
+ * Whether the program reads model transformations, which are not part of
+ * #InstanceTransformation - like the inverse model view matrix.
+ */
+bool ProgramUsesInverseModelTransformations( const ShaderProgram* program );
+
 void DrawCameraView( Camera* camera, ShaderProgramSet* set );
 
 #endif
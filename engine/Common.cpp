@@ -9,6 +9,7 @@
 #include <stdarg.h>
 #include <assert.h>
 #include <tinycthread.h> // thrd_*
+#include <chrono> // std::chrono::steady_clock
 
 #include "Constants.h" // KONSTRUKT_STACKTRACE_ENABLED, KONSTRUKT_PROFILER_ENABLED
 #include "Warnings.h"
@@ -36,6 +37,7 @@ static void InitFatalErrorHandler();
 static void DestroyFatalErrorHandler();
 
 static thrd_t MainThread;
+static thread_local bool IsSerialPhaseDelegate = false;
 
 void InitCommon()
 {
@@ -51,7 +53,20 @@ void DestroyCommon()
 
 bool InSerialPhase()
 {
-    return thrd_equal(thrd_current(), MainThread) != 0;
+    return IsSerialPhaseDelegate ||
+           thrd_equal(thrd_current(), MainThread) != 0;
+}
+
+void BeginSerialPhaseDelegation()
+{
+    assert(!IsSerialPhaseDelegate);
+    IsSerialPhaseDelegate = true;
+}
+
+void EndSerialPhaseDelegation()
+{
+    assert(IsSerialPhaseDelegate);
+    IsSerialPhaseDelegate = false;
 }
 
 
@@ -485,3 +500,11 @@ static void FatalErrorSignalHandler(int sig)
     ClearArray(&FatalErrorHandlers);
     exit(EXIT_FAILURE);
 }
+
+double GetMonotonicTime()
+{
+    typedef std::chrono::duration<double> Seconds;
+    const std::chrono::steady_clock::duration time =
+        std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<Seconds>(time).count();
+}
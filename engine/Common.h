@@ -12,6 +12,15 @@ void DestroyCommon();
 
 bool InSerialPhase();
 
+/**
+ * Lets the calling thread act as part of the serial phase, while the main
+ * thread is blocked and waits for it.
+ *
+ * @see RunInRenderThread
+ */
+void BeginSerialPhaseDelegation();
+void EndSerialPhaseDelegation();
+
 
 // --- Memory allocation ---
 
@@ -130,6 +139,12 @@ typedef void (*FatalErrorHandlerFn)();
  */
 void OnFatalError(FatalErrorHandlerFn fn);
 
+/**
+ * Seconds since an arbitrary point in time.  Unlike the wall clock it never
+ * jumps, so it's suited for measuring durations - in any thread.
+ */
+double GetMonotonicTime();
+
 #define Ensure( test ) do { if(!(test)) FatalError("Expression failed: %s", #test); } while(0)
 
 #define REPEAT(N,I) for(int _n = (int)(N), I = 0; I < _n; I++)
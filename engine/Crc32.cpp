@@ -5,7 +5,6 @@
 
 
 //const uint32_t Crc32Poly = 0x04C11DB7;
-const uint32_t Crc32PolyRev = 0xEDB88320;
 static uint32_t Crc32Table[256];
 
 
@@ -15,7 +14,7 @@ void InitCrc32()
     Crc32Table[0] = 0;
     for(i = 128; i; i >>= 1)
     {
-        h = (h >> 1) ^ ((h & 1) ? Crc32PolyRev : 0);
+        h = (h >> 1) ^ ((h & 1) ? CRC32_POLY_REV : 0);
         // h is now Crc32Table[i]
         for(j = 0; j < 256; j += 2 * i)
             Crc32Table[i + j] = Crc32Table[j] ^ h;
@@ -36,7 +35,8 @@ void InitCrc32()
  */
 static uint32_t CalcCrc32( uint32_t crc, const char* buffer, int length )
 {
-    InitCrc32();
+    if(Crc32Table[255] == 0) // Table has not been initialized yet.
+        InitCrc32();
     crc ^= 0xFFFFFFFF;
     while(length--)
         crc = (crc >> 8) ^ Crc32Table[(crc ^ *buffer++) & 0xFF];
@@ -55,3 +55,8 @@ uint32_t CalcCrc32ForString( const char* string )
 {
     return CalcCrc32ForBuffer(string, strlen(string));
 }
+
+uint32_t ContinueCrc32( uint32_t crc, const void* buffer, int length )
+{
+    return CalcCrc32(crc, (const char*)buffer, length);
+}
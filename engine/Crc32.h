@@ -3,8 +3,49 @@
 
 #include <stdint.h>
 
+static const uint32_t CRC32_POLY_REV = 0xEDB88320;
+
+
 void InitCrc32();
 uint32_t CalcCrc32ForBuffer( const void* buffer, int length );
 uint32_t CalcCrc32ForString( const char* string );
 
+/**
+ * Continues a checksum with more data.
+ *
+ * `ContinueCrc32(CalcCrc32ForString("ab"), "cd", 2)` equals
+ * `CalcCrc32ForString("abcd")`.
+ */
+uint32_t ContinueCrc32( uint32_t crc, const void* buffer, int length );
+
+
+// --- Compile time evaluation ---
+
+constexpr uint32_t CalcConstCrc32TableEntry( uint32_t value, int bits )
+{
+    return bits == 0 ? value :
+        CalcConstCrc32TableEntry((value >> 1) ^ ((value & 1) ? CRC32_POLY_REV : 0),
+                                 bits-1);
+}
+
+constexpr uint32_t CalcConstCrc32( uint32_t crc, const char* string )
+{
+    return *string == '\0' ? crc :
+        CalcConstCrc32((crc >> 8) ^
+                       CalcConstCrc32TableEntry((crc ^ (unsigned char)*string) & 0xFF, 8),
+                       string+1);
+}
+
+/**
+ * Variant of #CalcCrc32ForString, which can be evaluated at compile time.
+ *
+ * Useful for hashing names which are known in advance:
+ *
+ *     static const uint32_t TIME_HASH = CalcConstCrc32ForString("Time");
+ */
+constexpr uint32_t CalcConstCrc32ForString( const char* string )
+{
+    return CalcConstCrc32(0xFFFFFFFF, string) ^ 0xFFFFFFFF;
+}
+
 #endif
@@ -0,0 +1,141 @@
+#include <assert.h>
+
+#include "Common.h"
+#include "Shader.h" // ShaderVariableSetsAreEqual
+#include "DrawList.h"
+
+
+static bool VariableSetsAreEqual( const ShaderVariableSet* a,
+                                  const ShaderVariableSet* b )
+{
+    if(a == b)
+        return true;
+    if(!a || !b)
+        return false;
+    return ShaderVariableSetsAreEqual(a, b);
+}
+
+/**
+ * Compares everything except the meshes.
+ */
+static bool DrawKeyStatesAreEqual( const DrawKey* a, const DrawKey* b )
+{
+    if(a->program      != b->program ||
+       a->overlayLevel != b->overlayLevel ||
+       a->instanced    != b->instanced ||
+       a->textureCount != b->textureCount)
+        return false;
+
+    // Texture bindings are sorted already:
+    REPEAT(a->textureCount, i)
+        if(a->textures[i] != b->textures[i])
+            return false;
+
+    return VariableSetsAreEqual(a->variableSet, b->variableSet) &&
+           VariableSetsAreEqual(a->lightVariableSet, b->lightVariableSet);
+}
+
+bool DrawKeysAreEqual( const DrawKey* a, const DrawKey* b )
+{
+    return a->mesh == b->mesh &&
+           a->lod == b->lod &&
+           DrawKeyStatesAreEqual(a, b);
+}
+
+/**
+ * The states - including the lights - must be equal, since only the
+ * transformations are passed per entry.
+ */
+static bool DrawKeysCanBeMultiDrawn( const DrawKey* a, const DrawKey* b )
+{
+    return a->multiDrawGroup != 0 &&
+           a->multiDrawGroup == b->multiDrawGroup &&
+           DrawKeyStatesAreEqual(a, b);
+}
+
+static void AddDrawCommand( DrawCommandList* commands,
+                            DrawCommandType type,
+                            int firstEntry,
+                            int entryCount )
+{
+    DrawCommand* command = AllocateAtEndOfArray(commands, 1);
+    command->type       = type;
+    command->firstEntry = firstEntry;
+    command->entryCount = entryCount;
+}
+
+void GenerateDrawCommands( DrawCommandList* commands,
+                           const DrawKey* keys,
+                           int keyCount,
+                           int maxInstanceCount )
+{
+    assert(maxInstanceCount >= 1);
+    ClearArray(commands);
+
+    int i = 0;
+    while(i < keyCount)
+    {
+        const DrawKey* key = &keys[i];
+        if(!key->instanced)
+        {
+            AddDrawCommand(commands, DRAW_COMMAND, i, 1);
+            i++;
+            continue;
+        }
+
+        int runLength = 1;
+        bool meshesDiffer = false;
+        while(i+runLength < keyCount && runLength < maxInstanceCount)
+        {
+            const DrawKey* other = &keys[i+runLength];
+            if(DrawKeysAreEqual(key, other))
+            {
+                runLength++;
+            }
+            else if(DrawKeysCanBeMultiDrawn(key, other))
+            {
+                runLength++;
+                meshesDiffer = true;
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        AddDrawCommand(commands,
+                       meshesDiffer ? DRAW_MULTI_COMMAND : DRAW_INSTANCED_COMMAND,
+                       i,
+                       runLength);
+        i += runLength;
+    }
+}
+
+int GenerateIndirectDrawCommands( IndirectDrawCommand* commands,
+                                  const MeshDrawRange* ranges,
+                                  int rangeCount )
+{
+    int commandCount = 0;
+    IndirectDrawCommand* command = NULL;
+    REPEAT(rangeCount, i)
+    {
+        const MeshDrawRange* range = &ranges[i];
+        if(command &&
+           command->firstIndex == (uint32_t)range->firstIndex &&
+           command->count      == (uint32_t)range->indexCount &&
+           command->baseVertex == range->baseVertex)
+        {
+            command->instanceCount++;
+            continue;
+        }
+
+        command = &commands[commandCount];
+        command->count         = range->indexCount;
+        command->instanceCount = 1;
+        command->firstIndex    = range->firstIndex;
+        command->baseVertex    = range->baseVertex;
+        command->baseInstance  = i;
+        commandCount++;
+    }
+    return commandCount;
+}
@@ -0,0 +1,166 @@
+#ifndef __KONSTRUKT_DRAW_LIST__
+#define __KONSTRUKT_DRAW_LIST__
+
+#include <stdint.h> // uint32_t, int32_t
+
+#include "Array.h"
+#include "Texture.h" // MAX_TEXTURE_UNITS
+
+
+struct Mesh;
+struct ShaderProgram;
+struct ShaderVariableSet;
+
+
+/**
+ * Describes the state which is needed to draw a single draw list entry.
+ *
+ * Draw list entries are merged into one instanced draw command, if their
+ * keys are equal and their program supports instancing.
+ */
+struct DrawKey
+{
+    const ShaderProgram* program;
+    const Mesh* mesh;
+
+    /**
+     * Detail level of the mesh.  Entries which use different levels of
+     * the same mesh can't be instanced, but may be multi drawn.
+     */
+    int lod;
+
+    int textureCount;
+    const Texture* textures[MAX_TEXTURE_UNITS];
+    int overlayLevel;
+
+    /**
+     * Variables which are specific to the entry.
+     * Entries can only be merged if these are equal.
+     *
+     * May be `NULL`.
+     */
+    const ShaderVariableSet* variableSet;
+
+    /**
+     * Lights which affect the entry.  They depend on its position, so
+     * entries can only be merged if they're lit by the same lights.
+     *
+     * May be `NULL`.
+     */
+    const ShaderVariableSet* lightVariableSet;
+
+    /**
+     * Whether the program reads its transformations from the instance
+     * buffer.
+     *
+     * @see ShaderProgramSupportsInstancing
+     */
+    bool instanced;
+
+    /**
+     * Instanced entries whose meshes are in the same non zero group can be
+     * drawn with one #DRAW_MULTI_COMMAND, even if their meshes differ.
+     *
+     * @see GetMeshMultiDrawGroup
+     */
+    int multiDrawGroup;
+};
+
+enum DrawCommandType
+{
+    /**
+     * Draws a single entry using the regular uniform path.
+     */
+    DRAW_COMMAND,
+
+    /**
+     * Draws `entryCount` entries at once.  The per instance transformations
+     * are passed in the instance buffer.
+     */
+    DRAW_INSTANCED_COMMAND,
+
+    /**
+     * Like #DRAW_INSTANCED_COMMAND, but the entries may use different meshes
+     * of the same multi draw group.  They are drawn using one indirect
+     * multi draw call.
+     *
+     * @see GenerateIndirectDrawCommands
+     */
+    DRAW_MULTI_COMMAND
+};
+
+struct DrawCommand
+{
+    DrawCommandType type;
+    int firstEntry;
+    int entryCount;
+};
+
+typedef Array<DrawCommand> DrawCommandList;
+
+/**
+ * Part of the shared index and vertex buffers, which is used by a mesh.
+ */
+struct MeshDrawRange
+{
+    int firstIndex;
+    int indexCount;
+    int baseVertex;
+};
+
+/**
+ * Layout matches the commands which are read by
+ * `glMultiDrawElementsIndirect`.
+ */
+struct IndirectDrawCommand
+{
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t baseInstance;
+};
+
+
+/**
+ * Compares the state of two draw keys.
+ *
+ * @return
+ * `true` if both entries could be rendered with the same draw call.
+ */
+bool DrawKeysAreEqual( const DrawKey* a, const DrawKey* b );
+
+/**
+ * Generates the commands which are needed to render a sorted draw list.
+ *
+ * Runs of equal instanced keys are merged into #DRAW_INSTANCED_COMMAND
+ * commands.  Runs which only differ in meshes of the same multi draw group
+ * are merged into #DRAW_MULTI_COMMAND commands.  Each of these contains at
+ * most `maxInstanceCount` entries.
+ *
+ * The previous contents of `commands` are discarded.
+ */
+void GenerateDrawCommands( DrawCommandList* commands,
+                           const DrawKey* keys,
+                           int keyCount,
+                           int maxInstanceCount );
+
+/**
+ * Generates the indirect draw commands for the entries of a
+ * #DRAW_MULTI_COMMAND.
+ *
+ * Consecutive entries which use the same range become one command with
+ * multiple instances.  The instance index of entry `i` is always `i`, so the
+ * per entry data can be stored in the instance buffer.
+ *
+ * @param commands
+ * Must provide space for `rangeCount` commands.
+ *
+ * @return
+ * Number of generated commands.
+ */
+int GenerateIndirectDrawCommands( IndirectDrawCommand* commands,
+                                  const MeshDrawRange* ranges,
+                                  int rangeCount );
+
+#endif
@@ -11,7 +11,7 @@
     #include <dirent.h> // opendir, readdir, closedir
 #endif
 
-#include <stdio.h> // remove
+#include <stdio.h> // remove, rename
 #include <string.h> // strerror
 #include <errno.h>
 
@@ -183,6 +183,23 @@ void RemoveFile( const char* path )
         FatalError("Can't remove '%s': %s", path, strerror(errno));
 }
 
+void RenameFile( const char* oldPath, const char* newPath )
+{
+#if defined(_WIN32)
+    if(!MoveFileExA(oldPath, newPath, MOVEFILE_REPLACE_EXISTING))
+    {
+        FatalError("Can't rename '%s' to '%s': %s",
+                   oldPath, newPath, GetLastErrorAsString());
+    }
+#else
+    if(rename(oldPath, newPath) != 0)
+    {
+        FatalError("Can't rename '%s' to '%s': %s",
+                   oldPath, newPath, strerror(errno));
+    }
+#endif
+}
+
 void RemoveDirectoryTree( const char* path )
 {
     switch(GetFileType(path))
@@ -57,6 +57,11 @@ void DestroyPathList( PathList* list );
  */
 void RemoveFile( const char* path );
 
+/**
+ * Moves a file to a new path, replacing files which exist there.
+ */
+void RenameFile( const char* oldPath, const char* newPath );
+
 /**
  * Deletes files and directories recursively.
  *
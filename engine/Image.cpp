@@ -136,7 +136,9 @@ static void MultiplyImageRgbByAlpha( Image* image )
 
 static Image* CreateResizedImage( const Image* input,
                                   int width,
-                                  int height )
+                                  int height,
+                                  stbir_filter filter,
+                                  stbir_colorspace colorSpace )
 {
     assert(input->type == GL_UNSIGNED_BYTE);
 
@@ -176,8 +178,8 @@ static Image* CreateResizedImage( const Image* input,
                                    outputPixels, output->width, output->height, 0,
                                    channelCount, alphaChannel, flags,
                                    STBIR_EDGE_CLAMP,
-                                   STBIR_FILTER_DEFAULT,
-                                   STBIR_COLORSPACE_LINEAR,
+                                   filter,
+                                   colorSpace,
                                    NULL))
         FatalError("Failed to resize image.");
 
@@ -245,7 +247,9 @@ static void ProcessImageCreationJob( void* _desc )
         case RESIZE_IMAGE_JOB:
             desc->result = CreateResizedImage(desc->params.resizeImage.input,
                                               desc->params.resizeImage.width,
-                                              desc->params.resizeImage.height);
+                                              desc->params.resizeImage.height,
+                                              STBIR_FILTER_DEFAULT,
+                                              STBIR_COLORSPACE_LINEAR);
             break;
     }
     ReferenceImage(desc->result);
@@ -311,6 +315,93 @@ JobId MultiplyImageRgbByAlpha_( Image* image )
 
 // ---------------------------------------------------------------------------
 
+struct MipmapCreationJobDesc
+{
+    Image* levels[MAX_MIPMAP_LEVELS]; // Level 0 is the input image.
+    int levelCount;
+    bool srgb;
+};
+
+static void DestroyMipmapCreationJob( void* _desc )
+{
+    MipmapCreationJobDesc* desc = (MipmapCreationJobDesc*)_desc;
+    REPEAT(desc->levelCount, i)
+        if(desc->levels[i])
+            ReleaseImage(desc->levels[i]);
+    DELETE(desc);
+}
+
+static void ProcessMipmapCreationJob( void* _desc )
+{
+    MipmapCreationJobDesc* desc = (MipmapCreationJobDesc*)_desc;
+    const stbir_colorspace colorSpace = desc->srgb ? STBIR_COLORSPACE_SRGB
+                                                   : STBIR_COLORSPACE_LINEAR;
+    // Each level is created from the previous one, which is cheaper than
+    // filtering the full image again and again:
+    for(int i = 1; i < desc->levelCount; i++)
+    {
+        const Image* previous = desc->levels[i-1];
+        Image* level = CreateResizedImage(previous,
+                                          GetMipmapSize(previous->width),
+                                          GetMipmapSize(previous->height),
+                                          STBIR_FILTER_BOX,
+                                          colorSpace);
+        ReferenceImage(level);
+        desc->levels[i] = level;
+    }
+}
+
+int GetMipmapSize( int size )
+{
+    return (size > 1) ? size/2 : 1;
+}
+
+int CalcMipmapCount( int width, int height )
+{
+    int count = 1;
+    while(width > 1 || height > 1)
+    {
+        width  = GetMipmapSize(width);
+        height = GetMipmapSize(height);
+        count++;
+    }
+    return count;
+}
+
+JobId BeginCreatingMipmaps( Image* image, bool srgb )
+{
+    MipmapCreationJobDesc* desc = NEW(MipmapCreationJobDesc);
+    memset(desc->levels, 0, sizeof(desc->levels));
+    desc->levelCount = CalcMipmapCount(image->width, image->height);
+    desc->srgb = srgb;
+    if(desc->levelCount > MAX_MIPMAP_LEVELS)
+        FatalError("Image is too large for mipmapping: %dx%d",
+                   image->width, image->height);
+    desc->levels[0] = image;
+    ReferenceImage(image); // released in DestroyMipmapCreationJob
+    return CreateJob({"CreateMipmaps",
+                      ProcessMipmapCreationJob,
+                      DestroyMipmapCreationJob,
+                      desc});
+}
+
+int GetCreatedMipmapCount( JobId job )
+{
+    Ensure(GetJobStatus(job) == COMPLETED_JOB);
+    const MipmapCreationJobDesc* desc = (const MipmapCreationJobDesc*)GetJobData(job);
+    return desc->levelCount;
+}
+
+Image* GetCreatedMipmap( JobId job, int level )
+{
+    Ensure(GetJobStatus(job) == COMPLETED_JOB);
+    MipmapCreationJobDesc* desc = (MipmapCreationJobDesc*)GetJobData(job);
+    Ensure(level >= 0 && level < desc->levelCount);
+    return desc->levels[level];
+}
+
+// ---------------------------------------------------------------------------
+
 int GetImageWidth( const Image* image )
 {
     return image->width;
@@ -29,6 +29,42 @@ JobId BeginResizingImage( Image* input, int width, int height );
 
 Image* GetCreatedImage( JobId job );
 
+static const int MAX_MIPMAP_LEVELS = 16;
+
+/**
+ * Starts a job which creates the mipmaps of the given image.
+ *
+ * Each level has half the size of the previous one, till a size of 1x1 is
+ * reached.  The levels are box filtered.  Color channels of sRGB images are
+ * filtered in linear space.
+ *
+ * Note that the image *mustn't* be modified while the job runs!
+ *
+ * Once the job is completed the levels can be retrieved using
+ * #GetCreatedMipmap.
+ */
+JobId BeginCreatingMipmaps( Image* image, bool srgb );
+
+/**
+ * Number of levels, including the original image.
+ */
+int GetCreatedMipmapCount( JobId job );
+
+/**
+ * Level 0 is the original image.
+ */
+Image* GetCreatedMipmap( JobId job, int level );
+
+/**
+ * Size of the next mipmap level - but at least 1.
+ */
+int GetMipmapSize( int size );
+
+/**
+ * Number of mipmap levels, which is needed for an image of the given size.
+ */
+int CalcMipmapCount( int width, int height );
+
 /**
  * The RGB channels will be multiplied by the alpha channel.
  *
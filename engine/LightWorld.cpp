@@ -1,16 +1,47 @@
 #include <assert.h>
+#include <math.h> // floorf, sqrtf
 #include <string.h> // memset, strcmp
 #include <stdlib.h> // qsort
 
 #include "Common.h"
 #include "Profiler.h"
 #include "Reference.h"
+#include "Array.h"
 #include "AttachmentTarget.h"
 #include "Shader.h"
 #include "LightWorld.h"
 
 
-static const int MAX_LIGHTS = 32;
+static const int MAX_LIGHTS = 1024;
+
+/**
+ * Edge length of the light grid cells.
+ */
+static const float LIGHT_GRID_CELL_SIZE = 16;
+
+/**
+ * Number of hash buckets, which the grid cells are mapped to.
+ * Must be a power of two.
+ */
+static const int LIGHT_GRID_BUCKET_COUNT = 1024;
+
+/**
+ * Lights which would cover more cells, are treated like global lights.
+ */
+static const int MAX_LIGHT_GRID_CELLS_PER_LIGHT = 64;
+
+/**
+ * Objects which would cover more cells, consider all lights of the grid.
+ */
+static const int MAX_LIGHT_GRID_CELLS_PER_OBJECT = 64;
+
+/**
+ * Point lights are only assigned to the cells in which they provide at
+ * least this illuminance.
+ */
+static const float MIN_LIGHT_ILLUMINANCE = 0.01f;
+
+static const char* LIGHT_WORLD_UNIFORM_BLOCK_NAME = "LightWorld";
 
 
 struct Light
@@ -27,14 +58,49 @@ struct Light
     float range;
 };
 
+struct LightGridRegion
+{
+    int min[3];
+    int max[3];
+};
+
+/**
+ * Maps cells of a uniform grid to the lights, which illuminate them.
+ *
+ * The grid is unbounded, so cells are hashed into a fixed number of buckets.
+ * A bucket may contain lights of multiple cells, thus bucket entries are
+ * just candidates which still need to be checked.
+ *
+ * It's rebuilt by #UpdateLights using a counting sort, which reuses the
+ * memory of previous frames.
+ */
+struct LightGrid
+{
+    /**
+     * Bucket `i` uses the entries from `bucketStart[i]` up to
+     * `bucketStart[i+1]` in #bucketLights.
+     */
+    int bucketStart[LIGHT_GRID_BUCKET_COUNT+1];
+    int bucketFill[LIGHT_GRID_BUCKET_COUNT];
+    Array<const Light*> bucketLights;
+
+    /**
+     * Global lights and point lights, which are too large for the grid.
+     * These are considered for every object.
+     */
+    Array<const Light*> unboundLights;
+};
+
 struct LightWorld
 {
     ReferenceCounter refCounter;
-    char lightCountUniformName[MAX_UNIFORM_NAME_SIZE];
-    char lightPositionName[MAX_UNIFORM_NAME_SIZE];
+    uint32_t lightCountUniformNameHash;
+    UniformArrayName lightPositionName;
     int maxActiveLightCount;
     Light lights[MAX_LIGHTS];
+    LightGrid grid;
     ShaderVariableSet* shaderVariableSet;
+    UniformBuffer* uniformBuffer;
     ShaderVariableSet* unusedLightShaderVariableSet;
 };
 
@@ -56,13 +122,19 @@ LightWorld* CreateLightWorld( const char* lightCountUniformName,
     LightWorld* world = new LightWorld;
     memset(world, 0, sizeof(LightWorld));
     InitReferenceCounter(&world->refCounter);
-    CopyString(lightCountUniformName,
-               world->lightCountUniformName,
-               sizeof(world->lightCountUniformName));
-    CopyString(lightPositionName,
-               world->lightPositionName,
-               sizeof(world->lightPositionName));
+    world->lightCountUniformNameHash =
+        CalcShaderVariableNameHash(lightCountUniformName);
+    InitUniformArrayName(&world->lightPositionName,
+                         lightPositionName,
+                         MAX_ACTIVE_LIGHTS);
+    InitArray(&world->grid.bucketLights);
+    InitArray(&world->grid.unboundLights);
     world->shaderVariableSet = CreateShaderVariableSet();
+    world->uniformBuffer = CreateUniformBuffer(world->shaderVariableSet);
+    ReferenceUniformBuffer(world->uniformBuffer);
+    SetUniformBuffer(world->shaderVariableSet,
+                     LIGHT_WORLD_UNIFORM_BLOCK_NAME,
+                     world->uniformBuffer);
     world->unusedLightShaderVariableSet = CreateShaderVariableSet();
     return world;
 }
@@ -82,7 +154,10 @@ static void FreeLightWorld( LightWorld* world )
         }
     }
     FreeShaderVariableSet(world->shaderVariableSet);
+    ReleaseUniformBuffer(world->uniformBuffer);
     FreeShaderVariableSet(world->unusedLightShaderVariableSet);
+    DestroyArray(&world->grid.bucketLights);
+    DestroyArray(&world->grid.unboundLights);
     delete world;
 }
 
@@ -101,6 +176,9 @@ void ReleaseLightWorld( LightWorld* world )
 void SetMaxActiveLightCount( LightWorld* world, int count )
 {
     assert(InSerialPhase());
+    if(count < 0 || count > MAX_ACTIVE_LIGHTS)
+        FatalError("Active light count must be between 0 and %d.",
+                   MAX_ACTIVE_LIGHTS);
     world->maxActiveLightCount = count;
 }
 
@@ -111,6 +189,156 @@ static Mat4 CalculateLightTransformation( const Light* light )
     return MulMat4(t, light->transformation);
 }
 
+/**
+ * Grid coordinates beyond this are never used, since no region this far out
+ * could be small enough anyway.  Keeps the coordinates and their
+ * differences well inside the `int` range.
+ */
+static const float MAX_LIGHT_GRID_COORDINATE = 1 << 24;
+
+/**
+ * @param maxCellCount
+ * Regions which would cover more cells are rejected.  The limit is
+ * checked per axis before the extents are multiplied, so the cell count
+ * can't overflow.
+ *
+ * @return
+ * `false` if the region would be larger than `maxCellCount` or if position
+ * or radius aren't finite.  `region` is undefined in that case.
+ */
+static bool CalcLightGridRegion( Vec3 position,
+                                 float radius,
+                                 int maxCellCount,
+                                 LightGridRegion* region )
+{
+    int cellCount = 1;
+    REPEAT(3, i)
+    {
+        const float min = floorf((position._[i] - radius) / LIGHT_GRID_CELL_SIZE);
+        const float max = floorf((position._[i] + radius) / LIGHT_GRID_CELL_SIZE);
+
+        // Written so that NaNs fail the test:
+        if(!(min >= -MAX_LIGHT_GRID_COORDINATE &&
+             max <=  MAX_LIGHT_GRID_COORDINATE &&
+             min <= max))
+            return false;
+
+        region->min[i] = (int)min;
+        region->max[i] = (int)max;
+
+        const int extent = region->max[i] - region->min[i] + 1;
+        if(extent > maxCellCount)
+            return false;
+        cellCount *= extent; // At most maxCellCount^2, so it can't overflow.
+        if(cellCount > maxCellCount)
+            return false;
+    }
+    return true;
+}
+
+static int GetLightGridBucket( int x, int y, int z )
+{
+    const unsigned int hash = ((unsigned int)x * 73856093u) ^
+                              ((unsigned int)y * 19349663u) ^
+                              ((unsigned int)z * 83492791u);
+    return (int)(hash & (LIGHT_GRID_BUCKET_COUNT-1));
+}
+
+#define FOR_EACH_LIGHT_GRID_CELL(region, x, y, z) \
+    for(int z = (region)->min[2]; z <= (region)->max[2]; z++) \
+    for(int y = (region)->min[1]; y <= (region)->max[1]; y++) \
+    for(int x = (region)->min[0]; x <= (region)->max[0]; x++)
+
+/**
+ * Distance at which a point light provides less than
+ * #MIN_LIGHT_ILLUMINANCE.
+ *
+ * @see CalcLightIlluminance
+ */
+static float CalcLightInfluenceRadius( const Light* light )
+{
+    assert(light->type == POINT_LIGHT);
+    return light->range + sqrtf(light->value / (4 * PI * MIN_LIGHT_ILLUMINANCE));
+}
+
+/**
+ * @return
+ * `false` if the light needs to be treated as unbound light.  That's the
+ * case for very bright lights, whose influence radius would cover too many
+ * cells, and for lights with a non-finite position, value or range.
+ */
+static bool GetLightGridRegionOfLight( const Light* light,
+                                       LightGridRegion* region )
+{
+    if(light->type != POINT_LIGHT)
+        return false;
+    return CalcLightGridRegion(light->position,
+                               CalcLightInfluenceRadius(light),
+                               MAX_LIGHT_GRID_CELLS_PER_LIGHT,
+                               region);
+}
+
+static void UpdateLightGrid( LightWorld* world )
+{
+    LightGrid* grid = &world->grid;
+    memset(grid->bucketFill, 0, sizeof(grid->bucketFill));
+    ClearArray(&grid->unboundLights);
+
+    // Count bucket entries:
+    REPEAT(MAX_LIGHTS, i)
+    {
+        const Light* light = &world->lights[i];
+        if(!light->active || light->value <= 0)
+            continue;
+
+        LightGridRegion region;
+        if(GetLightGridRegionOfLight(light, &region))
+        {
+            FOR_EACH_LIGHT_GRID_CELL(&region, x, y, z)
+                grid->bucketFill[GetLightGridBucket(x, y, z)]++;
+        }
+        else
+        {
+            AppendToArray(&grid->unboundLights, 1, &light);
+        }
+    }
+
+    // Calculate bucket offsets:
+    int entryCount = 0;
+    REPEAT(LIGHT_GRID_BUCKET_COUNT, i)
+    {
+        grid->bucketStart[i] = entryCount;
+        entryCount += grid->bucketFill[i];
+        grid->bucketFill[i] = 0;
+    }
+    grid->bucketStart[LIGHT_GRID_BUCKET_COUNT] = entryCount;
+
+    ClearArray(&grid->bucketLights);
+    const Light** entries = AllocateAtEndOfArray(&grid->bucketLights,
+                                                 entryCount);
+
+    // Fill buckets:
+    REPEAT(MAX_LIGHTS, i)
+    {
+        const Light* light = &world->lights[i];
+        if(!light->active || light->value <= 0)
+            continue;
+
+        LightGridRegion region;
+        if(GetLightGridRegionOfLight(light, &region))
+        {
+            FOR_EACH_LIGHT_GRID_CELL(&region, x, y, z)
+            {
+                const int bucket = GetLightGridBucket(x, y, z);
+                const int entry = grid->bucketStart[bucket] +
+                                  grid->bucketFill[bucket];
+                entries[entry] = light;
+                grid->bucketFill[bucket]++;
+            }
+        }
+    }
+}
+
 void UpdateLights( LightWorld* world )
 {
     ProfileFunction();
@@ -124,6 +352,8 @@ void UpdateLights( LightWorld* world )
 
         light->position = MulMat4ByVec3(transformation, Vec3Zero);
     }
+    UpdateLightGrid(world);
+    UpdateUniformBuffer(world->uniformBuffer);
 }
 
 ShaderVariableSet* GetLightWorldShaderVariableSet( const LightWorld* world )
@@ -161,77 +391,121 @@ static float CalcLightIlluminance( const Light* light,
     return 0;
 }
 
+/**
+ * Inserts the light into the list of active lights, which is sorted by
+ * descending illuminance.  The least important light is dropped, if the
+ * list is full already.
+ */
+static void ConsiderLight( ActiveLight* activeLights,
+                           int* count,
+                           int maxCount,
+                           const Light* light,
+                           Vec3 objectPosition,
+                           float objectRadius )
+{
+    // Lights may be stored in multiple buckets:
+    REPEAT(*count, i)
+        if(activeLights[i].light == light)
+            return;
+
+    const float illuminance = CalcLightIlluminance(light,
+                                                   objectPosition,
+                                                   objectRadius);
+    // Ignore lights which doesn't illuminate the object:
+    if(illuminance <= 0)
+        return;
+
+    int i = *count;
+    if(*count < maxCount)
+    {
+        (*count)++;
+    }
+    else
+    {
+        if(maxCount == 0 ||
+           illuminance <= activeLights[maxCount-1].illuminance)
+            return;
+        i = maxCount-1;
+    }
+
+    for(; i > 0 && activeLights[i-1].illuminance < illuminance; i--)
+        activeLights[i] = activeLights[i-1];
+    activeLights[i].light = light;
+    activeLights[i].illuminance = illuminance;
+}
+
+static void ConsiderLights( ActiveLight* activeLights,
+                            int* count,
+                            int maxCount,
+                            const Light* const* lights,
+                            int lightCount,
+                            Vec3 objectPosition,
+                            float objectRadius )
+{
+    REPEAT(lightCount, i)
+        ConsiderLight(activeLights, count, maxCount,
+                      lights[i], objectPosition, objectRadius);
+}
+
 void GenerateLightShaderVariables( const LightWorld* world,
                                    ShaderVariableSet* variableSet,
                                    Vec3 objectPosition,
                                    float objectRadius )
 {
+    const LightGrid* grid = &world->grid;
     const int maxCount = world->maxActiveLightCount;
     int count = 0;
-    ActiveLight* activeLights = new ActiveLight[maxCount];
-
-    ActiveLight* leastImportantActiveLight = NULL;
+    ActiveLight activeLights[MAX_ACTIVE_LIGHTS];
 
     // Populate activeLights:
-    REPEAT(MAX_LIGHTS, i)
+    ConsiderLights(activeLights, &count, maxCount,
+                   grid->unboundLights.data,
+                   grid->unboundLights.length,
+                   objectPosition,
+                   objectRadius);
+
+    LightGridRegion region;
+    if(CalcLightGridRegion(objectPosition,
+                           objectRadius,
+                           MAX_LIGHT_GRID_CELLS_PER_OBJECT,
+                           &region))
     {
-        const Light* light = &world->lights[i];
-        if(!light->active)
-            continue;
-
-        float illuminance = CalcLightIlluminance(light,
-                                                 objectPosition,
-                                                 objectRadius);
-        // Ignore lights which doesn't illuminate the object:
-        if(illuminance > 0)
+        FOR_EACH_LIGHT_GRID_CELL(&region, x, y, z)
         {
-            // Fill activeLights array:
-            if(count < maxCount)
-            {
-                activeLights[count].light = light;
-                activeLights[count].illuminance = illuminance;
-                if(!leastImportantActiveLight ||
-                   leastImportantActiveLight->illuminance < illuminance)
-                {
-                    leastImportantActiveLight = &activeLights[count];
-                }
-                count++;
-            }
-            // When activeLights is full and current light has a higher
-            // illuminance: Replace active light with lowest illuminance!
-            else if(illuminance > leastImportantActiveLight->illuminance)
-            {
-                leastImportantActiveLight->light = light;
-                leastImportantActiveLight->illuminance = illuminance;
-
-                // Find active light with lowest illuminance:
-                leastImportantActiveLight = &activeLights[0];
-                for(int j = 1; j < maxCount; j++)
-                {
-                    if(activeLights[j].illuminance <
-                       leastImportantActiveLight->illuminance)
-                    {
-                        leastImportantActiveLight = &activeLights[j];
-                    }
-                }
-            }
+            const int bucket = GetLightGridBucket(x, y, z);
+            const int start = grid->bucketStart[bucket];
+            const int end   = grid->bucketStart[bucket+1];
+            ConsiderLights(activeLights, &count, maxCount,
+                           &grid->bucketLights.data[start],
+                           end - start,
+                           objectPosition,
+                           objectRadius);
         }
     }
+    else
+    {
+        ConsiderLights(activeLights, &count, maxCount,
+                       grid->bucketLights.data,
+                       grid->bucketLights.length,
+                       objectPosition,
+                       objectRadius);
+    }
 
 
     // Upload lights to shader program:
-    SetIntUniform(variableSet, world->lightCountUniformName, count);
+    SetIntUniformByHash(variableSet, world->lightCountUniformNameHash, count);
     REPEAT(count, i)
     {
         const Light* light = activeLights[i].light;
 
         // Position:
-        const char* positionName = Format("%s[%d]", world->lightPositionName, i);
+        const uint32_t positionNameHash =
+            world->lightPositionName.elementNameHashes[i];
 
         if(light->type == GLOBAL_LIGHT)
-            SetUnusedShaderVariable(variableSet, positionName);
+            SetUnusedShaderVariableByHash(variableSet, positionNameHash);
         else
-            SetVec3Uniform(variableSet, positionName, light->position);
+            SetVec3UniformByHash(variableSet, positionNameHash, light->position);
 
         // Other uniforms:
         CopyShaderVariablesAsArrayElements(variableSet, light->shaderVariableSet, i);
@@ -241,8 +515,6 @@ void GenerateLightShaderVariables( const LightWorld* world,
         // Use the 'unused light' variable set for ... well ... unused lights:
         CopyShaderVariablesAsArrayElements(variableSet, world->unusedLightShaderVariableSet, i);
     }
-
-    delete[] activeLights;
 }
 
 static Light* FindInactiveLight( LightWorld* world )
@@ -9,6 +9,14 @@ struct AttachmentTarget;
 struct ShaderVariableSet;
 
 
+/**
+ * Maximum number of lights, which can illuminate a single model.
+ *
+ * @see SetMaxActiveLightCount
+ */
+static const int MAX_ACTIVE_LIGHTS = 32;
+
+
 enum LightType
 {
     /**
@@ -52,9 +60,30 @@ void ReferenceLightWorld( LightWorld* world );
 void ReleaseLightWorld( LightWorld* world );
 
 void SetMaxActiveLightCount( LightWorld* world, int max );
+
+/**
+ * Updates the light positions and assigns lights to the cells of a spatial
+ * grid, which is used by #GenerateLightShaderVariables.
+ *
+ * Must be called once per frame before generating light variables.
+ */
 void UpdateLights( LightWorld* world );
+
+/**
+ * Variables which are shared by all models.
+ *
+ * They're also provided to the uniform block `LightWorld`.  The buffer is
+ * updated once per frame by #UpdateLights.
+ */
 ShaderVariableSet* GetLightWorldShaderVariableSet( const LightWorld* world );
 ShaderVariableSet* GetLightWorldUnusedLightShaderVariableSet( const LightWorld* world );
+
+/**
+ * Selects the lights which illuminate the given object the most.
+ *
+ * Only lights in the grid cells covered by the object and global lights
+ * are considered.
+ */
 void GenerateLightShaderVariables( const LightWorld* world,
                                    ShaderVariableSet* variableSet,
                                    Vec3 objectPosition,
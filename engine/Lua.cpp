@@ -1,6 +1,7 @@
 #include <assert.h>
-#include <string.h> // memcpy, strlen, strcmp
-#include <tinycthread.h> // mtx_*
+#include <string.h> // memcpy, memset, memcmp, strlen, strcmp
+#include <atomic> // std::atomic
+#include <tinycthread.h> // mtx_*, tss_*, thrd_yield
 
 extern "C"
 {
@@ -14,9 +15,12 @@ extern "C"
 #include "Common.h"
 #include "Profiler.h"
 #include "JobManager.h"
+#include "Crc32.h"
 #include "Vfs.h"
 #include "Array.h"
 #include "LuaBuffer.h"
+#include "LuaAllocator.h"
+#include "LuaProfiler.h"
 #include "Lua.h"
 
 
@@ -58,11 +62,21 @@ static const char* CALLBACK_NAMES[] =
 static const int MAX_JOB_NAME_SIZE = 32;
 static const char* LUA_WORKER_KEY = "konstrukt_worker";
 
+/**
+ * Work done by a single incremental collection step in kilobytes.
+ */
+static const int GC_STEP_SIZE = 16;
+
+static const uint32_t LUA_CACHE_MAGIC = 0x4b4c4243; // 'KLBC'
+static const int LUA_CACHE_VERSION = 2; // Increment if the file format changes.
+static const char* LUA_CACHE_DIRECTORY = "shared-state/lua-cache";
+
 
 struct LuaTypeDescription
 {
     const char* name;
     lua_CFunction gcCallback;
+    const luaL_Reg* methods; // may be NULL
 };
 
 enum LuaFunctionFlags
@@ -86,28 +100,159 @@ struct LuaFunctionDescription
     int flags;
 };
 
+/**
+ * Messages from one worker to another.
+ *
+ * The sender fills one buffer, while the receiver reads the other one in
+ * the serial phase.  So messages, which are sent during the serial phase,
+ * are delivered in the next frame.
+ */
+struct LuaMessageQueue
+{
+    LuaBuffer* sendBuffer;
+    LuaBuffer* deliveryBuffer;
+    int sendCount;
+    int deliveryCount;
+};
+
+/**
+ * Bytecode cache files start with this header.  It's followed by the output
+ * of `lua_dump`.
+ */
+struct LuaCacheHeader
+{
+    uint32_t magic;
+    int version;
+    uint32_t key;
+    int sourceSize; // Guards against collisions.
+    int bytecodeSize;
+    uint32_t bytecodeChecksum; // Lua 5.2 doesn't verify bytecode.
+};
+
+/**
+ * Threads which create events.  Each one gets its own event segments.
+ */
+static const int MAX_LUA_EVENT_PRODUCERS = 32;
+
+/**
+ * A coalesced event, which waits for the next merge.
+ */
+struct StagedLuaEvent
+{
+    int count; // Number of events which were merged into this one.
+    int valueCount;
+    double values[MAX_LUA_EVENT_VALUES];
+};
+
+/**
+ * Events of one filter, which wait for the next merge.
+ */
+struct LuaEventStage
+{
+    Array<StagedLuaEvent> events;
+
+    /**
+     * Open addressing hash table, which maps keys to staged events.
+     * Holds the event index plus one, so zero marks empty slots.
+     */
+    Array<int> table;
+};
+
+/**
+ * Applies the #LuaEventPolicy to the events of one name and worker.
+ */
+struct LuaEventFilter
+{
+    char* name;
+    int index; // in LuaWorker::eventFilters
+    LuaEventPolicy policy;
+    LuaEventStage mergedEvents; // Only used by #MergeLuaEvents.
+};
+
+/**
+ * Events which one thread created for one worker.  So producers don't need
+ * to synchronize with each other.
+ *
+ * The producer writes to the active half, while #MergeLuaEvents reads the
+ * other one.  `busy` is set while an event is written, so the merge can
+ * wait for events which were begun before it flipped the halves.
+ */
+struct LuaEventSegment
+{
+    LuaBuffer* buffers[2];
+    Array<LuaEventStage> stages[2]; // indexed by filter
+    std::atomic<int> activeHalf;
+    std::atomic<bool> busy;
+    int writeHalf; // Half which the producer is writing to.
+};
+
 struct LuaWorker
 {
+    int index;
     lua_State* state;
     int callbacks[CALLBACK_COUNT]; // references to Lua functions
     JobId job;
     char jobName[MAX_JOB_NAME_SIZE];
-    LuaBuffer* privateEventBuffer;
-    LuaBuffer* publicEventBuffer;
-    mtx_t publicEventBufferMutex;
+    LuaBuffer* eventBuffer; // Events of the last frame, read by the worker.
+    LuaEventSegment* eventSegments[MAX_LUA_EVENT_PRODUCERS];
+    LuaAllocator allocator;
+    LuaProfiler profiler; // only used if Config.profilerInterval > 0
+    int lastAllocationCount; // when the counters were updated
+    Array<LuaEventFilter*> eventFilters;
+
+    // Of the last event merge:
+    int coalescedEventCount;
+    int droppedEventCount;
+
+    // Garbage collection:
+    int heapSizeAfterGc; // in bytes
+    bool fullGcRequested;
+    double gcTime; // of the last frame in seconds
+    int gcStepCount; // of the last frame
+
+    /**
+     * Outgoing messages - indexed by the receiving worker.
+     * Only written by this worker, so no locking is needed.
+     */
+    Array<LuaMessageQueue> messageQueues;
 };
 
 
 static LuaWorker* GetLuaWorkerFromState( lua_State* l );
 static int Lua_SetCallback( lua_State* l );
 static int Lua_Log( lua_State* l );
+static int Lua_CollectGarbage( lua_State* l );
+static int Lua_GetLuaWorkerIndex( lua_State* l );
+static int Lua_GetLuaWorkerCount( lua_State* l );
+static int Lua_SendLuaMessage( lua_State* l );
+static int Lua_LoadScript( lua_State* l );
+static int Lua_SetEventPolicy( lua_State* l );
+static void InitLuaEventProducers();
+static void DestroyLuaEventProducers();
+static LuaEventSegment* CreateLuaEventSegment();
+static void DestroyLuaEventSegment( LuaEventSegment* segment );
+static void DestroyLuaEventFilters( LuaWorker* worker );
 static void PushLuaScript( lua_State* l, const char* vfsPath );
 static int CallLuaFunction( lua_State* l, int argumentCount, int returnValueCount );
-static void SwapEventBuffers( LuaWorker* worker );
+static void MergeLuaEvents( LuaWorker* worker );
 static void PreparePublicBuffer(LuaBuffer* buffer);
-
-
-//DefineCounter(MemoryCounter, "memory", BYTE_COUNTER);
+static void CompletePublicBuffer(LuaBuffer* buffer);
+static void DestroyLuaMessageQueues( LuaWorker* worker, int firstReceiver );
+static void SwapLuaMessageQueues( LuaWorker* worker );
+static int PushLuaMessages( const LuaWorker* receiver );
+
+
+DefineCounter(LuaMemoryCounter, "lua memory", BYTE_COUNTER);
+DefineCounter(LuaGcTimeCounter, "lua gc time (us)");
+DefineCounter(LuaGcStepCounter, "lua gc steps");
+DefineCounter(LuaPooledMemoryCounter, "lua pooled memory", BYTE_COUNTER);
+DefineCounter(LuaPoolReserveCounter, "lua pool reserve", BYTE_COUNTER);
+DefineCounter(LuaLargeMemoryCounter, "lua large memory", BYTE_COUNTER);
+DefineCounter(LuaAllocationCounter, "lua allocations");
+DefineCounter(LuaCoalescedEventCounter, "lua coalesced events");
+DefineCounter(LuaDroppedEventCounter, "lua dropped events");
+static LuaConfig Config;
+static Path ProfileFile;
 static Array<LuaFunctionDescription> LuaFunctions;
 static Array<LuaTypeDescription> LuaTypes;
 static Array<LuaWorker*> LuaWorkers;
@@ -115,11 +260,28 @@ static Array<LuaWorker*> LuaWorkers;
 
 // --- General ---
 
-void InitLua()
+void InitLua( LuaConfig config )
 {
     assert(InSerialPhase());
-
-    InitCounter(MemoryCounter);
+    assert(config.gcTimeBudget >= 0);
+    assert(config.gcPace > 0);
+    assert(config.profilerInterval >= 0);
+    Config = config;
+    if(config.profileFile)
+        CopyString(config.profileFile, ProfileFile.str, sizeof(ProfileFile.str));
+    else
+        ProfileFile.str[0] = '\0';
+    Config.profileFile = NULL; // Use ProfileFile instead.
+
+    InitCounter(LuaMemoryCounter);
+    InitCounter(LuaGcTimeCounter);
+    InitCounter(LuaGcStepCounter);
+    InitCounter(LuaPooledMemoryCounter);
+    InitCounter(LuaPoolReserveCounter);
+    InitCounter(LuaLargeMemoryCounter);
+    InitCounter(LuaAllocationCounter);
+    InitCounter(LuaCoalescedEventCounter);
+    InitCounter(LuaDroppedEventCounter);
 
     LogInfo("Compiled with " LUA_COPYRIGHT);
     const int version = (int)*lua_version(NULL);
@@ -131,39 +293,89 @@ void InitLua()
     InitArray(&LuaFunctions);
     InitArray(&LuaTypes);
     InitArray(&LuaWorkers);
+    InitLuaEventProducers();
 
     REGISTER_LUA_FUNCTION(SetCallback);
     REGISTER_LUA_FUNCTION(Log);
+    REGISTER_LUA_FUNCTION(CollectGarbage);
+    REGISTER_LUA_FUNCTION(LoadScript);
+    REGISTER_LUA_FUNCTION(SetEventPolicy);
+
+    // These only access the calling worker:
+    RegisterThreadSafeLuaFunction("GetLuaWorkerIndex", Lua_GetLuaWorkerIndex);
+    RegisterThreadSafeLuaFunction("GetLuaWorkerCount", Lua_GetLuaWorkerCount);
+    RegisterThreadSafeLuaFunction("SendLuaMessage", Lua_SendLuaMessage);
+}
+
+static void WriteLuaProfile()
+{
+    Array<char> report;
+    InitArray(&report);
+    REPEAT(LuaWorkers.length, i)
+    {
+        const LuaWorker* worker = LuaWorkers.data[i];
+        char title[32];
+        FormatBuffer(title, sizeof(title), "Lua worker #%d", worker->index);
+        FormatLuaProfilerReport(&worker->profiler, title, &report);
+    }
+
+    VfsFile* file = OpenVfsFile(ProfileFile.str, VFS_OPEN_WRITE);
+    WriteVfsFile(file, report.data, report.length);
+    CloseVfsFile(file);
+    DestroyArray(&report);
+    LogNotice("Wrote Lua profile to %s", ProfileFile.str);
 }
 
 void DestroyLua()
 {
     assert(InSerialPhase());
 
+    if(Config.profilerInterval > 0 && ProfileFile.str[0] != '\0')
+        WriteLuaProfile();
+
     SetLuaWorkerCount(0);
+    DestroyLuaEventProducers();
 
     DestroyArray(&LuaFunctions);
     DestroyArray(&LuaTypes);
     DestroyArray(&LuaWorkers);
 }
 
-void RegisterLuaFunction( const char* name, lua_CFunction fn )
+static void RegisterLuaFunctionWithFlags( const char* name, lua_CFunction fn, int flags )
 {
     assert(InSerialPhase());
     assert(LuaWorkers.length == 0);
     LuaFunctionDescription* desc = AllocateAtEndOfArray(&LuaFunctions, 1);
     desc->name = name;
     desc->function = fn;
-    desc->flags = 0;
+    desc->flags = flags;
+}
+
+void RegisterLuaFunction( const char* name, lua_CFunction fn )
+{
+    RegisterLuaFunctionWithFlags(name, fn, 0);
+}
+
+void RegisterThreadSafeLuaFunction( const char* name, lua_CFunction fn )
+{
+    RegisterLuaFunctionWithFlags(name, fn, LUA_THREAD_SAFE);
 }
 
 void RegisterLuaType( const char* name, lua_CFunction gcCallback )
+{
+    RegisterLuaTypeWithMethods(name, gcCallback, NULL);
+}
+
+void RegisterLuaTypeWithMethods( const char* name,
+                                 lua_CFunction gcCallback,
+                                 const luaL_Reg* methods )
 {
     assert(InSerialPhase());
     assert(LuaWorkers.length == 0);
     LuaTypeDescription* desc = AllocateAtEndOfArray(&LuaTypes, 1);
     desc->name = name;
     desc->gcCallback = gcCallback;
+    desc->methods = methods;
 }
 
 static int Lua_Log( lua_State* l )
@@ -232,21 +444,45 @@ static int PushBootstrapArguments( lua_State* l )
     return 2;
 }
 
+static int GetLuaMemoryInBytes( lua_State* l )
+{
+    return lua_gc(l, LUA_GCCOUNT, 0)*1024 +
+           lua_gc(l, LUA_GCCOUNTB, 0);
+}
+
+static int Lua_Panic( lua_State* l )
+{
+    FatalError("Unprotected Lua error: %s", lua_tostring(l, -1));
+    return 0;
+}
+
 static LuaWorker* CreateLuaWorker( int index )
 {
     LuaWorker* worker = NEW(LuaWorker);
 
-    worker->state = luaL_newstate();
+    worker->index = index;
+    InitLuaAllocator(&worker->allocator);
+    worker->state = lua_newstate(ReallocLuaMemory, &worker->allocator);
+    lua_atpanic(worker->state, Lua_Panic);
+    if(Config.profilerInterval > 0)
+    {
+        char counterPrefix[32];
+        FormatBuffer(counterPrefix, sizeof(counterPrefix), "lua worker #%d", index);
+        InitLuaProfiler(&worker->profiler,
+                        worker->state,
+                        Config.profilerInterval,
+                        counterPrefix);
+    }
     REPEAT(CALLBACK_COUNT, i)
         worker->callbacks[i] = LUA_NOREF;
     worker->job = INVALID_JOB_ID;
     FormatBuffer(worker->jobName, MAX_JOB_NAME_SIZE, "update lua worker #%d (%p)", index, worker);
-    worker->privateEventBuffer = CreateLuaBuffer(NATIVE_LUA_BUFFER);
-    worker->publicEventBuffer  = CreateLuaBuffer(NATIVE_LUA_BUFFER);
-    ReferenceLuaBuffer(worker->privateEventBuffer);
-    ReferenceLuaBuffer(worker->publicEventBuffer);
-    PreparePublicBuffer(worker->publicEventBuffer);
-    Ensure(mtx_init(&worker->publicEventBufferMutex, mtx_plain) == thrd_success);
+    worker->eventBuffer = CreateLuaBuffer(NATIVE_LUA_BUFFER);
+    ReferenceLuaBuffer(worker->eventBuffer);
+    REPEAT(MAX_LUA_EVENT_PRODUCERS, i)
+        worker->eventSegments[i] = CreateLuaEventSegment();
+    InitArray(&worker->messageQueues);
+    InitArray(&worker->eventFilters);
 
     lua_State* l = worker->state;
 
@@ -277,6 +513,9 @@ static LuaWorker* CreateLuaWorker( int index )
             lua_setfield(l, -2, "__gc");
         }
 
+        if(types[i].methods)
+            luaL_setfuncs(l, types[i].methods, 0);
+
         // pop metatable
         lua_pop(l, 1);
     }
@@ -288,6 +527,10 @@ static LuaWorker* CreateLuaWorker( int index )
     REPEAT(CALLBACK_COUNT, i)
         assert(worker->callbacks[i] != LUA_NOREF);
 
+    // Start with a clean heap, since loading leaves a lot of garbage behind:
+    lua_gc(l, LUA_GCCOLLECT, 0);
+    worker->heapSizeAfterGc = GetLuaMemoryInBytes(l);
+
     return worker;
 }
 
@@ -305,10 +548,19 @@ static void DestroyLuaWorker( LuaWorker* worker )
         luaL_unref(l, LUA_REGISTRYINDEX, worker->callbacks[i]);
 
     lua_close(l);
+    if(Config.profilerInterval > 0)
+        DestroyLuaProfiler(&worker->profiler, true);
+    DestroyLuaAllocator(&worker->allocator);
+
+    ReleaseLuaBuffer(worker->eventBuffer);
+    REPEAT(MAX_LUA_EVENT_PRODUCERS, i)
+        DestroyLuaEventSegment(worker->eventSegments[i]);
 
-    mtx_destroy(&worker->publicEventBufferMutex);
-    ReleaseLuaBuffer(worker->publicEventBuffer);
-    ReleaseLuaBuffer(worker->privateEventBuffer);
+    DestroyLuaMessageQueues(worker, 0);
+    DestroyArray(&worker->messageQueues);
+
+    DestroyLuaEventFilters(worker);
+    DestroyArray(&worker->eventFilters);
 
     DELETE(worker);
 }
@@ -332,6 +584,10 @@ void SetLuaWorkerCount( int count )
         for(int i = count; i < LuaWorkers.length; i++)
             DestroyLuaWorker(LuaWorkers.data[i]);
         PopFromArray(&LuaWorkers, removedWorkers);
+
+        // Drop messages to the removed workers:
+        REPEAT(LuaWorkers.length, i)
+            DestroyLuaMessageQueues(LuaWorkers.data[i], count);
     }
 }
 
@@ -362,14 +618,59 @@ static int Lua_SetCallback( lua_State* l )
     return 0;
 }
 
-//#if defined(KONSTRUKT_PROFILER_ENABLED)
-//static int GetLuaMemoryInBytes()
-//{
-//    assert(g_LuaState);
-//    return lua_gc(g_LuaState, LUA_GCCOUNT, 0)*1024 +
-//           lua_gc(g_LuaState, LUA_GCCOUNTB, 0);
-//}
-//#endif
+/**
+ * Requests a full collection cycle at the end of the next parallel phase.
+ * Meant for loading screens and similar points, where a longer frame
+ * doesn't hurt.
+ */
+static int Lua_CollectGarbage( lua_State* l )
+{
+    LuaWorker* worker = GetLuaWorkerFromState(l);
+    worker->fullGcRequested = true;
+    return 0;
+}
+
+/**
+ * Runs incremental collection steps until the collector has caught up with
+ * the memory which has been allocated since the last frame, a collection
+ * cycle has been completed or the time budget is used up.
+ *
+ * At least one step is done per frame, so the collector always makes some
+ * progress.
+ */
+static void CollectLuaGarbage( LuaWorker* worker )
+{
+    lua_State* l = worker->state;
+    const double startTime = GetMonotonicTime();
+    int stepCount = 0;
+
+    if(worker->fullGcRequested)
+    {
+        lua_gc(l, LUA_GCCOLLECT, 0);
+        worker->fullGcRequested = false;
+    }
+    else
+    {
+        const int allocatedBytes = GetLuaMemoryInBytes(l) -
+                                   worker->heapSizeAfterGc;
+        const int work = (int)((float)allocatedBytes / 1024.0f * Config.gcPace);
+        int doneWork = 0;
+        for(;;)
+        {
+            const bool cycleCompleted = lua_gc(l, LUA_GCSTEP, GC_STEP_SIZE);
+            doneWork += GC_STEP_SIZE;
+            stepCount++;
+            if(cycleCompleted ||
+               doneWork >= work ||
+               GetMonotonicTime() - startTime >= Config.gcTimeBudget)
+                break;
+        }
+    }
+
+    worker->heapSizeAfterGc = GetLuaMemoryInBytes(l);
+    worker->gcTime = GetMonotonicTime() - startTime;
+    worker->gcStepCount = stepCount;
+}
 
 static void UpdateLua( void* worker_ )
 {
@@ -380,16 +681,64 @@ static void UpdateLua( void* worker_ )
 
         // Run parallel callback:
         lua_State* l = worker->state;
+        if(Config.profilerInterval > 0)
+            ResumeLuaProfiler(&worker->profiler);
         lua_rawgeti(l, LUA_REGISTRYINDEX, worker->callbacks[PARALLEL_CALLBACK]);
-        const int args = PushLuaBufferToLua(worker->privateEventBuffer, l);
+        const int args = PushLuaBufferToLua(worker->eventBuffer, l);
         CallLuaFunction(l, args, 0);
     }
 
     {
         ProfileScope("Lua GC");
-        lua_gc(worker->state, LUA_GCCOLLECT, 0);
-        //SetCounter(MemoryCounter, GetLuaMemoryInBytes());
+        CollectLuaGarbage(worker);
+    }
+}
+
+LuaStatistics GetLuaStatistics()
+{
+    LuaStatistics statistics;
+    memset(&statistics, 0, sizeof(statistics));
+    REPEAT(LuaWorkers.length, i)
+    {
+        const LuaWorker* worker = LuaWorkers.data[i];
+        statistics.memory              += worker->heapSizeAfterGc;
+        statistics.gcTime              += worker->gcTime;
+        statistics.gcStepCount         += worker->gcStepCount;
+        statistics.coalescedEventCount += worker->coalescedEventCount;
+        statistics.droppedEventCount   += worker->droppedEventCount;
+    }
+    return statistics;
+}
+
+static void UpdateLuaCounters()
+{
+    int64_t pooledMemory = 0;
+    int64_t poolReserve = 0;
+    int64_t largeMemory = 0;
+    int allocationCount = 0;
+    REPEAT(LuaWorkers.length, i)
+    {
+        LuaWorker* worker = LuaWorkers.data[i];
+        const LuaAllocator* allocator = &worker->allocator;
+        pooledMemory += allocator->pooledBytes;
+        poolReserve  += allocator->reservedBytes;
+        largeMemory  += allocator->largeBytes;
+        allocationCount += allocator->allocationCount -
+                           worker->lastAllocationCount;
+        worker->lastAllocationCount = allocator->allocationCount;
+        if(Config.profilerInterval > 0)
+            PublishLuaProfilerCounters(&worker->profiler);
     }
+    const LuaStatistics statistics = GetLuaStatistics();
+    SetCounter(LuaMemoryCounter, statistics.memory);
+    SetCounter(LuaGcTimeCounter, (int64_t)(statistics.gcTime * 1e6));
+    SetCounter(LuaGcStepCounter, statistics.gcStepCount);
+    SetCounter(LuaPooledMemoryCounter, pooledMemory);
+    SetCounter(LuaPoolReserveCounter, poolReserve);
+    SetCounter(LuaLargeMemoryCounter, largeMemory);
+    SetCounter(LuaAllocationCounter, allocationCount);
+    SetCounter(LuaCoalescedEventCounter, statistics.coalescedEventCount);
+    SetCounter(LuaDroppedEventCounter, statistics.droppedEventCount);
 }
 
 void BeginLuaUpdate()
@@ -415,50 +764,333 @@ void CompleteLuaUpdate()
         WaitForJobs(&workers[i]->job, 1);
         workers[i]->job = INVALID_JOB_ID;
     }
+    UpdateLuaCounters();
 
     ProfileScope("Lua serial phase");
     REPEAT(LuaWorkers.length, i)
     {
-        LuaWorker* worker = LuaWorkers.data[i];
+        MergeLuaEvents(workers[i]);
+        SwapLuaMessageQueues(workers[i]);
+    }
 
-        SwapEventBuffers(worker);
+    // Workers run one after another, in the same order each frame:
+    REPEAT(LuaWorkers.length, i)
+    {
+        LuaWorker* worker = workers[i];
 
         // Run serial callback:
         lua_State* l = worker->state;
-        lua_rawgeti(l, LUA_REGISTRYINDEX, worker->callbacks[PARALLEL_CALLBACK]);
-        CallLuaFunction(l, 0, 0);
+        if(Config.profilerInterval > 0)
+            ResumeLuaProfiler(&worker->profiler);
+        lua_rawgeti(l, LUA_REGISTRYINDEX, worker->callbacks[SERIAL_CALLBACK]);
+        const int args = PushLuaMessages(worker);
+        CallLuaFunction(l, args, 0);
+    }
+}
+
+static int Lua_GetLuaWorkerIndex( lua_State* l )
+{
+    lua_pushinteger(l, GetLuaWorkerFromState(l)->index);
+    return 1;
+}
+
+static int Lua_GetLuaWorkerCount( lua_State* l )
+{
+    lua_pushinteger(l, LuaWorkers.length);
+    return 1;
+}
+
+
+// --- Messages ---
+// Each message is stored as list, which starts with the index of the
+// sending worker, followed by the message values.  A message queue buffer
+// is a list of messages.
+
+static void DestroyLuaMessageQueues( LuaWorker* worker, int firstReceiver )
+{
+    Array<LuaMessageQueue>* queues = &worker->messageQueues;
+    if(queues->length <= firstReceiver)
+        return;
+    for(int i = firstReceiver; i < queues->length; i++)
+    {
+        ReleaseLuaBuffer(queues->data[i].sendBuffer);
+        ReleaseLuaBuffer(queues->data[i].deliveryBuffer);
     }
+    PopFromArray(queues, queues->length - firstReceiver);
+}
+
+static LuaMessageQueue* GetLuaMessageQueue( LuaWorker* sender, int receiver )
+{
+    Array<LuaMessageQueue>* queues = &sender->messageQueues;
+    while(queues->length <= receiver)
+    {
+        LuaMessageQueue* queue = AllocateAtEndOfArray(queues, 1);
+        queue->sendBuffer     = CreateLuaBuffer(NATIVE_LUA_BUFFER);
+        queue->deliveryBuffer = CreateLuaBuffer(NATIVE_LUA_BUFFER);
+        ReferenceLuaBuffer(queue->sendBuffer);
+        ReferenceLuaBuffer(queue->deliveryBuffer);
+        PreparePublicBuffer(queue->sendBuffer);
+        queue->sendCount = 0;
+        queue->deliveryCount = 0;
+    }
+    return &queues->data[receiver];
+}
+
+/**
+ * Makes the messages, which have been sent since the last call, ready for
+ * delivery.
+ */
+static void SwapLuaMessageQueues( LuaWorker* worker )
+{
+    assert(InSerialPhase());
+    REPEAT(worker->messageQueues.length, i)
+    {
+        LuaMessageQueue* queue = &worker->messageQueues.data[i];
+        LuaBuffer* sendBuffer = queue->sendBuffer;
+        LuaBuffer* deliveryBuffer = queue->deliveryBuffer;
+
+        PreparePublicBuffer(deliveryBuffer);
+        CompletePublicBuffer(sendBuffer);
+
+        queue->sendBuffer = deliveryBuffer;
+        queue->deliveryBuffer = sendBuffer;
+        queue->deliveryCount = queue->sendCount;
+        queue->sendCount = 0;
+    }
+}
+
+/**
+ * Pushes a list with all messages for the receiver.
+ *
+ * They're ordered by the index of the sending worker and - for each
+ * sender - by the order in which they were sent.  So the order doesn't
+ * depend on how the worker jobs were scheduled.
+ */
+static int PushLuaMessages( const LuaWorker* receiver )
+{
+    lua_State* l = receiver->state;
+    lua_newtable(l);
+    int messageCount = 0;
+    REPEAT(LuaWorkers.length, i)
+    {
+        const LuaWorker* sender = LuaWorkers.data[i];
+        if(sender->messageQueues.length <= receiver->index)
+            continue;
+
+        const LuaMessageQueue* queue = &sender->messageQueues.data[receiver->index];
+        if(queue->deliveryCount == 0)
+            continue;
+
+        PushLuaBufferToLua(queue->deliveryBuffer, l);
+        REPEAT(queue->deliveryCount, j)
+        {
+            lua_rawgeti(l, -1, j+1);
+            lua_rawseti(l, -3, messageCount+1);
+            messageCount++;
+        }
+        lua_pop(l, 1);
+    }
+    return 1;
+}
+
+static int Lua_SendLuaMessage( lua_State* l )
+{
+    LuaWorker* sender = GetLuaWorkerFromState(l);
+    const int receiver = luaL_checkinteger(l, 1);
+    luaL_argcheck(l, receiver >= 0 && receiver < LuaWorkers.length, 1,
+                  "no such worker");
+
+    LuaMessageQueue* queue = GetLuaMessageQueue(sender, receiver);
+    LuaBuffer* buffer = queue->sendBuffer;
+
+    BeginListInLuaBuffer(buffer);
+    AddIntegerToLuaBuffer(buffer, sender->index);
+    AddLuaValuesToLuaBuffer(buffer, l, 2, lua_gettop(l)-1);
+    EndListInLuaBuffer(buffer);
+    queue->sendCount++;
+    return 0;
 }
 
 
 // --- loading ---
 
-static const int LOAD_BUFFER_SIZE = 1024;
-struct LoadState
+static uint32_t CalcLuaCacheKey( const char* vfsPath,
+                                 const char* source,
+                                 int sourceSize )
 {
-    VfsFile* file;
-    char buffer[LOAD_BUFFER_SIZE];
-};
+    uint32_t key = CalcCrc32ForBuffer(&LUA_CACHE_VERSION,
+                                      sizeof(LUA_CACHE_VERSION));
+    key = ContinueCrc32(key, vfsPath, strlen(vfsPath)+1);
+    return ContinueCrc32(key, source, sourceSize);
+}
+
+/**
+ * @param path
+ * Must be able to hold #MAX_PATH_SIZE bytes.
+ */
+static void GetLuaCachePath( uint32_t key, char* path )
+{
+    FormatBuffer(path, MAX_PATH_SIZE, "%s/%08x.luac", LUA_CACHE_DIRECTORY, key);
+}
+
+/**
+ * Cache files which can't be used are deleted, so they're replaced once
+ * the script has been compiled.
+ */
+static bool LoadLuaChunkFromCache( lua_State* l,
+                                   const char* chunkName,
+                                   uint32_t key,
+                                   int sourceSize )
+{
+    char vfsPath[MAX_PATH_SIZE];
+    GetLuaCachePath(key, vfsPath);
+    if(GetVfsFileType(vfsPath) != FILE_TYPE_REGULAR)
+        return false;
+
+    int size = 0;
+    char* data = ReadWholeVfsFile(vfsPath, &size);
+    const LuaCacheHeader* header = (const LuaCacheHeader*)data;
+    bool success = data &&
+                   size >= (int)sizeof(LuaCacheHeader) &&
+                   header->magic == LUA_CACHE_MAGIC &&
+                   header->version == LUA_CACHE_VERSION &&
+                   header->key == key &&
+                   header->sourceSize == sourceSize &&
+                   header->bytecodeSize == size - (int)sizeof(LuaCacheHeader) &&
+                   header->bytecodeChecksum == CalcCrc32ForBuffer(data + sizeof(LuaCacheHeader),
+                                                                  header->bytecodeSize);
+
+    if(success)
+    {
+        // Lua only checks the header of binary chunks, so bytecode of other
+        // Lua versions is rejected here.  Corrupted bytecode is caught by
+        // the checksum above.
+        success = luaL_loadbufferx(l,
+                                   data + sizeof(LuaCacheHeader),
+                                   header->bytecodeSize,
+                                   chunkName,
+                                   "b") == LUA_OK;
+        if(!success)
+            lua_pop(l, 1); // pop error message
+    }
 
-static const char* ReadLuaChunk( lua_State* l, void* userData, size_t* bytesRead )
+    if(!success)
+    {
+        LogInfo("Discarding Lua cache file %s", vfsPath);
+        DeleteVfsFile(vfsPath);
+    }
+
+    if(data)
+        Free(data);
+    return success;
+}
+
+static int WriteLuaChunk( lua_State* l, const void* data, size_t size, void* userData )
+{
+    Array<char>* bytecode = (Array<char>*)userData;
+    AppendToArray(bytecode, (int)size, (const char*)data);
+    return 0;
+}
+
+/**
+ * Stores the function on top of the stack in the cache.
+ */
+static void SaveLuaChunkToCache( lua_State* l, uint32_t key, int sourceSize )
 {
-    LoadState* state = (LoadState*)userData;
-    *bytesRead = ReadVfsFile(state->file, state->buffer, LOAD_BUFFER_SIZE);
-    return state->buffer;
+    Array<char> bytecode;
+    InitArray(&bytecode);
+    lua_dump(l, WriteLuaChunk, &bytecode);
+
+    if(GetVfsFileType(LUA_CACHE_DIRECTORY) == FILE_TYPE_INVALID)
+        MakeVfsDir(LUA_CACHE_DIRECTORY);
+
+    LuaCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = LUA_CACHE_MAGIC;
+    header.version = LUA_CACHE_VERSION;
+    header.key = key;
+    header.sourceSize = sourceSize;
+    header.bytecodeSize = bytecode.length;
+    header.bytecodeChecksum = CalcCrc32ForBuffer(bytecode.data, bytecode.length);
+
+    // The file is moved into place once it's complete, so an interrupted
+    // write doesn't leave a truncated cache file behind:
+    char cachePath[MAX_PATH_SIZE];
+    char tempPath[MAX_PATH_SIZE];
+    GetLuaCachePath(key, cachePath);
+    FormatBuffer(tempPath, sizeof(tempPath), "%s.tmp", cachePath);
+
+    VfsFile* file = OpenVfsFile(tempPath, VFS_OPEN_WRITE);
+    WriteVfsFile(file, &header, sizeof(header));
+    WriteVfsFile(file, bytecode.data, bytecode.length);
+    CloseVfsFile(file);
+    RenameVfsFile(tempPath, cachePath);
+
+    DestroyArray(&bytecode);
+}
+
+bool LoadLuaScript( lua_State* l, const char* vfsPath )
+{
+    assert(InSerialPhase()); // The cache isn't synchronized.
+    if(GetVfsFileType(vfsPath) != FILE_TYPE_REGULAR)
+    {
+        lua_pushfstring(l, "Can't open %s", vfsPath);
+        return false;
+    }
+
+    int sourceSize = 0;
+    char* source = ReadWholeVfsFile(vfsPath, &sourceSize);
+    if(!source)
+    {
+        lua_pushfstring(l, "Can't read %s", vfsPath);
+        return false;
+    }
+
+    char chunkName[MAX_PATH_SIZE+1];
+    FormatBuffer(chunkName, sizeof(chunkName), "@%s", vfsPath);
+
+    const bool useCache = Config.bytecodeCache;
+    uint32_t key = 0;
+    bool success = false;
+    if(useCache)
+    {
+        key = CalcLuaCacheKey(vfsPath, source, sourceSize);
+        success = LoadLuaChunkFromCache(l, chunkName, key, sourceSize);
+    }
+
+    if(!success)
+    {
+        success = luaL_loadbufferx(l,
+                                   source,
+                                   sourceSize,
+                                   chunkName,
+                                   "t") == LUA_OK;
+        if(success && useCache)
+            SaveLuaChunkToCache(l, key, sourceSize);
+    }
+
+    Free(source);
+    return success;
 }
 
 static void PushLuaScript( lua_State* l, const char* vfsPath )
 {
-    VfsFile* file = OpenVfsFile(vfsPath, VFS_OPEN_READ);
-    LoadState state;
-    state.file = file;
-    const char* source = Format("@%s", vfsPath);
-    if(lua_load(l, ReadLuaChunk, &state, source, "t") != LUA_OK)
+    if(!LoadLuaScript(l, vfsPath))
     {
         FatalError("%s", lua_tostring(l, -1));
-        lua_pop(l, 2); // pop error function and error message
+        lua_pop(l, 1); // pop error message
     }
-    CloseVfsFile(file);
+}
+
+static int Lua_LoadScript( lua_State* l )
+{
+    const char* vfsPath = luaL_checkstring(l, 1);
+    if(LoadLuaScript(l, vfsPath))
+        return 1;
+
+    lua_pushnil(l);
+    lua_insert(l, -2);
+    return 2; // nil, error message
 }
 
 
@@ -664,19 +1296,234 @@ unsigned int CheckIdFromLua( lua_State* l, int stackPosition )
 //    { ... (event data) ... },
 //    ...
 // }
+//
+// Each thread writes its events to its own segment, so no locks are needed.
+// The segments are merged into the worker's event buffer in the serial phase.
+// Events of one thread keep their order, but the order between threads
+// depends on which thread created events first.
+
+/**
+ * Bit `i` is set while a thread uses the segments with index `i`.
+ * So only threads which are alive at the same time count towards
+ * #MAX_LUA_EVENT_PRODUCERS.
+ */
+static std::atomic<uint32_t> UsedLuaEventProducers;
+static_assert(MAX_LUA_EVENT_PRODUCERS <= 32, "Producers must fit into the bit mask.");
+
+/**
+ * Stores the producer index plus one, so the slot can be released when the
+ * thread exits.
+ */
+static tss_t LuaEventProducerKey;
+
+static void ReleaseLuaEventProducer( void* value )
+{
+    const int index = (int)(intptr_t)value - 1;
+    UsedLuaEventProducers &= ~(1u << index);
+}
+
+static void InitLuaEventProducers()
+{
+    UsedLuaEventProducers = 0;
+    Ensure(tss_create(&LuaEventProducerKey, ReleaseLuaEventProducer) == thrd_success);
+}
+
+/**
+ * Threads which are still alive keep their slots until #InitLuaEventProducers
+ * resets them.
+ */
+static void DestroyLuaEventProducers()
+{
+    tss_delete(LuaEventProducerKey);
+}
+
+static int ClaimLuaEventProducer()
+{
+    uint32_t used = UsedLuaEventProducers;
+    for(;;)
+    {
+        int index = 0;
+        while(index < MAX_LUA_EVENT_PRODUCERS && (used & (1u << index)))
+            index++;
+        if(index == MAX_LUA_EVENT_PRODUCERS)
+            FatalError("More than %d threads create Lua events.",
+                       MAX_LUA_EVENT_PRODUCERS);
+        // Updates `used` on failure:
+        if(UsedLuaEventProducers.compare_exchange_weak(used, used | (1u << index)))
+            return index;
+    }
+}
+
+static int GetLuaEventProducerIndex()
+{
+    intptr_t value = (intptr_t)tss_get(LuaEventProducerKey);
+    if(value == 0)
+    {
+        value = ClaimLuaEventProducer() + 1;
+        Ensure(tss_set(LuaEventProducerKey, (void*)value) == thrd_success);
+    }
+    return (int)value - 1;
+}
+
+static void InitLuaEventStage( LuaEventStage* stage )
+{
+    InitArray(&stage->events);
+    InitArray(&stage->table);
+}
+
+static void DestroyLuaEventStage( LuaEventStage* stage )
+{
+    DestroyArray(&stage->events);
+    DestroyArray(&stage->table);
+}
+
+static void ClearLuaEventStage( LuaEventStage* stage )
+{
+    ClearArray(&stage->events);
+    memset(stage->table.data, 0, sizeof(int)*stage->table.length);
+}
+
+static LuaEventSegment* CreateLuaEventSegment()
+{
+    // Allocated with new, so the atomics are constructed:
+    LuaEventSegment* segment = new LuaEventSegment;
+    REPEAT(2, i)
+    {
+        segment->buffers[i] = CreateLuaBuffer(NATIVE_LUA_BUFFER);
+        ReferenceLuaBuffer(segment->buffers[i]);
+        InitArray(&segment->stages[i]);
+    }
+    segment->activeHalf = 0;
+    segment->busy = false;
+    segment->writeHalf = 0;
+    return segment;
+}
+
+static void DestroyLuaEventSegment( LuaEventSegment* segment )
+{
+    assert(!segment->busy);
+    REPEAT(2, i)
+    {
+        ReleaseLuaBuffer(segment->buffers[i]);
+        Array<LuaEventStage>* stages = &segment->stages[i];
+        REPEAT(stages->length, j)
+            DestroyLuaEventStage(&stages->data[j]);
+        DestroyArray(stages);
+    }
+    delete segment;
+}
+
+/**
+ * Marks the calling thread's segment as busy until #EndLuaEventSegment.
+ */
+static LuaEventSegment* BeginLuaEventSegment( LuaWorker* worker )
+{
+    LuaEventSegment* segment = worker->eventSegments[GetLuaEventProducerIndex()];
+    assert(!segment->busy); // Events can't be nested.
+    segment->busy = true;
+    // Read after setting busy:  Either the merge waits for this event or
+    // the event goes to the new half.
+    segment->writeHalf = segment->activeHalf;
+    return segment;
+}
+
+static void EndLuaEventSegment( LuaEventSegment* segment )
+{
+    segment->busy = false;
+}
+
+/**
+ * @return
+ * Stage of the filter in the given segment half - created on demand.
+ */
+static LuaEventStage* GetSegmentLuaEventStage( LuaEventSegment* segment,
+                                               int half,
+                                               const LuaEventFilter* filter )
+{
+    Array<LuaEventStage>* stages = &segment->stages[half];
+    while(stages->length <= filter->index)
+        InitLuaEventStage(AllocateAtEndOfArray(stages, 1));
+    return &stages->data[filter->index];
+}
+
+static LuaEventFilter* GetLuaEventFilter( LuaWorker* worker, const char* name )
+{
+    REPEAT(worker->eventFilters.length, i)
+    {
+        LuaEventFilter* filter = worker->eventFilters.data[i];
+        if(strcmp(filter->name, name) == 0)
+            return filter;
+    }
+
+    LuaEventFilter* filter = NEW(LuaEventFilter);
+    const int nameSize = strlen(name)+1;
+    filter->name = (char*)Alloc(nameSize);
+    memcpy(filter->name, name, nameSize);
+    filter->index = worker->eventFilters.length;
+    filter->policy.coalescing = LUA_EVENT_KEEP_ALL;
+    InitLuaEventStage(&filter->mergedEvents);
+    AppendToArray(&worker->eventFilters, 1, &filter);
+    return filter;
+}
+
+static void DestroyLuaEventFilters( LuaWorker* worker )
+{
+    REPEAT(worker->eventFilters.length, i)
+    {
+        LuaEventFilter* filter = worker->eventFilters.data[i];
+        Free(filter->name);
+        DestroyLuaEventStage(&filter->mergedEvents);
+        DELETE(filter);
+    }
+    ClearArray(&worker->eventFilters);
+}
 
 LuaEventListener GetLuaEventListener( lua_State* l, const char* name )
 {
-    return { GetLuaWorkerFromState(l), name };
+    LuaWorker* worker = GetLuaWorkerFromState(l);
+    LuaEventFilter* filter = GetLuaEventFilter(worker, name);
+    return { worker, filter->name, filter };
+}
+
+void SetLuaEventPolicy( lua_State* l, const char* name, LuaEventPolicy policy )
+{
+    assert(InSerialPhase()); // Events are only queued in the parallel phase.
+    assert(policy.keyValueCount >= 0 &&
+           policy.keyValueCount <= MAX_LUA_EVENT_VALUES);
+    assert(policy.maxEventsPerFrame >= 0);
+    LuaEventFilter* filter = GetLuaEventFilter(GetLuaWorkerFromState(l), name);
+    filter->policy = policy;
+}
+
+static int Lua_SetEventPolicy( lua_State* l )
+{
+    static const char* coalescingNames[] =
+    {
+        "all",
+        "first",
+        "last",
+        "accumulate",
+        NULL
+    };
+
+    const char* name = luaL_checkstring(l, 1);
+    LuaEventPolicy policy;
+    policy.coalescing = (LuaEventCoalescing)luaL_checkoption(l, 2, NULL, coalescingNames);
+    policy.keyValueCount = luaL_optinteger(l, 3, 0);
+    policy.maxEventsPerFrame = luaL_optinteger(l, 4, 0);
+    luaL_argcheck(l, policy.keyValueCount >= 0 &&
+                     policy.keyValueCount <= MAX_LUA_EVENT_VALUES, 3, "out of range");
+    luaL_argcheck(l, policy.maxEventsPerFrame >= 0, 4, "must not be negative");
+    SetLuaEventPolicy(l, name, policy);
+    return 0;
 }
 
 LuaBuffer* BeginLuaEvent( LuaEventListener listener )
 {
     assert(!InSerialPhase()); // Events should be queued in the parallel phase!
                               // Albeit this shouldn't pose a problem.
-    LuaWorker* worker = listener.worker;
-    Ensure(mtx_lock(&worker->publicEventBufferMutex) == thrd_success);
-    LuaBuffer* buffer = worker->publicEventBuffer;
+    LuaEventSegment* segment = BeginLuaEventSegment(listener.worker);
+    LuaBuffer* buffer = segment->buffers[segment->writeHalf];
 
     // Prepare new event in buffer:
     BeginListInLuaBuffer(buffer);
@@ -689,12 +1536,202 @@ void CompleteLuaEvent( LuaEventListener listener )
     assert(!InSerialPhase()); // Events should be queued in the parallel phase!
                               // Albeit this shouldn't pose a problem.
     LuaWorker* worker = listener.worker;
-    LuaBuffer* buffer = worker->publicEventBuffer;
+    LuaEventSegment* segment = worker->eventSegments[GetLuaEventProducerIndex()];
+    LuaBuffer* buffer = segment->buffers[segment->writeHalf];
 
     // Complete event in buffer:
     EndListInLuaBuffer(buffer);
 
-    Ensure(mtx_unlock(&worker->publicEventBufferMutex) == thrd_success);
+    EndLuaEventSegment(segment);
+}
+
+static void AddNumericLuaEvent( LuaBuffer* buffer,
+                                int count,
+                                const double* values,
+                                int valueCount )
+{
+    BeginListInLuaBuffer(buffer);
+    AddIntegerToLuaBuffer(buffer, count);
+    AddDoubleArrayToLuaBuffer(buffer, values, valueCount);
+    EndListInLuaBuffer(buffer);
+}
+
+static uint32_t CalcLuaEventKeyHash( const LuaEventPolicy* policy, const double* values )
+{
+    return CalcCrc32ForBuffer(values, sizeof(double)*policy->keyValueCount);
+}
+
+static bool LuaEventKeysAreEqual( const LuaEventPolicy* policy,
+                                  const double* a,
+                                  const double* b )
+{
+    return memcmp(a, b, sizeof(double)*policy->keyValueCount) == 0;
+}
+
+/**
+ * @return
+ * Table slot, which either holds the event with the given key or is empty.
+ */
+static int* FindStagedLuaEventSlot( LuaEventStage* stage,
+                                    const LuaEventPolicy* policy,
+                                    const double* values )
+{
+    const int mask = stage->table.length - 1;
+    int slot = CalcLuaEventKeyHash(policy, values) & mask;
+    for(;;)
+    {
+        int* entry = &stage->table.data[slot];
+        if(*entry == 0)
+            return entry;
+        const StagedLuaEvent* event = &stage->events.data[*entry-1];
+        if(LuaEventKeysAreEqual(policy, event->values, values))
+            return entry;
+        slot = (slot+1) & mask;
+    }
+}
+
+/**
+ * Keeps the table at most half full, so probe sequences stay short.
+ */
+static void ResizeStagedLuaEventTable( LuaEventStage* stage,
+                                       const LuaEventPolicy* policy )
+{
+    const int eventCount = stage->events.length;
+    int size = stage->table.length;
+    if(size >= 16 && (eventCount+1)*2 <= size)
+        return;
+
+    size = size < 16 ? 16 : size*2;
+    ClearArray(&stage->table);
+    int* table = AllocateAtEndOfArray(&stage->table, size);
+    memset(table, 0, sizeof(int)*size);
+    REPEAT(eventCount, i)
+        *FindStagedLuaEventSlot(stage, policy, stage->events.data[i].values) = i+1;
+}
+
+/**
+ * Merges `count` events, which are represented by `values`, into the stage.
+ * Events are only appended if they are kept all.
+ */
+static void StageLuaEvent( LuaEventStage* stage,
+                           const LuaEventPolicy* policy,
+                           int count,
+                           const double* values,
+                           int valueCount )
+{
+    assert(valueCount >= policy->keyValueCount);
+
+    int* entry = NULL;
+    if(policy->coalescing != LUA_EVENT_KEEP_ALL)
+    {
+        ResizeStagedLuaEventTable(stage, policy);
+        entry = FindStagedLuaEventSlot(stage, policy, values);
+    }
+
+    if(!entry || *entry == 0)
+    {
+        StagedLuaEvent* event = AllocateAtEndOfArray(&stage->events, 1);
+        event->count = count;
+        event->valueCount = valueCount;
+        memcpy(event->values, values, sizeof(double)*valueCount);
+        if(entry)
+            *entry = stage->events.length;
+        return;
+    }
+
+    StagedLuaEvent* event = &stage->events.data[*entry-1];
+    assert(event->valueCount == valueCount);
+    event->count += count;
+    switch(policy->coalescing)
+    {
+        case LUA_EVENT_KEEP_ALL:
+            assert(!"Events should not have been coalesced.");
+            break;
+
+        case LUA_EVENT_KEEP_FIRST:
+            break;
+
+        case LUA_EVENT_KEEP_LAST:
+            memcpy(event->values, values, sizeof(double)*valueCount);
+            break;
+
+        case LUA_EVENT_ACCUMULATE:
+            for(int i = policy->keyValueCount; i < valueCount; i++)
+                event->values[i] += values[i];
+            break;
+    }
+}
+
+void QueueLuaEvent( LuaEventListener listener,
+                    const double* values,
+                    int valueCount )
+{
+    assert(!InSerialPhase()); // Events should be queued in the parallel phase!
+    assert(valueCount >= 0 && valueCount <= MAX_LUA_EVENT_VALUES);
+    const LuaEventFilter* filter = listener.filter;
+    const LuaEventPolicy* policy = &filter->policy;
+    LuaEventSegment* segment = BeginLuaEventSegment(listener.worker);
+    const int half = segment->writeHalf;
+
+    if(policy->coalescing == LUA_EVENT_KEEP_ALL &&
+       policy->maxEventsPerFrame == 0)
+    {
+        // Nothing to filter:
+        AddNumericLuaEvent(segment->buffers[half], 1, values, valueCount);
+    }
+    else
+    {
+        LuaEventStage* stage = GetSegmentLuaEventStage(segment, half, filter);
+        StageLuaEvent(stage, policy, 1, values, valueCount);
+    }
+
+    EndLuaEventSegment(segment);
+}
+
+/**
+ * Merges the staged events of all producers and adds them to the event
+ * buffer - as far as the limit allows.
+ */
+static void FlushLuaEventFilter( LuaWorker* worker, LuaEventFilter* filter, int half )
+{
+    LuaEventStage* mergedEvents = &filter->mergedEvents;
+    REPEAT(MAX_LUA_EVENT_PRODUCERS, i)
+    {
+        Array<LuaEventStage>* stages = &worker->eventSegments[i]->stages[half];
+        if(filter->index >= stages->length)
+            continue;
+
+        LuaEventStage* stage = &stages->data[filter->index];
+        REPEAT(stage->events.length, j)
+        {
+            const StagedLuaEvent* event = &stage->events.data[j];
+            StageLuaEvent(mergedEvents,
+                          &filter->policy,
+                          event->count,
+                          event->values,
+                          event->valueCount);
+        }
+        ClearLuaEventStage(stage);
+    }
+
+    const int limit = filter->policy.maxEventsPerFrame;
+    REPEAT(mergedEvents->events.length, i)
+    {
+        const StagedLuaEvent* event = &mergedEvents->events.data[i];
+
+        // Each event is counted once - either as dropped or as coalesced:
+        if(limit > 0 && i >= limit)
+        {
+            worker->droppedEventCount += event->count;
+            continue;
+        }
+        worker->coalescedEventCount += event->count - 1;
+        AddNumericLuaEvent(worker->eventBuffer,
+                           event->count,
+                           event->values,
+                           event->valueCount);
+    }
+    ClearLuaEventStage(mergedEvents);
 }
 
 static void PreparePublicBuffer(LuaBuffer* buffer)
@@ -709,28 +1746,44 @@ static void CompletePublicBuffer(LuaBuffer* buffer)
 }
 
 /**
- * Swaps out public and private buffers.  So that the earlier public buffer
- * becomes the new private buffer and is ready to be read by the Lua worker.
- * The former private buffer consequently becomes the new public buffer and is
- * ready to be filled with events.
+ * Moves the events of all producers into the event buffer, where the Lua
+ * worker can read them during the next frame.
+ *
+ * Producers may create events in the meantime.  They go to the other half of
+ * their segment and are merged in the next frame.
  */
-static void SwapEventBuffers( LuaWorker* worker )
+static void MergeLuaEvents( LuaWorker* worker )
 {
     assert(InSerialPhase());
     assert(worker->job == INVALID_JOB_ID);
 
-    LuaBuffer* publicBuffer  = worker->publicEventBuffer;
-    LuaBuffer* privateBuffer = worker->privateEventBuffer;
+    const int half = worker->eventSegments[0]->activeHalf;
+    REPEAT(MAX_LUA_EVENT_PRODUCERS, i)
+    {
+        LuaEventSegment* segment = worker->eventSegments[i];
+        assert(segment->activeHalf == half);
+        segment->activeHalf = 1 - half;
 
-    PreparePublicBuffer(privateBuffer); // prepare the new public buffer
+        // Wait for events which were begun in the old half:
+        while(segment->busy)
+            thrd_yield();
+    }
 
-    Ensure(mtx_trylock(&worker->publicEventBufferMutex) == thrd_success);
-    // ^- More of a sanity check.
+    LuaBuffer* buffer = worker->eventBuffer;
+    PreparePublicBuffer(buffer);
 
-    CompletePublicBuffer(publicBuffer); // complete the old public buffer
+    // Producers are merged in the same order each frame:
+    REPEAT(MAX_LUA_EVENT_PRODUCERS, i)
+    {
+        LuaBuffer* segmentBuffer = worker->eventSegments[i]->buffers[half];
+        AppendLuaBuffer(buffer, segmentBuffer);
+        ClearLuaBuffer(segmentBuffer);
+    }
 
-    worker->publicEventBuffer  = privateBuffer;
-    worker->privateEventBuffer = publicBuffer;
+    worker->coalescedEventCount = 0;
+    worker->droppedEventCount = 0;
+    REPEAT(worker->eventFilters.length, i)
+        FlushLuaEventFilter(worker, worker->eventFilters.data[i], half);
 
-    Ensure(mtx_unlock(&worker->publicEventBufferMutex) == thrd_success);
+    CompletePublicBuffer(buffer);
 }
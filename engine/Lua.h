@@ -1,6 +1,8 @@
 #ifndef __KONSTRUKT_LUA__
 #define __KONSTRUKT_LUA__
 
+#include <stdint.h> // int64_t
+
 extern "C"
 {
 #define LUA_LIB
@@ -16,18 +18,94 @@ enum
 
 struct LuaWorker;
 struct LuaBuffer;
+struct LuaEventFilter;
 
 struct LuaEventListener
 {
     // Internal properties - do not use!
     LuaWorker* worker;
     const char* name;
+    LuaEventFilter* filter;
+};
+
+/**
+ * How #QueueLuaEvent treats events, which have the same key during a frame.
+ */
+enum LuaEventCoalescing
+{
+    LUA_EVENT_KEEP_ALL,
+    LUA_EVENT_KEEP_FIRST,
+    LUA_EVENT_KEEP_LAST,
+
+    /**
+     * Sums up the values, which aren't part of the key.  Use this for
+     * things like impulses.  Scripts can divide by the event count to get
+     * an average.
+     */
+    LUA_EVENT_ACCUMULATE
+};
+
+struct LuaEventPolicy
+{
+    LuaEventCoalescing coalescing;
+
+    /**
+     * The leading values of an event, which form its key.
+     */
+    int keyValueCount;
+
+    /**
+     * Events beyond this limit are dropped.  Zero means unlimited.
+     */
+    int maxEventsPerFrame;
+};
+
+static const int MAX_LUA_EVENT_VALUES = 16;
+
+struct LuaConfig
+{
+    /**
+     * Time in seconds, which each worker may spend on incremental garbage
+     * collection per frame.
+     */
+    double gcTimeBudget;
+
+    /**
+     * Collector work per frame relative to the memory, which the worker
+     * allocated since the last frame.  Values above one let the collector
+     * outpace the scripts, so the heap doesn't grow.
+     */
+    float gcPace;
+
+    /**
+     * Store compiled scripts in `shared-state/lua-cache`.  See
+     * #LoadLuaScript.
+     */
+    bool bytecodeCache;
+
+    /**
+     * VM instructions between two samples of the #LuaProfiler.  Zero
+     * disables the profiler.
+     */
+    int profilerInterval;
+
+    /**
+     * Vfs path to which the profile of all workers is written when Lua is
+     * destroyed.  May be `NULL` or empty.
+     */
+    const char* profileFile;
 };
 
 
 // --- General ---
 
-void InitLua();
+/**
+ * Lua workers only collect garbage incrementally at the end of their
+ * parallel phase.  Full collections are done after loading a worker and
+ * when scripts request them using `CollectGarbage` (e.g. during loading
+ * screens).
+ */
+void InitLua( LuaConfig config );
 void DestroyLua();
 
 /**
@@ -42,11 +120,35 @@ void BeginLuaUpdate();
  */
 void CompleteLuaUpdate();
 
+/**
+ * Sums over all workers, which are also published as profiler counters.
+ */
+struct LuaStatistics
+{
+    // Of the last parallel phase:
+    int64_t memory; // after garbage collection, in bytes
+    double gcTime; // in seconds
+    int gcStepCount; // Zero if a full collection was done.
+
+    // Of the last event merge.  Events which were coalesced into an event,
+    // that was dropped, only count as dropped:
+    int coalescedEventCount;
+    int droppedEventCount;
+};
+
+LuaStatistics GetLuaStatistics();
+
 /**
  * Registers a native function in Lua.
  */
 void RegisterLuaFunction( const char* name, lua_CFunction fn );
 #define REGISTER_LUA_FUNCTION(Name) RegisterLuaFunction(#Name, Lua_##Name)
+
+/**
+ * Like #RegisterLuaFunction, but the function may also be called during the
+ * parallel phase - i.e. concurrently by multiple workers.
+ */
+void RegisterThreadSafeLuaFunction( const char* name, lua_CFunction fn );
 #define RegisterFunctionInLua RegisterLuaFunction
 
 
@@ -68,17 +170,58 @@ void RegisterLuaFunction( const char* name, lua_CFunction fn );
 void RegisterLuaType( const char* name, lua_CFunction gcCallback );
 #define RegisterUserDataTypeInLua RegisterLuaType
 
+/**
+ * Like #RegisterLuaType, but also sets the functions of `methods` in the
+ * metatable.  Use this for metamethods like `__add`.
+ *
+ * @param methods
+ * List which is terminated by a `{NULL, NULL}` entry.  It must stay valid
+ * until Lua is destroyed.
+ */
+void RegisterLuaTypeWithMethods( const char* name,
+                                 lua_CFunction gcCallback,
+                                 const luaL_Reg* methods );
+
 
 // --- LuaWorker ---
 
 /**
  * Creates or destroys workers so there are exactly `count` living ones.
+ *
+ * Each worker has its own Lua state and runs its parallel phase as a
+ * separate job, so workers can't share values.  The states allocate their
+ * memory from a #LuaAllocator per worker.  Scripts can partition
+ * their work using `GetLuaWorkerIndex` and `GetLuaWorkerCount`.
+ *
+ * Workers communicate using `SendLuaMessage(receiver, ...)`.  The values
+ * are copied into a #LuaBuffer and passed to the serial callback of the
+ * receiver in its next serial phase.  Messages are ordered by the index of
+ * the sender and then by the order in which they were sent, so the result
+ * doesn't depend on job scheduling.
  */
 void SetLuaWorkerCount( int count );
 
 
 // --- Utils ---
 
+/**
+ * Compiles the script at `vfsPath` and pushes it as function on top of the
+ * stack.
+ *
+ * If the bytecode cache is enabled, compiled chunks are kept in
+ * `shared-state/lua-cache`.  Cache entries are keyed by the path and the
+ * source of the script, so changed scripts are compiled again.  Entries
+ * which Lua rejects (e.g. because they were created by another Lua build)
+ * are replaced.
+ *
+ * May only be called in the serial phase.
+ *
+ * @return
+ * `false` if the script couldn't be loaded.  An error message is pushed
+ * instead of the function then.
+ */
+bool LoadLuaScript( lua_State* l, const char* vfsPath );
+
 /**
  * Allocates memory for a user defined data structure in Lua
  * and pushes it on top of the stack.
@@ -171,19 +314,34 @@ unsigned int CheckIdFromLua( lua_State* l, int stackPosition );
 /**
  * Use this constant to initialize unused event listeners.
  */
-static const LuaEventListener INVALID_LUA_EVENT_LISTENER = {NULL, NULL};
+static const LuaEventListener INVALID_LUA_EVENT_LISTENER = {NULL, NULL, NULL};
 
 inline bool IsValidLuaEventListener( LuaEventListener listener )
 {
     return listener.worker && listener.name;
 }
 
+/**
+ * Listeners of the same worker and name share their #LuaEventPolicy.
+ */
 LuaEventListener GetLuaEventListener( lua_State* l, const char* name );
 
+/**
+ * Sets the policy for events named `name` of the calling worker.
+ * The default policy keeps all events.
+ *
+ * Scripts can use `SetEventPolicy(name, coalescing, keyValueCount,
+ * maxEventsPerFrame)`, where `coalescing` is one of `all`, `first`, `last`
+ * and `accumulate`.
+ */
+void SetLuaEventPolicy( lua_State* l, const char* name, LuaEventPolicy policy );
+
 /**
  * Creates a new event for Lua.
  *
- * May block if other threads are currently creating events.
+ * Each thread writes to its own buffer, so this doesn't block.  Events of
+ * one thread arrive in the order in which they were created.  Events can't
+ * be nested.
  *
  * @return A buffer which takes event parameters as values.
  * It may only be used to add new values.
@@ -194,7 +352,23 @@ LuaBuffer* BeginLuaEvent( LuaEventListener listener );
 
 /**
  * After all parameters were added this is used to complete the event.
+ * Must be called by the thread which began the event.
  */
 void CompleteLuaEvent( LuaEventListener listener );
 
+/**
+ * Creates an event, which consists of numbers only, according to the
+ * listeners #LuaEventPolicy.
+ *
+ * Coalesced events are held back until the events are merged in the
+ * serial phase, so only one event per key reaches the buffer.  In Lua the event has two
+ * parameters:  The number of events it represents and a packed array of
+ * the values.  (See #AddDoubleArrayToLuaBuffer)
+ *
+ * Use this for events which are fired often, like collisions.
+ */
+void QueueLuaEvent( LuaEventListener listener,
+                    const double* values,
+                    int valueCount );
+
 #endif
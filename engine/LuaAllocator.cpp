@@ -0,0 +1,149 @@
+#include <assert.h>
+#include <string.h> // memset, memcpy
+
+#include "Common.h"
+#include "LuaAllocator.h"
+
+
+static const int LARGE_ALLOCATION = -1;
+
+
+void InitLuaAllocator( LuaAllocator* allocator )
+{
+    memset(allocator, 0, sizeof(LuaAllocator));
+    InitArray(&allocator->slabs);
+}
+
+void DestroyLuaAllocator( LuaAllocator* allocator )
+{
+    assert(allocator->largeBytes == 0);
+    REPEAT(allocator->slabs.length, i)
+        Free(allocator->slabs.data[i]);
+    DestroyArray(&allocator->slabs);
+    memset(allocator, 0, sizeof(LuaAllocator));
+}
+
+/**
+ * @return
+ * Index of the pool or #LARGE_ALLOCATION.
+ */
+static int GetLuaPoolIndex( size_t size )
+{
+    assert(size > 0);
+    if(size > (size_t)LUA_POOL_MAX_BLOCK_SIZE)
+        return LARGE_ALLOCATION;
+    else
+        return (int)(size-1) / LUA_POOL_GRANULARITY;
+}
+
+static int GetLuaPoolBlockSize( int poolIndex )
+{
+    return (poolIndex+1) * LUA_POOL_GRANULARITY;
+}
+
+static void* AllocateLuaPoolBlock( LuaAllocator* allocator, int poolIndex )
+{
+    LuaPool* pool = &allocator->pools[poolIndex];
+    const int blockSize = GetLuaPoolBlockSize(poolIndex);
+    allocator->pooledBytes += blockSize;
+
+    if(pool->freeBlocks)
+    {
+        LuaPoolBlock* block = pool->freeBlocks;
+        pool->freeBlocks = block->next;
+        return block;
+    }
+
+    if(pool->slabEnd - pool->slabPosition < blockSize)
+    {
+        // The rest of the old slab is lost, but it's smaller than a block:
+        char* slab = (char*)Alloc(LUA_POOL_SLAB_SIZE);
+        AppendToArray(&allocator->slabs, 1, (void**)&slab);
+        allocator->reservedBytes += LUA_POOL_SLAB_SIZE;
+        pool->slabPosition = slab;
+        pool->slabEnd = slab + LUA_POOL_SLAB_SIZE;
+    }
+
+    void* block = pool->slabPosition;
+    pool->slabPosition += blockSize;
+    return block;
+}
+
+static void FreeLuaPoolBlock( LuaAllocator* allocator, int poolIndex, void* pointer )
+{
+    LuaPool* pool = &allocator->pools[poolIndex];
+    LuaPoolBlock* block = (LuaPoolBlock*)pointer;
+    block->next = pool->freeBlocks;
+    pool->freeBlocks = block;
+    allocator->pooledBytes -= GetLuaPoolBlockSize(poolIndex);
+}
+
+static void* AllocateLuaMemory( LuaAllocator* allocator, size_t size )
+{
+    const int poolIndex = GetLuaPoolIndex(size);
+    if(poolIndex == LARGE_ALLOCATION)
+    {
+        allocator->largeBytes += (int)size;
+        return Alloc(size);
+    }
+    else
+    {
+        return AllocateLuaPoolBlock(allocator, poolIndex);
+    }
+}
+
+static void FreeLuaMemory( LuaAllocator* allocator, void* pointer, size_t size )
+{
+    const int poolIndex = GetLuaPoolIndex(size);
+    if(poolIndex == LARGE_ALLOCATION)
+    {
+        allocator->largeBytes -= (int)size;
+        Free(pointer);
+    }
+    else
+    {
+        FreeLuaPoolBlock(allocator, poolIndex, pointer);
+    }
+}
+
+void* ReallocLuaMemory( void* allocatorPointer,
+                        void* pointer,
+                        size_t oldSize,
+                        size_t newSize )
+{
+    LuaAllocator* allocator = (LuaAllocator*)allocatorPointer;
+
+    // For new objects Lua passes the object type as old size:
+    if(!pointer)
+        oldSize = 0;
+
+    allocator->usedBytes += (int)newSize - (int)oldSize;
+
+    if(newSize == 0)
+    {
+        if(pointer)
+            FreeLuaMemory(allocator, pointer, oldSize);
+        return NULL;
+    }
+
+    allocator->allocationCount++;
+
+    if(!pointer)
+        return AllocateLuaMemory(allocator, newSize);
+
+    const int oldPoolIndex = GetLuaPoolIndex(oldSize);
+    const int newPoolIndex = GetLuaPoolIndex(newSize);
+    if(oldPoolIndex == newPoolIndex)
+    {
+        if(newPoolIndex != LARGE_ALLOCATION)
+            return pointer; // The block is large enough already.
+
+        allocator->largeBytes += (int)newSize - (int)oldSize;
+        return Realloc(pointer, newSize);
+    }
+
+    void* newPointer = AllocateLuaMemory(allocator, newSize);
+    memcpy(newPointer, pointer, oldSize < newSize ? oldSize : newSize);
+    FreeLuaMemory(allocator, pointer, oldSize);
+    return newPointer;
+}
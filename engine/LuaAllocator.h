@@ -0,0 +1,81 @@
+#ifndef __KONSTRUKT_LUA_ALLOCATOR__
+#define __KONSTRUKT_LUA_ALLOCATOR__
+
+#include <stddef.h> // size_t
+
+#include "Array.h"
+
+
+static const int LUA_POOL_GRANULARITY = 16; // Block sizes are multiples of this.
+static const int LUA_POOL_MAX_BLOCK_SIZE = 256;
+static const int LUA_POOL_COUNT = LUA_POOL_MAX_BLOCK_SIZE / LUA_POOL_GRANULARITY;
+static const int LUA_POOL_SLAB_SIZE = 16*1024;
+
+
+struct LuaPoolBlock
+{
+    LuaPoolBlock* next;
+};
+
+/**
+ * Blocks of a single size class.
+ *
+ * Released blocks are put on a free list.  New blocks are cut from the
+ * current slab once the free list is empty.
+ */
+struct LuaPool
+{
+    LuaPoolBlock* freeBlocks;
+    char* slabPosition;
+    char* slabEnd;
+};
+
+/**
+ * Memory allocator for a single Lua state.
+ *
+ * Lua creates lots of tiny objects (strings, tables, closures and small user
+ * data like vectors), which are served from per size class pools.  Larger
+ * allocations, like table arrays or long strings, are passed to #Realloc.
+ * Slabs are allocated using #Alloc too, so all memory shows up in the engine
+ * allocation accounting.
+ *
+ * Slabs are only released when the allocator is destroyed.  Since each pool
+ * only holds blocks of the same size, its free blocks can always be reused
+ * by the next allocation of that size class.
+ *
+ * The allocator isn't thread-safe.  That's fine as long as it's only used by
+ * one Lua state, since a state may only be accessed by one thread at a time
+ * anyway.
+ */
+struct LuaAllocator
+{
+    LuaPool pools[LUA_POOL_COUNT];
+    Array<void*> slabs;
+
+    // Statistics:
+    int usedBytes; // Sum of all requested sizes
+    int pooledBytes; // Pool blocks which are in use
+    int reservedBytes; // Allocated slabs
+    int largeBytes; // Allocations which are too large for the pools
+    int allocationCount; // Number of allocations including reallocations
+};
+
+
+void InitLuaAllocator( LuaAllocator* allocator );
+
+/**
+ * Frees all slabs.  Large allocations must have been freed already - i.e.
+ * the Lua state must have been closed.
+ */
+void DestroyLuaAllocator( LuaAllocator* allocator );
+
+/**
+ * Implements `lua_Alloc`, so it can be passed to `lua_newstate` along with a
+ * #LuaAllocator as user data.
+ */
+void* ReallocLuaMemory( void* allocator,
+                        void* pointer,
+                        size_t oldSize,
+                        size_t newSize );
+
+#endif
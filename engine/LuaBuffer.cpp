@@ -1,5 +1,8 @@
 #include <assert.h>
 #include <string.h> // strlen, memcpy
+#include <stdint.h> // uintptr_t, int32_t, uint32_t
+#include <math.h> // floor, signbit
+#include <limits> // std::numeric_limits
 
 #include "Common.h"
 #include "Array.h"
@@ -18,6 +21,7 @@ enum TokenType
     NUMBER_TOKEN,
     STRING_TOKEN,
     USER_DATA_TOKEN,
+    ARRAY_TOKEN,
 #if defined(SIMPLE)
     LIST_START_TOKEN,
     LIST_END_TOKEN
@@ -44,6 +48,13 @@ struct Token
             int size;
             void* data;
         } userData;
+        struct
+        {
+            int length;
+            unsigned short type; // LuaBufferArrayType
+            unsigned short recordSize;
+            const void* data;
+        } array;
 #if !defined(SIMPLE)
         struct
         {
@@ -53,6 +64,25 @@ struct Token
     } data;
 };
 
+/**
+ * Header of the user data, which represents packed arrays in Lua.
+ * The elements follow directly.
+ */
+struct PackedArray
+{
+    int length;
+    unsigned short type; // LuaBufferArrayType
+    unsigned short recordSize;
+};
+
+static const char* PACKED_ARRAY_TYPE = "PackedArray";
+
+/**
+ * Tables which are nested deeper are rejected.  This also stops cyclic
+ * tables, before they overflow the C stack.
+ */
+static const int MAX_LUA_BUFFER_TABLE_DEPTH = 64;
+
 #if !defined(SIMPLE)
 struct Container
 {
@@ -92,8 +122,14 @@ struct LuaBufferTypeDescription
                       int length,
                       int flags);
     void (*addUserData)(void* buffer_, void* value, int size);
+    void (*addArray)(void* buffer_,
+                     LuaBufferArrayType type,
+                     const void* values,
+                     int length,
+                     int recordSize);
     void (*beginList)(void* buffer_);
     void (*endList)(void* buffer_);
+    void (*append)(void* buffer_, const void* source_);
     void (*clear)(void* buffer_);
     int  (*getData)(const void* buffer_, const char** dataOut);
     int  (*pushToLua)(const char* data, int length, lua_State* state);
@@ -152,6 +188,40 @@ static Token* CreateToken(NativeBuffer* buffer, TokenType type)
     return token;
 }
 
+/**
+ * Tokens point into the auxiliary data, so they need to be updated when it
+ * is moved.
+ */
+static void* AllocateAuxData(NativeBuffer* buffer, int size)
+{
+    const char* oldData = buffer->auxData.data;
+    const int oldLength = buffer->auxData.length;
+    char* data = AllocateAtEndOfArray(&buffer->auxData, size);
+    const char* newData = buffer->auxData.data;
+    if(oldData && newData != oldData)
+    {
+        REPEAT(buffer->tokens.length, i)
+        {
+            Token* token = &buffer->tokens.data[i];
+            const char** pointer;
+            if(token->type == STRING_TOKEN)
+                pointer = &token->data.string.data;
+            else if(token->type == USER_DATA_TOKEN && token->data.userData.size > 0)
+                pointer = (const char**)&token->data.userData.data;
+            else if(token->type == ARRAY_TOKEN)
+                pointer = (const char**)&token->data.array.data;
+            else
+                continue;
+
+            // Literal strings and light user data are left alone:
+            const uintptr_t offset = (uintptr_t)*pointer - (uintptr_t)oldData;
+            if(offset < (uintptr_t)oldLength)
+                *pointer = newData + offset;
+        }
+    }
+    return data;
+}
+
 static void NativeBuffer_AddNil(void* buffer_)
 {
     NativeBuffer* buffer = (NativeBuffer*)buffer_;
@@ -193,7 +263,7 @@ static void NativeBuffer_AddString(void* buffer_,
     }
     else
     {
-        char* stringBuffer = AllocateAtEndOfArray(&buffer->auxData, length);
+        char* stringBuffer = (char*)AllocateAuxData(buffer, length);
         memcpy(stringBuffer, string, length);
         token->data.string.data = stringBuffer;
     }
@@ -210,12 +280,42 @@ static void NativeBuffer_AddUserData(void* buffer_, void* value, int size)
     }
     else
     {
-        void* dataBuffer = AllocateAtEndOfArray(&buffer->auxData, size);
+        void* dataBuffer = AllocateAuxData(buffer, size);
         memcpy(dataBuffer, value, size);
         token->data.userData.data = dataBuffer;
     }
 }
 
+static int GetArrayElementSize(LuaBufferArrayType type)
+{
+    switch(type)
+    {
+        case LUA_BUFFER_FLOAT_ARRAY: return sizeof(float);
+        case LUA_BUFFER_INT32_ARRAY: return sizeof(int32_t);
+        case LUA_BUFFER_UINT32_ARRAY: return sizeof(uint32_t);
+        case LUA_BUFFER_DOUBLE_ARRAY: return sizeof(double);
+    }
+    FatalError("Unknown array type.");
+    return 0;
+}
+
+static void NativeBuffer_AddArray(void* buffer_,
+                                  LuaBufferArrayType type,
+                                  const void* values,
+                                  int length,
+                                  int recordSize)
+{
+    NativeBuffer* buffer = (NativeBuffer*)buffer_;
+    Token* token = CreateToken(buffer, ARRAY_TOKEN);
+    const int size = GetArrayElementSize(type) * length;
+    void* dataBuffer = AllocateAuxData(buffer, size);
+    memcpy(dataBuffer, values, size);
+    token->data.array.length = length;
+    token->data.array.type = type;
+    token->data.array.recordSize = recordSize;
+    token->data.array.data = dataBuffer;
+}
+
 #if defined(SIMPLE)
 static void NativeBuffer_BeginList(void* buffer_)
 {
@@ -252,6 +352,82 @@ static void NativeBuffer_EndList(void* buffer_)
 }
 #endif
 
+#if !defined(SIMPLE)
+/**
+ * @return
+ * Index of the token which follows the value at `tokenIndex`.
+ */
+static int SkipValue(const Token* tokens, int tokenIndex)
+{
+    const Token* token = &tokens[tokenIndex];
+    tokenIndex++;
+    if(token->type == LIST_TOKEN)
+    {
+        REPEAT(token->data.list.length, i)
+            tokenIndex = SkipValue(tokens, tokenIndex);
+    }
+    return tokenIndex;
+}
+#endif
+
+static void NativeBuffer_Append(void* buffer_, const void* source_)
+{
+    NativeBuffer* buffer = (NativeBuffer*)buffer_;
+    const NativeBuffer* source = (const NativeBuffer*)source_;
+#if !defined(SIMPLE)
+    assert(source->containerStack.length == 0);
+#endif
+
+    const int auxLength = source->auxData.length;
+    const char* sourceAux = source->auxData.data;
+    char* aux = NULL;
+    if(auxLength > 0)
+    {
+        aux = (char*)AllocateAuxData(buffer, auxLength);
+        memcpy(aux, sourceAux, auxLength);
+    }
+
+    const int tokenCount = source->tokens.length;
+    if(tokenCount == 0)
+        return;
+    const int firstToken = buffer->tokens.length;
+    AppendToArray(&buffer->tokens, tokenCount, source->tokens.data);
+
+    // Redirect pointers from the source's auxiliary data to the copy:
+    for(int i = firstToken; i < buffer->tokens.length; i++)
+    {
+        Token* token = &buffer->tokens.data[i];
+        const char** pointer;
+        if(token->type == STRING_TOKEN)
+            pointer = &token->data.string.data;
+        else if(token->type == USER_DATA_TOKEN && token->data.userData.size > 0)
+            pointer = (const char**)&token->data.userData.data;
+        else if(token->type == ARRAY_TOKEN)
+            pointer = (const char**)&token->data.array.data;
+        else
+            continue;
+
+        const uintptr_t offset = (uintptr_t)*pointer - (uintptr_t)sourceAux;
+        if(offset < (uintptr_t)auxLength)
+            *pointer = aux + offset;
+    }
+
+#if !defined(SIMPLE)
+    // The appended values become part of the open container:
+    Container* container = GetContainer(buffer);
+    if(container)
+    {
+        const Token* tokens = source->tokens.data;
+        int tokenIndex = 0;
+        while(tokenIndex < tokenCount)
+        {
+            tokenIndex = SkipValue(tokens, tokenIndex);
+            container->length++;
+        }
+    }
+#endif
+}
+
 static void NativeBuffer_Clear(void* buffer_)
 {
     NativeBuffer* buffer = (NativeBuffer*)buffer_;
@@ -269,6 +445,101 @@ static int NativeBuffer_GetData(const void* buffer_, const char** dataOut)
     return buffer->tokens.length * sizeof(Token);
 }
 
+static void PushPackedArrayElement(lua_State* l, const PackedArray* array, int index)
+{
+    const void* elements = array + 1;
+    switch((LuaBufferArrayType)array->type)
+    {
+        case LUA_BUFFER_FLOAT_ARRAY:
+            lua_pushnumber(l, ((const float*)elements)[index]);
+            break;
+
+        case LUA_BUFFER_INT32_ARRAY:
+            lua_pushinteger(l, ((const int32_t*)elements)[index]);
+            break;
+
+        case LUA_BUFFER_UINT32_ARRAY:
+            lua_pushunsigned(l, ((const uint32_t*)elements)[index]);
+            break;
+
+        case LUA_BUFFER_DOUBLE_ARRAY:
+            lua_pushnumber(l, ((const double*)elements)[index]);
+            break;
+    }
+}
+
+static int PackedArray_Unpack(lua_State* l)
+{
+    const PackedArray* array =
+        (const PackedArray*)luaL_checkudata(l, 1, PACKED_ARRAY_TYPE);
+    const int first = luaL_optinteger(l, 2, 1);
+    const int last  = luaL_optinteger(l, 3, array->length);
+    luaL_argcheck(l, first >= 1, 2, "out of range");
+    luaL_argcheck(l, last <= array->length, 3, "out of range");
+    if(first > last)
+        return 0;
+
+    const int count = last - first + 1;
+    luaL_checkstack(l, count, "too many values to unpack");
+    for(int i = first-1; i < last; i++)
+        PushPackedArrayElement(l, array, i);
+    return count;
+}
+
+/**
+ * Elements are accessed by their index.  Besides that `recordSize`,
+ * `recordCount` and `unpack(first, last)` are available.
+ */
+static int PackedArray_Index(lua_State* l)
+{
+    const PackedArray* array =
+        (const PackedArray*)luaL_checkudata(l, 1, PACKED_ARRAY_TYPE);
+
+    if(lua_type(l, 2) == LUA_TNUMBER)
+    {
+        const int index = lua_tointeger(l, 2);
+        if(index >= 1 && index <= array->length)
+            PushPackedArrayElement(l, array, index-1);
+        else
+            lua_pushnil(l);
+        return 1;
+    }
+
+    const char* key = luaL_checkstring(l, 2);
+    if(strcmp(key, "recordSize") == 0)
+        lua_pushinteger(l, array->recordSize);
+    else if(strcmp(key, "recordCount") == 0)
+        lua_pushinteger(l, array->length / array->recordSize);
+    else if(strcmp(key, "unpack") == 0)
+        lua_pushcfunction(l, PackedArray_Unpack);
+    else
+        lua_pushnil(l);
+    return 1;
+}
+
+static int PackedArray_Length(lua_State* l)
+{
+    const PackedArray* array =
+        (const PackedArray*)luaL_checkudata(l, 1, PACKED_ARRAY_TYPE);
+    lua_pushinteger(l, array->length);
+    return 1;
+}
+
+/**
+ * The metatable is created on demand, so that Lua states don't need to
+ * register it.
+ */
+static void PushPackedArrayMetatable(lua_State* l)
+{
+    if(luaL_newmetatable(l, PACKED_ARRAY_TYPE))
+    {
+        lua_pushcfunction(l, PackedArray_Index);
+        lua_setfield(l, -2, "__index");
+        lua_pushcfunction(l, PackedArray_Length);
+        lua_setfield(l, -2, "__len");
+    }
+}
+
 static void NativeBuffer_PushTokenToLua(lua_State* l,
                                         const Token* tokens,
                                         int tokenCount,
@@ -291,7 +562,7 @@ static void NativeBuffer_PushTokenToLua(lua_State* l,
             break;
 
         case NUMBER_TOKEN:
-            lua_pushinteger(l, token->data.number);
+            lua_pushnumber(l, token->data.number);
             break;
 
         case USER_DATA_TOKEN:
@@ -309,6 +580,23 @@ static void NativeBuffer_PushTokenToLua(lua_State* l,
             lua_pushlstring(l, token->data.string.data, token->data.string.length);
             break;
 
+        case ARRAY_TOKEN:
+            {
+                const LuaBufferArrayType type =
+                    (LuaBufferArrayType)token->data.array.type;
+                const int length = token->data.array.length;
+                const int size = GetArrayElementSize(type) * length;
+                PackedArray* array =
+                    (PackedArray*)lua_newuserdata(l, sizeof(PackedArray) + size);
+                array->length = length;
+                array->type = token->data.array.type;
+                array->recordSize = token->data.array.recordSize;
+                memcpy(array + 1, token->data.array.data, size);
+                PushPackedArrayMetatable(l);
+                lua_setmetatable(l, -2);
+                break;
+            }
+
 #if defined(SIMPLE)
         case LIST_START_TOKEN:
         {
@@ -371,8 +659,10 @@ static const LuaBufferTypeDescription BufferTypes[] =
         NativeBuffer_AddNumber,
         NativeBuffer_AddString,
         NativeBuffer_AddUserData,
+        NativeBuffer_AddArray,
         NativeBuffer_BeginList,
         NativeBuffer_EndList,
+        NativeBuffer_Append,
         NativeBuffer_Clear,
         NativeBuffer_GetData,
         NativeBuffer_PushToLua
@@ -457,6 +747,174 @@ void AddUserDataToLuaBuffer(LuaBuffer* buffer, void* value, int size)
     BufferTypes[buffer->type].addUserData(BufferImpl(buffer), value, size);
 }
 
+void AddFloatArrayToLuaBuffer(LuaBuffer* buffer, const float* values, int length)
+{
+    AddRecordsToLuaBuffer(buffer, LUA_BUFFER_FLOAT_ARRAY, values, 1, length);
+}
+
+void AddInt32ArrayToLuaBuffer(LuaBuffer* buffer, const int32_t* values, int length)
+{
+    AddRecordsToLuaBuffer(buffer, LUA_BUFFER_INT32_ARRAY, values, 1, length);
+}
+
+void AddRecordsToLuaBuffer(LuaBuffer* buffer,
+                           LuaBufferArrayType type,
+                           const void* records,
+                           int recordSize,
+                           int recordCount)
+{
+    assert(recordSize > 0 && recordSize <= 0xFFFF);
+    assert(recordCount >= 0);
+    assert(records || recordCount == 0);
+    BufferTypes[buffer->type].addArray(BufferImpl(buffer),
+                                       type,
+                                       records,
+                                       recordSize*recordCount,
+                                       recordSize);
+}
+
+void AddUInt32ArrayToLuaBuffer(LuaBuffer* buffer, const uint32_t* values, int length)
+{
+    AddRecordsToLuaBuffer(buffer, LUA_BUFFER_UINT32_ARRAY, values, 1, length);
+}
+
+void AddDoubleArrayToLuaBuffer(LuaBuffer* buffer, const double* values, int length)
+{
+    AddRecordsToLuaBuffer(buffer, LUA_BUFFER_DOUBLE_ARRAY, values, 1, length);
+}
+
+static int GetAbsoluteStackPosition(lua_State* l, int stackPosition)
+{
+    if(stackPosition < 0)
+        return lua_gettop(l) + stackPosition + 1;
+    else
+        return stackPosition;
+}
+
+/**
+ * Raises a Lua error if the value can't be copied.  This is checked
+ * beforehand, so a failed copy doesn't leave half a list behind.
+ *
+ * @param depth
+ * Number of tables which contain the value.
+ */
+static void CheckLuaValueForBuffer(lua_State* l, int stackPosition, int depth)
+{
+    switch(lua_type(l, stackPosition))
+    {
+        case LUA_TNIL:
+        case LUA_TBOOLEAN:
+        case LUA_TNUMBER:
+        case LUA_TSTRING:
+        case LUA_TLIGHTUSERDATA:
+            return;
+
+        case LUA_TTABLE:
+        {
+            if(depth >= MAX_LUA_BUFFER_TABLE_DEPTH)
+                luaL_error(l, "Can't serialize cyclic or too deeply nested table.");
+            stackPosition = GetAbsoluteStackPosition(l, stackPosition);
+            luaL_checkstack(l, 1, "table nested too deeply");
+            const int length = lua_rawlen(l, stackPosition);
+            for(int i = 1; i <= length; i++)
+            {
+                lua_rawgeti(l, stackPosition, i);
+                CheckLuaValueForBuffer(l, -1, depth+1);
+                lua_pop(l, 1);
+            }
+            return;
+        }
+
+        default:
+            luaL_error(l, "Can't serialize %s values.",
+                          luaL_typename(l, stackPosition));
+    }
+}
+
+/**
+ * Whether the number can be stored as integer without changing its value.
+ *
+ * Lua 5.2 only knows floating point numbers, so this must be checked before
+ * casting:  Converting NaN, infinities or numbers outside of the
+ * `lua_Integer` range is undefined.  Negative zero stays a number, so its
+ * sign isn't lost.
+ */
+static bool IsIntegralLuaNumber( lua_Number number )
+{
+    // -2^n is exact, while the maximum (2^n - 1) would be rounded up:
+    const lua_Number min = (lua_Number)std::numeric_limits<lua_Integer>::min();
+
+    // Written so that NaNs fail the test:
+    if(!(number >= min && number < -min))
+        return false;
+    if(number == 0)
+        return !signbit(number);
+    return floor(number) == number;
+}
+
+static void AddCheckedLuaValueToLuaBuffer(LuaBuffer* buffer, lua_State* l, int stackPosition)
+{
+    switch(lua_type(l, stackPosition))
+    {
+        case LUA_TNIL:
+            AddNilToLuaBuffer(buffer);
+            break;
+
+        case LUA_TBOOLEAN:
+            AddBooleanToLuaBuffer(buffer, lua_toboolean(l, stackPosition) != 0);
+            break;
+
+        case LUA_TNUMBER:
+        {
+            const lua_Number number = lua_tonumber(l, stackPosition);
+            if(IsIntegralLuaNumber(number))
+                AddIntegerToLuaBuffer(buffer, (lua_Integer)number);
+            else
+                AddNumberToLuaBuffer(buffer, number);
+            break;
+        }
+
+        case LUA_TSTRING:
+        {
+            size_t length;
+            const char* string = lua_tolstring(l, stackPosition, &length);
+            BufferTypes[buffer->type].addString(BufferImpl(buffer), string, length, 0);
+            break;
+        }
+
+        case LUA_TLIGHTUSERDATA:
+            AddUserDataToLuaBuffer(buffer, lua_touserdata(l, stackPosition), 0);
+            break;
+
+        case LUA_TTABLE:
+        {
+            stackPosition = GetAbsoluteStackPosition(l, stackPosition);
+            const int length = lua_rawlen(l, stackPosition);
+            BeginListInLuaBuffer(buffer);
+            for(int i = 1; i <= length; i++)
+            {
+                lua_rawgeti(l, stackPosition, i);
+                AddCheckedLuaValueToLuaBuffer(buffer, l, -1);
+                lua_pop(l, 1);
+            }
+            EndListInLuaBuffer(buffer);
+            break;
+        }
+    }
+}
+
+void AddLuaValuesToLuaBuffer(LuaBuffer* buffer,
+                             lua_State* l,
+                             int stackPosition,
+                             int count)
+{
+    assert(stackPosition > 0 || count == 0);
+    REPEAT(count, i)
+        CheckLuaValueForBuffer(l, stackPosition+i, 0);
+    REPEAT(count, i)
+        AddCheckedLuaValueToLuaBuffer(buffer, l, stackPosition+i);
+}
+
 void BeginListInLuaBuffer(LuaBuffer* buffer)
 {
     BufferTypes[buffer->type].beginList(BufferImpl(buffer));
@@ -467,6 +925,12 @@ void EndListInLuaBuffer(LuaBuffer* buffer)
     BufferTypes[buffer->type].endList(BufferImpl(buffer));
 }
 
+void AppendLuaBuffer(LuaBuffer* buffer, const LuaBuffer* source)
+{
+    assert(buffer->type == source->type);
+    BufferTypes[buffer->type].append(BufferImpl(buffer), ConstBufferImpl(source));
+}
+
 void ClearLuaBuffer(LuaBuffer* buffer)
 {
     BufferTypes[buffer->type].clear(BufferImpl(buffer));
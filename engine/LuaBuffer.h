@@ -1,6 +1,8 @@
 #ifndef __KONSTRUKT_LUA_BUFFER__
 #define __KONSTRUKT_LUA_BUFFER__
 
+#include <stdint.h> // int32_t, uint32_t
+
 #include "Lua.h"
 
 
@@ -13,6 +15,14 @@ enum LuaBufferType
     NATIVE_LUA_BUFFER
 };
 
+enum LuaBufferArrayType
+{
+    LUA_BUFFER_FLOAT_ARRAY,
+    LUA_BUFFER_INT32_ARRAY,
+    LUA_BUFFER_UINT32_ARRAY,
+    LUA_BUFFER_DOUBLE_ARRAY
+};
+
 enum LuaBufferStringFlags
 {
     /**
@@ -59,9 +69,55 @@ void AddStringToLuaBuffer(LuaBuffer* buffer,
  */
 void AddUserDataToLuaBuffer(LuaBuffer* buffer, void* value, int size);
 
+/**
+ * Adds packed numbers, which reach Lua as a single `PackedArray` user data
+ * instead of a table.
+ *
+ * Arrays support `array[i]` and `#array`.  `array:unpack(first, last)`
+ * returns a range of elements - like `table.unpack` does.  This is much
+ * cheaper than lists for events which are fired often.
+ */
+void AddFloatArrayToLuaBuffer(LuaBuffer* buffer, const float* values, int length);
+void AddInt32ArrayToLuaBuffer(LuaBuffer* buffer, const int32_t* values, int length);
+void AddUInt32ArrayToLuaBuffer(LuaBuffer* buffer, const uint32_t* values, int length);
+void AddDoubleArrayToLuaBuffer(LuaBuffer* buffer, const double* values, int length);
+
+/**
+ * Adds a packed array of flat records, which consist of `recordSize`
+ * elements each.
+ *
+ * In Lua `array.recordSize` and `array.recordCount` are available.  Field
+ * `f` of record `r` is `array[(r-1)*array.recordSize + f]`, so a whole
+ * record can be retrieved with `unpack`.
+ */
+void AddRecordsToLuaBuffer(LuaBuffer* buffer,
+                           LuaBufferArrayType type,
+                           const void* records,
+                           int recordSize,
+                           int recordCount);
+
+/**
+ * Copies `count` values from the Lua stack, starting at `stackPosition`.
+ *
+ * Tables are stored as lists, i.e. only their sequence is copied.  Raises a
+ * Lua error for values which can't be copied (like functions or cyclic
+ * tables) - before anything has been added to the buffer.
+ */
+void AddLuaValuesToLuaBuffer(LuaBuffer* buffer,
+                             lua_State* l,
+                             int stackPosition,
+                             int count);
+
 void BeginListInLuaBuffer(LuaBuffer* buffer);
 void EndListInLuaBuffer(LuaBuffer* buffer);
 
+/**
+ * Copies all values of `source` to the end of `buffer`.  If `buffer` has an
+ * open list, the values become its elements.  `source` must not have open
+ * lists and both buffers must have the same type.
+ */
+void AppendLuaBuffer(LuaBuffer* buffer, const LuaBuffer* source);
+
 /**
  * Remove all elements from the buffer - this should be a fast action.
  */
@@ -0,0 +1,346 @@
+#include <assert.h>
+#include <string.h> // memset, memcpy, strlen, strcmp
+#include <stdlib.h> // qsort
+
+#include "Common.h"
+#include "Crc32.h"
+#include "LuaProfiler.h"
+
+
+static const char* LUA_PROFILER_KEY = "LuaProfiler";
+
+
+struct LuaProfilerCounter
+{
+#if defined(KONSTRUKT_PROFILER_ENABLED)
+    Counter counter;
+#endif
+    char name[MAX_LUA_PROFILER_NAME_SIZE];
+    bool used; // By a function of a profiler, which hasn't been destroyed.
+};
+
+/**
+ * All counters which were ever handed out.
+ */
+static Array<LuaProfilerCounter*> LuaProfilerCounters;
+
+
+/**
+ * Lua functions are identified by their definition, C functions by the name
+ * under which they were called.
+ */
+static void GetLuaProfilerFunctionName( const lua_Debug* info,
+                                        char* name,
+                                        int nameSize )
+{
+    if(strcmp(info->what, "C") == 0)
+        FormatBuffer(name, nameSize, "[C] %s", info->name ? info->name : "?");
+    else if(strcmp(info->what, "main") == 0)
+        FormatBuffer(name, nameSize, "%s (main chunk)", info->short_src);
+    else
+        FormatBuffer(name, nameSize, "%s:%d", info->short_src, info->linedefined);
+}
+
+static int* FindLuaProfilerFunctionSlot( LuaProfiler* profiler,
+                                         uint32_t hash,
+                                         const char* name )
+{
+    const int mask = profiler->functionTable.length - 1;
+    int slot = hash & mask;
+    for(;;)
+    {
+        int* entry = &profiler->functionTable.data[slot];
+        if(*entry == 0)
+            return entry;
+        const LuaProfilerFunction* function = profiler->functions.data[*entry-1];
+        if(function->hash == hash &&
+           function->keyLength == (int)strlen(name) &&
+           strncmp(function->name, name, function->keyLength) == 0)
+            return entry;
+        slot = (slot+1) & mask;
+    }
+}
+
+/**
+ * Keeps the table at most half full, so probe sequences stay short.
+ */
+static void ResizeLuaProfilerFunctionTable( LuaProfiler* profiler )
+{
+    const int functionCount = profiler->functions.length;
+    int size = profiler->functionTable.length;
+    if(size >= 64 && (functionCount+1)*2 <= size)
+        return;
+
+    size = size < 64 ? 64 : size*2;
+    ClearArray(&profiler->functionTable);
+    int* table = AllocateAtEndOfArray(&profiler->functionTable, size);
+    memset(table, 0, sizeof(int)*size);
+    REPEAT(functionCount, i)
+    {
+        const LuaProfilerFunction* function = profiler->functions.data[i];
+        char name[MAX_LUA_PROFILER_NAME_SIZE];
+        CopyString(function->name, name, function->keyLength+1);
+        *FindLuaProfilerFunctionSlot(profiler, function->hash, name) = i+1;
+    }
+}
+
+static LuaProfilerFunction* GetLuaProfilerFunction( LuaProfiler* profiler,
+                                                    const lua_Debug* info )
+{
+    char name[MAX_LUA_PROFILER_NAME_SIZE];
+    GetLuaProfilerFunctionName(info, name, sizeof(name));
+    const uint32_t hash = CalcCrc32ForString(name);
+
+    ResizeLuaProfilerFunctionTable(profiler);
+    int* entry = FindLuaProfilerFunctionSlot(profiler, hash, name);
+    if(*entry != 0)
+        return profiler->functions.data[*entry-1];
+
+    LuaProfilerFunction* function = NEW(LuaProfilerFunction);
+    function->hash = hash;
+    function->keyLength = strlen(name);
+    function->lastSample = -1;
+
+    // The call site may know a name for Lua functions:
+    if(info->name && strcmp(info->what, "Lua") == 0)
+        FormatBuffer(function->name, sizeof(function->name), "%s (%s)", name, info->name);
+    else
+        CopyString(name, function->name, sizeof(function->name));
+
+    AppendToArray(&profiler->functions, 1, &function);
+    *entry = profiler->functions.length;
+    return function;
+}
+
+static void SampleLuaStack( LuaProfiler* profiler, lua_State* l )
+{
+    const double time = GetMonotonicTime();
+    const double elapsedTime = time - profiler->lastSampleTime;
+    profiler->lastSampleTime = time;
+    const int sample = profiler->sampleCount++;
+
+    lua_Debug info;
+    for(int level = 0; lua_getstack(l, level, &info); level++)
+    {
+        lua_getinfo(l, "Sn", &info);
+        LuaProfilerFunction* function = GetLuaProfilerFunction(profiler, &info);
+
+        if(level == 0)
+        {
+            function->sampleCount++;
+            function->selfTime += elapsedTime;
+            function->frameSelfTime += elapsedTime;
+        }
+
+        if(function->lastSample != sample)
+        {
+            function->totalTime += elapsedTime;
+            function->lastSample = sample;
+        }
+    }
+}
+
+static void LuaProfilerHook( lua_State* l, lua_Debug* info )
+{
+    lua_getfield(l, LUA_REGISTRYINDEX, LUA_PROFILER_KEY);
+    LuaProfiler* profiler = (LuaProfiler*)lua_touserdata(l, -1);
+    lua_pop(l, 1);
+    if(profiler)
+        SampleLuaStack(profiler, l);
+}
+
+void InitLuaProfiler( LuaProfiler* profiler,
+                      lua_State* l,
+                      int instructionInterval,
+                      const char* counterPrefix )
+{
+    assert(instructionInterval > 0);
+    memset(profiler, 0, sizeof(LuaProfiler));
+    profiler->state = l;
+    profiler->instructionInterval = instructionInterval;
+    profiler->lastSampleTime = GetMonotonicTime();
+    CopyString(counterPrefix, profiler->counterPrefix, sizeof(profiler->counterPrefix));
+    InitArray(&profiler->functions);
+    InitArray(&profiler->functionTable);
+
+    lua_pushlightuserdata(l, profiler);
+    lua_setfield(l, LUA_REGISTRYINDEX, LUA_PROFILER_KEY);
+    lua_sethook(l, LuaProfilerHook, LUA_MASKCOUNT, instructionInterval);
+}
+
+void DestroyLuaProfiler( LuaProfiler* profiler, bool stateClosed )
+{
+    if(!stateClosed)
+    {
+        lua_State* l = profiler->state;
+        lua_sethook(l, NULL, 0, 0);
+        lua_pushnil(l);
+        lua_setfield(l, LUA_REGISTRYINDEX, LUA_PROFILER_KEY);
+    }
+
+    REPEAT(profiler->functions.length, i)
+    {
+        LuaProfilerFunction* function = profiler->functions.data[i];
+        if(function->counter)
+        {
+            SetCounter(function->counter->counter, 0);
+            function->counter->used = false;
+        }
+        DELETE(function);
+    }
+    DestroyArray(&profiler->functions);
+    DestroyArray(&profiler->functionTable);
+    memset(profiler, 0, sizeof(LuaProfiler));
+}
+
+void ResumeLuaProfiler( LuaProfiler* profiler )
+{
+    profiler->lastSampleTime = GetMonotonicTime();
+}
+
+static int CompareLuaProfilerFunctions( const void* a_, const void* b_ )
+{
+    const LuaProfilerFunction* a = *(const LuaProfilerFunction**)a_;
+    const LuaProfilerFunction* b = *(const LuaProfilerFunction**)b_;
+    if(a->selfTime > b->selfTime)
+        return -1;
+    else if(a->selfTime < b->selfTime)
+        return 1;
+    else
+        return strcmp(a->name, b->name);
+}
+
+void DestroyLuaProfilerCounters()
+{
+    REPEAT(LuaProfilerCounters.length, i)
+    {
+        assert(!LuaProfilerCounters.data[i]->used);
+        DELETE(LuaProfilerCounters.data[i]);
+    }
+    DestroyArray(&LuaProfilerCounters);
+}
+
+#if defined(KONSTRUKT_PROFILER_ENABLED)
+/**
+ * Reuses the unused counter with the same name, as backends identify
+ * counters by their name.
+ */
+static LuaProfilerCounter* GetLuaProfilerCounter( const char* name )
+{
+    REPEAT(LuaProfilerCounters.length, i)
+    {
+        LuaProfilerCounter* counter = LuaProfilerCounters.data[i];
+        if(!counter->used && strcmp(counter->name, name) == 0)
+            return counter;
+    }
+
+    LuaProfilerCounter* counter = NEW(LuaProfilerCounter);
+    CopyString(name, counter->name, sizeof(counter->name));
+    counter->counter.fileName = __FILE__;
+    counter->counter.name = counter->name;
+    counter->counter.type = DEFAULT_COUNTER;
+    InitCounter(counter->counter);
+    AppendToArray(&LuaProfilerCounters, 1, &counter);
+    return counter;
+}
+
+static void InitLuaProfilerCounter( LuaProfiler* profiler,
+                                    LuaProfilerFunction* function )
+{
+    char name[MAX_LUA_PROFILER_NAME_SIZE];
+    FormatBuffer(name,
+                 sizeof(name),
+                 "%s/%s",
+                 profiler->counterPrefix,
+                 function->name);
+    function->counter = GetLuaProfilerCounter(name);
+    function->counter->used = true;
+    profiler->counterCount++;
+}
+
+/**
+ * Gives the most expensive functions, which were sampled in this frame, a
+ * counter - as long as there are counters left.
+ */
+static void AssignLuaProfilerCounters( LuaProfiler* profiler )
+{
+    const int functionCount = profiler->functions.length;
+    LuaProfilerFunction** functions = NEW_ARRAY(LuaProfilerFunction*, functionCount);
+    memcpy(functions, profiler->functions.data, sizeof(LuaProfilerFunction*)*functionCount);
+    qsort(functions,
+          functionCount,
+          sizeof(LuaProfilerFunction*),
+          CompareLuaProfilerFunctions);
+
+    for(int i = 0;
+        i < functionCount && profiler->counterCount < MAX_LUA_PROFILER_COUNTERS;
+        i++)
+    {
+        LuaProfilerFunction* function = functions[i];
+        if(!function->counter && function->frameSelfTime > 0)
+            InitLuaProfilerCounter(profiler, function);
+    }
+
+    DELETE_ARRAY(functions, functionCount);
+}
+#endif
+
+void PublishLuaProfilerCounters( LuaProfiler* profiler )
+{
+#if defined(KONSTRUKT_PROFILER_ENABLED)
+    if(profiler->counterCount < MAX_LUA_PROFILER_COUNTERS)
+        AssignLuaProfilerCounters(profiler);
+#endif
+
+    REPEAT(profiler->functions.length, i)
+    {
+        LuaProfilerFunction* function = profiler->functions.data[i];
+#if defined(KONSTRUKT_PROFILER_ENABLED)
+        if(function->counter)
+            SetCounter(function->counter->counter, (int64_t)(function->frameSelfTime * 1e6));
+#endif
+        function->frameSelfTime = 0;
+    }
+}
+
+static void AppendToReport( Array<char>* report, const char* text )
+{
+    AppendToArray(report, strlen(text), text);
+}
+
+void FormatLuaProfilerReport( const LuaProfiler* profiler,
+                              const char* title,
+                              Array<char>* report )
+{
+    const int functionCount = profiler->functions.length;
+    LuaProfilerFunction** functions = NEW_ARRAY(LuaProfilerFunction*, functionCount);
+    memcpy(functions, profiler->functions.data, sizeof(LuaProfilerFunction*)*functionCount);
+    qsort(functions,
+          functionCount,
+          sizeof(LuaProfilerFunction*),
+          CompareLuaProfilerFunctions);
+
+    double selfTimeSum = 0;
+    REPEAT(functionCount, i)
+        selfTimeSum += functions[i]->selfTime;
+
+    AppendToReport(report, Format("%s: %d samples every %d instructions\n",
+                                  title,
+                                  profiler->sampleCount,
+                                  profiler->instructionInterval));
+    AppendToReport(report, "   self ms  self %   total ms  samples  function\n");
+    REPEAT(functionCount, i)
+    {
+        const LuaProfilerFunction* function = functions[i];
+        const double share = selfTimeSum > 0 ? function->selfTime / selfTimeSum : 0;
+        AppendToReport(report, Format("%10.3f  %6.2f  %9.3f  %7d  %s\n",
+                                      function->selfTime * 1000.0,
+                                      share * 100.0,
+                                      function->totalTime * 1000.0,
+                                      function->sampleCount,
+                                      function->name));
+    }
+    AppendToReport(report, "\n");
+
+    DELETE_ARRAY(functions, functionCount);
+}
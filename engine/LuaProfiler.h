@@ -0,0 +1,130 @@
+#ifndef __KONSTRUKT_LUA_PROFILER__
+#define __KONSTRUKT_LUA_PROFILER__
+
+#include <stdint.h> // uint32_t
+
+#include "Constants.h" // KONSTRUKT_PROFILER_ENABLED
+#include "Array.h"
+#include "Profiler.h"
+#include "Lua.h"
+
+
+static const int MAX_LUA_PROFILER_NAME_SIZE = 128;
+
+/**
+ * Profiler backends can't release counters, so only this many functions of
+ * each profiler get one.
+ */
+static const int MAX_LUA_PROFILER_COUNTERS = 32;
+
+/**
+ * Counters are kept until #DestroyLuaProfilerCounters, since the profiler
+ * backends hold pointers to them.
+ */
+struct LuaProfilerCounter;
+
+
+/**
+ * Statistics of a single Lua or C function.
+ *
+ * Times are measured between samples, so they're only as precise as the
+ * sample interval allows.
+ */
+struct LuaProfilerFunction
+{
+    char name[MAX_LUA_PROFILER_NAME_SIZE]; // `source:line (name)` or `[C] name`
+    uint32_t hash;
+    int keyLength; // The call site name isn't part of the key.
+    int sampleCount; // Samples in which the function was running itself.
+    double selfTime; // in seconds
+    double totalTime; // Including the functions it called.
+    double frameSelfTime; // Since the last #PublishLuaProfilerCounters.
+    int lastSample; // Counts recursive calls only once.
+
+    LuaProfilerCounter* counter; // Self time of the last frame in microseconds.
+};
+
+/**
+ * Samples the call stack of a Lua state using a count hook.
+ *
+ * Each time the state executed `instructionInterval` VM instructions, the
+ * time since the previous sample is attributed to the running function
+ * (self time) and all functions on the stack (total time).  Time spent in C
+ * functions is attributed to them, as far as they return to Lua.
+ *
+ * Coroutines inherit the hook when they're created, but only their own
+ * stack is sampled.
+ */
+struct LuaProfiler
+{
+    lua_State* state;
+    int instructionInterval;
+    double lastSampleTime;
+    int sampleCount;
+    char counterPrefix[32];
+    int counterCount;
+
+    /**
+     * Entries are allocated individually, so pointers to them stay valid
+     * while the array grows.
+     */
+    Array<LuaProfilerFunction*> functions;
+
+    /**
+     * Open addressing hash table, which maps function hashes to functions.
+     * Holds the function index plus one, so zero marks empty slots.
+     */
+    Array<int> functionTable;
+};
+
+
+/**
+ * Installs the hook in the given state.
+ *
+ * @param counterPrefix
+ * Counters of the functions are named `<counterPrefix>/<function name>`.
+ */
+void InitLuaProfiler( LuaProfiler* profiler,
+                      lua_State* l,
+                      int instructionInterval,
+                      const char* counterPrefix );
+
+/**
+ * Removes the hook - if the state hasn't been closed yet.
+ *
+ * The counters of the profiler are reset and kept, so they can be reused by
+ * profilers created later on.
+ */
+void DestroyLuaProfiler( LuaProfiler* profiler, bool stateClosed );
+
+/**
+ * Frees the counters of all destroyed profilers.  Call this after
+ * #DestroyProfiler, as the profiler backends may use them until then.
+ */
+void DestroyLuaProfilerCounters();
+
+/**
+ * Call before Lua code is run, so the time in which the state was idle isn't
+ * attributed to the function of the next sample.
+ */
+void ResumeLuaProfiler( LuaProfiler* profiler );
+
+/**
+ * Sets the counters of the engine #Profiler to the self time, which the
+ * functions used since the last call.  Should be called once per frame.
+ *
+ * Counters are handed out to the functions with the highest self time, until
+ * #MAX_LUA_PROFILER_COUNTERS are in use.  Other functions only show up in the
+ * report.
+ */
+void PublishLuaProfilerCounters( LuaProfiler* profiler );
+
+/**
+ * Appends a table of all sampled functions - sorted by self time - to
+ * `report`.  The text is not zero terminated.
+ */
+void FormatLuaProfilerReport( const LuaProfiler* profiler,
+                              const char* title,
+                              Array<char>* report );
+
+#endif
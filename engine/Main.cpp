@@ -12,9 +12,12 @@
 #include "Controls.h"
 #include "OpenGL.h"
 #include "Vertex.h"
+#include "Mesh.h"
+#include "Texture.h"
 #include "Audio.h"
 #include "Math.h"
 #include "Lua.h"
+#include "LuaProfiler.h"
 #include "PhysicsWorld.h"
 #include "RenderTarget.h"
 #include "RenderManager.h"
@@ -23,6 +26,7 @@
 #include "Time.h"
 #include "Vfs.h"
 #include "JobManager.h"
+#include "RenderCommandQueue.h"
 
 #include "lua_bindings/Audio.h"
 #include "lua_bindings/AttachmentTarget.h"
@@ -99,21 +103,46 @@ static void InitModules( const char* arg0, const Arguments* arguments )
     InitWindow();
     InitGPUProfiler();
     InitVfs(arg0, arguments->state, arguments->sharedState);
-    InitLua();
+    InitLua({GetConfigFloat("lua.gc-time-budget", 1) / 1000.0, // ms
+             GetConfigFloat("lua.gc-pace", 2),
+             GetConfigBool("lua.bytecode-cache", true),
+             GetConfigInt("debug.lua-profiler-interval", 0),
+             GetConfigString("debug.lua-profile-file", "state/lua-profile.txt")});
     InitTime();
     InitAudio();
     InitControls();
     InitShader();
+    InitMeshArena({GetConfigInt("opengl.mesh-arena-vertices", 262144),
+                   GetConfigInt("opengl.mesh-arena-indices", 1048576)});
+    InitTextureStreaming({GetConfigInt("opengl.texture-upload-bytes", 4194304)});
     InitRenderManager();
     InitDefaultRenderTarget();
+
+    // From now on the OpenGL context belongs to the render thread:
+    const bool useRenderThread = GetConfigBool("opengl.render-thread", true);
+    if(useRenderThread)
+        ReleaseWindowContext();
+    InitRenderCommandQueue({useRenderThread,
+                            MakeWindowContextCurrent,
+                            ReleaseWindowContext});
+
     RegisterAllModulesInLua();
 }
 
 static void DestroyModules()
 {
     DestroyLua();
+    CompleteLuaFileJobs();
+
+    const bool usedRenderThread = !InRenderThread();
+    DestroyRenderCommandQueue();
+    if(usedRenderThread)
+        MakeWindowContextCurrent();
+
     DestroyDefaultRenderTarget();
     DestroyRenderManager();
+    DestroyTextureStreaming();
+    DestroyMeshArena();
     DestroyShader();
     DestroyControls();
     DestroyAudio();
@@ -125,6 +154,7 @@ static void DestroyModules()
     DestroyJobManager();
     DestroyCommon();
     DestroyProfiler();
+    DestroyLuaProfilerCounters();
 }
 
 static void InitScript( const Arguments* args )
@@ -149,7 +179,7 @@ static void InitScript( const Arguments* args )
     //    lua_setglobal(GetLuaState(), "_scenario");
     //}
 
-    SetLuaWorkerCount(1);
+    SetLuaWorkerCount(GetConfigInt("lua.workers", 1));
 }
 
 static void RunSimulation()
@@ -163,6 +193,7 @@ static void RunSimulation()
         const double curTime = glfwGetTime();
         const double timeDelta = curTime-lastTime;
         UpdateTime(timeDelta);
+        PollWindowEvents();
         UpdateControls(timeDelta);
         lastTime = curTime;
 
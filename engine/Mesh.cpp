@@ -1,19 +1,57 @@
-#include <string.h> // memset
+#include <assert.h>
+#include <math.h> // sqrtf, log2f, floorf
+#include <string.h> // memset, memcpy
 
 #include "Common.h"
 #include "OpenGL.h"
+#include "Array.h"
+#include "DrawList.h" // MeshDrawRange, IndirectDrawCommand
 #include "MeshBuffer.h"
+#include "OpenGLState.h"
+#include "Profiler.h"
+#include "RangeAllocator.h"
 #include "Reference.h"
+#include "RenderCommandQueue.h"
+#include "Shader.h" // MAX_DRAW_INSTANCES
+#include "Vertex.h" // InstanceIndicesAreAvailable
 #include "Mesh.h"
 
 
+struct MeshLod
+{
+    int firstIndex;
+    int size;
+};
+
 struct Mesh
 {
     ReferenceCounter refCounter;
     GLuint vertexBuffer;
     GLuint indexBuffer;
     int primitiveType;
-    int size;
+
+    /**
+     * Index range (or vertex range if the mesh has no indices) of each
+     * detail level.  Indices are relative to the index buffer.
+     */
+    int lodCount;
+    MeshLod lods[MAX_MESH_LODS];
+
+    /**
+     * Distance of the farthest vertex to the origin.
+     */
+    float radius;
+
+    /**
+     * Whether the buffers belong to the mesh arena.
+     * In that case the mesh only occupies a part of them.
+     */
+    bool inArena;
+    int firstVertex;
+    int vertexCount;
+    int firstIndex;
+    int indexCount;
+
 #if defined(KONSTRUKT_DEBUG_MESH)
     GLuint debugVertexBuffer;
     int debugVertexCount;
@@ -21,30 +59,316 @@ struct Mesh
 };
 
 
+struct MeshArenaBuffer
+{
+    GLuint handle;
+    int elementSize;
+    RangeAllocator allocator;
+
+    /**
+     * Persistently mapped buffer storage or `NULL` if the buffer is updated
+     * using `glBufferSubData`.
+     */
+    char* mapping;
+};
+
+/**
+ * Arena ranges of a freed mesh.
+ *
+ * They can't be reused until the GPU has finished all draw calls, which
+ * have been issued before the mesh was freed.
+ */
+struct PendingArenaRanges
+{
+    GLsync fence; // `NULL` until #FenceMeshArena has been called.
+    int firstVertex;
+    int vertexCount;
+    int firstIndex;
+    int indexCount;
+};
+
+DefineCounter(MeshArenaVertexCounter, "mesh arena vertices");
+
+static bool MeshArenaEnabled = false;
+static MeshArenaBuffer ArenaVertexBuffer;
+static MeshArenaBuffer ArenaIndexBuffer;
+static Array<PendingArenaRanges> PendingArenaFrees;
+static GLuint IndirectCommandBuffer = 0;
+
+/**
+ * Buffer which the vertex attribute pointers have been set up for.
+ * (Just binding the buffer doesn't change the attribute source.)
+ */
+static GLuint AttributeVertexBuffer = 0;
+
+
 #if defined(KONSTRUKT_DEBUG_MESH)
 static void BuildDebugMesh( const MeshBuffer* buffer, Mesh* mesh );
 static void DrawDebugMesh( const Mesh* mesh );
 #endif
 
 
-Mesh* CreateMesh( const MeshBuffer* buffer )
+/**
+ * Arena buffers are bound to `GL_COPY_WRITE_BUFFER` for updates, because
+ * binding `GL_ELEMENT_ARRAY_BUFFER` would change the vertex array state.
+ */
+static const GLenum ARENA_WRITE_TARGET = GL_COPY_WRITE_BUFFER;
+
+static void InitArenaBuffer( MeshArenaBuffer* buffer,
+                             int elementSize,
+                             int capacity )
+{
+    buffer->elementSize = elementSize;
+    buffer->mapping = NULL;
+    InitRangeAllocator(&buffer->allocator, capacity);
+
+    const GLsizeiptr size = (GLsizeiptr)capacity * elementSize;
+    glGenBuffers(1, &buffer->handle);
+    BindBuffer(ARENA_WRITE_TARGET, buffer->handle);
+    if(GLAD_GL_ARB_buffer_storage)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT |
+                                 GL_MAP_PERSISTENT_BIT |
+                                 GL_MAP_COHERENT_BIT;
+        glBufferStorage(ARENA_WRITE_TARGET, size, NULL, flags);
+        buffer->mapping = (char*)glMapBufferRange(ARENA_WRITE_TARGET,
+                                                  0,
+                                                  size,
+                                                  flags);
+        if(!buffer->mapping)
+            FatalError("Can't map mesh arena buffer.");
+    }
+    else
+    {
+        glBufferData(ARENA_WRITE_TARGET, size, NULL, GL_DYNAMIC_DRAW);
+    }
+}
+
+static void DestroyArenaBuffer( MeshArenaBuffer* buffer )
+{
+    if(buffer->mapping)
+    {
+        BindBuffer(ARENA_WRITE_TARGET, buffer->handle);
+        glUnmapBuffer(ARENA_WRITE_TARGET);
+    }
+    glDeleteBuffers(1, &buffer->handle);
+    ForgetBuffer(buffer->handle);
+    DestroyRangeAllocator(&buffer->allocator);
+}
+
+static void WriteArenaBuffer( MeshArenaBuffer* buffer,
+                              int offset,
+                              int count,
+                              const void* data )
+{
+    const int byteOffset = offset * buffer->elementSize;
+    const int byteCount = count * buffer->elementSize;
+    if(buffer->mapping)
+    {
+        // The range isn't used by the GPU (see #FenceMeshArena) and the
+        // mapping is coherent, so no further synchronization is needed:
+        memcpy(buffer->mapping + byteOffset, data, byteCount);
+    }
+    else
+    {
+        BindBuffer(ARENA_WRITE_TARGET, buffer->handle);
+        glBufferSubData(ARENA_WRITE_TARGET, byteOffset, byteCount, data);
+    }
+}
+
+static void UpdateMeshArenaCounter()
+{
+    const RangeAllocator* allocator = &ArenaVertexBuffer.allocator;
+    SetCounter(MeshArenaVertexCounter, allocator->capacity - allocator->freeSize);
+}
+
+void InitMeshArena( MeshArenaConfig config )
+{
+    assert(InSerialPhase());
+    assert(InRenderThread());
+    InitCounter(MeshArenaVertexCounter);
+    InitArray(&PendingArenaFrees);
+    if(config.vertexCount <= 0 || config.indexCount <= 0)
+        return;
+
+    InitArenaBuffer(&ArenaVertexBuffer, sizeof(Vertex), config.vertexCount);
+    InitArenaBuffer(&ArenaIndexBuffer, sizeof(VertexIndex), config.indexCount);
+    MeshArenaEnabled = true;
+
+    if(IndirectMultiDrawIsSupported())
+    {
+        glGenBuffers(1, &IndirectCommandBuffer);
+        BindBuffer(GL_DRAW_INDIRECT_BUFFER, IndirectCommandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER,
+                     sizeof(IndirectDrawCommand)*MAX_DRAW_INSTANCES,
+                     NULL,
+                     GL_STREAM_DRAW);
+    }
+
+    LogInfo("Mesh arena: %d vertices, %d indices, %s",
+            config.vertexCount,
+            config.indexCount,
+            ArenaVertexBuffer.mapping ? "persistently mapped" : "not mapped");
+}
+
+static void ReleaseArenaRanges( const PendingArenaRanges* ranges )
+{
+    FreeRange(&ArenaVertexBuffer.allocator,
+              ranges->firstVertex,
+              ranges->vertexCount);
+    if(ranges->indexCount)
+        FreeRange(&ArenaIndexBuffer.allocator,
+                  ranges->firstIndex,
+                  ranges->indexCount);
+}
+
+void DestroyMeshArena()
+{
+    assert(InSerialPhase());
+    assert(InRenderThread());
+    if(MeshArenaEnabled)
+    {
+        GLsync lastFence = NULL;
+        REPEAT(PendingArenaFrees.length, i)
+        {
+            const PendingArenaRanges* ranges = &PendingArenaFrees.data[i];
+            if(ranges->fence && ranges->fence != lastFence)
+            {
+                glDeleteSync(ranges->fence);
+                lastFence = ranges->fence;
+            }
+            ReleaseArenaRanges(ranges);
+        }
+
+        const RangeAllocator* allocator = &ArenaVertexBuffer.allocator;
+        if(allocator->freeSize != allocator->capacity)
+            LogWarning("%d vertices are still used by meshes, while the mesh arena is destroyed.",
+                       allocator->capacity - allocator->freeSize);
+
+        DestroyArenaBuffer(&ArenaVertexBuffer);
+        DestroyArenaBuffer(&ArenaIndexBuffer);
+        if(IndirectCommandBuffer)
+        {
+            glDeleteBuffers(1, &IndirectCommandBuffer);
+            ForgetBuffer(IndirectCommandBuffer);
+            IndirectCommandBuffer = 0;
+        }
+        AttributeVertexBuffer = 0;
+        MeshArenaEnabled = false;
+    }
+    DestroyArray(&PendingArenaFrees);
+}
+
+static bool IsFenceSignaled( GLsync fence )
+{
+    const GLenum status = glClientWaitSync(fence, 0, 0);
+    return status == GL_ALREADY_SIGNALED ||
+           status == GL_CONDITION_SATISFIED;
+}
+
+void FenceMeshArena()
+{
+    assert(InRenderThread());
+    if(!MeshArenaEnabled || PendingArenaFrees.length == 0)
+        return;
+
+    // Ranges which have been freed since the last call are protected by a
+    // new fence:
+    PendingArenaRanges* lastRanges =
+        &PendingArenaFrees.data[PendingArenaFrees.length-1];
+    if(!lastRanges->fence)
+    {
+        const GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        for(int i = PendingArenaFrees.length-1; i >= 0; i--)
+        {
+            PendingArenaRanges* ranges = &PendingArenaFrees.data[i];
+            if(ranges->fence)
+                break;
+            ranges->fence = fence;
+        }
+    }
+
+    // Fences are signaled in order, so the search can stop at the first
+    // fence which hasn't been passed yet:
+    int releasedCount = 0;
+    while(releasedCount < PendingArenaFrees.length)
+    {
+        const GLsync fence = PendingArenaFrees.data[releasedCount].fence;
+        if(!IsFenceSignaled(fence))
+            break;
+        glDeleteSync(fence);
+        while(releasedCount < PendingArenaFrees.length &&
+              PendingArenaFrees.data[releasedCount].fence == fence)
+        {
+            ReleaseArenaRanges(&PendingArenaFrees.data[releasedCount]);
+            releasedCount++;
+        }
+    }
+    if(releasedCount > 0)
+    {
+        RemoveFromArray(&PendingArenaFrees, 0, releasedCount);
+        UpdateMeshArenaCounter();
+    }
+}
+
+/**
+ * Tries to place the mesh data in the arena.
+ *
+ * @return
+ * `false` if there wasn't enough space left.
+ */
+static bool CreateMeshInArena( Mesh* mesh, const MeshBuffer* buffer )
 {
     const int vertexCount = GetMeshBufferVertexCount(buffer);
     const int indexCount = GetMeshBufferIndexCount(buffer);
 
-    if(!vertexCount)
-        FatalError("Creating an empty mesh.");
+    const int firstVertex = AllocateRange(&ArenaVertexBuffer.allocator,
+                                          vertexCount);
+    if(firstVertex == INVALID_RANGE_OFFSET)
+        return false;
 
-    Mesh* mesh = new Mesh;
-    memset(mesh, 0, sizeof(Mesh));
+    int firstIndex = 0;
+    if(indexCount)
+    {
+        firstIndex = AllocateRange(&ArenaIndexBuffer.allocator, indexCount);
+        if(firstIndex == INVALID_RANGE_OFFSET)
+        {
+            FreeRange(&ArenaVertexBuffer.allocator, firstVertex, vertexCount);
+            return false;
+        }
+    }
 
-    InitReferenceCounter(&mesh->refCounter);
+    WriteArenaBuffer(&ArenaVertexBuffer,
+                     firstVertex,
+                     vertexCount,
+                     GetMeshBufferVertices(buffer));
+    if(indexCount)
+    {
+        WriteArenaBuffer(&ArenaIndexBuffer,
+                         firstIndex,
+                         indexCount,
+                         GetMeshBufferIndices(buffer));
+    }
 
-    mesh->primitiveType = GL_TRIANGLES; // Default to triangles (can be changed later)
+    mesh->inArena = true;
+    mesh->vertexBuffer = ArenaVertexBuffer.handle;
+    mesh->indexBuffer = indexCount ? ArenaIndexBuffer.handle : 0;
+    mesh->firstVertex = firstVertex;
+    mesh->vertexCount = vertexCount;
+    mesh->firstIndex = firstIndex;
+    mesh->indexCount = indexCount;
+    UpdateMeshArenaCounter();
+    return true;
+}
+
+static void CreateMeshBuffers( Mesh* mesh, const MeshBuffer* buffer )
+{
+    const int vertexCount = GetMeshBufferVertexCount(buffer);
+    const int indexCount = GetMeshBufferIndexCount(buffer);
 
     glGenBuffers(1, &mesh->vertexBuffer);
 
-    glBindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer);
+    BindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer);
     glBufferData(GL_ARRAY_BUFFER,
                  vertexCount*sizeof(Vertex),
                  GetMeshBufferVertices(buffer),
@@ -54,19 +378,90 @@ Mesh* CreateMesh( const MeshBuffer* buffer )
     {
         glGenBuffers(1, &mesh->indexBuffer);
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer);
+        BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                     indexCount*sizeof(unsigned short),
+                     indexCount*sizeof(VertexIndex),
                      GetMeshBufferIndices(buffer),
                      GL_STATIC_DRAW);
+    }
+
+    mesh->vertexCount = vertexCount;
+    mesh->indexCount = indexCount;
+}
+
 
-        mesh->size = indexCount;
+static void InitMeshLods( Mesh* mesh, const MeshBuffer* buffer )
+{
+    if(mesh->indexCount)
+    {
+        mesh->lodCount = GetMeshBufferLodCount(buffer);
+        REPEAT(mesh->lodCount, i)
+        {
+            MeshLod* lod = &mesh->lods[i];
+            GetMeshBufferLodRange(buffer, i, &lod->firstIndex, &lod->size);
+            lod->firstIndex += mesh->firstIndex;
+        }
     }
     else
     {
-        mesh->size = vertexCount;
+        mesh->lodCount = 1;
+        mesh->lods[0].firstIndex = 0;
+        mesh->lods[0].size = mesh->vertexCount;
+    }
+
+    const Vertex* vertices = GetMeshBufferVertices(buffer);
+    float radiusSquared = 0;
+    REPEAT(mesh->vertexCount, i)
+    {
+        const Vec3 p = vertices[i].position;
+        const float lengthSquared = p._[0]*p._[0] +
+                                    p._[1]*p._[1] +
+                                    p._[2]*p._[2];
+        if(lengthSquared > radiusSquared)
+            radiusSquared = lengthSquared;
+    }
+    mesh->radius = sqrtf(radiusSquared);
+}
+
+
+struct CreateMeshArgs
+{
+    const MeshBuffer* buffer;
+    Mesh* mesh;
+};
+
+static void CreateMeshInRenderThread( void* data )
+{
+    CreateMeshArgs* args = (CreateMeshArgs*)data;
+    args->mesh = CreateMesh(args->buffer);
+}
+
+Mesh* CreateMesh( const MeshBuffer* buffer )
+{
+    if(!InRenderThread())
+    {
+        CreateMeshArgs args = {buffer, NULL};
+        RunInRenderThread(CreateMeshInRenderThread, &args);
+        return args.mesh;
     }
 
+    const int vertexCount = GetMeshBufferVertexCount(buffer);
+
+    if(!vertexCount)
+        FatalError("Creating an empty mesh.");
+
+    Mesh* mesh = new Mesh;
+    memset(mesh, 0, sizeof(Mesh));
+
+    InitReferenceCounter(&mesh->refCounter);
+
+    mesh->primitiveType = GL_TRIANGLES; // Default to triangles (can be changed later)
+
+    if(!MeshArenaEnabled || !CreateMeshInArena(mesh, buffer))
+        CreateMeshBuffers(mesh, buffer);
+
+    InitMeshLods(mesh, buffer);
+
 #if defined(KONSTRUKT_DEBUG_MESH)
     BuildDebugMesh(buffer, mesh);
 #endif
@@ -74,48 +469,203 @@ Mesh* CreateMesh( const MeshBuffer* buffer )
     return mesh;
 }
 
-static void BindMesh( const Mesh* mesh )
+/**
+ * Meshes in the arena share their buffers, so switching between them
+ * doesn't require any state changes.
+ */
+static void UseMesh( const Mesh* mesh )
 {
-    glBindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer);
+    if(mesh->vertexBuffer != AttributeVertexBuffer)
+    {
+        BindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer);
+        SetVertexAttributePointers(NULL);
+        AttributeVertexBuffer = mesh->vertexBuffer;
+    }
 
     if(mesh->indexBuffer)
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer);
+        BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer);
 
-    SetVertexAttributePointers(NULL);
+    MarkFramebufferAsDrawn();
 }
 
-static const Mesh* CurrentMesh = NULL;
+static const MeshLod* GetMeshLod( const Mesh* mesh, int lod )
+{
+    assert(lod >= 0 && lod < mesh->lodCount);
+    return &mesh->lods[lod];
+}
 
-void DrawMesh( const Mesh* mesh )
+static const void* GetIndexOffset( const MeshLod* lod )
 {
-    if(mesh != CurrentMesh)
-    {
-        BindMesh(mesh);
-        CurrentMesh = mesh;
-    }
+    return (const void*)(lod->firstIndex * sizeof(VertexIndex));
+}
+
+void DrawMesh( const Mesh* mesh, int lodIndex )
+{
+    const MeshLod* lod = GetMeshLod(mesh, lodIndex);
+    UseMesh(mesh);
 
     if(mesh->indexBuffer)
-        glDrawElements(mesh->primitiveType, mesh->size, GL_UNSIGNED_SHORT, 0);
+        glDrawElementsBaseVertex(mesh->primitiveType,
+                                 lod->size,
+                                 GL_UNSIGNED_SHORT,
+                                 GetIndexOffset(lod),
+                                 mesh->firstVertex);
     else
-        glDrawArrays(mesh->primitiveType, 0, mesh->size);
+        glDrawArrays(mesh->primitiveType, mesh->firstVertex, lod->size);
 
 #if defined(KONSTRUKT_DEBUG_MESH)
     DrawDebugMesh(mesh);
 #endif
 }
 
+void DrawMeshInstanced( const Mesh* mesh, int lodIndex, int instanceCount )
+{
+    const MeshLod* lod = GetMeshLod(mesh, lodIndex);
+    UseMesh(mesh);
+
+    if(mesh->indexBuffer)
+        glDrawElementsInstancedBaseVertex(mesh->primitiveType,
+                                          lod->size,
+                                          GL_UNSIGNED_SHORT,
+                                          GetIndexOffset(lod),
+                                          instanceCount,
+                                          mesh->firstVertex);
+    else
+        glDrawArraysInstanced(mesh->primitiveType,
+                              mesh->firstVertex,
+                              lod->size,
+                              instanceCount);
+}
+
+int GetMeshLodCount( const Mesh* mesh )
+{
+    return mesh->lodCount;
+}
+
+float GetMeshRadius( const Mesh* mesh )
+{
+    return mesh->radius;
+}
+
+/**
+ * Projected size at which the full detail level is used.
+ * Each further level halves the triangle count, so it's used once the
+ * projected area has been halved too.
+ */
+static const float FULL_DETAIL_PROJECTED_SIZE = 0.25f;
+
+int SelectMeshLod( const Mesh* mesh, float projectedSize )
+{
+    if(mesh->lodCount == 1 || projectedSize >= FULL_DETAIL_PROJECTED_SIZE)
+        return 0;
+    if(projectedSize <= 0)
+        return mesh->lodCount-1;
+
+    // Area is proportional to the squared size:
+    const float lod = floorf(2.0f * log2f(FULL_DETAIL_PROJECTED_SIZE / projectedSize));
+    if(lod >= mesh->lodCount-1)
+        return mesh->lodCount-1;
+    return (int)lod;
+}
+
+bool IndirectMultiDrawIsSupported()
+{
+    return GLAD_GL_ARB_multi_draw_indirect &&
+           GLAD_GL_ARB_draw_indirect &&
+           GLAD_GL_ARB_base_instance &&
+           InstanceIndicesAreAvailable();
+}
+
+int GetMeshMultiDrawGroup( const Mesh* mesh )
+{
+    if(!mesh->inArena || !mesh->indexBuffer || !IndirectCommandBuffer)
+        return 0;
+    // All arena meshes share their buffers, so only the primitive type
+    // needs to match:
+    return mesh->primitiveType + 1;
+}
+
+void GetMeshDrawRange( const Mesh* mesh, int lodIndex, MeshDrawRange* range )
+{
+    const MeshLod* lod = GetMeshLod(mesh, lodIndex);
+    range->firstIndex = lod->firstIndex;
+    range->indexCount = lod->size;
+    range->baseVertex = mesh->firstVertex;
+}
+
+void DrawMeshesIndirect( const Mesh* mesh,
+                         const IndirectDrawCommand* commands,
+                         int commandCount )
+{
+    assert(GetMeshMultiDrawGroup(mesh) != 0);
+    assert(commandCount >= 1 && commandCount <= MAX_DRAW_INSTANCES);
+    UseMesh(mesh);
+
+    BindBuffer(GL_DRAW_INDIRECT_BUFFER, IndirectCommandBuffer);
+    // Orphan the old storage like SetInstanceTransformations does:
+    glBufferData(GL_DRAW_INDIRECT_BUFFER,
+                 sizeof(IndirectDrawCommand)*MAX_DRAW_INSTANCES,
+                 NULL,
+                 GL_STREAM_DRAW);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER,
+                    0,
+                    sizeof(IndirectDrawCommand)*commandCount,
+                    commands);
+
+    glMultiDrawElementsIndirect(mesh->primitiveType,
+                                GL_UNSIGNED_SHORT,
+                                NULL,
+                                commandCount,
+                                0); // Commands are tightly packed.
+}
+
+static void FreeMeshInRenderThread( void* data );
+
 static void FreeMesh( Mesh* mesh )
 {
+    if(!InRenderThread())
+    {
+        RunInRenderThread(FreeMeshInRenderThread, mesh);
+        return;
+    }
+
     FreeReferenceCounter(&mesh->refCounter);
 
-    glDeleteBuffers(1, &mesh->vertexBuffer);
+    if(mesh->inArena)
+    {
+        // Nothing to do if the arena has been destroyed already.
+        if(MeshArenaEnabled)
+        {
+            const PendingArenaRanges ranges = {NULL,
+                                               mesh->firstVertex,
+                                               mesh->vertexCount,
+                                               mesh->firstIndex,
+                                               mesh->indexCount};
+            AppendToArray(&PendingArenaFrees, 1, &ranges);
+        }
+    }
+    else
+    {
+        if(AttributeVertexBuffer == mesh->vertexBuffer)
+            AttributeVertexBuffer = 0;
+        glDeleteBuffers(1, &mesh->vertexBuffer);
+        ForgetBuffer(mesh->vertexBuffer);
 
-    if(mesh->indexBuffer)
-        glDeleteBuffers(1, &mesh->indexBuffer);
+        if(mesh->indexBuffer)
+        {
+            glDeleteBuffers(1, &mesh->indexBuffer);
+            ForgetBuffer(mesh->indexBuffer);
+        }
+    }
 
     delete mesh;
 }
 
+static void FreeMeshInRenderThread( void* data )
+{
+    FreeMesh((Mesh*)data);
+}
+
 void ReferenceMesh( Mesh* mesh )
 {
     Reference(&mesh->refCounter);
@@ -155,10 +705,15 @@ static void CalcDebugVertices( const Vertex* input, Vertex* outputs )
 static void BuildDebugMesh( const MeshBuffer* buffer, Mesh* mesh )
 {
     const int vertexCount      = GetMeshBufferVertexCount(buffer);
-    const int indexCount       = GetMeshBufferIndexCount(buffer);
     const Vertex* vertices     = GetMeshBufferVertices(buffer);
     const VertexIndex* indices = GetMeshBufferIndices(buffer);
 
+    // Only the original geometry, the detail levels reuse its vertices:
+    int firstIndex;
+    int indexCount;
+    GetMeshBufferLodRange(buffer, 0, &firstIndex, &indexCount);
+    indices += firstIndex;
+
     const int elementCount = (indexCount > 0) ? indexCount : vertexCount;
     const int debugVertexCount = elementCount * DebugVerticesPerVertex;
     Vertex* debugVertices = new Vertex[debugVertexCount];
@@ -185,7 +740,7 @@ static void BuildDebugMesh( const MeshBuffer* buffer, Mesh* mesh )
     }
 
     glGenBuffers(1, &mesh->debugVertexBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh->debugVertexBuffer);
+    BindBuffer(GL_ARRAY_BUFFER, mesh->debugVertexBuffer);
     glBufferData(GL_ARRAY_BUFFER,
                  debugVertexCount*sizeof(Vertex),
                  debugVertices,
@@ -198,8 +753,8 @@ static void BuildDebugMesh( const MeshBuffer* buffer, Mesh* mesh )
 
 static void DrawDebugMesh( const Mesh* mesh )
 {
-    CurrentMesh = NULL; // Make sure the render function always gets called.
-    glBindBuffer(GL_ARRAY_BUFFER, mesh->debugVertexBuffer);
+    AttributeVertexBuffer = 0; // Make sure the attribute pointers get reset.
+    BindBuffer(GL_ARRAY_BUFFER, mesh->debugVertexBuffer);
     SetVertexAttributePointers(NULL);
     glDrawArrays(GL_LINES, 0, mesh->debugVertexCount);
 }
@@ -3,10 +3,111 @@
 
 struct MeshBuffer;
 struct Mesh;
+struct MeshDrawRange;
+struct IndirectDrawCommand;
 
 
+struct MeshArenaConfig
+{
+    int vertexCount;
+    int indexCount;
+};
+
+
+/**
+ * Creates the mesh arena: A large vertex and index buffer, which are shared
+ * by all meshes that fit into them.
+ *
+ * Meshes in the arena don't need their own buffer objects, so creating and
+ * freeing them doesn't stall the driver and drawing them doesn't require
+ * buffer rebinds.  If `GL_ARB_buffer_storage` is available the buffers are
+ * mapped persistently and mesh data is just copied into them.
+ *
+ * Meshes which don't fit into the arena get their own buffers.
+ * The arena is disabled if one of the sizes is zero.
+ */
+void InitMeshArena( MeshArenaConfig config );
+void DestroyMeshArena();
+
+/**
+ * Must be called once per frame, after all draw calls have been issued.
+ *
+ * Space which was used by freed meshes is only reused once the GPU has
+ * finished the frames in which they might have been drawn.
+ */
+void FenceMeshArena();
+
+
+/**
+ * Uploads the mesh buffer including all its detail levels.
+ *
+ * @see MESH_BUFFER_GENERATE_LODS
+ */
 Mesh* CreateMesh( const MeshBuffer* buffer );
-void DrawMesh( const Mesh* mesh );
+
+/**
+ * @param lod
+ * Detail level, which must be less than #GetMeshLodCount.
+ * Zero is the full detail mesh.
+ */
+void DrawMesh( const Mesh* mesh, int lod );
+
+/**
+ * Draws the mesh `instanceCount` times using a single draw call.
+ *
+ * @see SetInstanceTransformations
+ */
+void DrawMeshInstanced( const Mesh* mesh, int lod, int instanceCount );
+
+/**
+ * Is one, unless detail levels have been generated for the mesh buffer.
+ */
+int GetMeshLodCount( const Mesh* mesh );
+
+/**
+ * Radius of the bounding sphere around the model space origin.
+ */
+float GetMeshRadius( const Mesh* mesh );
+
+/**
+ * Picks the detail level for a mesh which covers the given fraction of the
+ * viewport height.
+ *
+ * @see CalcCameraProjectedSize
+ */
+int SelectMeshLod( const Mesh* mesh, float projectedSize );
+
+/**
+ * Whether #DrawMeshesIndirect can be used.
+ *
+ * Requires `GL_ARB_multi_draw_indirect`, `GL_ARB_draw_indirect`,
+ * `GL_ARB_base_instance` and `GL_ARB_instanced_arrays`.
+ */
+bool IndirectMultiDrawIsSupported();
+
+/**
+ * Meshes of the same group can be drawn using a single
+ * #DrawMeshesIndirect call.
+ *
+ * @return
+ * Zero if the mesh can't be drawn indirectly.  This is the case if it
+ * isn't stored in the mesh arena or doesn't use indices.
+ */
+int GetMeshMultiDrawGroup( const Mesh* mesh );
+
+void GetMeshDrawRange( const Mesh* mesh, int lod, MeshDrawRange* range );
+
+/**
+ * Issues multiple draw commands with one call.
+ *
+ * @param mesh
+ * Any mesh of the multi draw group, which is used by the commands.
+ *
+ * @see GenerateIndirectDrawCommands
+ */
+void DrawMeshesIndirect( const Mesh* mesh,
+                         const IndirectDrawCommand* commands,
+                         int commandCount );
 
 void ReferenceMesh( Mesh* mesh );
 void ReleaseMesh( Mesh* mesh );
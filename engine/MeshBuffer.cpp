@@ -1,11 +1,15 @@
 #include <vector>
+#include <algorithm> // std::sort, std::binary_search
 #include <assert.h>
 #include <stddef.h> // size_t
-#include <math.h> // fabsf
+#include <math.h> // fabsf, sqrt
+#include <stdint.h> // uint32_t
+#include <string.h> // memset
 
 #include "Common.h"
 #include "Math.h"
 #include "Reference.h"
+#include "TextureArray.h"
 #include "MeshBuffer.h"
 
 
@@ -15,6 +19,9 @@ struct MeshBuffer
     std::vector<Vertex> vertices;
     std::vector<VertexIndex> indices;
     // TODO: Replace std::vector with Array!
+
+    int lodCount;
+    int lodFirstIndices[MAX_MESH_LODS];
 };
 
 
@@ -22,6 +29,8 @@ MeshBuffer* CreateMeshBuffer()
 {
     MeshBuffer* buffer = new MeshBuffer;
     InitReferenceCounter(&buffer->refCounter);
+    buffer->lodCount = 1;
+    buffer->lodFirstIndices[0] = 0;
     return buffer;
 }
 
@@ -48,8 +57,26 @@ void AddVertexToMeshBuffer( MeshBuffer* buffer, const Vertex* vertex )
     buffer->vertices.push_back(*vertex);
 }
 
+/**
+ * Number of indices which belong to the original geometry.
+ */
+static int GetBaseIndexCount( const MeshBuffer* buffer )
+{
+    if(buffer->lodCount > 1)
+        return buffer->lodFirstIndices[1];
+    else
+        return buffer->indices.size();
+}
+
+static void DiscardMeshBufferLods( MeshBuffer* buffer )
+{
+    buffer->indices.resize(GetBaseIndexCount(buffer));
+    buffer->lodCount = 1;
+}
+
 void AddIndexToMeshBuffer( MeshBuffer* buffer, VertexIndex index )
 {
+    DiscardMeshBufferLods(buffer);
     buffer->indices.push_back(index);
 }
 
@@ -82,9 +109,11 @@ void AppendMeshBuffer( MeshBuffer* buffer, const MeshBuffer* otherBuffer, const
     // TODO: Raise error if target buffer doesn't use indices, but source buffer does.
     // TODO: Generate indices if target buffer uses them, but source buffer doesn't.
 
-    buffer->indices.reserve(buffer->indices.size()+otherBuffer->indices.size());
+    DiscardMeshBufferLods(buffer);
+    const int otherIndexCount = GetBaseIndexCount(otherBuffer);
+    buffer->indices.reserve(buffer->indices.size()+otherIndexCount);
     const VertexIndex indexOffset = buffer->vertices.size();
-    for(size_t i = 0; i < otherBuffer->indices.size(); i++)
+    for(int i = 0; i < otherIndexCount; i++)
     {
         const VertexIndex index = otherBuffer->indices[i];
         buffer->indices.push_back(index+indexOffset);
@@ -100,6 +129,15 @@ void AppendMeshBuffer( MeshBuffer* buffer, const MeshBuffer* otherBuffer, const
         TransformMeshBufferRange(buffer, *transformation, start, otherBuffer->vertices.size());
 }
 
+void RemapMeshBufferTexCoords( MeshBuffer* buffer, int firstVertex, const TextureArrayPlacement* placement )
+{
+    const int vertexCount = buffer->vertices.size() - firstVertex;
+    assert(firstVertex >= 0);
+    assert(vertexCount >= 0);
+    if(vertexCount > 0)
+        RemapTexCoords(&buffer->vertices[firstVertex], vertexCount, placement);
+}
+
 int GetMeshBufferVertexCount( const MeshBuffer* buffer )
 {
     return buffer->vertices.size();
@@ -120,6 +158,25 @@ const VertexIndex* GetMeshBufferIndices( const MeshBuffer* buffer )
     return &buffer->indices[0];
 }
 
+int GetMeshBufferLodCount( const MeshBuffer* buffer )
+{
+    return buffer->lodCount;
+}
+
+void GetMeshBufferLodRange( const MeshBuffer* buffer,
+                            int lod,
+                            int* firstIndex,
+                            int* indexCount )
+{
+    assert(lod >= 0 && lod < buffer->lodCount);
+    const int first = buffer->lodFirstIndices[lod];
+    const int end = (lod+1 < buffer->lodCount) ?
+                    buffer->lodFirstIndices[lod+1] :
+                    (int)buffer->indices.size();
+    *firstIndex = first;
+    *indexCount = end - first;
+}
+
 
 // ---- mesh reindexing ----
 
@@ -154,6 +211,7 @@ static int FindSimilarVertex( const Vertex* vertices,
         if(IsNearlyEqualVec3(vertex->position, reference->position) &&
            IsNearlyEqualVec3(vertex->color,    reference->color) &&
            IsNearlyEqualVec2(vertex->texCoord, reference->texCoord) &&
+           vertex->textureLayer == reference->textureLayer &&
            IsNearlyEqualVec3(vertex->normal,   reference->normal))
         {
             return i;
@@ -192,6 +250,7 @@ static void IndexVertex( const Vertex* vertex,
 
 static void IndexMeshBuffer( MeshBuffer* buffer )
 {
+    DiscardMeshBufferLods(buffer);
     const Vertex* vertices     = GetMeshBufferVertices(buffer);
     const VertexIndex* indices = GetMeshBufferIndices(buffer);
     const int vertexCount      = GetMeshBufferVertexCount(buffer);
@@ -258,7 +317,7 @@ static void ModifyTriangles( MeshBuffer* buffer,
     Vertex* vertices      = &buffer->vertices[0];
     VertexIndex* indices  = &buffer->indices[0];
     const int vertexCount = GetMeshBufferVertexCount(buffer);
-    const int indexCount  = GetMeshBufferIndexCount(buffer);
+    const int indexCount  = GetBaseIndexCount(buffer);
 
     if(indexCount > 0)
     {
@@ -327,6 +386,409 @@ static void CalcMeshBufferTangents( MeshBuffer* buffer )
 }
 
 
+// ---- level of detail generation ----
+
+/**
+ * Levels which don't save at least this fraction of the triangles of the
+ * previous level aren't worth the memory.
+ */
+static const double MIN_LOD_REDUCTION = 0.2;
+
+/**
+ * Sums up the squared distances to a set of planes.
+ *
+ * It's a symmetric 4x4 matrix, so only the upper triangle is stored.  See
+ * Garland and Heckbert: Surface Simplification Using Quadric Error Metrics.
+ */
+struct Quadric
+{
+    double aa, ab, ac, ad,
+               bb, bc, bd,
+                   cc, cd,
+                       dd;
+};
+
+/**
+ * Replaces all occurrences of `from` with `to`.
+ * Triangles which contained both vertices degenerate and are removed.
+ */
+struct EdgeCollapse
+{
+    double error;
+    VertexIndex from;
+    VertexIndex to;
+};
+
+static void AddPlaneToQuadric( Quadric* q,
+                               double a,
+                               double b,
+                               double c,
+                               double d,
+                               double weight )
+{
+    q->aa += a*a*weight; q->ab += a*b*weight; q->ac += a*c*weight; q->ad += a*d*weight;
+                         q->bb += b*b*weight; q->bc += b*c*weight; q->bd += b*d*weight;
+                                              q->cc += c*c*weight; q->cd += c*d*weight;
+                                                                   q->dd += d*d*weight;
+}
+
+static void AddQuadric( Quadric* q, const Quadric* other )
+{
+    q->aa += other->aa; q->ab += other->ab; q->ac += other->ac; q->ad += other->ad;
+                        q->bb += other->bb; q->bc += other->bc; q->bd += other->bd;
+                                            q->cc += other->cc; q->cd += other->cd;
+                                                                q->dd += other->dd;
+}
+
+static double CalcQuadricError( const Quadric* q, Vec3 position )
+{
+    const double x = position._[0];
+    const double y = position._[1];
+    const double z = position._[2];
+    return     q->aa*x*x + 2*q->ab*x*y + 2*q->ac*x*z + 2*q->ad*x +
+                             q->bb*y*y + 2*q->bc*y*z + 2*q->bd*y +
+                                           q->cc*z*z + 2*q->cd*z +
+                                                         q->dd;
+}
+
+/**
+ * Unnormalized triangle normal.  Its length is twice the triangle area.
+ */
+static void CalcTriangleCross( Vec3 a, Vec3 b, Vec3 c, double* cross )
+{
+    const double ab[3] = {b._[0]-a._[0], b._[1]-a._[1], b._[2]-a._[2]};
+    const double ac[3] = {c._[0]-a._[0], c._[1]-a._[1], c._[2]-a._[2]};
+    cross[0] = ab[1]*ac[2] - ab[2]*ac[1];
+    cross[1] = ab[2]*ac[0] - ab[0]*ac[2];
+    cross[2] = ab[0]*ac[1] - ab[1]*ac[0];
+}
+
+static void CalcVertexQuadrics( const Vertex* vertices,
+                                const VertexIndex* indices,
+                                int indexCount,
+                                Quadric* quadrics )
+{
+    for(int i = 0; i < indexCount; i += 3)
+    {
+        const Vec3 a = vertices[indices[i+0]].position;
+        double cross[3];
+        CalcTriangleCross(a,
+                          vertices[indices[i+1]].position,
+                          vertices[indices[i+2]].position,
+                          cross);
+        const double length = sqrt(cross[0]*cross[0] +
+                                   cross[1]*cross[1] +
+                                   cross[2]*cross[2]);
+        if(length == 0)
+            continue;
+
+        const double nx = cross[0] / length;
+        const double ny = cross[1] / length;
+        const double nz = cross[2] / length;
+        const double d = -(nx*a._[0] + ny*a._[1] + nz*a._[2]);
+        const double area = length * 0.5;
+        REPEAT(3, j)
+            AddPlaneToQuadric(&quadrics[indices[i+j]], nx, ny, nz, d, area);
+    }
+}
+
+static bool VertexPositionIsLess( const Vertex* vertices, int a, int b )
+{
+    const Vec3 pa = vertices[a].position;
+    const Vec3 pb = vertices[b].position;
+    REPEAT(3, i)
+        if(pa._[i] != pb._[i])
+            return pa._[i] < pb._[i];
+    return a < b;
+}
+
+static bool VertexPositionsAreEqual( const Vertex* vertices, int a, int b )
+{
+    const Vec3 pa = vertices[a].position;
+    const Vec3 pb = vertices[b].position;
+    return pa._[0] == pb._[0] &&
+           pa._[1] == pb._[1] &&
+           pa._[2] == pb._[2];
+}
+
+struct VertexPositionComparator
+{
+    const Vertex* vertices;
+    bool operator()( int a, int b ) const
+    {
+        return VertexPositionIsLess(vertices, a, b);
+    }
+};
+
+/**
+ * Vertices which share their position with another vertex (i.e. lie on a
+ * seam) or are part of an open border can't be moved without tearing the
+ * surface apart.
+ */
+static void FindLockedVertices( const Vertex* vertices,
+                                int vertexCount,
+                                const VertexIndex* indices,
+                                int indexCount,
+                                std::vector<bool>* locked )
+{
+    locked->assign(vertexCount, false);
+
+    std::vector<int> sortedVertices(vertexCount);
+    REPEAT(vertexCount, i)
+        sortedVertices[i] = i;
+    const VertexPositionComparator comparator = {vertices};
+    std::sort(sortedVertices.begin(), sortedVertices.end(), comparator);
+    for(int i = 1; i < vertexCount; i++)
+    {
+        const int a = sortedVertices[i-1];
+        const int b = sortedVertices[i];
+        if(VertexPositionsAreEqual(vertices, a, b))
+        {
+            (*locked)[a] = true;
+            (*locked)[b] = true;
+        }
+    }
+
+    // Edges without an opposite edge are on a border:
+    std::vector<uint32_t> edges;
+    edges.reserve(indexCount);
+    for(int i = 0; i < indexCount; i += 3)
+        REPEAT(3, j)
+            edges.push_back(((uint32_t)indices[i+j] << 16) |
+                             (uint32_t)indices[i+(j+1)%3]);
+    std::sort(edges.begin(), edges.end());
+    REPEAT((int)edges.size(), i)
+    {
+        const uint32_t a = edges[i] >> 16;
+        const uint32_t b = edges[i] & 0xFFFF;
+        const uint32_t opposite = (b << 16) | a;
+        if(!std::binary_search(edges.begin(), edges.end(), opposite))
+        {
+            (*locked)[a] = true;
+            (*locked)[b] = true;
+        }
+    }
+}
+
+static bool EdgeCollapseIsLess( const EdgeCollapse& a, const EdgeCollapse& b )
+{
+    if(a.error != b.error)
+        return a.error < b.error;
+    if(a.from != b.from)
+        return a.from < b.from;
+    return a.to < b.to;
+}
+
+static void AddEdgeCollapse( std::vector<EdgeCollapse>* collapses,
+                             const Vertex* vertices,
+                             const Quadric* quadrics,
+                             const std::vector<bool>& locked,
+                             VertexIndex from,
+                             VertexIndex to )
+{
+    if(locked[from])
+        return;
+    Quadric q = quadrics[from];
+    AddQuadric(&q, &quadrics[to]);
+    const EdgeCollapse collapse = {CalcQuadricError(&q, vertices[to].position),
+                                   from,
+                                   to};
+    collapses->push_back(collapse);
+}
+
+/**
+ * Maps each vertex to the triangles which use it.
+ * The triangles of vertex `v` are `triangles[offsets[v]]` till
+ * `triangles[offsets[v+1]-1]`.
+ */
+static void BuildVertexTriangles( const std::vector<VertexIndex>& indices,
+                                  int vertexCount,
+                                  std::vector<int>* offsets,
+                                  std::vector<int>* triangles )
+{
+    offsets->assign(vertexCount+1, 0);
+    REPEAT((int)indices.size(), i)
+        (*offsets)[indices[i]+1]++;
+    REPEAT(vertexCount, i)
+        (*offsets)[i+1] += (*offsets)[i];
+
+    std::vector<int> fill(offsets->begin(), offsets->end()-1);
+    triangles->resize(indices.size());
+    REPEAT((int)indices.size(), i)
+        (*triangles)[fill[indices[i]]++] = i / 3;
+}
+
+/**
+ * Whether moving the vertex would flip one of the remaining triangles.
+ */
+static bool EdgeCollapseFlipsTriangles( const Vertex* vertices,
+                                        const std::vector<VertexIndex>& indices,
+                                        const std::vector<int>& offsets,
+                                        const std::vector<int>& triangles,
+                                        const EdgeCollapse* collapse )
+{
+    for(int i = offsets[collapse->from]; i < offsets[collapse->from+1]; i++)
+    {
+        const VertexIndex* triangle = &indices[triangles[i]*3];
+        if(triangle[0] == collapse->to ||
+           triangle[1] == collapse->to ||
+           triangle[2] == collapse->to)
+            continue; // Degenerates anyway.
+
+        Vec3 positions[3];
+        Vec3 newPositions[3];
+        REPEAT(3, j)
+        {
+            positions[j] = vertices[triangle[j]].position;
+            newPositions[j] = (triangle[j] == collapse->from) ?
+                              vertices[collapse->to].position :
+                              positions[j];
+        }
+
+        double oldCross[3];
+        double newCross[3];
+        CalcTriangleCross(positions[0], positions[1], positions[2], oldCross);
+        CalcTriangleCross(newPositions[0], newPositions[1], newPositions[2], newCross);
+        const double dot = oldCross[0]*newCross[0] +
+                           oldCross[1]*newCross[1] +
+                           oldCross[2]*newCross[2];
+        if(dot <= 0)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Collapses the cheapest edges until at most `targetIndexCount` indices are
+ * left or no more edges can be collapsed.
+ *
+ * Each pass collapses independent edges only:  Once a vertex has been
+ * moved, its neighbours are left alone until the next pass.  Candidates are
+ * ordered by error and vertex indices, so the result is deterministic.
+ */
+static void SimplifyTriangles( const Vertex* vertices,
+                               int vertexCount,
+                               Quadric* quadrics,
+                               const std::vector<bool>& locked,
+                               std::vector<VertexIndex>* indices,
+                               int targetIndexCount )
+{
+    std::vector<EdgeCollapse> collapses;
+    std::vector<int> offsets;
+    std::vector<int> triangles;
+    std::vector<VertexIndex> remap(vertexCount);
+    std::vector<bool> touched(vertexCount);
+
+    while((int)indices->size() > targetIndexCount)
+    {
+        collapses.clear();
+        for(int i = 0; i < (int)indices->size(); i += 3)
+        {
+            REPEAT(3, j)
+            {
+                const VertexIndex a = (*indices)[i+j];
+                const VertexIndex b = (*indices)[i+(j+1)%3];
+                AddEdgeCollapse(&collapses, vertices, quadrics, locked, a, b);
+                AddEdgeCollapse(&collapses, vertices, quadrics, locked, b, a);
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), EdgeCollapseIsLess);
+
+        BuildVertexTriangles(*indices, vertexCount, &offsets, &triangles);
+        REPEAT(vertexCount, i)
+        {
+            remap[i] = i;
+            touched[i] = false;
+        }
+
+        // Each collapse removes at least one triangle:
+        const int maxCollapseCount = ((int)indices->size() - targetIndexCount + 2) / 3;
+        int collapseCount = 0;
+        REPEAT((int)collapses.size(), i)
+        {
+            if(collapseCount == maxCollapseCount)
+                break;
+
+            const EdgeCollapse* collapse = &collapses[i];
+            if(touched[collapse->from] || touched[collapse->to])
+                continue;
+            if(EdgeCollapseFlipsTriangles(vertices, *indices, offsets, triangles, collapse))
+                continue;
+
+            remap[collapse->from] = collapse->to;
+            AddQuadric(&quadrics[collapse->to], &quadrics[collapse->from]);
+            for(int j = offsets[collapse->from]; j < offsets[collapse->from+1]; j++)
+            {
+                const VertexIndex* triangle = &(*indices)[triangles[j]*3];
+                REPEAT(3, k)
+                    touched[triangle[k]] = true;
+            }
+            collapseCount++;
+        }
+
+        if(collapseCount == 0)
+            break;
+
+        int newIndexCount = 0;
+        for(int i = 0; i < (int)indices->size(); i += 3)
+        {
+            const VertexIndex a = remap[(*indices)[i+0]];
+            const VertexIndex b = remap[(*indices)[i+1]];
+            const VertexIndex c = remap[(*indices)[i+2]];
+            if(a == b || b == c || c == a)
+                continue;
+            (*indices)[newIndexCount+0] = a;
+            (*indices)[newIndexCount+1] = b;
+            (*indices)[newIndexCount+2] = c;
+            newIndexCount += 3;
+        }
+        indices->resize(newIndexCount);
+    }
+}
+
+static void GenerateMeshBufferLods( MeshBuffer* buffer )
+{
+    DiscardMeshBufferLods(buffer);
+
+    const Vertex* vertices = GetMeshBufferVertices(buffer);
+    const int vertexCount  = GetMeshBufferVertexCount(buffer);
+    const int indexCount   = GetBaseIndexCount(buffer);
+    if(indexCount == 0)
+        return;
+    assert(indexCount % 3 == 0);
+
+    std::vector<Quadric> quadrics(vertexCount);
+    memset(&quadrics[0], 0, sizeof(Quadric)*vertexCount);
+    CalcVertexQuadrics(vertices, &buffer->indices[0], indexCount, &quadrics[0]);
+
+    std::vector<bool> locked;
+    FindLockedVertices(vertices, vertexCount, &buffer->indices[0], indexCount, &locked);
+
+    // Each level is simplified further from the previous one:
+    std::vector<VertexIndex> lodIndices(buffer->indices.begin(),
+                                        buffer->indices.end());
+    while(buffer->lodCount < MAX_MESH_LODS)
+    {
+        const int previousIndexCount = lodIndices.size();
+        const int targetIndexCount = previousIndexCount / 6 * 3;
+        SimplifyTriangles(vertices,
+                          vertexCount,
+                          &quadrics[0],
+                          locked,
+                          &lodIndices,
+                          targetIndexCount);
+        if((double)lodIndices.size() > (double)previousIndexCount * (1.0 - MIN_LOD_REDUCTION))
+            break;
+
+        buffer->lodFirstIndices[buffer->lodCount] = buffer->indices.size();
+        buffer->indices.insert(buffer->indices.end(),
+                               lodIndices.begin(),
+                               lodIndices.end());
+        buffer->lodCount++;
+    }
+}
+
+
 // ---- jobs ----
 
 struct MeshBufferPostprocessingJobDesc
@@ -356,6 +818,9 @@ static void ProcessMeshBufferPostprocessingJob( void* _desc )
 
     if(desc->options & MESH_BUFFER_CALC_TANGENTS)
         CalcMeshBufferTangents(desc->buffer);
+
+    if(desc->options & MESH_BUFFER_GENERATE_LODS)
+        GenerateMeshBufferLods(desc->buffer);
 }
 
 JobId BeginMeshBufferPostprocessing( MeshBuffer* buffer, int options )
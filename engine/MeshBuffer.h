@@ -6,12 +6,30 @@
 #include "JobManager.h" // JobId
 
 struct MeshBuffer;
+struct TextureArrayPlacement;
+
+/**
+ * Detail levels of a mesh buffer - including the original geometry.
+ */
+static const int MAX_MESH_LODS = 4;
 
 enum MeshBufferPostprocessingOptions
 {
     MESH_BUFFER_INDEX         = (1 << 0),
     MESH_BUFFER_CALC_NORMALS  = (1 << 1),
-    MESH_BUFFER_CALC_TANGENTS = (1 << 2)
+    MESH_BUFFER_CALC_TANGENTS = (1 << 2),
+
+    /**
+     * Generates simplified detail levels using quadric edge collapse.
+     * Each level has about half the triangles of the previous one.
+     *
+     * Only indexed buffers are simplified.  Vertices on open borders and
+     * texture or normal seams are kept, so adjacent meshes don't crack.
+     * The result only depends on the input geometry.
+     *
+     * The levels are discarded once the indices are modified.
+     */
+    MESH_BUFFER_GENERATE_LODS = (1 << 3)
 };
 
 MeshBuffer* CreateMeshBuffer();
@@ -24,11 +42,34 @@ void AddIndexToMeshBuffer( MeshBuffer* buffer, VertexIndex index );
 void TransformMeshBuffer( MeshBuffer* buffer, Mat4 transformation );
 void AppendMeshBuffer( MeshBuffer* buffer, const MeshBuffer* otherBuffer, const Mat4* transformation );
 
+/**
+ * Applies #RemapTexCoords to all vertices starting at `firstVertex`.
+ */
+void RemapMeshBufferTexCoords( MeshBuffer* buffer, int firstVertex, const TextureArrayPlacement* placement );
+
 int GetMeshBufferVertexCount( const MeshBuffer* buffer );
 const Vertex* GetMeshBufferVertices( const MeshBuffer* buffer );
+
+/**
+ * Includes the indices of all detail levels.
+ */
 int GetMeshBufferIndexCount( const MeshBuffer* buffer );
 const VertexIndex* GetMeshBufferIndices( const MeshBuffer* buffer );
 
+/**
+ * Number of detail levels.  Level 0 is the original geometry.
+ */
+int GetMeshBufferLodCount( const MeshBuffer* buffer );
+
+/**
+ * The levels use the same vertices and store their indices one after
+ * another.
+ */
+void GetMeshBufferLodRange( const MeshBuffer* buffer,
+                            int lod,
+                            int* firstIndex,
+                            int* indexCount );
+
 /**
  * Starts a job which will enrich the mesh buffer according to the selected
  * `options`.
@@ -9,6 +9,7 @@
 #include "MeshBuffer.h"
 #include "Reference.h"
 #include "VoxelVolume.h"
+#include "TextureArray.h"
 #include "MeshChunkGenerator.h"
 
 
@@ -41,6 +42,7 @@ struct VoxelMesh
 {
     VoxelMeshType type;
     int materialId;
+    TextureArrayPlacement texturePlacement;
     union data_
     {
         BlockVoxelMesh block;
@@ -113,6 +115,7 @@ void ReleaseMeshChunkGenerator( MeshChunkGenerator* generator )
 static void* CreateVoxelMesh( MeshChunkGenerator* generator,
                               VoxelMeshType type,
                               int materialId,
+                              const TextureArrayPlacement* texturePlacement,
                               const BitCondition* conditions,
                               int conditionCount )
 {
@@ -123,6 +126,15 @@ static void* CreateVoxelMesh( MeshChunkGenerator* generator,
     VoxelMesh* mesh = &generator->voxelMeshes[i];
     mesh->type = type;
     mesh->materialId = materialId;
+    if(texturePlacement)
+    {
+        mesh->texturePlacement = *texturePlacement;
+    }
+    else
+    {
+        const TextureArrayPlacement identity = {0, 0, {{1, 1}}};
+        mesh->texturePlacement = identity;
+    }
     AddBitConditions(generator->meshConditions,
                      conditions,
                      conditionCount,
@@ -133,6 +145,7 @@ static void* CreateVoxelMesh( MeshChunkGenerator* generator,
 
 void CreateBlockVoxelMesh( MeshChunkGenerator* generator,
                            int materialId,
+                           const TextureArrayPlacement* texturePlacement,
                            const BitCondition* conditions,
                            int conditionCount,
                            bool transparent,
@@ -142,6 +155,7 @@ void CreateBlockVoxelMesh( MeshChunkGenerator* generator,
     BlockVoxelMesh* mesh = (BlockVoxelMesh*)CreateVoxelMesh(generator,
                                                             BLOCK_VOXEL_MESH,
                                                             materialId,
+                                                            texturePlacement,
                                                             conditions,
                                                             conditionCount);
     mesh->transparent = transparent;
@@ -381,6 +395,7 @@ static void ProcessVoxelMesh( ChunkEnvironment* env,
 {
     MeshBuffer* materialMeshBuffer =
         GetMeshBufferForMaterial(env, mesh->materialId);
+    const int firstVertex = GetMeshBufferVertexCount(materialMeshBuffer);
     switch(mesh->type)
     {
         case BLOCK_VOXEL_MESH:
@@ -389,9 +404,14 @@ static void ProcessVoxelMesh( ChunkEnvironment* env,
                                   materialMeshBuffer,
                                   x, y, z,
                                   (BlockVoxelMesh*)&mesh->data);
-            return;
+            break;
+
+        default:
+            FatalError("Unknown voxel mesh type.");
     }
-    FatalError("Unknown voxel mesh type.");
+    RemapMeshBufferTexCoords(materialMeshBuffer,
+                             firstVertex,
+                             &mesh->texturePlacement);
 }
 
 static void ProcessVoxelMeshes( ChunkEnvironment* env )
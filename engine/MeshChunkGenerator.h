@@ -9,6 +9,7 @@
 struct VoxelVolume;
 struct MeshBuffer;
 struct Mesh;
+struct TextureArrayPlacement;
 
 
 enum BlockVoxelMeshBuffers
@@ -60,6 +61,12 @@ void ReleaseMeshChunkGenerator( MeshChunkGenerator* generator );
  * #GenerateMeshChunk uses this id to determine the mesh in which the voxels
  * geometry should be written.
  *
+ * @param texturePlacement
+ * Texture coordinates of the geometry are remapped to this layer of a
+ * texture array (see #RemapTexCoords).  Voxel meshes which share a material
+ * id, but use different layers, still end up in the same mesh.
+ * May be `NULL`, which selects the first layer and keeps the coordinates.
+ *
  * @param conditions
  * Geometry is only generated for voxels, which match these conditions.
  *
@@ -79,6 +86,7 @@ void ReleaseMeshChunkGenerator( MeshChunkGenerator* generator );
  */
 void CreateBlockVoxelMesh( MeshChunkGenerator* generator,
                            int materialId,
+                           const TextureArrayPlacement* texturePlacement,
                            const BitCondition* conditions,
                            int conditionCount,
                            bool transparent,
@@ -5,13 +5,16 @@
 
 #include "Common.h"
 #include "Profiler.h"
+#include "Array.h"
 #include "Mesh.h"
+#include "OpenGLState.h"
 #include "Texture.h"
 #include "Shader.h"
 #include "Reference.h"
 #include "AttachmentTarget.h"
 #include "Camera.h"
 #include "LightWorld.h"
+#include "DrawList.h"
 #include "ModelWorld.h"
 
 
@@ -24,7 +27,7 @@ struct Model
     ReferenceCounter refCounter;
     Mat4 transformation;
     Mesh* mesh;
-    char programFamilyList[MAX_PROGRAM_FAMILY_LIST_SIZE];
+    ProgramFamilyListId programFamilyList;
     ShaderVariableSet* shaderVariableSet;
     AttachmentTarget attachmentTarget;
     int overlayLevel;
@@ -33,8 +36,11 @@ struct Model
 struct ModelDrawEntry
 {
     const Model* model;
+    Mat4 transformation;
     ShaderProgram* program;
+    int lod;
     ShaderVariableSet* generatedVariableSet;
+    ShaderVariableSet* lightVariableSet;
     ShaderVariableBindings bindings;
 };
 
@@ -43,6 +49,8 @@ struct ModelWorld
     ReferenceCounter refCounter;
     Model models[MAX_MODELS];
     ModelDrawEntry drawEntries[MAX_MODELS];
+    DrawKey drawKeys[MAX_MODELS];
+    DrawCommandList drawCommands;
 };
 
 
@@ -57,7 +65,11 @@ ModelWorld* CreateModelWorld()
     memset(world, 0, sizeof(ModelWorld));
     InitReferenceCounter(&world->refCounter);
     REPEAT(MAX_MODELS, i)
+    {
         world->drawEntries[i].generatedVariableSet = CreateShaderVariableSet();
+        world->drawEntries[i].lightVariableSet = CreateShaderVariableSet();
+    }
+    InitArray(&world->drawCommands);
     return world;
 }
 
@@ -75,7 +87,9 @@ static void FreeModelWorld( ModelWorld* world )
         }
 
         FreeShaderVariableSet(world->drawEntries[i].generatedVariableSet);
+        FreeShaderVariableSet(world->drawEntries[i].lightVariableSet);
     }
+    DestroyArray(&world->drawCommands);
     delete world;
 }
 
@@ -91,44 +105,23 @@ void ReleaseModelWorld( ModelWorld* world )
         FreeModelWorld(world);
 }
 
-static int CurrentOverlayLevel = 0;
-
 static void SetOverlayLevel( int level )
 {
     assert(InSerialPhase());
 
-    if(level == CurrentOverlayLevel)
-        return;
-
-    if(CurrentOverlayLevel == 0 &&
-                     level != 0)
-    {
-        glDepthMask(GL_FALSE);
-
-        glEnable(GL_POLYGON_OFFSET_FILL);
-        //glEnable(GL_POLYGON_OFFSET_LINE);
-        //glEnable(GL_POLYGON_OFFSET_POINT);
-
-    }
-    else if(CurrentOverlayLevel != 0 &&
-                          level == 0)
-    {
-        glDepthMask(GL_TRUE);
-
-        glDisable(GL_POLYGON_OFFSET_FILL);
-        //glDisable(GL_POLYGON_OFFSET_LINE);
-        //glDisable(GL_POLYGON_OFFSET_POINT);
-    }
-
-    if(level != 0)
-        glPolygonOffset(0.0, -level);
-
-    CurrentOverlayLevel = level;
+    const bool isOverlay = level != 0;
+    SetDepthMask(!isOverlay);
+    SetCapability(GL_POLYGON_OFFSET_FILL, isOverlay);
+    //SetCapability(GL_POLYGON_OFFSET_LINE, isOverlay);
+    //SetCapability(GL_POLYGON_OFFSET_POINT, isOverlay);
+    if(isOverlay)
+        SetPolygonOffset(0.0, -level);
 }
 
 static void ClearModelDrawEntry( ModelDrawEntry* entry )
 {
     ClearShaderVariableSet(entry->generatedVariableSet);
+    ClearShaderVariableSet(entry->lightVariableSet);
     entry->bindings.textureCount = 0;
 }
 
@@ -136,7 +129,7 @@ static int GetShaderVariableSets( const ShaderVariableSet*** setsOut,
                                   const ModelDrawEntry* entry,
                                   const Camera* camera )
 {
-    static const int SHADER_VARIABLE_SET_COUNT = 6;
+    static const int SHADER_VARIABLE_SET_COUNT = 7;
     static const ShaderVariableSet* sets[SHADER_VARIABLE_SET_COUNT];
     *setsOut = sets;
     const LightWorld* lightWorld = GetCameraLightWorld(camera);
@@ -145,9 +138,10 @@ static int GetShaderVariableSets( const ShaderVariableSet*** setsOut,
         sets[0] = GetCameraShaderVariableSet(camera);
         sets[1] = GetLightWorldShaderVariableSet(lightWorld);
         sets[2] = entry->generatedVariableSet;
-        sets[3] = entry->model->shaderVariableSet;
-        sets[4] = GetShaderProgramShaderVariableSet(entry->program);
-        sets[5] = GetGlobalShaderVariableSet();
+        sets[3] = entry->lightVariableSet;
+        sets[4] = entry->model->shaderVariableSet;
+        sets[5] = GetShaderProgramShaderVariableSet(entry->program);
+        sets[6] = GetGlobalShaderVariableSet();
         return SHADER_VARIABLE_SET_COUNT;
     }
     else
@@ -157,7 +151,7 @@ static int GetShaderVariableSets( const ShaderVariableSet*** setsOut,
         sets[2] = entry->model->shaderVariableSet;
         sets[3] = GetShaderProgramShaderVariableSet(entry->program);
         sets[4] = GetGlobalShaderVariableSet();
-        return SHADER_VARIABLE_SET_COUNT-1;
+        return SHADER_VARIABLE_SET_COUNT-2;
     }
 }
 
@@ -170,19 +164,35 @@ static Mat4 CalculateModelTransformation( const Model* model )
 
 static void SetModelDrawEntry( ModelDrawEntry* entry,
                                const Model* model,
-                               const ShaderProgramSet* programSet,
+                               ShaderProgramSet* programSet,
                                const Camera* camera )
 {
     entry->model = model;
-    entry->program = GetShaderProgramByFamilyList(programSet,
-                                                  model->programFamilyList);
+    entry->transformation = CalculateModelTransformation(model);
+    entry->program = GetShaderProgramByFamilyListId(programSet,
+                                                    model->programFamilyList);
     const ShaderVariableSet** variableSets = NULL;
 
+    // Incomplete models are rejected when they're drawn.
+    float radius = 1;
+    entry->lod = 0;
+    if(model->mesh)
+    {
+        radius = GetMeshRadius(model->mesh);
+        if(GetMeshLodCount(model->mesh) > 1)
+        {
+            const float projectedSize =
+                CalcCameraProjectedSize(camera, entry->transformation, radius);
+            entry->lod = SelectMeshLod(model->mesh, projectedSize);
+        }
+    }
+
     GenerateCameraModelShaderVariables(camera,
                                        entry->generatedVariableSet,
+                                       entry->lightVariableSet,
                                        entry->program,
-                                       CalculateModelTransformation(model),
-                                       1); // TODO: Pass a proper radius.
+                                       entry->transformation,
+                                       radius);
 
     const int variableSetCount =
         GetShaderVariableSets(&variableSets, entry, camera);
@@ -192,8 +202,30 @@ static void SetModelDrawEntry( ModelDrawEntry* entry,
                                  variableSetCount);
 }
 
-static void DrawModel( const ModelDrawEntry* entry,
-                       Camera* camera )
+static void SetDrawKey( DrawKey* key, const ModelDrawEntry* entry )
+{
+    key->program      = entry->program;
+    key->mesh         = entry->model->mesh;
+    key->lod          = entry->lod;
+    key->textureCount = entry->bindings.textureCount;
+    REPEAT(entry->bindings.textureCount, i)
+        key->textures[i] = entry->bindings.textures[i];
+    key->overlayLevel = entry->model->overlayLevel;
+    key->variableSet  = entry->model->shaderVariableSet;
+    key->lightVariableSet = entry->lightVariableSet;
+    // Inverse transformations aren't passed per instance:
+    key->instanced    = ShaderProgramSupportsInstancing(entry->program) &&
+                        !ProgramUsesInverseModelTransformations(entry->program);
+    key->multiDrawGroup = 0;
+    if(ShaderProgramSupportsMultiDraw(entry->program))
+        key->multiDrawGroup = GetMeshMultiDrawGroup(entry->model->mesh);
+}
+
+/**
+ * Applies the render state for the given entry - except the mesh.
+ */
+static void PrepareModelDraw( const ModelDrawEntry* entry,
+                              Camera* camera )
 {
     const Model* model     = entry->model;
     ShaderProgram* program = entry->program;
@@ -216,13 +248,103 @@ static void DrawModel( const ModelDrawEntry* entry,
                              &entry->bindings);
 
     SetOverlayLevel(model->overlayLevel);
+}
+
+static void DrawModel( const ModelDrawEntry* entry,
+                       Camera* camera )
+{
+    PrepareModelDraw(entry, camera);
 
     // Mesh optimization is handled by the mesh module already.
-    DrawMesh(model->mesh);
+    DrawMesh(entry->model->mesh, entry->lod);
+}
+
+static void SetModelInstanceTransformations( const ModelDrawEntry* entries,
+                                             int entryCount,
+                                             Camera* camera )
+{
+    assert(entryCount <= MAX_DRAW_INSTANCES);
+    static InstanceTransformation instances[MAX_DRAW_INSTANCES];
+
+    REPEAT(entryCount, i)
+    {
+        const ModelDrawEntry* entry = &entries[i];
+        InstanceTransformation* instance = &instances[i];
+        instance->model = entry->transformation;
+        CalcCameraModelTransformations(camera,
+                                       entry->transformation,
+                                       &instance->modelView,
+                                       &instance->modelViewProjection);
+    }
+
+    SetInstanceTransformations(instances, entryCount);
+}
+
+/**
+ * Draws multiple entries which have equal draw keys with one draw call.
+ *
+ * Only the transformations are passed per instance.  All other variables -
+ * including the lights - are equal, since they're part of the draw key.
+ */
+static void DrawModelInstances( const ModelDrawEntry* entries,
+                                int entryCount,
+                                Camera* camera )
+{
+    PrepareModelDraw(&entries[0], camera);
+    SetModelInstanceTransformations(entries, entryCount, camera);
+    DrawMeshInstanced(entries[0].model->mesh, entries[0].lod, entryCount);
+}
+
+/**
+ * Draws multiple entries, which only differ in their meshes, with one
+ * indirect draw call.
+ *
+ * Like #DrawModelInstances only the transformations are passed per entry.
+ * Meshes at different positions are usually lit by different lights, so
+ * they end up in separate runs.
+ */
+static void DrawModelsIndirect( const ModelDrawEntry* entries,
+                                int entryCount,
+                                Camera* camera )
+{
+    assert(entryCount <= MAX_DRAW_INSTANCES);
+    static MeshDrawRange ranges[MAX_DRAW_INSTANCES];
+    static IndirectDrawCommand commands[MAX_DRAW_INSTANCES];
+
+    REPEAT(entryCount, i)
+        GetMeshDrawRange(entries[i].model->mesh, entries[i].lod, &ranges[i]);
+    const int commandCount =
+        GenerateIndirectDrawCommands(commands, ranges, entryCount);
+
+    PrepareModelDraw(&entries[0], camera);
+    SetModelInstanceTransformations(entries, entryCount, camera);
+    DrawMeshesIndirect(entries[0].model->mesh, commands, commandCount);
+}
+
+static void ExecuteDrawCommand( const DrawCommand* command,
+                                const ModelDrawEntry* entries,
+                                Camera* camera )
+{
+    const ModelDrawEntry* firstEntry = &entries[command->firstEntry];
+    switch(command->type)
+    {
+        case DRAW_COMMAND:
+            DrawModel(firstEntry, camera);
+            return;
+
+        case DRAW_INSTANCED_COMMAND:
+            DrawModelInstances(firstEntry, command->entryCount, camera);
+            return;
+
+        case DRAW_MULTI_COMMAND:
+            DrawModelsIndirect(firstEntry, command->entryCount, camera);
+            return;
+    }
+    FatalError("Unknown draw command type.");
 }
 
 void DrawModelWorld( ModelWorld* world,
-                     const ShaderProgramSet* programSet,
+                     ShaderProgramSet* programSet,
                      Camera* camera )
 {
     ProfileFunction();
@@ -248,9 +370,19 @@ void DrawModelWorld( ModelWorld* world,
     // Sort draw list:
     qsort(drawEntries, drawEntryCount, sizeof(ModelDrawEntry), CompareModelDrawEntries);
 
-    // Render draw list:
+    // Merge equal entries into instanced draw commands:
+    DrawKey* drawKeys = world->drawKeys;
     REPEAT(drawEntryCount, i)
-        DrawModel(&drawEntries[i], camera);
+        SetDrawKey(&drawKeys[i], &drawEntries[i]);
+    GenerateDrawCommands(&world->drawCommands,
+                         drawKeys,
+                         drawEntryCount,
+                         MAX_DRAW_INSTANCES);
+
+    // Render draw list:
+    const DrawCommandList* drawCommands = &world->drawCommands;
+    REPEAT(drawCommands->length, i)
+        ExecuteDrawCommand(&drawCommands->data[i], drawEntries, camera);
 
     SetOverlayLevel(0);
 }
@@ -287,13 +419,20 @@ static int CompareModelDrawEntries( const void* a_, const void* b_ )
     if(r != 0)
         return r;
 
+    // Textures come before meshes, so models which only differ in their
+    // meshes end up next to each other and can be multi drawn:
+    r = Compare((uintptr_t)a->bindings.textures[0],
+                (uintptr_t)b->bindings.textures[0]);
+    if(r != 0)
+        return r;
+
     r = Compare((uintptr_t)a->model->mesh,
                 (uintptr_t)b->model->mesh);
     if(r != 0)
         return r;
 
-    r = Compare((uintptr_t)a->bindings.textures[0],
-                (uintptr_t)b->bindings.textures[0]);
+    r = Compare((uintptr_t)a->lod,
+                (uintptr_t)b->lod);
     if(r != 0)
         return r;
 
@@ -323,6 +462,7 @@ Model* CreateModel( ModelWorld* world )
     model->active = true;
     InitReferenceCounter(&model->refCounter);
     model->transformation = Mat4Identity;
+    model->programFamilyList = INVALID_PROGRAM_FAMILY_LIST_ID;
     model->shaderVariableSet = CreateShaderVariableSet();
     InitAttachmentTarget(&model->attachmentTarget);
     return model;
@@ -382,9 +522,7 @@ void SetModelMesh( Model* model, Mesh* mesh )
 void SetModelProgramFamilyList( Model* model, const char* familyList )
 {
     assert(InSerialPhase());
-    CopyString(familyList,
-               model->programFamilyList,
-               sizeof(model->programFamilyList));
+    model->programFamilyList = InternProgramFamilyList(familyList);
 }
 
 ShaderVariableSet* GetModelShaderVariableSet( const Model* model )
@@ -395,5 +533,5 @@ ShaderVariableSet* GetModelShaderVariableSet( const Model* model )
 static bool ModelIsComplete( const Model* model )
 {
     return model->mesh &&
-           model->programFamilyList[0] != '\0';
+           model->programFamilyList != INVALID_PROGRAM_FAMILY_LIST_ID;
 }
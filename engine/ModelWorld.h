@@ -33,7 +33,7 @@ void ReferenceModelWorld( ModelWorld* world );
 void ReleaseModelWorld( ModelWorld* world );
 
 void DrawModelWorld( ModelWorld* world,
-                     const ShaderProgramSet* programSet,
+                     ShaderProgramSet* programSet,
                      Camera* camera );
 
 
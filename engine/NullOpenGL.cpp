@@ -0,0 +1,1562 @@
+#include <assert.h>
+#include <string.h> // memset, strcmp, strncpy, strncat, strlen, strchr
+#include <stdlib.h> // atoi
+
+#include "Common.h"
+#include "OpenGL.h"
+#include "OpenGLState.h" // ResetOpenGLState
+#include "Array.h"
+#include "NullOpenGL.h"
+
+
+static const int MAX_NULL_GL_NAME_SIZE = 64;
+static const int STD140_VEC4_SIZE = 16;
+static const GLenum NULL_PROGRAM_BINARY_FORMAT = 0x4e554c4c; // 'NULL'
+
+
+struct NullUniform
+{
+    char name[MAX_NULL_GL_NAME_SIZE]; // Array uniforms are stored without `[0]`.
+    GLenum type;
+    int size; // Array length
+    int location; // -1 for block members
+
+    // std140 layout of block members:
+    int block; // -1 for uniforms of the default block
+    int offset;
+    int arrayStride;
+    int matrixStride;
+};
+
+struct NullAttribute
+{
+    char name[MAX_NULL_GL_NAME_SIZE];
+};
+
+struct NullUniformBlock
+{
+    char name[MAX_NULL_GL_NAME_SIZE];
+    int dataSize;
+};
+
+/**
+ * Memory layout of a GLSL type as defined by the std140 rules.
+ */
+struct Std140Type
+{
+    char name[MAX_NULL_GL_NAME_SIZE];
+    int size;
+    int alignment;
+};
+
+/**
+ * Shader or shader program.
+ */
+struct NullShaderObject
+{
+    bool inUse;
+    GLenum shaderType; // `GL_NONE` for programs
+    bool linked;
+    Array<NullAttribute> attributes; // Location is the index.
+    Array<NullUniform> uniforms;
+    Array<NullUniformBlock> uniformBlocks;
+    Array<GLuint> attachedShaders;
+};
+
+/**
+ * Header of the program binaries.  It's followed by the attributes, uniforms
+ * and uniform blocks of the program.
+ */
+struct NullProgramBinaryHeader
+{
+    int driverInstance;
+    int attributeCount;
+    int uniformCount;
+    int uniformBlockCount;
+};
+
+/**
+ * Incremented on each initialization.  Program binaries are only accepted
+ * by the instance which created them, just like drivers reject binaries
+ * after an update.
+ */
+static int NullDriverInstance = 0;
+
+static struct
+{
+    NullOpenGLStatistics statistics;
+    GLuint lastObjectName; // Used for buffers, textures, etc.
+    Array<NullShaderObject> shaderObjects; // Index is the name minus one.
+    Array<char> mappedBuffer; // Memory which is handed out by glMapBufferRange
+} NullOpenGL;
+
+
+// --- GLSL declaration parser ---
+
+struct GlslTokenizer
+{
+    const char* pos;
+    const char* end;
+    char token[MAX_NULL_GL_NAME_SIZE];
+};
+
+static bool IsIdentifierChar( char c )
+{
+    return (c >= 'a' && c <= 'z') ||
+           (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') ||
+           c == '_';
+}
+
+static void SkipWhitespaceAndComments( GlslTokenizer* t )
+{
+    while(t->pos < t->end)
+    {
+        const char c = *t->pos;
+        const char next = (t->pos+1 < t->end) ? t->pos[1] : '\0';
+        if((c == '/' && next == '/') || c == '#') // Also skips preprocessor directives.
+        {
+            while(t->pos < t->end && *t->pos != '\n')
+                t->pos++;
+        }
+        else if(c == '/' && next == '*')
+        {
+            t->pos += 2;
+            while(t->pos+1 < t->end && !(t->pos[0] == '*' && t->pos[1] == '/'))
+                t->pos++;
+            t->pos += 2;
+        }
+        else if(c == ' ' || c == '\t' || c == '\n' || c == '\r')
+        {
+            t->pos++;
+        }
+        else
+        {
+            break;
+        }
+    }
+}
+
+static bool NextToken( GlslTokenizer* t )
+{
+    SkipWhitespaceAndComments(t);
+    if(t->pos >= t->end)
+    {
+        t->token[0] = '\0';
+        return false;
+    }
+
+    int length = 0;
+    if(IsIdentifierChar(*t->pos))
+    {
+        while(t->pos < t->end && IsIdentifierChar(*t->pos))
+        {
+            if(length < MAX_NULL_GL_NAME_SIZE-1)
+                t->token[length++] = *t->pos;
+            t->pos++;
+        }
+    }
+    else
+    {
+        t->token[length++] = *t->pos;
+        t->pos++;
+    }
+    t->token[length] = '\0';
+    return true;
+}
+
+static bool TokenIs( const GlslTokenizer* t, const char* token )
+{
+    return strcmp(t->token, token) == 0;
+}
+
+/**
+ * Skips tokens till the given closing character, which matches the one that
+ * has just been read.
+ */
+static void SkipBlock( GlslTokenizer* t, char open, char close )
+{
+    int depth = 1;
+    while(depth > 0 && NextToken(t))
+    {
+        if(t->token[0] == open)
+            depth++;
+        else if(t->token[0] == close)
+            depth--;
+    }
+}
+
+static int RoundUp( int value, int multiple )
+{
+    return ((value + multiple - 1) / multiple) * multiple;
+}
+
+static bool GetBuiltinStd140Type( const char* name, Std140Type* type )
+{
+    static const Std140Type builtinTypes[] =
+    {
+        {"bool",   4,  4},
+        {"int",    4,  4},
+        {"uint",   4,  4},
+        {"float",  4,  4},
+        {"vec2",   8,  8},
+        {"vec3",  12, 16},
+        {"vec4",  16, 16},
+        {"ivec2",  8,  8},
+        {"ivec3", 12, 16},
+        {"ivec4", 16, 16},
+        {"mat3",  48, 16}, // Stored like vec3[3]
+        {"mat4",  64, 16}
+    };
+
+    REPEAT(sizeof(builtinTypes)/sizeof(Std140Type), i)
+    {
+        if(strcmp(builtinTypes[i].name, name) == 0)
+        {
+            *type = builtinTypes[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool GetStd140Type( const Array<Std140Type>* structs,
+                           const char* name,
+                           Std140Type* type )
+{
+    if(GetBuiltinStd140Type(name, type))
+        return true;
+
+    REPEAT(structs->length, i)
+    {
+        if(strcmp(structs->data[i].name, name) == 0)
+        {
+            *type = structs->data[i];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static GLenum GetUniformGLType( const char* name );
+
+/**
+ * Parses struct or block members till the closing brace and calculates their
+ * std140 layout.
+ *
+ * @param members
+ * If not `NULL`, members of a builtin type are added as uniforms of `block`.
+ * (Members of struct type aren't reported.)
+ */
+static Std140Type ParseMembers( GlslTokenizer* t,
+                                const Array<Std140Type>* structs,
+                                const char* name,
+                                Array<NullUniform>* members,
+                                int block )
+{
+    Std140Type result;
+    memset(&result, 0, sizeof(result));
+    strncpy(result.name, name, MAX_NULL_GL_NAME_SIZE-1);
+    result.alignment = STD140_VEC4_SIZE;
+
+    while(NextToken(t) && !TokenIs(t, "}"))
+    {
+        char typeName[MAX_NULL_GL_NAME_SIZE];
+        strncpy(typeName, t->token, MAX_NULL_GL_NAME_SIZE);
+
+        Std140Type memberType;
+        const bool isBuiltin = GetBuiltinStd140Type(typeName, &memberType);
+        if(!isBuiltin && !GetStd140Type(structs, typeName, &memberType))
+            FatalError("Null OpenGL backend: Unsupported type '%s' in %s.",
+                       typeName, name);
+
+        NextToken(t);
+        char memberName[MAX_NULL_GL_NAME_SIZE];
+        strncpy(memberName, t->token, MAX_NULL_GL_NAME_SIZE);
+
+        int length = 1;
+        int arrayStride = 0;
+        NextToken(t);
+        if(TokenIs(t, "["))
+        {
+            NextToken(t);
+            length = atoi(t->token);
+            NextToken(t); // ]
+            NextToken(t); // ;
+
+            arrayStride = RoundUp(memberType.size, STD140_VEC4_SIZE);
+            memberType.alignment = STD140_VEC4_SIZE;
+            memberType.size = arrayStride * length;
+        }
+
+        result.size = RoundUp(result.size, memberType.alignment);
+
+        if(members && isBuiltin)
+        {
+            NullUniform* member = AllocateAtEndOfArray(members, 1);
+            memset(member, 0, sizeof(NullUniform));
+            strncpy(member->name, memberName, MAX_NULL_GL_NAME_SIZE);
+            member->type = GetUniformGLType(typeName);
+            member->size = length;
+            member->location = -1;
+            member->block = block;
+            member->offset = result.size;
+            member->arrayStride = arrayStride;
+            if(strncmp(typeName, "mat", 3) == 0)
+                member->matrixStride = STD140_VEC4_SIZE;
+        }
+
+        result.size += memberType.size;
+    }
+
+    result.size = RoundUp(result.size, result.alignment);
+    return result;
+}
+
+static GLenum GetUniformGLType( const char* name )
+{
+    static const struct { const char* name; GLenum type; } types[] =
+    {
+        {"bool",            GL_BOOL},
+        {"int",             GL_INT},
+        {"uint",            GL_UNSIGNED_INT},
+        {"float",           GL_FLOAT},
+        {"ivec2",           GL_INT_VEC2},
+        {"ivec3",           GL_INT_VEC3},
+        {"ivec4",           GL_INT_VEC4},
+        {"vec2",            GL_FLOAT_VEC2},
+        {"vec3",            GL_FLOAT_VEC3},
+        {"vec4",            GL_FLOAT_VEC4},
+        {"mat3",            GL_FLOAT_MAT3},
+        {"mat4",            GL_FLOAT_MAT4},
+        {"sampler2D",       GL_SAMPLER_2D},
+        {"sampler2DShadow", GL_SAMPLER_2D_SHADOW},
+        {"samplerCube",     GL_SAMPLER_CUBE}
+    };
+
+    REPEAT(sizeof(types)/sizeof(types[0]), i)
+        if(strcmp(types[i].name, name) == 0)
+            return types[i].type;
+
+    FatalError("Null OpenGL backend: Unsupported uniform type '%s'.", name);
+    return GL_NONE;
+}
+
+static void ParseShaderSource( NullShaderObject* shader,
+                               const char* source,
+                               int length )
+{
+    Array<Std140Type> structs;
+    InitArray(&structs);
+
+    GlslTokenizer t;
+    t.pos = source;
+    t.end = source + length;
+
+    while(NextToken(&t))
+    {
+        if(TokenIs(&t, "struct"))
+        {
+            NextToken(&t);
+            char name[MAX_NULL_GL_NAME_SIZE];
+            strncpy(name, t.token, MAX_NULL_GL_NAME_SIZE);
+            NextToken(&t); // {
+            const Std140Type type = ParseMembers(&t, &structs, name, NULL, -1);
+            AppendToArray(&structs, 1, &type);
+        }
+        else if(TokenIs(&t, "uniform"))
+        {
+            NextToken(&t);
+            char typeName[MAX_NULL_GL_NAME_SIZE];
+            strncpy(typeName, t.token, MAX_NULL_GL_NAME_SIZE);
+
+            NextToken(&t);
+            if(TokenIs(&t, "{"))
+            {
+                NullUniformBlock* block =
+                    AllocateAtEndOfArray(&shader->uniformBlocks, 1);
+                memset(block, 0, sizeof(NullUniformBlock));
+                strncpy(block->name, typeName, MAX_NULL_GL_NAME_SIZE);
+                block->dataSize = ParseMembers(&t,
+                                               &structs,
+                                               typeName,
+                                               &shader->uniforms,
+                                               shader->uniformBlocks.length-1).size;
+            }
+            else
+            {
+                NullUniform* uniform = AllocateAtEndOfArray(&shader->uniforms, 1);
+                memset(uniform, 0, sizeof(NullUniform));
+                strncpy(uniform->name, t.token, MAX_NULL_GL_NAME_SIZE);
+                uniform->type = GetUniformGLType(typeName);
+                uniform->size = 1;
+                uniform->block = -1;
+
+                NextToken(&t);
+                if(TokenIs(&t, "["))
+                {
+                    NextToken(&t);
+                    uniform->size = atoi(t.token);
+                }
+            }
+        }
+        else if(TokenIs(&t, "in") && shader->shaderType == GL_VERTEX_SHADER)
+        {
+            NextToken(&t); // Type
+            NextToken(&t);
+            NullAttribute* attribute =
+                AllocateAtEndOfArray(&shader->attributes, 1);
+            memset(attribute, 0, sizeof(NullAttribute));
+            strncpy(attribute->name, t.token, MAX_NULL_GL_NAME_SIZE-1);
+        }
+        else if(TokenIs(&t, "(")) // Layout qualifiers or function parameters
+        {
+            SkipBlock(&t, '(', ')');
+        }
+        else if(TokenIs(&t, "{")) // Function body
+        {
+            SkipBlock(&t, '{', '}');
+        }
+    }
+
+    DestroyArray(&structs);
+}
+
+
+// --- Object management ---
+
+static GLuint CreateObjectName()
+{
+    NullOpenGL.lastObjectName++;
+    return NullOpenGL.lastObjectName;
+}
+
+static void GenObjectNames( GLsizei count, GLuint* names )
+{
+    REPEAT(count, i)
+        names[i] = CreateObjectName();
+}
+
+static GLuint CreateShaderObject( GLenum shaderType )
+{
+    NullShaderObject* object =
+        AllocateAtEndOfArray(&NullOpenGL.shaderObjects, 1);
+    memset(object, 0, sizeof(NullShaderObject));
+    object->inUse = true;
+    object->shaderType = shaderType;
+    InitArray(&object->attributes);
+    InitArray(&object->uniforms);
+    InitArray(&object->uniformBlocks);
+    InitArray(&object->attachedShaders);
+    return (GLuint)NullOpenGL.shaderObjects.length;
+}
+
+static NullShaderObject* GetShaderObject( GLuint name )
+{
+    const int index = (int)name - 1;
+    Ensure(index >= 0 && index < NullOpenGL.shaderObjects.length);
+    NullShaderObject* object = &NullOpenGL.shaderObjects.data[index];
+    Ensure(object->inUse);
+    return object;
+}
+
+static void FreeShaderObject( NullShaderObject* object )
+{
+    DestroyArray(&object->attributes);
+    DestroyArray(&object->uniforms);
+    DestroyArray(&object->uniformBlocks);
+    DestroyArray(&object->attachedShaders);
+    object->inUse = false;
+}
+
+static NullUniform* FindUniform( NullShaderObject* program, const char* name )
+{
+    REPEAT(program->uniforms.length, i)
+    {
+        NullUniform* uniform = &program->uniforms.data[i];
+        if(strcmp(uniform->name, name) == 0)
+            return uniform;
+    }
+    return NULL;
+}
+
+static int FindUniformBlock( const NullShaderObject* program, const char* name )
+{
+    REPEAT(program->uniformBlocks.length, i)
+        if(strcmp(program->uniformBlocks.data[i].name, name) == 0)
+            return i;
+    return -1;
+}
+
+static void LinkProgram( NullShaderObject* program )
+{
+    ClearArray(&program->attributes);
+    ClearArray(&program->uniforms);
+    ClearArray(&program->uniformBlocks);
+
+    int nextLocation = 0;
+    REPEAT(program->attachedShaders.length, i)
+    {
+        const NullShaderObject* shader =
+            GetShaderObject(program->attachedShaders.data[i]);
+
+        AppendToArray(&program->attributes,
+                      shader->attributes.length,
+                      shader->attributes.data);
+
+        // Uniforms and blocks may be declared by multiple stages:
+
+        REPEAT(shader->uniformBlocks.length, j)
+        {
+            const NullUniformBlock* block = &shader->uniformBlocks.data[j];
+            if(FindUniformBlock(program, block->name) == -1)
+                AppendToArray(&program->uniformBlocks, 1, block);
+        }
+
+        REPEAT(shader->uniforms.length, j)
+        {
+            const NullUniform* uniform = &shader->uniforms.data[j];
+            if(FindUniform(program, uniform->name))
+                continue;
+
+            NullUniform* programUniform =
+                AppendToArray(&program->uniforms, 1, uniform);
+            if(uniform->block == -1)
+            {
+                programUniform->location = nextLocation;
+                nextLocation += uniform->size;
+            }
+            else
+            {
+                const char* blockName =
+                    shader->uniformBlocks.data[uniform->block].name;
+                programUniform->block = FindUniformBlock(program, blockName);
+            }
+        }
+    }
+
+    program->linked = true;
+}
+
+static int GetProgramBinarySize( const NullShaderObject* program )
+{
+    return sizeof(NullProgramBinaryHeader) +
+           sizeof(NullAttribute)*program->attributes.length +
+           sizeof(NullUniform)*program->uniforms.length +
+           sizeof(NullUniformBlock)*program->uniformBlocks.length;
+}
+
+static void WriteProgramBinary( const NullShaderObject* program, char* binary )
+{
+    NullProgramBinaryHeader header;
+    header.driverInstance = NullDriverInstance;
+    header.attributeCount = program->attributes.length;
+    header.uniformCount = program->uniforms.length;
+    header.uniformBlockCount = program->uniformBlocks.length;
+
+    memcpy(binary, &header, sizeof(header));
+    binary += sizeof(header);
+    memcpy(binary, program->attributes.data, sizeof(NullAttribute)*header.attributeCount);
+    binary += sizeof(NullAttribute)*header.attributeCount;
+    memcpy(binary, program->uniforms.data, sizeof(NullUniform)*header.uniformCount);
+    binary += sizeof(NullUniform)*header.uniformCount;
+    memcpy(binary, program->uniformBlocks.data, sizeof(NullUniformBlock)*header.uniformBlockCount);
+}
+
+static bool ReadProgramBinary( NullShaderObject* program,
+                               const char* binary,
+                               int size )
+{
+    if(size < (int)sizeof(NullProgramBinaryHeader))
+        return false;
+
+    NullProgramBinaryHeader header;
+    memcpy(&header, binary, sizeof(header));
+    binary += sizeof(header);
+    if(header.driverInstance != NullDriverInstance)
+        return false;
+
+    const int attributesSize = sizeof(NullAttribute)*header.attributeCount;
+    const int uniformsSize = sizeof(NullUniform)*header.uniformCount;
+    const int blocksSize = sizeof(NullUniformBlock)*header.uniformBlockCount;
+    if(size != (int)sizeof(header) + attributesSize + uniformsSize + blocksSize)
+        return false;
+
+    AppendToArray(&program->attributes, header.attributeCount, (const NullAttribute*)binary);
+    binary += attributesSize;
+    AppendToArray(&program->uniforms, header.uniformCount, (const NullUniform*)binary);
+    binary += uniformsSize;
+    AppendToArray(&program->uniformBlocks, header.uniformBlockCount, (const NullUniformBlock*)binary);
+    return true;
+}
+
+
+// --- Stubs ---
+
+static void CountCall()
+{
+    NullOpenGL.statistics.calls++;
+}
+
+static void CountStateChange()
+{
+    NullOpenGL.statistics.calls++;
+    NullOpenGL.statistics.stateChanges++;
+}
+
+static void CountUniformUpload()
+{
+    NullOpenGL.statistics.calls++;
+    NullOpenGL.statistics.uniformUploads++;
+}
+
+static void CountDrawCall()
+{
+    NullOpenGL.statistics.calls++;
+    NullOpenGL.statistics.drawCalls++;
+}
+
+// General:
+
+static const GLubyte* APIENTRY NullGetString( GLenum name )
+{
+    CountCall();
+    switch(name)
+    {
+        case GL_VERSION:                  return (const GLubyte*)"3.2.0 Null";
+        case GL_VENDOR:                   return (const GLubyte*)"Konstrukt";
+        case GL_RENDERER:                 return (const GLubyte*)"Null";
+        case GL_SHADING_LANGUAGE_VERSION: return (const GLubyte*)"1.50";
+        default:                          return NULL;
+    }
+}
+
+/**
+ * Extensions whose functions are stubbed too.
+ */
+static const char* NullExtensions[] =
+{
+    "GL_ARB_base_instance",
+    "GL_ARB_draw_indirect",
+    "GL_ARB_get_program_binary",
+    "GL_ARB_instanced_arrays",
+    "GL_ARB_multi_draw_indirect"
+};
+static const int NULL_EXTENSION_COUNT = sizeof(NullExtensions)/sizeof(const char*);
+
+static const GLubyte* APIENTRY NullGetStringi( GLenum name, GLuint index )
+{
+    CountCall();
+    if(name == GL_EXTENSIONS && index < (GLuint)NULL_EXTENSION_COUNT)
+        return (const GLubyte*)NullExtensions[index];
+    return NULL;
+}
+
+static void APIENTRY NullGetIntegerv( GLenum name, GLint* data )
+{
+    CountCall();
+    switch(name)
+    {
+        case GL_MAJOR_VERSION:              *data = 3; break;
+        case GL_MINOR_VERSION:              *data = 2; break;
+        case GL_NUM_EXTENSIONS:             *data = NULL_EXTENSION_COUNT; break;
+        case GL_NUM_PROGRAM_BINARY_FORMATS: *data = 1; break;
+        case GL_PROGRAM_BINARY_FORMATS:     *data = NULL_PROGRAM_BINARY_FORMAT; break;
+        default:                            *data = 0; break;
+    }
+}
+
+static void APIENTRY NullGetInteger64v( GLenum name, GLint64* data )
+{
+    CountCall();
+    *data = 0;
+}
+
+static void APIENTRY NullGetFloatv( GLenum name, GLfloat* data )
+{
+    CountCall();
+    *data = 0;
+}
+
+static GLenum APIENTRY NullGetError()
+{
+    CountCall();
+    return GL_NO_ERROR;
+}
+
+static void APIENTRY NullFlush()
+{
+    CountCall();
+}
+
+static void APIENTRY NullClear( GLbitfield mask )
+{
+    CountCall();
+    NullOpenGL.statistics.clears++;
+}
+
+static void APIENTRY NullClearColor( GLfloat r, GLfloat g, GLfloat b, GLfloat a )
+{
+    CountCall();
+}
+
+// State:
+
+static void APIENTRY NullEnable( GLenum capability )
+{
+    CountStateChange();
+}
+
+static void APIENTRY NullDisable( GLenum capability )
+{
+    CountStateChange();
+}
+
+static void APIENTRY NullDepthFunc( GLenum function )
+{
+    CountStateChange();
+}
+
+static void APIENTRY NullDepthMask( GLboolean flag )
+{
+    CountStateChange();
+}
+
+static void APIENTRY NullCullFace( GLenum face )
+{
+    CountStateChange();
+}
+
+static void APIENTRY NullBlendEquationSeparate( GLenum rgb, GLenum alpha )
+{
+    CountStateChange();
+}
+
+static void APIENTRY NullBlendFuncSeparate( GLenum srcRgb,
+                                            GLenum dstRgb,
+                                            GLenum srcAlpha,
+                                            GLenum dstAlpha )
+{
+    CountStateChange();
+}
+
+static void APIENTRY NullPolygonOffset( GLfloat factor, GLfloat units )
+{
+    CountStateChange();
+}
+
+static void APIENTRY NullViewport( GLint x, GLint y, GLsizei width, GLsizei height )
+{
+    CountStateChange();
+}
+
+// Buffers and vertex arrays:
+
+static void APIENTRY NullGenObjects( GLsizei count, GLuint* names )
+{
+    CountCall();
+    GenObjectNames(count, names);
+}
+
+static void APIENTRY NullDeleteObjects( GLsizei count, const GLuint* names )
+{
+    CountCall();
+}
+
+static void APIENTRY NullBindBuffer( GLenum target, GLuint buffer )
+{
+    CountStateChange();
+}
+
+static void APIENTRY NullBindBufferBase( GLenum target, GLuint index, GLuint buffer )
+{
+    CountStateChange();
+}
+
+static void APIENTRY NullBufferData( GLenum target,
+                                     GLsizeiptr size,
+                                     const void* data,
+                                     GLenum usage )
+{
+    CountCall();
+    NullOpenGL.statistics.bufferUploads++;
+}
+
+static void APIENTRY NullBufferSubData( GLenum target,
+                                        GLintptr offset,
+                                        GLsizeiptr size,
+                                        const void* data )
+{
+    CountCall();
+    NullOpenGL.statistics.bufferUploads++;
+}
+
+static void* APIENTRY NullMapBufferRange( GLenum target,
+                                          GLintptr offset,
+                                          GLsizeiptr length,
+                                          GLbitfield access )
+{
+    CountCall();
+    ClearArray(&NullOpenGL.mappedBuffer);
+    return AllocateAtEndOfArray(&NullOpenGL.mappedBuffer, length);
+}
+
+static GLboolean APIENTRY NullUnmapBuffer( GLenum target )
+{
+    CountCall();
+    NullOpenGL.statistics.bufferUploads++;
+    return GL_TRUE;
+}
+
+static void APIENTRY NullBindVertexArray( GLuint array )
+{
+    CountStateChange();
+}
+
+static void APIENTRY NullBindFramebuffer( GLenum target, GLuint framebuffer )
+{
+    CountStateChange();
+}
+
+static void APIENTRY NullEnableVertexAttribArray( GLuint index )
+{
+    CountStateChange();
+}
+
+static void APIENTRY NullVertexAttribPointer( GLuint index,
+                                              GLint size,
+                                              GLenum type,
+                                              GLboolean normalized,
+                                              GLsizei stride,
+                                              const void* pointer )
+{
+    CountStateChange();
+}
+
+static void APIENTRY NullVertexAttribIPointer( GLuint index,
+                                               GLint size,
+                                               GLenum type,
+                                               GLsizei stride,
+                                               const void* pointer )
+{
+    CountStateChange();
+}
+
+static void APIENTRY NullVertexAttribDivisor( GLuint index, GLuint divisor )
+{
+    CountStateChange();
+}
+
+// Textures:
+
+static void APIENTRY NullActiveTexture( GLenum unit )
+{
+    CountStateChange();
+}
+
+static void APIENTRY NullBindTexture( GLenum target, GLuint texture )
+{
+    CountStateChange();
+}
+
+static void APIENTRY NullTexParameteri( GLenum target, GLenum name, GLint value )
+{
+    CountCall();
+}
+
+static void APIENTRY NullTexParameterf( GLenum target, GLenum name, GLfloat value )
+{
+    CountCall();
+}
+
+static void APIENTRY NullTexImage2D( GLenum target,
+                                     GLint level,
+                                     GLint internalFormat,
+                                     GLsizei width,
+                                     GLsizei height,
+                                     GLint border,
+                                     GLenum format,
+                                     GLenum type,
+                                     const void* pixels )
+{
+    CountCall();
+    NullOpenGL.statistics.textureUploads++;
+}
+
+static int GetPixelSize( GLenum format, GLenum type )
+{
+    int components = 0;
+    switch(format)
+    {
+        case GL_RED:  components = 1; break;
+        case GL_RG:   components = 2; break;
+        case GL_RGB:  components = 3; break;
+        case GL_RGBA: components = 4; break;
+        default: FatalError("Unsupported pixel format 0x%X", format);
+    }
+    return (type == GL_UNSIGNED_BYTE) ? components : components*4;
+}
+
+static void APIENTRY NullTexSubImage2D( GLenum target,
+                                        GLint level,
+                                        GLint x,
+                                        GLint y,
+                                        GLsizei width,
+                                        GLsizei height,
+                                        GLenum format,
+                                        GLenum type,
+                                        const void* pixels )
+{
+    CountCall();
+    NullOpenGL.statistics.textureUploads++;
+
+    // Rows are aligned like GL_UNPACK_ALIGNMENT demands by default:
+    const int rowSize = (width*GetPixelSize(format, type) + 3) / 4 * 4;
+    NullOpenGL.statistics.textureUploadBytes += rowSize*height;
+}
+
+static void APIENTRY NullTexImage3D( GLenum target,
+                                     GLint level,
+                                     GLint internalFormat,
+                                     GLsizei width,
+                                     GLsizei height,
+                                     GLsizei depth,
+                                     GLint border,
+                                     GLenum format,
+                                     GLenum type,
+                                     const void* pixels )
+{
+    CountCall();
+    NullOpenGL.statistics.textureUploads++;
+}
+
+static void APIENTRY NullTexSubImage3D( GLenum target,
+                                        GLint level,
+                                        GLint x,
+                                        GLint y,
+                                        GLint z,
+                                        GLsizei width,
+                                        GLsizei height,
+                                        GLsizei depth,
+                                        GLenum format,
+                                        GLenum type,
+                                        const void* pixels )
+{
+    CountCall();
+    NullOpenGL.statistics.textureUploads++;
+
+    const int rowSize = (width*GetPixelSize(format, type) + 3) / 4 * 4;
+    NullOpenGL.statistics.textureUploadBytes += rowSize*height*depth;
+}
+
+static void APIENTRY NullGenerateMipmap( GLenum target )
+{
+    CountCall();
+}
+
+// Shaders:
+
+static GLuint APIENTRY NullCreateShader( GLenum type )
+{
+    CountCall();
+    return CreateShaderObject(type);
+}
+
+static GLuint APIENTRY NullCreateProgram()
+{
+    CountCall();
+    return CreateShaderObject(GL_NONE);
+}
+
+static void APIENTRY NullDeleteShaderObject( GLuint name )
+{
+    CountCall();
+    FreeShaderObject(GetShaderObject(name));
+}
+
+static void APIENTRY NullShaderSource( GLuint shader,
+                                       GLsizei count,
+                                       const GLchar* const* strings,
+                                       const GLint* lengths )
+{
+    CountCall();
+    NullShaderObject* object = GetShaderObject(shader);
+    ClearArray(&object->attributes);
+    ClearArray(&object->uniforms);
+    ClearArray(&object->uniformBlocks);
+    REPEAT(count, i)
+    {
+        const int length = (lengths && lengths[i] >= 0) ? lengths[i]
+                                                        : strlen(strings[i]);
+        ParseShaderSource(object, strings[i], length);
+    }
+}
+
+static void APIENTRY NullCompileShader( GLuint shader )
+{
+    CountCall();
+    NullOpenGL.statistics.shaderCompilations++;
+}
+
+static void APIENTRY NullAttachShader( GLuint program, GLuint shader )
+{
+    CountCall();
+    AppendToArray(&GetShaderObject(program)->attachedShaders, 1, &shader);
+}
+
+static void APIENTRY NullLinkProgram( GLuint program )
+{
+    CountCall();
+    LinkProgram(GetShaderObject(program));
+}
+
+static void APIENTRY NullValidateProgram( GLuint program )
+{
+    CountCall();
+}
+
+static void APIENTRY NullProgramParameteri( GLuint program, GLenum name, GLint value )
+{
+    CountCall();
+}
+
+static void APIENTRY NullGetProgramBinary( GLuint program,
+                                           GLsizei bufferSize,
+                                           GLsizei* length,
+                                           GLenum* format,
+                                           void* binary )
+{
+    CountCall();
+    const NullShaderObject* object = GetShaderObject(program);
+    const int size = GetProgramBinarySize(object);
+    Ensure(object->linked);
+    Ensure(bufferSize >= size);
+    WriteProgramBinary(object, (char*)binary);
+    if(length)
+        *length = size;
+    *format = NULL_PROGRAM_BINARY_FORMAT;
+}
+
+static void APIENTRY NullProgramBinary( GLuint program,
+                                        GLenum format,
+                                        const void* binary,
+                                        GLsizei length )
+{
+    CountCall();
+    NullShaderObject* object = GetShaderObject(program);
+    ClearArray(&object->attributes);
+    ClearArray(&object->uniforms);
+    ClearArray(&object->uniformBlocks);
+    object->linked = format == NULL_PROGRAM_BINARY_FORMAT &&
+                     ReadProgramBinary(object, (const char*)binary, length);
+}
+
+static void APIENTRY NullGetShaderiv( GLuint shader, GLenum name, GLint* value )
+{
+    CountCall();
+    switch(name)
+    {
+        case GL_COMPILE_STATUS: *value = GL_TRUE; break;
+        default:                *value = 0;       break;
+    }
+}
+
+static void APIENTRY NullGetProgramiv( GLuint program, GLenum name, GLint* value )
+{
+    CountCall();
+    const NullShaderObject* object = GetShaderObject(program);
+    switch(name)
+    {
+        case GL_LINK_STATUS:
+            *value = object->linked;
+            break;
+
+        case GL_VALIDATE_STATUS:
+            *value = GL_TRUE;
+            break;
+
+        case GL_PROGRAM_BINARY_LENGTH:
+            *value = GetProgramBinarySize(object);
+            break;
+
+        case GL_ACTIVE_UNIFORMS:
+            *value = object->uniforms.length;
+            break;
+
+        case GL_ACTIVE_UNIFORM_BLOCKS:
+            *value = object->uniformBlocks.length;
+            break;
+
+        default:
+            *value = 0;
+    }
+}
+
+static void APIENTRY NullGetInfoLog( GLuint object,
+                                     GLsizei bufferSize,
+                                     GLsizei* length,
+                                     GLchar* log )
+{
+    CountCall();
+    if(length)
+        *length = 0;
+    if(bufferSize > 0)
+        log[0] = '\0';
+}
+
+static void APIENTRY NullBindAttribLocation( GLuint program,
+                                             GLuint index,
+                                             const GLchar* name )
+{
+    CountCall();
+}
+
+static void APIENTRY NullGetActiveUniform( GLuint program,
+                                           GLuint index,
+                                           GLsizei bufferSize,
+                                           GLsizei* length,
+                                           GLint* size,
+                                           GLenum* type,
+                                           GLchar* name )
+{
+    CountCall();
+    NullShaderObject* object = GetShaderObject(program);
+    Ensure((int)index < object->uniforms.length);
+    const NullUniform* uniform = &object->uniforms.data[index];
+
+    // Arrays are reported like `name[0]`:
+    strncpy(name, uniform->name, bufferSize);
+    name[bufferSize-1] = '\0';
+    if(uniform->size > 1)
+        strncat(name, "[0]", bufferSize - strlen(name) - 1);
+    if(length)
+        *length = strlen(name);
+    *size = uniform->size;
+    *type = uniform->type;
+}
+
+static GLint APIENTRY NullGetAttribLocation( GLuint program, const GLchar* name )
+{
+    CountCall();
+    const NullShaderObject* object = GetShaderObject(program);
+    REPEAT(object->attributes.length, i)
+        if(strcmp(object->attributes.data[i].name, name) == 0)
+            return i;
+    return -1;
+}
+
+static GLint APIENTRY NullGetUniformLocation( GLuint program, const GLchar* name )
+{
+    CountCall();
+
+    char baseName[MAX_NULL_GL_NAME_SIZE];
+    strncpy(baseName, name, MAX_NULL_GL_NAME_SIZE-1);
+    baseName[MAX_NULL_GL_NAME_SIZE-1] = '\0';
+
+    int arrayIndex = 0;
+    char* bracket = strchr(baseName, '[');
+    if(bracket)
+    {
+        arrayIndex = atoi(bracket+1);
+        *bracket = '\0';
+    }
+
+    const NullUniform* uniform = FindUniform(GetShaderObject(program), baseName);
+    if(!uniform || uniform->block != -1 || arrayIndex >= uniform->size)
+        return -1;
+    return uniform->location + arrayIndex;
+}
+
+static GLuint APIENTRY NullGetUniformBlockIndex( GLuint program, const GLchar* name )
+{
+    CountCall();
+    const int index = FindUniformBlock(GetShaderObject(program), name);
+    if(index == -1)
+        return GL_INVALID_INDEX;
+    return index;
+}
+
+static void APIENTRY NullGetActiveUniformBlockName( GLuint program,
+                                                    GLuint index,
+                                                    GLsizei bufferSize,
+                                                    GLsizei* length,
+                                                    GLchar* name )
+{
+    CountCall();
+    const NullShaderObject* object = GetShaderObject(program);
+    Ensure((int)index < object->uniformBlocks.length);
+    strncpy(name, object->uniformBlocks.data[index].name, bufferSize);
+    name[bufferSize-1] = '\0';
+    if(length)
+        *length = strlen(name);
+}
+
+static void APIENTRY NullGetActiveUniformBlockiv( GLuint program,
+                                                  GLuint index,
+                                                  GLenum name,
+                                                  GLint* value )
+{
+    CountCall();
+    const NullShaderObject* object = GetShaderObject(program);
+    Ensure((int)index < object->uniformBlocks.length);
+    switch(name)
+    {
+        case GL_UNIFORM_BLOCK_DATA_SIZE:
+            *value = object->uniformBlocks.data[index].dataSize;
+            break;
+
+        case GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS:
+            *value = 0;
+            REPEAT(object->uniforms.length, i)
+                if(object->uniforms.data[i].block == (int)index)
+                    (*value)++;
+            break;
+
+        case GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES:
+            REPEAT(object->uniforms.length, i)
+            {
+                if(object->uniforms.data[i].block == (int)index)
+                {
+                    *value = i;
+                    value++;
+                }
+            }
+            break;
+
+        default:
+            *value = 0;
+    }
+}
+
+static void APIENTRY NullGetActiveUniformsiv( GLuint program,
+                                              GLsizei count,
+                                              const GLuint* indices,
+                                              GLenum name,
+                                              GLint* values )
+{
+    CountCall();
+    const NullShaderObject* object = GetShaderObject(program);
+    REPEAT(count, i)
+    {
+        Ensure((int)indices[i] < object->uniforms.length);
+        const NullUniform* uniform = &object->uniforms.data[indices[i]];
+        const bool isMember = uniform->block != -1;
+        switch(name)
+        {
+            case GL_UNIFORM_TYPE:          values[i] = uniform->type; break;
+            case GL_UNIFORM_SIZE:          values[i] = uniform->size; break;
+            case GL_UNIFORM_BLOCK_INDEX:   values[i] = uniform->block; break;
+            case GL_UNIFORM_OFFSET:        values[i] = isMember ? uniform->offset : -1; break;
+            case GL_UNIFORM_ARRAY_STRIDE:  values[i] = isMember ? uniform->arrayStride : -1; break;
+            case GL_UNIFORM_MATRIX_STRIDE: values[i] = isMember ? uniform->matrixStride : -1; break;
+            default:                       values[i] = 0;
+        }
+    }
+}
+
+static void APIENTRY NullUniformBlockBinding( GLuint program,
+                                              GLuint index,
+                                              GLuint binding )
+{
+    CountCall();
+}
+
+static void APIENTRY NullUseProgram( GLuint program )
+{
+    CountStateChange();
+}
+
+static void APIENTRY NullUniform1i( GLint location, GLint value )
+{
+    CountUniformUpload();
+}
+
+static void APIENTRY NullUniform1f( GLint location, GLfloat value )
+{
+    CountUniformUpload();
+}
+
+static void APIENTRY NullUniformiv( GLint location, GLsizei count, const GLint* values )
+{
+    CountUniformUpload();
+}
+
+static void APIENTRY NullUniformfv( GLint location, GLsizei count, const GLfloat* values )
+{
+    CountUniformUpload();
+}
+
+static void APIENTRY NullUniformMatrixfv( GLint location,
+                                          GLsizei count,
+                                          GLboolean transpose,
+                                          const GLfloat* values )
+{
+    CountUniformUpload();
+}
+
+// Drawing:
+
+static void APIENTRY NullDrawArrays( GLenum mode, GLint first, GLsizei count )
+{
+    CountDrawCall();
+}
+
+static void APIENTRY NullDrawElements( GLenum mode,
+                                       GLsizei count,
+                                       GLenum type,
+                                       const void* indices )
+{
+    CountDrawCall();
+}
+
+static void APIENTRY NullDrawArraysInstanced( GLenum mode,
+                                              GLint first,
+                                              GLsizei count,
+                                              GLsizei instanceCount )
+{
+    CountDrawCall();
+}
+
+static void APIENTRY NullDrawElementsInstanced( GLenum mode,
+                                                GLsizei count,
+                                                GLenum type,
+                                                const void* indices,
+                                                GLsizei instanceCount )
+{
+    CountDrawCall();
+}
+
+static void APIENTRY NullDrawElementsBaseVertex( GLenum mode,
+                                                 GLsizei count,
+                                                 GLenum type,
+                                                 const void* indices,
+                                                 GLint baseVertex )
+{
+    CountDrawCall();
+}
+
+static void APIENTRY NullDrawElementsInstancedBaseVertex( GLenum mode,
+                                                          GLsizei count,
+                                                          GLenum type,
+                                                          const void* indices,
+                                                          GLsizei instanceCount,
+                                                          GLint baseVertex )
+{
+    CountDrawCall();
+}
+
+static void APIENTRY NullMultiDrawElementsIndirect( GLenum mode,
+                                                    GLenum type,
+                                                    const void* commands,
+                                                    GLsizei drawCount,
+                                                    GLsizei stride )
+{
+    CountDrawCall();
+}
+
+// Synchronization:
+
+static GLsync APIENTRY NullFenceSync( GLenum condition, GLbitfield flags )
+{
+    CountCall();
+    return (GLsync)1; // Only needs to be distinguishable from NULL.
+}
+
+static GLenum APIENTRY NullClientWaitSync( GLsync sync, GLbitfield flags, GLuint64 timeout )
+{
+    CountCall();
+    return GL_ALREADY_SIGNALED; // Nothing is ever pending.
+}
+
+static void APIENTRY NullDeleteSync( GLsync sync )
+{
+    CountCall();
+}
+
+// Queries (used by the GPU profiler):
+
+static void APIENTRY NullQueryCounter( GLuint query, GLenum target )
+{
+    CountCall();
+}
+
+static void APIENTRY NullGetQueryObjectiv( GLuint query, GLenum name, GLint* value )
+{
+    CountCall();
+    *value = GL_TRUE; // Results are available immediately.
+}
+
+static void APIENTRY NullGetQueryObjectui64v( GLuint query, GLenum name, GLuint64* value )
+{
+    CountCall();
+    *value = 0;
+}
+
+
+// --- Loader ---
+
+struct NullFunction
+{
+    const char* name;
+    void* function;
+};
+
+#define NULL_FUNCTION( name, function ) { name, (void*)function }
+
+static const NullFunction NullFunctions[] =
+{
+    NULL_FUNCTION("glGetString",    NullGetString),
+    NULL_FUNCTION("glGetStringi",   NullGetStringi),
+    NULL_FUNCTION("glGetIntegerv",  NullGetIntegerv),
+    NULL_FUNCTION("glGetInteger64v",NullGetInteger64v),
+    NULL_FUNCTION("glGetFloatv",    NullGetFloatv),
+    NULL_FUNCTION("glGetError",     NullGetError),
+    NULL_FUNCTION("glFlush",        NullFlush),
+    NULL_FUNCTION("glFinish",       NullFlush),
+    NULL_FUNCTION("glClear",        NullClear),
+    NULL_FUNCTION("glClearColor",   NullClearColor),
+
+    NULL_FUNCTION("glEnable",                NullEnable),
+    NULL_FUNCTION("glDisable",               NullDisable),
+    NULL_FUNCTION("glDepthFunc",             NullDepthFunc),
+    NULL_FUNCTION("glDepthMask",             NullDepthMask),
+    NULL_FUNCTION("glCullFace",              NullCullFace),
+    NULL_FUNCTION("glBlendEquationSeparate", NullBlendEquationSeparate),
+    NULL_FUNCTION("glBlendFuncSeparate",     NullBlendFuncSeparate),
+    NULL_FUNCTION("glPolygonOffset",         NullPolygonOffset),
+    NULL_FUNCTION("glViewport",              NullViewport),
+
+    NULL_FUNCTION("glGenBuffers",              NullGenObjects),
+    NULL_FUNCTION("glDeleteBuffers",           NullDeleteObjects),
+    NULL_FUNCTION("glBindBuffer",              NullBindBuffer),
+    NULL_FUNCTION("glBindBufferBase",          NullBindBufferBase),
+    NULL_FUNCTION("glBufferData",              NullBufferData),
+    NULL_FUNCTION("glBufferSubData",           NullBufferSubData),
+    NULL_FUNCTION("glMapBufferRange",          NullMapBufferRange),
+    NULL_FUNCTION("glUnmapBuffer",             NullUnmapBuffer),
+    NULL_FUNCTION("glGenVertexArrays",         NullGenObjects),
+    NULL_FUNCTION("glDeleteVertexArrays",      NullDeleteObjects),
+    NULL_FUNCTION("glBindVertexArray",         NullBindVertexArray),
+    NULL_FUNCTION("glGenFramebuffers",         NullGenObjects),
+    NULL_FUNCTION("glDeleteFramebuffers",      NullDeleteObjects),
+    NULL_FUNCTION("glBindFramebuffer",         NullBindFramebuffer),
+    NULL_FUNCTION("glEnableVertexAttribArray", NullEnableVertexAttribArray),
+    NULL_FUNCTION("glVertexAttribPointer",     NullVertexAttribPointer),
+    NULL_FUNCTION("glVertexAttribIPointer",    NullVertexAttribIPointer),
+    NULL_FUNCTION("glVertexAttribDivisorARB",  NullVertexAttribDivisor),
+
+    NULL_FUNCTION("glGenTextures",    NullGenObjects),
+    NULL_FUNCTION("glDeleteTextures", NullDeleteObjects),
+    NULL_FUNCTION("glActiveTexture",  NullActiveTexture),
+    NULL_FUNCTION("glBindTexture",    NullBindTexture),
+    NULL_FUNCTION("glTexParameteri",  NullTexParameteri),
+    NULL_FUNCTION("glTexParameterf",  NullTexParameterf),
+    NULL_FUNCTION("glTexImage2D",     NullTexImage2D),
+    NULL_FUNCTION("glTexSubImage2D",  NullTexSubImage2D),
+    NULL_FUNCTION("glTexImage3D",     NullTexImage3D),
+    NULL_FUNCTION("glTexSubImage3D",  NullTexSubImage3D),
+    NULL_FUNCTION("glGenerateMipmap", NullGenerateMipmap),
+
+    NULL_FUNCTION("glCreateShader",               NullCreateShader),
+    NULL_FUNCTION("glDeleteShader",               NullDeleteShaderObject),
+    NULL_FUNCTION("glShaderSource",               NullShaderSource),
+    NULL_FUNCTION("glCompileShader",              NullCompileShader),
+    NULL_FUNCTION("glGetShaderiv",                NullGetShaderiv),
+    NULL_FUNCTION("glGetShaderInfoLog",           NullGetInfoLog),
+    NULL_FUNCTION("glCreateProgram",              NullCreateProgram),
+    NULL_FUNCTION("glDeleteProgram",              NullDeleteShaderObject),
+    NULL_FUNCTION("glAttachShader",               NullAttachShader),
+    NULL_FUNCTION("glLinkProgram",                NullLinkProgram),
+    NULL_FUNCTION("glValidateProgram",            NullValidateProgram),
+    NULL_FUNCTION("glProgramParameteri",          NullProgramParameteri),
+    NULL_FUNCTION("glGetProgramBinary",           NullGetProgramBinary),
+    NULL_FUNCTION("glProgramBinary",              NullProgramBinary),
+    NULL_FUNCTION("glGetProgramiv",               NullGetProgramiv),
+    NULL_FUNCTION("glGetProgramInfoLog",          NullGetInfoLog),
+    NULL_FUNCTION("glBindAttribLocation",         NullBindAttribLocation),
+    NULL_FUNCTION("glGetAttribLocation",          NullGetAttribLocation),
+    NULL_FUNCTION("glGetActiveUniform",           NullGetActiveUniform),
+    NULL_FUNCTION("glGetUniformLocation",         NullGetUniformLocation),
+    NULL_FUNCTION("glGetUniformBlockIndex",       NullGetUniformBlockIndex),
+    NULL_FUNCTION("glGetActiveUniformBlockName",  NullGetActiveUniformBlockName),
+    NULL_FUNCTION("glGetActiveUniformBlockiv",    NullGetActiveUniformBlockiv),
+    NULL_FUNCTION("glGetActiveUniformsiv",        NullGetActiveUniformsiv),
+    NULL_FUNCTION("glUniformBlockBinding",        NullUniformBlockBinding),
+    NULL_FUNCTION("glUseProgram",                 NullUseProgram),
+    NULL_FUNCTION("glUniform1i",                  NullUniform1i),
+    NULL_FUNCTION("glUniform1f",                  NullUniform1f),
+    NULL_FUNCTION("glUniform1iv",                 NullUniformiv),
+    NULL_FUNCTION("glUniform1fv",                 NullUniformfv),
+    NULL_FUNCTION("glUniform2fv",                 NullUniformfv),
+    NULL_FUNCTION("glUniform3fv",                 NullUniformfv),
+    NULL_FUNCTION("glUniform4fv",                 NullUniformfv),
+    NULL_FUNCTION("glUniformMatrix3fv",           NullUniformMatrixfv),
+    NULL_FUNCTION("glUniformMatrix4fv",           NullUniformMatrixfv),
+
+    NULL_FUNCTION("glDrawArrays",            NullDrawArrays),
+    NULL_FUNCTION("glDrawElements",          NullDrawElements),
+    NULL_FUNCTION("glDrawArraysInstanced",   NullDrawArraysInstanced),
+    NULL_FUNCTION("glDrawElementsInstanced", NullDrawElementsInstanced),
+    NULL_FUNCTION("glDrawElementsBaseVertex", NullDrawElementsBaseVertex),
+    NULL_FUNCTION("glDrawElementsInstancedBaseVertex", NullDrawElementsInstancedBaseVertex),
+    NULL_FUNCTION("glMultiDrawElementsIndirect", NullMultiDrawElementsIndirect),
+
+    NULL_FUNCTION("glFenceSync",       NullFenceSync),
+    NULL_FUNCTION("glClientWaitSync",  NullClientWaitSync),
+    NULL_FUNCTION("glDeleteSync",      NullDeleteSync),
+
+    NULL_FUNCTION("glGenQueries",            NullGenObjects),
+    NULL_FUNCTION("glDeleteQueries",         NullDeleteObjects),
+    NULL_FUNCTION("glQueryCounter",          NullQueryCounter),
+    NULL_FUNCTION("glGetQueryObjectiv",      NullGetQueryObjectiv),
+    NULL_FUNCTION("glGetQueryObjectui64v",   NullGetQueryObjectui64v)
+};
+
+#undef NULL_FUNCTION
+
+static void* GetNullFunction( const char* name )
+{
+    REPEAT(sizeof(NullFunctions)/sizeof(NullFunction), i)
+        if(strcmp(NullFunctions[i].name, name) == 0)
+            return NullFunctions[i].function;
+    return NULL;
+}
+
+void InitNullOpenGL()
+{
+    assert(InSerialPhase());
+    memset(&NullOpenGL, 0, sizeof(NullOpenGL));
+    InitArray(&NullOpenGL.shaderObjects);
+    InitArray(&NullOpenGL.mappedBuffer);
+    NullDriverInstance++;
+
+    if(!gladLoadGLLoader((GLADloadproc)GetNullFunction))
+        FatalError("Failed to load the null OpenGL backend.");
+    ResetOpenGLState(); // The new context has its default state.
+
+    LogInfo("Using null OpenGL backend - nothing will be rendered.");
+}
+
+void DestroyNullOpenGL()
+{
+    assert(InSerialPhase());
+    REPEAT(NullOpenGL.shaderObjects.length, i)
+    {
+        NullShaderObject* object = &NullOpenGL.shaderObjects.data[i];
+        if(object->inUse)
+            FreeShaderObject(object);
+    }
+    DestroyArray(&NullOpenGL.shaderObjects);
+    DestroyArray(&NullOpenGL.mappedBuffer);
+}
+
+const NullOpenGLStatistics* GetNullOpenGLStatistics()
+{
+    return &NullOpenGL.statistics;
+}
+
+void ResetNullOpenGLStatistics()
+{
+    memset(&NullOpenGL.statistics, 0, sizeof(NullOpenGLStatistics));
+}
@@ -0,0 +1,49 @@
+#ifndef __KONSTRUKT_NULL_OPENGL__
+#define __KONSTRUKT_NULL_OPENGL__
+
+/**
+ * @file
+ * OpenGL backend which doesn't render anything.
+ *
+ * It replaces the function pointers, which are used by the engine to call
+ * OpenGL, with stubs that just count the calls.  This way the rendering code
+ * can run and be benchmarked on machines without a GPU.
+ *
+ * Shader sources are scanned for vertex attribute, uniform and uniform block
+ * declarations, so program introspection works like with a real driver.  (Except that unused
+ * uniforms aren't optimized away and that block members of struct type
+ * aren't reported.)  Blocks are always laid out using the std140 rules.
+ *
+ * Only the functions which are used by the engine are available.  Calling
+ * other functions will crash.  The extensions which provide indirect multi
+ * draw calls and program binaries are reported as available.  Program
+ * binaries are only accepted by the backend instance which created them,
+ * so reinitializing the backend behaves like a driver update.
+ */
+
+
+struct NullOpenGLStatistics
+{
+    int calls;
+    int drawCalls;
+    int clears;
+    int stateChanges; // Binding objects, enabling/disabling capabilities, etc.
+    int uniformUploads;
+    int bufferUploads;
+    int textureUploads;
+    int textureUploadBytes; // Pixel data, which has been passed to glTexSubImage2D
+    int shaderCompilations;
+};
+
+
+/**
+ * Loads the null backend instead of a real OpenGL implementation.
+ * May be called without a window or OpenGL context.
+ */
+void InitNullOpenGL();
+void DestroyNullOpenGL();
+
+const NullOpenGLStatistics* GetNullOpenGLStatistics();
+void ResetNullOpenGLStatistics();
+
+#endif
@@ -0,0 +1,423 @@
+#include <string.h> // memset
+
+#include "Common.h"
+#include "Profiler.h"
+#include "Texture.h" // MAX_TEXTURE_UNITS
+#include "OpenGLState.h"
+
+
+static const GLuint UNKNOWN = 0xFFFFFFFF;
+static const int UNKNOWN_UNIT = -1;
+
+enum CachedCapability
+{
+    CAP_BLEND,
+    CAP_CULL_FACE,
+    CAP_DEPTH_TEST,
+    CAP_POLYGON_OFFSET_FILL,
+    CAP_FRAMEBUFFER_SRGB,
+    CAP_TEXTURE_CUBE_MAP_SEAMLESS,
+    CAP_SCISSOR_TEST,
+    CACHED_CAPABILITY_COUNT
+};
+
+enum CachedBufferTarget
+{
+    BUF_ARRAY,
+    BUF_ELEMENT_ARRAY,
+    BUF_UNIFORM,
+    BUF_DRAW_INDIRECT,
+    BUF_PIXEL_UNPACK,
+    BUF_COPY_WRITE,
+    CACHED_BUFFER_TARGET_COUNT
+};
+
+enum CachedTextureTarget
+{
+    TEX_2D,
+    TEX_CUBE_MAP,
+    TEX_2D_ARRAY,
+    CACHED_TEXTURE_TARGET_COUNT
+};
+
+/**
+ * OpenGL 3.2 guarantees at least 36 uniform buffer binding points.
+ */
+static const int CACHED_UNIFORM_BINDING_COUNT = 36;
+
+static const GLenum TextureTargets[CACHED_TEXTURE_TARGET_COUNT] =
+{
+    GL_TEXTURE_2D,
+    GL_TEXTURE_CUBE_MAP,
+    GL_TEXTURE_2D_ARRAY
+};
+
+/**
+ * Everything is `UNKNOWN` after #ResetOpenGLState.
+ */
+struct OpenGLState
+{
+    GLuint capabilities[CACHED_CAPABILITY_COUNT]; // GL_TRUE, GL_FALSE or UNKNOWN
+    GLuint depthMask;
+    GLenum depthFunc;
+    GLenum cullFace;
+    GLenum blendEquation[2];
+    GLenum blendFunc[4];
+    bool polygonOffsetKnown;
+    float polygonOffset[2];
+    bool viewportKnown;
+    int viewport[4];
+
+    GLuint framebuffer;
+    GLuint vertexArray;
+    GLuint buffers[CACHED_BUFFER_TARGET_COUNT];
+    GLuint uniformBindings[CACHED_UNIFORM_BINDING_COUNT];
+    GLuint program;
+    int activeTextureUnit;
+    GLuint textures[MAX_TEXTURE_UNITS][CACHED_TEXTURE_TARGET_COUNT];
+
+    /**
+     * Buffers of the bound framebuffer, which haven't been drawn to since
+     * they were cleared.
+     */
+    GLbitfield clearedBuffers;
+};
+
+DefineCounter(IssuedChangesCounter, "issued gl state changes");
+DefineCounter(FilteredChangesCounter, "filtered gl state changes");
+static OpenGLState State;
+static OpenGLStateStatistics Statistics;
+
+
+void InitOpenGLState()
+{
+    InitCounter(IssuedChangesCounter);
+    InitCounter(FilteredChangesCounter);
+    ResetOpenGLState();
+}
+
+void ResetOpenGLState()
+{
+    // All bytes set to 0xFF make the handles UNKNOWN:
+    memset(&State, 0xFF, sizeof(State));
+    State.polygonOffsetKnown = false;
+    State.viewportKnown = false;
+    State.activeTextureUnit = UNKNOWN_UNIT;
+    State.clearedBuffers = 0;
+}
+
+void UpdateOpenGLStateCounters()
+{
+    SetCounter(IssuedChangesCounter, Statistics.issuedChanges);
+    SetCounter(FilteredChangesCounter, Statistics.filteredChanges);
+    ResetOpenGLStateStatistics();
+}
+
+const OpenGLStateStatistics* GetOpenGLStateStatistics()
+{
+    return &Statistics;
+}
+
+void ResetOpenGLStateStatistics()
+{
+    memset(&Statistics, 0, sizeof(Statistics));
+}
+
+/**
+ * Updates the cached value and the statistics.
+ * Returns whether the change needs to be issued.
+ */
+static bool ChangeState( GLuint* current, GLuint value )
+{
+    if(*current == value)
+    {
+        Statistics.filteredChanges++;
+        return false;
+    }
+    else
+    {
+        *current = value;
+        Statistics.issuedChanges++;
+        return true;
+    }
+}
+
+static bool ChangeStates( GLuint* current, const GLuint* values, int count )
+{
+    if(memcmp(current, values, sizeof(GLuint)*count) == 0)
+    {
+        Statistics.filteredChanges++;
+        return false;
+    }
+    else
+    {
+        memcpy(current, values, sizeof(GLuint)*count);
+        Statistics.issuedChanges++;
+        return true;
+    }
+}
+
+
+// --- Fixed function state ---
+
+static int GetCachedCapability( GLenum capability )
+{
+    switch(capability)
+    {
+        case GL_BLEND:                      return CAP_BLEND;
+        case GL_CULL_FACE:                  return CAP_CULL_FACE;
+        case GL_DEPTH_TEST:                 return CAP_DEPTH_TEST;
+        case GL_POLYGON_OFFSET_FILL:        return CAP_POLYGON_OFFSET_FILL;
+        case GL_FRAMEBUFFER_SRGB:           return CAP_FRAMEBUFFER_SRGB;
+        case GL_TEXTURE_CUBE_MAP_SEAMLESS:  return CAP_TEXTURE_CUBE_MAP_SEAMLESS;
+        case GL_SCISSOR_TEST:               return CAP_SCISSOR_TEST;
+        default:                            return -1;
+    }
+}
+
+void SetCapability( GLenum capability, bool enabled )
+{
+    const int index = GetCachedCapability(capability);
+    if(index == -1)
+        Statistics.issuedChanges++;
+    else if(!ChangeState(&State.capabilities[index], enabled ? GL_TRUE : GL_FALSE))
+        return;
+
+    if(enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+}
+
+void SetDepthMask( bool enabled )
+{
+    if(ChangeState(&State.depthMask, enabled ? GL_TRUE : GL_FALSE))
+        glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+}
+
+void SetDepthFunc( GLenum func )
+{
+    if(ChangeState(&State.depthFunc, func))
+        glDepthFunc(func);
+}
+
+void SetCullFace( GLenum face )
+{
+    if(ChangeState(&State.cullFace, face))
+        glCullFace(face);
+}
+
+void SetBlendEquation( GLenum rgb, GLenum alpha )
+{
+    const GLenum values[2] = {rgb, alpha};
+    if(ChangeStates(State.blendEquation, values, 2))
+        glBlendEquationSeparate(rgb, alpha);
+}
+
+void SetBlendFunc( GLenum srcRgb, GLenum dstRgb, GLenum srcAlpha, GLenum dstAlpha )
+{
+    const GLenum values[4] = {srcRgb, dstRgb, srcAlpha, dstAlpha};
+    if(ChangeStates(State.blendFunc, values, 4))
+        glBlendFuncSeparate(srcRgb, dstRgb, srcAlpha, dstAlpha);
+}
+
+void SetPolygonOffset( float factor, float units )
+{
+    if(State.polygonOffsetKnown &&
+       State.polygonOffset[0] == factor &&
+       State.polygonOffset[1] == units)
+    {
+        Statistics.filteredChanges++;
+        return;
+    }
+    State.polygonOffsetKnown = true;
+    State.polygonOffset[0] = factor;
+    State.polygonOffset[1] = units;
+    Statistics.issuedChanges++;
+    glPolygonOffset(factor, units);
+}
+
+void SetViewport( int x, int y, int width, int height )
+{
+    const int viewport[4] = {x, y, width, height};
+    if(State.viewportKnown &&
+       memcmp(State.viewport, viewport, sizeof(viewport)) == 0)
+    {
+        Statistics.filteredChanges++;
+        return;
+    }
+    State.viewportKnown = true;
+    memcpy(State.viewport, viewport, sizeof(viewport));
+    Statistics.issuedChanges++;
+    glViewport(x, y, width, height);
+}
+
+
+// --- Object bindings ---
+
+void BindFramebuffer( GLuint framebuffer )
+{
+    if(ChangeState(&State.framebuffer, framebuffer))
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        State.clearedBuffers = 0;
+        State.viewportKnown = false; // Usually changes with the framebuffer.
+    }
+}
+
+void BindVertexArray( GLuint vertexArray )
+{
+    if(ChangeState(&State.vertexArray, vertexArray))
+    {
+        glBindVertexArray(vertexArray);
+        State.buffers[BUF_ELEMENT_ARRAY] = UNKNOWN;
+    }
+}
+
+static int GetCachedBufferTarget( GLenum target )
+{
+    switch(target)
+    {
+        case GL_ARRAY_BUFFER:           return BUF_ARRAY;
+        case GL_ELEMENT_ARRAY_BUFFER:   return BUF_ELEMENT_ARRAY;
+        case GL_UNIFORM_BUFFER:         return BUF_UNIFORM;
+        case GL_DRAW_INDIRECT_BUFFER:   return BUF_DRAW_INDIRECT;
+        case GL_PIXEL_UNPACK_BUFFER:    return BUF_PIXEL_UNPACK;
+        case GL_COPY_WRITE_BUFFER:      return BUF_COPY_WRITE;
+        default:                        return -1;
+    }
+}
+
+void BindBuffer( GLenum target, GLuint buffer )
+{
+    const int index = GetCachedBufferTarget(target);
+    if(index == -1)
+        Statistics.issuedChanges++;
+    else if(!ChangeState(&State.buffers[index], buffer))
+        return;
+    glBindBuffer(target, buffer);
+}
+
+void BindBufferBase( GLenum target, GLuint index, GLuint buffer )
+{
+    const int targetIndex = GetCachedBufferTarget(target);
+    if(target == GL_UNIFORM_BUFFER && index < (GLuint)CACHED_UNIFORM_BINDING_COUNT)
+    {
+        if(!ChangeState(&State.uniformBindings[index], buffer))
+            return;
+    }
+    else
+    {
+        Statistics.issuedChanges++;
+    }
+    glBindBufferBase(target, index, buffer);
+    if(targetIndex != -1)
+        State.buffers[targetIndex] = buffer;
+}
+
+void UseProgram( GLuint program )
+{
+    if(ChangeState(&State.program, program))
+        glUseProgram(program);
+}
+
+static int GetCachedTextureTarget( GLenum target )
+{
+    REPEAT(CACHED_TEXTURE_TARGET_COUNT, i)
+        if(TextureTargets[i] == target)
+            return i;
+    return -1;
+}
+
+void SetActiveTextureUnit( int unit )
+{
+    if(unit == State.activeTextureUnit)
+    {
+        Statistics.filteredChanges++;
+        return;
+    }
+    State.activeTextureUnit = (unit < MAX_TEXTURE_UNITS) ? unit : UNKNOWN_UNIT;
+    Statistics.issuedChanges++;
+    glActiveTexture(GL_TEXTURE0+unit);
+}
+
+void BindTextureObject( GLenum target, GLuint texture )
+{
+    const int unit = State.activeTextureUnit;
+    const int index = GetCachedTextureTarget(target);
+    if(unit == UNKNOWN_UNIT || index == -1)
+        Statistics.issuedChanges++;
+    else if(!ChangeState(&State.textures[unit][index], texture))
+        return;
+    glBindTexture(target, texture);
+}
+
+void BindTextureToUnit( int unit, GLenum target, GLuint texture )
+{
+    SetActiveTextureUnit(unit);
+    if(unit < MAX_TEXTURE_UNITS)
+    {
+        REPEAT(CACHED_TEXTURE_TARGET_COUNT, i)
+        {
+            const GLenum otherTarget = TextureTargets[i];
+            // Unknown bindings are unbound too:
+            if(otherTarget != target && State.textures[unit][i] != 0)
+                BindTextureObject(otherTarget, 0);
+        }
+    }
+    BindTextureObject(target, texture);
+}
+
+
+// --- Deleted objects ---
+
+void ForgetBuffer( GLuint buffer )
+{
+    REPEAT(CACHED_BUFFER_TARGET_COUNT, i)
+        if(State.buffers[i] == buffer)
+            State.buffers[i] = 0;
+    REPEAT(CACHED_UNIFORM_BINDING_COUNT, i)
+        if(State.uniformBindings[i] == buffer)
+            State.uniformBindings[i] = 0;
+}
+
+void ForgetTexture( GLuint texture )
+{
+    REPEAT(MAX_TEXTURE_UNITS, unit)
+        REPEAT(CACHED_TEXTURE_TARGET_COUNT, i)
+            if(State.textures[unit][i] == texture)
+                State.textures[unit][i] = 0;
+}
+
+void ForgetProgram( GLuint program )
+{
+    if(State.program == program)
+        State.program = UNKNOWN;
+}
+
+
+// --- Clearing ---
+
+void ClearFramebuffer( GLbitfield mask )
+{
+    const GLbitfield buffers = mask & ~State.clearedBuffers;
+    if(!buffers)
+    {
+        Statistics.filteredClears++;
+        return;
+    }
+
+    if(buffers & GL_DEPTH_BUFFER_BIT)
+        SetDepthMask(true);
+    glClear(buffers);
+    Statistics.issuedClears++;
+
+    // Scissored clears only affect a part of the buffers:
+    if(State.capabilities[CAP_SCISSOR_TEST] == GL_FALSE)
+        State.clearedBuffers |= buffers;
+}
+
+void MarkFramebufferAsDrawn()
+{
+    State.clearedBuffers = 0;
+}
@@ -0,0 +1,131 @@
+#ifndef __KONSTRUKT_OPENGL_STATE__
+#define __KONSTRUKT_OPENGL_STATE__
+
+#include "OpenGL.h"
+
+/**
+ * @file
+ * Shadow copy of the OpenGL context state.
+ *
+ * All state changes of the renderer go through these functions, which only
+ * call OpenGL if the requested state differs from the current one.  The
+ * cache starts out empty (i.e. everything is unknown) whenever a context is
+ * loaded, so the first change of each state is always issued.
+ *
+ * State which isn't tracked by the cache (like capabilities not listed in
+ * the implementation) is passed through unfiltered.  Code which calls OpenGL
+ * directly must restore the state afterwards or call #ResetOpenGLState.
+ */
+
+
+struct OpenGLStateStatistics
+{
+    int issuedChanges;
+    int filteredChanges;
+    int issuedClears;
+    int filteredClears; // Buffers which were still cleared.
+};
+
+
+/**
+ * Initializes the profiler counters and resets the cache.
+ * Must be called after an OpenGL backend has been loaded.
+ */
+void InitOpenGLState();
+
+/**
+ * Forgets everything about the current state.
+ * Needed after the context was changed behind the caches back.
+ */
+void ResetOpenGLState();
+
+/**
+ * Publishes the number of issued and filtered state changes since the last
+ * call to the profiler.  Called once per frame.
+ */
+void UpdateOpenGLStateCounters();
+
+const OpenGLStateStatistics* GetOpenGLStateStatistics();
+void ResetOpenGLStateStatistics();
+
+
+// --- Fixed function state ---
+
+void SetCapability( GLenum capability, bool enabled );
+void SetDepthMask( bool enabled );
+void SetDepthFunc( GLenum func );
+void SetCullFace( GLenum face );
+void SetBlendEquation( GLenum rgb, GLenum alpha );
+void SetBlendFunc( GLenum srcRgb, GLenum dstRgb, GLenum srcAlpha, GLenum dstAlpha );
+void SetPolygonOffset( float factor, float units );
+void SetViewport( int x, int y, int width, int height );
+
+
+// --- Object bindings ---
+
+void BindFramebuffer( GLuint framebuffer );
+
+/**
+ * The element array buffer is part of the vertex array state, so it's
+ * forgotten when another vertex array is bound.
+ */
+void BindVertexArray( GLuint vertexArray );
+
+void BindBuffer( GLenum target, GLuint buffer );
+
+/**
+ * Binds the buffer to an indexed binding point.
+ * Like `glBindBufferBase` this also changes the generic binding of the
+ * target.
+ */
+void BindBufferBase( GLenum target, GLuint index, GLuint buffer );
+
+void UseProgram( GLuint program );
+
+void SetActiveTextureUnit( int unit );
+
+/**
+ * Binds the texture to the active texture unit.
+ */
+void BindTextureObject( GLenum target, GLuint texture );
+
+/**
+ * Activates the unit and makes the texture its only binding:  Textures
+ * which are bound to other targets of the unit are unbound.
+ */
+void BindTextureToUnit( int unit, GLenum target, GLuint texture );
+
+
+// --- Deleted objects ---
+
+/**
+ * Deleted buffers and textures are unbound implicitly, so the cache needs
+ * to be told about them.  Must be called after `glDelete*`.
+ */
+void ForgetBuffer( GLuint buffer );
+void ForgetTexture( GLuint texture );
+
+/**
+ * Deleting the current program doesn't unbind it, but its name may be
+ * reused by the next program.
+ */
+void ForgetProgram( GLuint program );
+
+
+// --- Clearing ---
+
+/**
+ * Clears the buffers of the bound framebuffer, unless they haven't been
+ * drawn to since they were last cleared.
+ *
+ * Clearing the depth buffer enables depth writes.
+ */
+void ClearFramebuffer( GLbitfield mask );
+
+/**
+ * Must be called for each draw call, so that the next clear isn't
+ * filtered.
+ */
+void MarkFramebufferAsDrawn();
+
+#endif
@@ -613,23 +613,17 @@ static void HandleCollision( const CollisionPoint* a,
     if(!IsValidLuaEventListener(listener))
         return;
 
-    LuaBuffer* buffer = BeginLuaEvent(listener);
-
-    AddIntegerToLuaBuffer(buffer, a->solidId);
-    REPEAT(3, i)
-        AddNumberToLuaBuffer(buffer, a->point._[i]);
-    REPEAT(3, i)
-        AddNumberToLuaBuffer(buffer, a->normal._[i]);
-
-    AddIntegerToLuaBuffer(buffer, b->solidId);
-    REPEAT(3, i)
-        AddNumberToLuaBuffer(buffer, b->point._[i]);
-    REPEAT(3, i)
-        AddNumberToLuaBuffer(buffer, b->normal._[i]);
-
-    AddNumberToLuaBuffer(buffer, impulse);
-
-    CompleteLuaEvent(listener);
+    // The solids form the key, so resting contacts can be coalesced:
+    const double values[15] =
+    {
+        (double)a->solidId, (double)b->solidId,
+        a->point._[0],  a->point._[1],  a->point._[2],
+        a->normal._[0], a->normal._[1], a->normal._[2],
+        b->point._[0],  b->point._[1],  b->point._[2],
+        b->normal._[0], b->normal._[1], b->normal._[2],
+        impulse
+    };
+    QueueLuaEvent(listener, values, 15);
 }
 
 static inline bool PropagateCollision( const btManifoldPoint& point,
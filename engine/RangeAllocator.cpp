@@ -0,0 +1,119 @@
+#include "Common.h"
+#include "RangeAllocator.h"
+
+
+void InitRangeAllocator( RangeAllocator* allocator, int capacity )
+{
+    Ensure(capacity > 0);
+    allocator->capacity = capacity;
+    allocator->freeSize = capacity;
+    InitArray(&allocator->freeRanges);
+    const UnusedRange range = {0, capacity};
+    AppendToArray(&allocator->freeRanges, 1, &range);
+}
+
+void DestroyRangeAllocator( RangeAllocator* allocator )
+{
+    DestroyArray(&allocator->freeRanges);
+    allocator->capacity = 0;
+    allocator->freeSize = 0;
+}
+
+int AllocateRange( RangeAllocator* allocator, int size )
+{
+    Ensure(size > 0);
+    if(size > allocator->freeSize)
+        return INVALID_RANGE_OFFSET;
+
+    Array<UnusedRange>* freeRanges = &allocator->freeRanges;
+    int bestIndex = -1;
+    REPEAT(freeRanges->length, i)
+    {
+        const UnusedRange* range = &freeRanges->data[i];
+        if(range->size < size)
+            continue;
+        if(bestIndex == -1 || range->size < freeRanges->data[bestIndex].size)
+        {
+            bestIndex = i;
+            if(range->size == size)
+                break; // Can't get any better.
+        }
+    }
+
+    if(bestIndex == -1)
+        return INVALID_RANGE_OFFSET;
+
+    UnusedRange* range = &freeRanges->data[bestIndex];
+    const int offset = range->offset;
+    if(range->size == size)
+    {
+        RemoveFromArray(freeRanges, bestIndex, 1);
+    }
+    else
+    {
+        range->offset += size;
+        range->size   -= size;
+    }
+    allocator->freeSize -= size;
+    return offset;
+}
+
+void FreeRange( RangeAllocator* allocator, int offset, int size )
+{
+    Ensure(size > 0);
+    Ensure(offset >= 0 && offset+size <= allocator->capacity);
+
+    Array<UnusedRange>* freeRanges = &allocator->freeRanges;
+
+    // Find the first free range which lies behind the released one:
+    int next = 0;
+    while(next < freeRanges->length &&
+          freeRanges->data[next].offset < offset)
+        next++;
+
+    UnusedRange* previousRange = (next > 0) ? &freeRanges->data[next-1] : NULL;
+    UnusedRange* nextRange = (next < freeRanges->length) ? &freeRanges->data[next] : NULL;
+
+    if((previousRange && previousRange->offset + previousRange->size > offset) ||
+       (nextRange && offset + size > nextRange->offset))
+        FatalError("Range %d+%d overlaps a free range.", offset, size);
+
+    const bool mergeWithPrevious =
+        previousRange && previousRange->offset + previousRange->size == offset;
+    const bool mergeWithNext =
+        nextRange && offset + size == nextRange->offset;
+
+    if(mergeWithPrevious && mergeWithNext)
+    {
+        previousRange->size += size + nextRange->size;
+        RemoveFromArray(freeRanges, next, 1);
+    }
+    else if(mergeWithPrevious)
+    {
+        previousRange->size += size;
+    }
+    else if(mergeWithNext)
+    {
+        nextRange->offset = offset;
+        nextRange->size  += size;
+    }
+    else
+    {
+        const UnusedRange range = {offset, size};
+        InsertInArray(freeRanges, next, 1, &range);
+    }
+
+    allocator->freeSize += size;
+}
+
+int GetLargestFreeRange( const RangeAllocator* allocator )
+{
+    int largest = 0;
+    REPEAT(allocator->freeRanges.length, i)
+    {
+        const int size = allocator->freeRanges.data[i].size;
+        if(size > largest)
+            largest = size;
+    }
+    return largest;
+}
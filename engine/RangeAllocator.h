@@ -0,0 +1,59 @@
+#ifndef __KONSTRUKT_RANGE_ALLOCATOR__
+#define __KONSTRUKT_RANGE_ALLOCATOR__
+
+#include "Array.h"
+
+
+struct UnusedRange
+{
+    int offset;
+    int size;
+};
+
+/**
+ * Hands out ranges of a fixed size address space.
+ *
+ * It only does the bookkeeping, so it can manage memory which isn't directly
+ * accessible - like a GPU buffer.  Offsets and sizes are given in abstract
+ * units, which may be bytes, vertices or whatever the user needs.
+ *
+ * Free ranges are kept sorted by offset.  Released ranges are merged with
+ * their free neighbours, so fragmentation can only arise from ranges which
+ * are still in use.
+ */
+struct RangeAllocator
+{
+    int capacity;
+    int freeSize; // Sum of all free ranges
+    Array<UnusedRange> freeRanges;
+};
+
+static const int INVALID_RANGE_OFFSET = -1;
+
+
+void InitRangeAllocator( RangeAllocator* allocator, int capacity );
+void DestroyRangeAllocator( RangeAllocator* allocator );
+
+/**
+ * Allocates a range of `size` units.
+ *
+ * Uses the smallest free range which is large enough (best fit).
+ *
+ * @return
+ * Offset of the allocated range or #INVALID_RANGE_OFFSET if there is no
+ * free range which is large enough.
+ */
+int AllocateRange( RangeAllocator* allocator, int size );
+
+/**
+ * Returns a range, which has been allocated using #AllocateRange, to the
+ * allocator.  `size` must be the size which was passed on allocation.
+ */
+void FreeRange( RangeAllocator* allocator, int offset, int size );
+
+/**
+ * Size of the largest range which could be allocated right now.
+ */
+int GetLargestFreeRange( const RangeAllocator* allocator );
+
+#endif
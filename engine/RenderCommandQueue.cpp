@@ -0,0 +1,274 @@
+#include <assert.h>
+#include <string.h> // memset
+#include <tinycthread.h>
+
+#include "Common.h"
+#include "Profiler.h"
+#include "Array.h"
+#include "FixedArray.h"
+#include "RenderCommandQueue.h"
+
+
+struct RenderCommand
+{
+    RenderCommandStatus status;
+    RenderCommandConfig config;
+
+    /**
+     * Issued in the serial phase by a thread, which waits for its
+     * completion.
+     */
+    bool serial;
+};
+
+static struct
+{
+    RenderCommandQueueConfig config;
+    mtx_t mutex;
+
+    cnd_t updateCondition; // notifies the render thread
+    cnd_t completionCondition; // notifies threads which wait for commands
+    bool isStopping; // render thread should stop after processing the queue
+    thrd_t thread;
+
+    FixedArray<RenderCommand> commands;
+    Array<RenderCommandId> queue; // queued commands, the oldest is at the end
+} RenderCommandQueue;
+
+
+DefineCounter(RenderCommandCounter, "render command count");
+
+
+static int RenderThreadFn( void* arg );
+
+void InitRenderCommandQueue( RenderCommandQueueConfig config )
+{
+    assert(InSerialPhase());
+
+    InitCounter(RenderCommandCounter);
+
+    memset(&RenderCommandQueue, 0, sizeof(RenderCommandQueue));
+
+    Ensure(mtx_init(&RenderCommandQueue.mutex, mtx_plain) == thrd_success);
+    Ensure(cnd_init(&RenderCommandQueue.updateCondition) == thrd_success);
+    Ensure(cnd_init(&RenderCommandQueue.completionCondition) == thrd_success);
+    RenderCommandQueue.isStopping = false;
+    InitFixedArray(&RenderCommandQueue.commands);
+    InitArray(&RenderCommandQueue.queue);
+
+    RenderCommandQueue.config = config;
+    if(config.useRenderThread)
+        Ensure(thrd_create(&RenderCommandQueue.thread, RenderThreadFn, NULL) == thrd_success);
+}
+
+void DestroyRenderCommandQueue()
+{
+    assert(InSerialPhase());
+
+    if(RenderCommandQueue.config.useRenderThread)
+    {
+        Ensure(mtx_lock(&RenderCommandQueue.mutex) == thrd_success);
+        RenderCommandQueue.isStopping = true;
+        cnd_signal(&RenderCommandQueue.updateCondition);
+        Ensure(mtx_unlock(&RenderCommandQueue.mutex) == thrd_success);
+
+        Ensure(thrd_join(RenderCommandQueue.thread, NULL) == thrd_success);
+    }
+
+    REPEAT(RenderCommandQueue.commands._.length, i)
+        if(RenderCommandQueue.commands._.data[i].inUse)
+            RemoveRenderCommand(i);
+
+    mtx_destroy(&RenderCommandQueue.mutex);
+    cnd_destroy(&RenderCommandQueue.updateCondition);
+    cnd_destroy(&RenderCommandQueue.completionCondition);
+    DestroyFixedArray(&RenderCommandQueue.commands);
+    DestroyArray(&RenderCommandQueue.queue);
+
+    memset(&RenderCommandQueue, 0, sizeof(RenderCommandQueue));
+}
+
+bool InRenderThread()
+{
+    return !RenderCommandQueue.config.useRenderThread ||
+           thrd_equal(thrd_current(), RenderCommandQueue.thread) != 0;
+}
+
+static RenderCommand* GetRenderCommand( RenderCommandId commandId )
+{
+    return GetFixedArrayElement(&RenderCommandQueue.commands, commandId);
+}
+
+static void ProcessRenderCommand( const RenderCommandConfig* config, bool serial )
+{
+    if(serial)
+        BeginSerialPhaseDelegation();
+    config->processor(config->data);
+    if(serial)
+        EndSerialPhaseDelegation();
+}
+
+static RenderCommandId AddRenderCommand( RenderCommandConfig config, bool serial )
+{
+    Ensure(mtx_lock(&RenderCommandQueue.mutex) == thrd_success);
+
+    FixedArrayAllocation<RenderCommand> allocation =
+        AllocateInFixedArray(&RenderCommandQueue.commands);
+    RenderCommand* command = allocation.element;
+    command->config = config;
+    command->serial = serial;
+    IncreaseCounter(RenderCommandCounter, 1);
+
+    const RenderCommandId id = (RenderCommandId)allocation.pos;
+
+    if(RenderCommandQueue.config.useRenderThread)
+    {
+        command->status = QUEUED_RENDER_COMMAND;
+        InsertInArray(&RenderCommandQueue.queue, 0, 1, &id);
+        cnd_signal(&RenderCommandQueue.updateCondition);
+        Ensure(mtx_unlock(&RenderCommandQueue.mutex) == thrd_success);
+    }
+    else
+    {
+        command->status = ACTIVE_RENDER_COMMAND;
+        Ensure(mtx_unlock(&RenderCommandQueue.mutex) == thrd_success);
+
+        // The command array may be reallocated while processing:
+        ProcessRenderCommand(&config, false);
+
+        Ensure(mtx_lock(&RenderCommandQueue.mutex) == thrd_success);
+        GetRenderCommand(id)->status = COMPLETED_RENDER_COMMAND;
+        Ensure(mtx_unlock(&RenderCommandQueue.mutex) == thrd_success);
+    }
+
+    return id;
+}
+
+RenderCommandId CreateRenderCommand( RenderCommandConfig config )
+{
+    return AddRenderCommand(config, false);
+}
+
+void RemoveRenderCommand( RenderCommandId commandId )
+{
+    Ensure(mtx_lock(&RenderCommandQueue.mutex) == thrd_success);
+    const RenderCommand* command = GetRenderCommand(commandId);
+    Ensure(command->status == COMPLETED_RENDER_COMMAND);
+    const RenderCommandConfig config = command->config;
+    RemoveFromFixedArray(&RenderCommandQueue.commands, commandId);
+    DecreaseCounter(RenderCommandCounter, 1);
+    Ensure(mtx_unlock(&RenderCommandQueue.mutex) == thrd_success);
+
+    if(config.destructor)
+        config.destructor(config.data);
+}
+
+RenderCommandStatus GetRenderCommandStatus( RenderCommandId commandId )
+{
+    Ensure(mtx_lock(&RenderCommandQueue.mutex) == thrd_success);
+    const RenderCommandStatus status = GetRenderCommand(commandId)->status;
+    Ensure(mtx_unlock(&RenderCommandQueue.mutex) == thrd_success);
+    return status;
+}
+
+void* GetRenderCommandData( RenderCommandId commandId )
+{
+    Ensure(mtx_lock(&RenderCommandQueue.mutex) == thrd_success);
+    const RenderCommand* command = GetRenderCommand(commandId);
+    Ensure(command->status == COMPLETED_RENDER_COMMAND);
+    void* data = command->config.data;
+    Ensure(mtx_unlock(&RenderCommandQueue.mutex) == thrd_success);
+    return data;
+}
+
+void WaitForRenderCommands( const RenderCommandId* commandIds, int commandIdCount )
+{
+    assert(!RenderCommandQueue.config.useRenderThread ||
+           !InRenderThread()); // Would wait for itself.
+
+    Ensure(mtx_lock(&RenderCommandQueue.mutex) == thrd_success);
+    REPEAT(commandIdCount, i)
+    {
+        const RenderCommandId id = commandIds[i];
+        while(GetRenderCommand(id)->status != COMPLETED_RENDER_COMMAND)
+            Ensure(cnd_wait(&RenderCommandQueue.completionCondition,
+                            &RenderCommandQueue.mutex) == thrd_success);
+    }
+    Ensure(mtx_unlock(&RenderCommandQueue.mutex) == thrd_success);
+}
+
+void RunInRenderThread( void (*processor)( void* data ), void* data )
+{
+    if(InRenderThread())
+    {
+        processor(data);
+    }
+    else
+    {
+        const RenderCommandId id =
+            AddRenderCommand({"RunInRenderThread", processor, NULL, data},
+                             InSerialPhase());
+        WaitForRenderCommands(&id, 1);
+        RemoveRenderCommand(id);
+    }
+}
+
+
+// --- Render thread specific ---
+
+static RenderCommandId TryToGetQueuedRenderCommand()
+{
+    if(RenderCommandQueue.queue.length == 0)
+        return INVALID_RENDER_COMMAND_ID;
+
+    const int queueIndex = RenderCommandQueue.queue.length - 1;
+    const RenderCommandId id = RenderCommandQueue.queue.data[queueIndex];
+    RemoveFromArray(&RenderCommandQueue.queue, queueIndex, 1);
+
+    RenderCommand* command = GetRenderCommand(id);
+    Ensure(command->status == QUEUED_RENDER_COMMAND);
+    command->status = ACTIVE_RENDER_COMMAND;
+    return id;
+}
+
+static int RenderThreadFn( void* arg )
+{
+    NotifyProfilerAboutThreadCreation("Render thread");
+
+    if(RenderCommandQueue.config.threadStartFn)
+        RenderCommandQueue.config.threadStartFn();
+
+    for(;;)
+    {
+        Ensure(mtx_lock(&RenderCommandQueue.mutex) == thrd_success);
+
+        RenderCommandId id;
+        while((id = TryToGetQueuedRenderCommand()) == INVALID_RENDER_COMMAND_ID &&
+              !RenderCommandQueue.isStopping)
+            Ensure(cnd_wait(&RenderCommandQueue.updateCondition,
+                            &RenderCommandQueue.mutex) == thrd_success);
+
+        if(id == INVALID_RENDER_COMMAND_ID) // stopping and queue is empty
+        {
+            Ensure(mtx_unlock(&RenderCommandQueue.mutex) == thrd_success);
+            break;
+        }
+
+        const RenderCommand* command = GetRenderCommand(id);
+        const RenderCommandConfig config = command->config;
+        const bool serial = command->serial;
+        Ensure(mtx_unlock(&RenderCommandQueue.mutex) == thrd_success);
+
+        ProcessRenderCommand(&config, serial);
+
+        Ensure(mtx_lock(&RenderCommandQueue.mutex) == thrd_success);
+        GetRenderCommand(id)->status = COMPLETED_RENDER_COMMAND;
+        cnd_broadcast(&RenderCommandQueue.completionCondition);
+        Ensure(mtx_unlock(&RenderCommandQueue.mutex) == thrd_success);
+    }
+
+    if(RenderCommandQueue.config.threadStopFn)
+        RenderCommandQueue.config.threadStopFn();
+
+    return 0;
+}
@@ -0,0 +1,108 @@
+#ifndef __KONSTRUKT_RENDER_COMMAND_QUEUE__
+#define __KONSTRUKT_RENDER_COMMAND_QUEUE__
+
+/**
+ * @file
+ * Graphics commands are processed by a dedicated render thread, which owns
+ * the OpenGL context.  This way rendering doesn't happen in the serial phase.
+ *
+ * Render commands work much like jobs:  They have an id, a processing
+ * callback and a destructor callback.  Their status and their data can be
+ * queried by the thread which created them.
+ *
+ * Commands are processed in the order in which they were created.
+ *
+ * @see JobManager.h
+ */
+
+
+static const int INVALID_RENDER_COMMAND_ID = -1;
+
+typedef int RenderCommandId;
+
+enum RenderCommandStatus
+{
+    QUEUED_RENDER_COMMAND,
+    ACTIVE_RENDER_COMMAND,
+    COMPLETED_RENDER_COMMAND
+};
+
+
+struct RenderCommandQueueConfig
+{
+    /**
+     * Whether commands are processed by a dedicated thread.
+     *
+     * Otherwise commands are processed immediately by the thread, which
+     * creates them.
+     */
+    bool useRenderThread;
+
+    /**
+     * Called by the render thread when it starts and stops.
+     * Used to move the OpenGL context to the render thread.
+     *
+     * May be `NULL`.
+     */
+    void (*threadStartFn)();
+    void (*threadStopFn)();
+};
+
+void InitRenderCommandQueue( RenderCommandQueueConfig config );
+
+/**
+ * Processes the remaining commands and stops the render thread.
+ */
+void DestroyRenderCommandQueue();
+
+/**
+ * Whether the calling thread may issue graphics calls directly.
+ *
+ * If no render thread is used, this is true for every thread.
+ */
+bool InRenderThread();
+
+/**
+ * Block till all given commands are completed.
+ */
+void WaitForRenderCommands( const RenderCommandId* commandIds, int commandIdCount );
+
+/**
+ * Runs `processor` in the render thread and waits till it has completed.
+ *
+ * If the calling thread is the render thread already, the function is
+ * called directly.
+ *
+ * When called in the serial phase, the processor is also run as part of the
+ * serial phase, since the main thread is blocked meanwhile.
+ */
+void RunInRenderThread( void (*processor)( void* data ), void* data );
+
+
+// --- Render command ---
+
+struct RenderCommandConfig
+{
+    const char* name; // Useful when debugging the engine.
+    void (*processor)( void* data );
+    void (*destructor)( void* data );
+    void* data;
+};
+
+RenderCommandId CreateRenderCommand( RenderCommandConfig config );
+
+/**
+ * May only be called on completed commands.
+ * Calls the destructor of the command.
+ */
+void RemoveRenderCommand( RenderCommandId commandId );
+
+RenderCommandStatus GetRenderCommandStatus( RenderCommandId commandId );
+
+/**
+ * May only be called on completed commands.
+ * Processors store their results in the command data.
+ */
+void* GetRenderCommandData( RenderCommandId commandId );
+
+#endif
@@ -3,19 +3,24 @@
 #include "Common.h"
 #include "Profiler.h"
 #include "OpenGL.h" // glfwGetTime
+#include "OpenGLState.h"
 #include "Vertex.h"
 #include "Time.h"
 #include "Shader.h"
+#include "Mesh.h" // FenceMeshArena
+#include "Texture.h" // PrepareTextureUploads, UploadTextures
 #include "RenderTarget.h"
 #include "Window.h" // SwapBuffers
-#include "JobManager.h"
+#include "RenderCommandQueue.h"
 #include "RenderManager.h"
 
 
+static const uint32_t TIME_UNIFORM = CalcConstShaderVariableNameHash("Time");
+
 DefineCounter(FrameTimeCounter, "frame time (ms)");
 static double LastFrameTimestamp;
 static double FrameTime;
-static JobId UpdateJob;
+static RenderCommandId UpdateCommand;
 
 
 void InitRenderManager()
@@ -23,15 +28,18 @@ void InitRenderManager()
     assert(InSerialPhase());
     InitCounter(FrameTimeCounter);
     EnableVertexArrays();
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
-    glEnable(GL_CULL_FACE);
-    glEnable(GL_BLEND);
-    glEnable(GL_FRAMEBUFFER_SRGB);
-    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
-    glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-    glBlendFuncSeparate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, // RGB
-                        GL_ONE, GL_ZERO);               // A
+    SetCapability(GL_DEPTH_TEST, true);
+    SetDepthFunc(GL_LEQUAL);
+    SetCapability(GL_CULL_FACE, true);
+    SetCullFace(GL_BACK);
+    SetCapability(GL_BLEND, true);
+    SetCapability(GL_FRAMEBUFFER_SRGB, true);
+    SetCapability(GL_TEXTURE_CUBE_MAP_SEAMLESS, true);
+    SetCapability(GL_SCISSOR_TEST, false);
+    SetDepthMask(true);
+    SetBlendEquation(GL_FUNC_ADD, GL_FUNC_ADD);
+    SetBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, // RGB
+                 GL_ONE, GL_ZERO);               // A
 }
 
 void DestroyRenderManager()
@@ -43,17 +51,18 @@ static void RenderScene( void* _data )
 {
     ProfileScope("RenderScene");
 
-    SetFloatUniform(GetGlobalShaderVariableSet(), "Time", GetTime());
-
     //RenderTarget* defaultRenderTarget = GetDefaultRenderTarget();
     //UpdateRenderTarget(defaultRenderTarget); // TODO
 
     SwapBuffers();
+    FenceMeshArena();
+    UploadTextures();
     const double curTimestamp = glfwGetTime();
     FrameTime = curTimestamp - LastFrameTimestamp;
     LastFrameTimestamp = curTimestamp;
 
     SetCounter(FrameTimeCounter, FrameTime*1000);
+    UpdateOpenGLStateCounters();
 
     /*
     // Render shadow map
@@ -86,11 +95,18 @@ double GetFrameTime()
 void BeginRenderManagerUpdate( void* _context, double _timeDelta )
 {
     assert(InSerialPhase());
-    UpdateJob = CreateJob({"RenderScene", RenderScene});
+
+    // Global variables may only be modified in the serial phase:
+    SetFloatUniformByHash(GetGlobalShaderVariableSet(), TIME_UNIFORM, GetTime());
+    UpdateUniformBuffer(GetGlobalUniformBuffer());
+    PrepareTextureUploads();
+
+    UpdateCommand = CreateRenderCommand({"RenderScene", RenderScene});
 }
 
 void CompleteRenderManagerUpdate( void* _context )
 {
     assert(InSerialPhase());
-    WaitForJobs(&UpdateJob, 1);
+    WaitForRenderCommands(&UpdateCommand, 1);
+    RemoveRenderCommand(UpdateCommand);
 }
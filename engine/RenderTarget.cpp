@@ -4,6 +4,7 @@
 #include "Common.h"
 #include "Profiler.h"
 #include "OpenGL.h"
+#include "OpenGLState.h"
 #include "Reference.h"
 #include "Texture.h"
 #include "Camera.h"
@@ -142,7 +143,7 @@ static void UpdateDefaultRenderTargetCameraProjection()
 
 static void OnFramebufferResize( int width, int height )
 {
-    glViewport(0, 0, width, height);
+    SetViewport(0, 0, width, height);
     UpdateDefaultRenderTargetCameraProjection();
 }
 
@@ -227,7 +228,7 @@ void UpdateRenderTarget( RenderTarget* target )
         if(camera)
         {
             DrawCameraView(camera, target->shaderProgramSet);
-            glClear(GL_DEPTH_BUFFER_BIT);
+            ClearFramebuffer(GL_DEPTH_BUFFER_BIT);
         }
     }
 }
@@ -4,12 +4,16 @@
 #include <stdint.h> // uintptr_t
 
 #include "Common.h"
+#include "Config.h"
 #include "Crc32.h"
 #include "Texture.h"
 #include "Vfs.h"
 #include "OpenGL.h"
+#include "OpenGLState.h"
 #include "Vertex.h"
 #include "Reference.h"
+#include "Array.h"
+#include "RenderCommandQueue.h"
 #include "Shader.h"
 
 
@@ -18,7 +22,18 @@ static const GLuint INVALID_SHADER_HANDLE = 0;
 static const int MAX_GLOBAL_UNIFORMS = 32;
 static const int MAX_SHADER_PROGRAM_SET_ENTRIES = 16;
 static const int MAX_SHADER_VARIABLE_SET_ENTRIES = 32;
+static const int SHADER_VARIABLE_SET_SLOTS = 64; // Must be a power of two
 static const int MAX_PROGRAM_FAMILY_SIZE = 32;
+static const char* INSTANCE_BLOCK_NAME = "InstanceTransformations";
+static const char* INSTANCE_INDEX_NAME = "InstanceIndex"; // See Vertex.cpp
+static const GLuint INSTANCE_BLOCK_BINDING = 0;
+static const char* GLOBAL_UNIFORM_BLOCK_NAME = "Global";
+static const int MAX_UNIFORM_BLOCKS = 8;
+static const GLuint FIRST_UNIFORM_BLOCK_BINDING = INSTANCE_BLOCK_BINDING+1;
+static const int INVALID_UNIFORM_BLOCK_ID = -1;
+static const uint32_t PROGRAM_CACHE_MAGIC = 0x4b505243; // 'KPRC'
+static const int PROGRAM_CACHE_VERSION = 1; // Increment if the file format or the attribute bindings change.
+static const char* PROGRAM_CACHE_DIRECTORY = "shared-state/program-cache";
 
 
 enum ShaderVariableType
@@ -40,10 +55,18 @@ enum UniformType
 };
 
 
+/**
+ * Shaders are compiled lazily: When a program is linked which can't be
+ * loaded from the program cache.  Until then only the source is kept.
+ */
 struct Shader
 {
     ReferenceCounter refCounter;
-    GLuint handle;
+    GLuint handle; // #INVALID_SHADER_HANDLE until the shader is compiled.
+    GLenum type;
+    char vfsPath[MAX_PATH_SIZE];
+    char* source;
+    int sourceSize;
 };
 
 struct UniformDefinition
@@ -54,6 +77,32 @@ struct UniformDefinition
     UniformType type;
 };
 
+struct UniformBlockMember
+{
+    uint32_t nameHash;
+    char name[MAX_UNIFORM_NAME_SIZE];
+    UniformType type;
+    int offset;
+    int matrixStride;
+};
+
+/**
+ * Uniform blocks are shared by all programs, which declare a block with the
+ * same name.  Each block has a fixed binding point, so buffers stay bound
+ * when programs are switched.
+ *
+ * The layout is read from the first program which declares the block.
+ * Other programs must yield the same layout, which is guaranteed if the
+ * blocks are declared equally and use the std140 layout.
+ */
+struct UniformBlock
+{
+    uint32_t nameHash;
+    char name[MAX_UNIFORM_NAME_SIZE];
+    int size;
+    Array<UniformBlockMember> members; // Array elements are separate members.
+};
+
 struct ShaderProgram
 {
     ReferenceCounter refCounter;
@@ -67,7 +116,70 @@ struct ShaderProgram
     UniformDefinition* uniformDefinitions;
     UniformValue* currentUniformValues;
 
+    /**
+     * Indices of the sampler uniforms, so binding textures doesn't need to
+     * iterate all uniforms.
+     */
+    int samplerCount;
+    int* samplerUniformIndices;
+
+    /**
+     * Ids of the declared uniform blocks - except the instance block.
+     */
+    int uniformBlockCount;
+    int* uniformBlockIds;
+
     ShaderVariableSet* variableSet;
+
+    bool supportsInstancing;
+    bool supportsMultiDraw;
+};
+
+/**
+ * Program cache files start with this header.  It's followed by the program
+ * binary, the uniform definitions and the uniform blocks.
+ */
+struct ProgramCacheHeader
+{
+    uint32_t magic;
+    int version;
+    uint32_t key;
+    int sourceSize; // Total size of all shader sources - guards against collisions.
+    GLenum binaryFormat;
+    int binarySize;
+    int uniformCount;
+    int uniformBlockCount;
+};
+
+/**
+ * Precedes the members of each uniform block in a program cache file.
+ */
+struct CachedUniformBlock
+{
+    char name[MAX_UNIFORM_NAME_SIZE];
+    int size;
+    int memberCount;
+};
+
+/**
+ * Parses a program cache file, which has been read into memory.
+ */
+struct ProgramCacheReader
+{
+    const char* data;
+    int size;
+    int position;
+};
+
+struct ProgramFamilyList
+{
+    char families[MAX_PROGRAM_FAMILY_LIST_SIZE];
+};
+
+struct ResolvedProgram
+{
+    bool resolved;
+    ShaderProgram* program;
 };
 
 struct ShaderProgramSetEntry
@@ -80,6 +192,12 @@ struct ShaderProgramSet
 {
     ReferenceCounter refCounter;
     ShaderProgramSetEntry entries[MAX_SHADER_PROGRAM_SET_ENTRIES];
+
+    /**
+     * Resolved program for each #ProgramFamilyListId.
+     * Cleared by #SetShaderProgramFamily.
+     */
+    Array<ResolvedProgram> resolvedPrograms;
 };
 
 struct GlobalUniform
@@ -94,10 +212,14 @@ struct UniformBuffer
 {
     ReferenceCounter refCounter;
 
-    GLuint handle;
+    GLuint handle; // Created when the buffer is used the first time.
 
-    // TODO: layout info goes here
+    const ShaderVariableSet* variableSet;
+    int blockId; // Block which defines the layout.
 
+    /**
+     * Copy of the buffer contents, so only changes need to be uploaded.
+     */
     int size;
     char* data;
 
@@ -107,12 +229,11 @@ struct UniformBuffer
 struct ShaderVariable
 {
     uint32_t nameHash;
-    char name[MAX_UNIFORM_NAME_SIZE];
 
     ShaderVariableType type;
     union
     {
-        union
+        struct
         {
             UniformType  type;
             UniformValue value;
@@ -122,25 +243,64 @@ struct ShaderVariable
     } value;
 };
 
+/**
+ * Hash table which uses open addressing with linear probing.
+ *
+ * Slots with a name hash of zero are empty.  The table has twice as many
+ * slots as entries, so lookups rarely need more than one or two probes.
+ */
 struct ShaderVariableSet
 {
-    ShaderVariable entries[MAX_SHADER_VARIABLE_SET_ENTRIES];
+    int entryCount;
+    ShaderVariable slots[SHADER_VARIABLE_SET_SLOTS];
 };
 
 
 static ShaderVariableSet* GlobalShaderVariableSet = NULL;
+static UniformBuffer* GlobalUniformBuffer = NULL;
+static Array<ProgramFamilyList> ProgramFamilyLists;
+static Array<UniformBlock> UniformBlocks;
+static GLuint InstanceBuffer = 0;
+static bool ProgramCacheEnabled = false;
+static uint32_t ProgramCacheDriverHash = 0;
+
+static void InitProgramCache();
 
 
 void InitShader()
 {
     assert(InSerialPhase());
+    InitArray(&UniformBlocks);
     GlobalShaderVariableSet = CreateShaderVariableSet();
+    GlobalUniformBuffer = CreateUniformBuffer(GlobalShaderVariableSet);
+    SetUniformBuffer(GlobalShaderVariableSet,
+                     GLOBAL_UNIFORM_BLOCK_NAME,
+                     GlobalUniformBuffer);
+    InitArray(&ProgramFamilyLists);
+
+    glGenBuffers(1, &InstanceBuffer);
+    BindBuffer(GL_UNIFORM_BUFFER, InstanceBuffer);
+    glBufferData(GL_UNIFORM_BUFFER,
+                 sizeof(InstanceTransformation)*MAX_DRAW_INSTANCES,
+                 NULL,
+                 GL_STREAM_DRAW);
+    BindBufferBase(GL_UNIFORM_BUFFER, INSTANCE_BLOCK_BINDING, InstanceBuffer);
+
+    InitProgramCache();
 }
 
 void DestroyShader()
 {
     assert(InSerialPhase());
-    FreeShaderVariableSet(GlobalShaderVariableSet);
+    FreeShaderVariableSet(GlobalShaderVariableSet); // Frees the global buffer
+    GlobalUniformBuffer = NULL;
+    DestroyArray(&ProgramFamilyLists);
+    REPEAT(UniformBlocks.length, i)
+        DestroyArray(&UniformBlocks.data[i].members);
+    DestroyArray(&UniformBlocks);
+    glDeleteBuffers(1, &InstanceBuffer);
+    ForgetBuffer(InstanceBuffer);
+    InstanceBuffer = 0;
 }
 
 ShaderVariableSet* GetGlobalShaderVariableSet()
@@ -148,6 +308,11 @@ ShaderVariableSet* GetGlobalShaderVariableSet()
     return GlobalShaderVariableSet;
 }
 
+UniformBuffer* GetGlobalUniformBuffer()
+{
+    return GlobalUniformBuffer;
+}
+
 
 // ----- Tools ------
 
@@ -165,9 +330,7 @@ static bool StringEndsWith( const char* target, const char* end )
 
 // ----- Shader ------
 
-static void FreeShader( Shader* shader );
-
-static void ShowShaderLog( Shader* shader, bool success, const char* vfsPath )
+static void ShowShaderLog( Shader* shader, bool success )
 {
     GLint length = 0;
     glGetShaderiv(shader->handle, GL_INFO_LOG_LENGTH, &length);
@@ -182,16 +345,16 @@ static void ShowShaderLog( Shader* shader, bool success, const char* vfsPath )
     if(success)
     {
         if(log)
-            LogWarning("Compiled shader: %s\n%s", vfsPath, log);
+            LogWarning("Compiled shader: %s\n%s", shader->vfsPath, log);
     }
     else
-        FatalError("Error compiling shader %s\n%s", vfsPath, log);
+        FatalError("Error compiling shader %s\n%s", shader->vfsPath, log);
 
     if(log)
         delete[] log;
 }
 
-static Shader* CreateShader( const char* vfsPath, int type )
+static Shader* CreateShader( const char* vfsPath, GLenum type )
 {
     assert(InSerialPhase());
 
@@ -199,24 +362,35 @@ static Shader* CreateShader( const char* vfsPath, int type )
     if(!file)
         return NULL;
 
-    const int fileSize = GetVfsFileSize(file);
-    char* fileContent = (char*)Alloc(fileSize);
-    ReadVfsFile(file, fileContent, fileSize);
-    CloseVfsFile(file);
-
     Shader* shader = new Shader;
     InitReferenceCounter(&shader->refCounter);
-    shader->handle = glCreateShader(type);
+    shader->handle = INVALID_SHADER_HANDLE;
+    shader->type = type;
+    CopyString(vfsPath, shader->vfsPath, sizeof(shader->vfsPath));
+
+    shader->sourceSize = GetVfsFileSize(file);
+    shader->source = (char*)Alloc(shader->sourceSize);
+    ReadVfsFile(file, shader->source, shader->sourceSize);
+    CloseVfsFile(file);
 
-    glShaderSource(shader->handle, 1, &fileContent, &fileSize);
-    Free(fileContent);
+    return shader;
+}
 
+/**
+ * Must be called in the render thread.
+ */
+static void CompileShader( Shader* shader )
+{
+    assert(shader->handle == INVALID_SHADER_HANDLE);
+    shader->handle = glCreateShader(shader->type);
+
+    const char* source = shader->source;
+    glShaderSource(shader->handle, 1, &source, &shader->sourceSize);
     glCompileShader(shader->handle);
 
     GLint state;
     glGetShaderiv(shader->handle, GL_COMPILE_STATUS, &state);
-    ShowShaderLog(shader, state, vfsPath);
-    return shader;
+    ShowShaderLog(shader, state);
 }
 
 Shader* LoadShader( const char* vfsPath )
@@ -236,11 +410,25 @@ Shader* LoadShader( const char* vfsPath )
     }
 }
 
+static void FreeShader( Shader* shader );
+
+static void FreeShaderInRenderThread( void* data )
+{
+    FreeShader((Shader*)data);
+}
+
 static void FreeShader( Shader* shader )
 {
     assert(InSerialPhase());
+    if(!InRenderThread())
+    {
+        RunInRenderThread(FreeShaderInRenderThread, shader);
+        return;
+    }
     FreeReferenceCounter(&shader->refCounter);
-    glDeleteShader(shader->handle);
+    if(shader->handle != INVALID_SHADER_HANDLE)
+        glDeleteShader(shader->handle);
+    Free(shader->source);
     delete shader;
 }
 
@@ -363,7 +551,7 @@ static void AddUniformDefinition( ShaderProgram* program,
     const int nameLength = strlen(name);
     assert(nameLength <= MAX_UNIFORM_NAME_SIZE-1);
 
-    def->nameHash = CalcCrc32ForString(name);
+    def->nameHash = CalcShaderVariableNameHash(name);
     memset(def->name, 0, MAX_UNIFORM_NAME_SIZE);
     strncpy(def->name, name, nameLength);
     def->location = location;
@@ -372,6 +560,8 @@ static void AddUniformDefinition( ShaderProgram* program,
     (*index)++;
 }
 
+static void InitUniformValues( ShaderProgram* program );
+
 static void ReadUniformDefinitions( ShaderProgram* program )
 {
     if(program->uniformDefinitions)
@@ -386,6 +576,12 @@ static void ReadUniformDefinitions( ShaderProgram* program )
         program->currentUniformValues = NULL;
     }
 
+    if(program->samplerUniformIndices)
+    {
+        delete[] program->samplerUniformIndices;
+        program->samplerUniformIndices = NULL;
+    }
+
     int count = CountUniforms(program);
     program->uniformCount = count;
     program->uniformDefinitions = new UniformDefinition[count];
@@ -438,8 +634,206 @@ static void ReadUniformDefinitions( ShaderProgram* program )
         }
     }
 
+    InitUniformValues(program);
+}
+
+/**
+ * Builds the tables which are derived from the uniform definitions.
+ */
+static void InitUniformValues( ShaderProgram* program )
+{
+    const int count = program->uniformCount;
     program->currentUniformValues = new UniformValue[count];
     memset(program->currentUniformValues, 0, sizeof(UniformValue)*count);
+
+    // Build sampler index:
+    program->samplerCount = 0;
+    REPEAT(count, i)
+        if(program->uniformDefinitions[i].type == SAMPLER_UNIFORM)
+            program->samplerCount++;
+    program->samplerUniformIndices = new int[program->samplerCount];
+    int samplerIndex = 0;
+    REPEAT(count, i)
+    {
+        if(program->uniformDefinitions[i].type == SAMPLER_UNIFORM)
+        {
+            program->samplerUniformIndices[samplerIndex] = i;
+            samplerIndex++;
+        }
+    }
+}
+
+static void AddUniformBlockMember( UniformBlock* block,
+                                   uint32_t nameHash,
+                                   const char* name,
+                                   UniformType type,
+                                   int offset,
+                                   int matrixStride )
+{
+    UniformBlockMember* member = AllocateAtEndOfArray(&block->members, 1);
+    member->nameHash = nameHash;
+    CopyString(name, member->name, sizeof(member->name));
+    member->type = type;
+    member->offset = offset;
+    member->matrixStride = matrixStride;
+}
+
+static void ReadUniformBlockLayout( const ShaderProgram* program,
+                                    GLuint index,
+                                    const char* name,
+                                    UniformBlock* block )
+{
+    memset(block, 0, sizeof(UniformBlock));
+    block->nameHash = CalcShaderVariableNameHash(name);
+    CopyString(name, block->name, sizeof(block->name));
+    InitArray(&block->members);
+
+    glGetActiveUniformBlockiv(program->handle,
+                              index,
+                              GL_UNIFORM_BLOCK_DATA_SIZE,
+                              &block->size);
+
+    int memberCount = 0;
+    glGetActiveUniformBlockiv(program->handle,
+                              index,
+                              GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS,
+                              &memberCount);
+
+    int* memberIndices_ = new int[memberCount];
+    glGetActiveUniformBlockiv(program->handle,
+                              index,
+                              GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES,
+                              memberIndices_);
+    GLuint* memberIndices = new GLuint[memberCount];
+    REPEAT(memberCount, i)
+        memberIndices[i] = memberIndices_[i];
+    delete[] memberIndices_;
+
+    // Offsets and strides are given in bytes:
+    int* offsets       = new int[memberCount];
+    int* arrayStrides  = new int[memberCount];
+    int* matrixStrides = new int[memberCount];
+    glGetActiveUniformsiv(program->handle, memberCount, memberIndices, GL_UNIFORM_OFFSET, offsets);
+    glGetActiveUniformsiv(program->handle, memberCount, memberIndices, GL_UNIFORM_ARRAY_STRIDE, arrayStrides);
+    glGetActiveUniformsiv(program->handle, memberCount, memberIndices, GL_UNIFORM_MATRIX_STRIDE, matrixStrides);
+
+    static char memberName[MAX_UNIFORM_NAME_SIZE];
+    REPEAT(memberCount, i)
+    {
+        int nameLength = 0;
+        int size = 0;
+        GLenum glType = GL_ZERO;
+        glGetActiveUniform(program->handle,
+                           memberIndices[i],
+                           MAX_UNIFORM_NAME_SIZE,
+                           &nameLength,
+                           &size,
+                           &glType,
+                           memberName);
+        assert(nameLength > 0);
+        assert(nameLength <= MAX_UNIFORM_NAME_SIZE-1);
+
+        const UniformType type = GLToUniformType(glType);
+
+        if(StringEndsWith(memberName, "[0]")) // array:
+        {
+            memberName[nameLength-3] = '\0';
+            const uint32_t nameHash = CalcShaderVariableNameHash(memberName);
+            REPEAT(size, j)
+                AddUniformBlockMember(block,
+                                      CalcShaderVariableArrayElementNameHash(nameHash, j),
+                                      memberName,
+                                      type,
+                                      offsets[i] + arrayStrides[i]*j,
+                                      matrixStrides[i]);
+        }
+        else
+        {
+            AddUniformBlockMember(block,
+                                  CalcShaderVariableNameHash(memberName),
+                                  memberName,
+                                  type,
+                                  offsets[i],
+                                  matrixStrides[i]);
+        }
+    }
+
+    delete[] memberIndices;
+    delete[] offsets;
+    delete[] arrayStrides;
+    delete[] matrixStrides;
+}
+
+static const UniformBlockMember* FindUniformBlockMember( const UniformBlock* block,
+                                                         uint32_t nameHash )
+{
+    REPEAT(block->members.length, i)
+        if(block->members.data[i].nameHash == nameHash)
+            return &block->members.data[i];
+    return NULL;
+}
+
+static bool UniformBlockLayoutsAreEqual( const UniformBlock* a,
+                                         const UniformBlock* b )
+{
+    if(a->size != b->size ||
+       a->members.length != b->members.length)
+        return false;
+
+    REPEAT(a->members.length, i)
+    {
+        const UniformBlockMember* aMember = &a->members.data[i];
+        const UniformBlockMember* bMember =
+            FindUniformBlockMember(b, aMember->nameHash);
+        if(!bMember ||
+           aMember->type != bMember->type ||
+           aMember->offset != bMember->offset ||
+           aMember->matrixStride != bMember->matrixStride)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Returns the id of the block with the given layout.
+ * Blocks are created when they're declared the first time.
+ *
+ * Takes ownership of the layout.
+ */
+static int RegisterUniformBlock( UniformBlock* layout )
+{
+    REPEAT(UniformBlocks.length, i)
+    {
+        const UniformBlock* block = &UniformBlocks.data[i];
+        if(block->nameHash == layout->nameHash)
+        {
+            if(!UniformBlockLayoutsAreEqual(block, layout))
+                FatalError("Uniform block %s has been declared with different layouts.  Blocks must use the std140 layout.",
+                           layout->name);
+            DestroyArray(&layout->members);
+            return i;
+        }
+    }
+
+    if(UniformBlocks.length >= MAX_UNIFORM_BLOCKS)
+        FatalError("Too many uniform blocks.");
+    AppendToArray(&UniformBlocks, 1, layout);
+    return UniformBlocks.length-1;
+}
+
+/**
+ * Takes ownership of the layout.  See #RegisterUniformBlock.
+ */
+static void AddUniformBlock( ShaderProgram* program,
+                             GLuint index,
+                             UniformBlock* layout )
+{
+    const int blockId = RegisterUniformBlock(layout);
+    glUniformBlockBinding(program->handle,
+                          index,
+                          FIRST_UNIFORM_BLOCK_BINDING + blockId);
+    program->uniformBlockIds[program->uniformBlockCount] = blockId;
+    program->uniformBlockCount++;
 }
 
 static void ReadUniformBlockDefinitions( ShaderProgram* program )
@@ -448,64 +842,343 @@ static void ReadUniformBlockDefinitions( ShaderProgram* program )
 
     int blockCount = 0;
     glGetProgramiv(program->handle, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+
+    program->uniformBlockCount = 0;
+    program->uniformBlockIds = new int[blockCount];
+
     REPEAT(blockCount, i)
     {
-        int nameLength = 0;
-        int size = 0;
-        int uniformCount = 0;
         glGetActiveUniformBlockName(program->handle,
                                     i,
                                     MAX_UNIFORM_NAME_SIZE,
-                                    &nameLength,
+                                    NULL,
                                     name);
-        glGetActiveUniformBlockiv(program->handle,
-                                  i,
-                                  GL_UNIFORM_BLOCK_DATA_SIZE,
-                                  &size);
-        glGetActiveUniformBlockiv(program->handle,
-                                  i,
-                                  GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS,
-                                  &uniformCount);
-        LogInfo("BLOCK: %d %s size=%d uniforms=%d", i, name, size, uniformCount);
-
-        int* uniformIndices_ = new int[uniformCount];
-        GLuint* uniformIndices = new GLuint[uniformCount];
-        glGetActiveUniformBlockiv(program->handle,
-                                  i,
-                                  GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES,
-                                  uniformIndices_);
-        REPEAT(uniformCount, j)
-            uniformIndices[j] = uniformIndices_[j];
-        delete[] uniformIndices_;
-        int* uniformOffset = new int[uniformCount];
-        int* uniformArrStride = new int[uniformCount];
-        int* uniformMatStride = new int[uniformCount];
-        glGetActiveUniformsiv(program->handle, uniformCount, uniformIndices, GL_UNIFORM_OFFSET, uniformOffset);
-        glGetActiveUniformsiv(program->handle, uniformCount, uniformIndices, GL_UNIFORM_ARRAY_STRIDE, uniformArrStride);
-        glGetActiveUniformsiv(program->handle, uniformCount, uniformIndices, GL_UNIFORM_MATRIX_STRIDE, uniformMatStride);
-        REPEAT(uniformCount, j)
-            LogInfo("  %d location=%d offset=%d arrStride=%d matStride=%d",
-                     j, uniformIndices[j], uniformOffset[j], uniformArrStride[j], uniformMatStride[j]);
-        delete[] uniformIndices;
-        delete[] uniformOffset;
-        delete[] uniformArrStride;
-        delete[] uniformMatStride;
-
-        // uniformOffset:
-        // offset, in basic machine units, relative to the beginning of the uniform block
-        //
-        // uniformArrStride:
-        // difference, in basic machine units, of consecutive elements in an array
-        //
-        // uniformMatStride:
-        // stride between columns of a column-major matrix or rows of a row-major matrix, in basic machine units
+        if(strcmp(name, INSTANCE_BLOCK_NAME) == 0)
+            continue; // See ReadInstanceBlockDefinition
+
+        UniformBlock layout;
+        ReadUniformBlockLayout(program, i, name, &layout);
+        AddUniformBlock(program, i, &layout);
+    }
+}
+
+static void ReadInstanceBlockDefinition( ShaderProgram* program )
+{
+    const GLuint index = glGetUniformBlockIndex(program->handle,
+                                                INSTANCE_BLOCK_NAME);
+    if(index == GL_INVALID_INDEX)
+    {
+        program->supportsInstancing = false;
+        program->supportsMultiDraw = false;
+        return;
+    }
+
+    int size = 0;
+    glGetActiveUniformBlockiv(program->handle,
+                              index,
+                              GL_UNIFORM_BLOCK_DATA_SIZE,
+                              &size);
+    const int expectedSize = sizeof(InstanceTransformation)*MAX_DRAW_INSTANCES;
+    if(size != expectedSize)
+        FatalError("Uniform block %s has %d bytes, but %d bytes are expected.",
+                   INSTANCE_BLOCK_NAME, size, expectedSize);
+
+    glUniformBlockBinding(program->handle, index, INSTANCE_BLOCK_BINDING);
+    program->supportsInstancing = true;
+
+    const bool usesInstanceIndex =
+        glGetAttribLocation(program->handle, INSTANCE_INDEX_NAME) != -1;
+    if(usesInstanceIndex && !InstanceIndicesAreAvailable())
+        LogWarning("Program uses %s, but GL_ARB_instanced_arrays is not available.",
+                   INSTANCE_INDEX_NAME);
+    program->supportsMultiDraw = usesInstanceIndex &&
+                                 InstanceIndicesAreAvailable();
+}
+
+/**
+ * Program binaries are only valid for the driver which created them, so the
+ * driver identification goes into every cache key.
+ */
+static void InitProgramCache()
+{
+    ProgramCacheEnabled = false;
+
+    if(!GetConfigBool("opengl.program-cache", true))
+        return;
+
+    if(!GLAD_GL_ARB_get_program_binary)
+    {
+        LogInfo("Program cache is not available: GL_ARB_get_program_binary is missing.");
+        return;
+    }
+
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    if(formatCount <= 0)
+    {
+        LogInfo("Program cache is not available: The driver doesn't support any binary formats.");
+        return;
+    }
+
+    if(GetVfsFileType(PROGRAM_CACHE_DIRECTORY) == FILE_TYPE_INVALID)
+        MakeVfsDir(PROGRAM_CACHE_DIRECTORY);
+
+    uint32_t hash = CalcCrc32ForBuffer(&PROGRAM_CACHE_VERSION,
+                                       sizeof(PROGRAM_CACHE_VERSION));
+    const GLenum driverStrings[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    REPEAT(3, i)
+    {
+        const char* string = (const char*)glGetString(driverStrings[i]);
+        if(string)
+            hash = ContinueCrc32(hash, string, strlen(string)+1);
+    }
+    ProgramCacheDriverHash = hash;
+    ProgramCacheEnabled = true;
+}
+
+static uint32_t CalcProgramCacheKey( Shader** shaders,
+                                     int shaderCount,
+                                     int* sourceSize )
+{
+    uint32_t key = ProgramCacheDriverHash;
+    *sourceSize = 0;
+    REPEAT(shaderCount, i)
+    {
+        const Shader* shader = shaders[i];
+        key = ContinueCrc32(key, &shader->type, sizeof(shader->type));
+        key = ContinueCrc32(key, shader->source, shader->sourceSize);
+        *sourceSize += shader->sourceSize;
+    }
+    return key;
+}
+
+static const char* GetProgramCachePath( uint32_t key )
+{
+    return Format("%s/%08x.bin", PROGRAM_CACHE_DIRECTORY, key);
+}
+
+/**
+ * @return
+ * Pointer to the next `size` bytes or `NULL` if the file is too short.
+ */
+static const void* ReadFromProgramCache( ProgramCacheReader* reader, int size )
+{
+    if(size < 0 || size > reader->size - reader->position)
+        return NULL;
+    const void* data = &reader->data[reader->position];
+    reader->position += size;
+    return data;
+}
+
+static bool ReadCachedUniformBlocks( ShaderProgram* program,
+                                     ProgramCacheReader* reader,
+                                     int blockCount )
+{
+    if(blockCount < 0 || blockCount > MAX_UNIFORM_BLOCKS)
+        return false;
+
+    // Verify everything before blocks are registered:
+    const int start = reader->position;
+    REPEAT(blockCount, i)
+    {
+        const CachedUniformBlock* block = (const CachedUniformBlock*)
+            ReadFromProgramCache(reader, sizeof(CachedUniformBlock));
+        if(!block ||
+           block->memberCount < 0 ||
+           block->memberCount > reader->size ||
+           !ReadFromProgramCache(reader, sizeof(UniformBlockMember)*block->memberCount))
+            return false;
+    }
+    reader->position = start;
+
+    program->uniformBlockCount = 0;
+    program->uniformBlockIds = new int[blockCount];
+    REPEAT(blockCount, i)
+    {
+        const CachedUniformBlock* block = (const CachedUniformBlock*)
+            ReadFromProgramCache(reader, sizeof(CachedUniformBlock));
+        const UniformBlockMember* members = (const UniformBlockMember*)
+            ReadFromProgramCache(reader, sizeof(UniformBlockMember)*block->memberCount);
+
+        UniformBlock layout;
+        memset(&layout, 0, sizeof(UniformBlock));
+        CopyString(block->name, layout.name, sizeof(layout.name));
+        layout.nameHash = CalcShaderVariableNameHash(layout.name);
+        layout.size = block->size;
+        InitArray(&layout.members);
+        AppendToArray(&layout.members, block->memberCount, members);
+
+        const GLuint index = glGetUniformBlockIndex(program->handle, layout.name);
+        AddUniformBlock(program, index, &layout);
+    }
+    return true;
+}
+
+/**
+ * Tries to restore the program from a cached binary.  This skips compiling,
+ * linking and most of the introspection.
+ *
+ * Cache files which can't be used are deleted, so they're replaced once the
+ * program has been linked.
+ */
+static bool LoadProgramFromCache( ShaderProgram* program,
+                                  uint32_t key,
+                                  int sourceSize )
+{
+    const char* vfsPath = GetProgramCachePath(key);
+    if(GetVfsFileType(vfsPath) != FILE_TYPE_REGULAR)
+        return false;
+
+    VfsFile* file = OpenVfsFile(vfsPath, VFS_OPEN_READ);
+    ProgramCacheReader reader;
+    reader.size = GetVfsFileSize(file);
+    reader.position = 0;
+    char* data = (char*)Alloc(reader.size);
+    reader.data = data;
+    const bool complete = ReadVfsFile(file, data, reader.size) == reader.size;
+    CloseVfsFile(file);
+
+    const ProgramCacheHeader* header = (const ProgramCacheHeader*)
+        ReadFromProgramCache(&reader, sizeof(ProgramCacheHeader));
+    bool success = complete &&
+                   header &&
+                   header->magic == PROGRAM_CACHE_MAGIC &&
+                   header->version == PROGRAM_CACHE_VERSION &&
+                   header->key == key &&
+                   header->sourceSize == sourceSize &&
+                   header->uniformCount >= 0 &&
+                   header->uniformCount <= reader.size;
+
+    const void* binary = NULL;
+    const UniformDefinition* uniformDefinitions = NULL;
+    if(success)
+    {
+        binary = ReadFromProgramCache(&reader, header->binarySize);
+        uniformDefinitions = (const UniformDefinition*)
+            ReadFromProgramCache(&reader, sizeof(UniformDefinition)*header->uniformCount);
+        success = binary && uniformDefinitions;
+    }
+
+    if(success)
+    {
+        glProgramBinary(program->handle,
+                        header->binaryFormat,
+                        binary,
+                        header->binarySize);
+        GLint state;
+        glGetProgramiv(program->handle, GL_LINK_STATUS, &state);
+        if(!state)
+        {
+            LogInfo("Program binary %s has been rejected by the driver.", vfsPath);
+            success = false;
+        }
+    }
+
+    if(success)
+        success = ReadCachedUniformBlocks(program,
+                                          &reader,
+                                          header->uniformBlockCount);
+
+    if(success)
+    {
+        program->uniformCount = header->uniformCount;
+        program->uniformDefinitions = new UniformDefinition[header->uniformCount];
+        memcpy(program->uniformDefinitions,
+               uniformDefinitions,
+               sizeof(UniformDefinition)*header->uniformCount);
+        InitUniformValues(program);
+        ReadInstanceBlockDefinition(program);
+    }
+    else
+    {
+        LogInfo("Discarding program cache file %s", vfsPath);
+        DeleteVfsFile(vfsPath);
     }
+
+    Free(data);
+    return success;
+}
+
+static void SaveProgramToCache( const ShaderProgram* program,
+                                uint32_t key,
+                                int sourceSize )
+{
+    GLint binarySize = 0;
+    glGetProgramiv(program->handle, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+    if(binarySize <= 0)
+    {
+        LogWarning("Driver didn't provide a binary for the program.");
+        return;
+    }
+
+    char* binary = (char*)Alloc(binarySize);
+    GLenum binaryFormat = GL_NONE;
+    glGetProgramBinary(program->handle,
+                       binarySize,
+                       NULL,
+                       &binaryFormat,
+                       binary);
+
+    ProgramCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = PROGRAM_CACHE_MAGIC;
+    header.version = PROGRAM_CACHE_VERSION;
+    header.key = key;
+    header.sourceSize = sourceSize;
+    header.binaryFormat = binaryFormat;
+    header.binarySize = binarySize;
+    header.uniformCount = program->uniformCount;
+    header.uniformBlockCount = program->uniformBlockCount;
+
+    VfsFile* file = OpenVfsFile(GetProgramCachePath(key), VFS_OPEN_WRITE);
+    WriteVfsFile(file, &header, sizeof(header));
+    WriteVfsFile(file, binary, binarySize);
+    WriteVfsFile(file,
+                 program->uniformDefinitions,
+                 sizeof(UniformDefinition)*program->uniformCount);
+    REPEAT(program->uniformBlockCount, i)
+    {
+        const UniformBlock* block = &UniformBlocks.data[program->uniformBlockIds[i]];
+        CachedUniformBlock cachedBlock;
+        memset(&cachedBlock, 0, sizeof(cachedBlock));
+        CopyString(block->name, cachedBlock.name, sizeof(cachedBlock.name));
+        cachedBlock.size = block->size;
+        cachedBlock.memberCount = block->members.length;
+        WriteVfsFile(file, &cachedBlock, sizeof(cachedBlock));
+        WriteVfsFile(file,
+                     block->members.data,
+                     sizeof(UniformBlockMember)*block->members.length);
+    }
+    CloseVfsFile(file);
+
+    Free(binary);
+}
+
+
+struct LinkShaderProgramArgs
+{
+    Shader** shaders;
+    int shaderCount;
+    ShaderProgram* program;
+};
+
+static void LinkShaderProgramInRenderThread( void* data )
+{
+    LinkShaderProgramArgs* args = (LinkShaderProgramArgs*)data;
+    args->program = LinkShaderProgram(args->shaders, args->shaderCount);
 }
 
 ShaderProgram* LinkShaderProgram( Shader** shaders, int shaderCount )
 {
+    if(!InRenderThread())
+    {
+        LinkShaderProgramArgs args = {shaders, shaderCount, NULL};
+        RunInRenderThread(LinkShaderProgramInRenderThread, &args);
+        return args.program;
+    }
+
     REPEAT(shaderCount, i)
-        if(!shaders[i] || shaders[i]->handle == INVALID_SHADER_HANDLE)
+        if(!shaders[i])
             FatalError("Cannot link a shader program with invalid shaders.");
 
     ShaderProgram* program = new ShaderProgram;
@@ -522,8 +1195,24 @@ ShaderProgram* LinkShaderProgram( Shader** shaders, int shaderCount )
     program->variableSet = CreateShaderVariableSet();
 
     REPEAT(shaderCount, i)
-    {
         ReferenceShader(shaders[i]);
+
+    uint32_t cacheKey = 0;
+    int sourceSize = 0;
+    if(ProgramCacheEnabled)
+    {
+        cacheKey = CalcProgramCacheKey(shaders, shaderCount, &sourceSize);
+        if(LoadProgramFromCache(program, cacheKey, sourceSize))
+            return program;
+        glProgramParameteri(programHandle,
+                            GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                            GL_TRUE);
+    }
+
+    REPEAT(shaderCount, i)
+    {
+        if(shaders[i]->handle == INVALID_SHADER_HANDLE)
+            CompileShader(shaders[i]);
         glAttachShader(programHandle, shaders[i]->handle);
     }
 
@@ -561,19 +1250,34 @@ ShaderProgram* LinkShaderProgram( Shader** shaders, int shaderCount )
 
     ReadUniformDefinitions(program);
     ReadUniformBlockDefinitions(program);
+    ReadInstanceBlockDefinition(program);
 
     BindVertexAttributes(program->handle);
 
+    if(ProgramCacheEnabled)
+        SaveProgramToCache(program, cacheKey, sourceSize);
+
     return program;
 }
 
+static void FreeShaderProgramInRenderThread( void* data )
+{
+    FreeShaderProgram((ShaderProgram*)data);
+}
+
 static void FreeShaderProgram( ShaderProgram* program )
 {
     assert(InSerialPhase());
+    if(!InRenderThread())
+    {
+        RunInRenderThread(FreeShaderProgramInRenderThread, program);
+        return;
+    }
 
     FreeReferenceCounter(&program->refCounter);
 
     glDeleteProgram(program->handle);
+    ForgetProgram(program->handle);
 
     REPEAT(program->shaderCount, i)
         ReleaseShader(program->shaders[i]);
@@ -585,6 +1289,12 @@ static void FreeShaderProgram( ShaderProgram* program )
     if(program->currentUniformValues)
         delete[] program->currentUniformValues;
 
+    if(program->samplerUniformIndices)
+        delete[] program->samplerUniformIndices;
+
+    if(program->uniformBlockIds)
+        delete[] program->uniformBlockIds;
+
     FreeShaderVariableSet(program->variableSet);
 
     delete program;
@@ -602,15 +1312,9 @@ void ReleaseShaderProgram( ShaderProgram* program )
         FreeShaderProgram(program);
 }
 
-static ShaderProgram* CurrentShaderProgram = NULL;
-
 void BindShaderProgram( ShaderProgram* program )
 {
-    if(program != CurrentShaderProgram)
-    {
-        glUseProgram(program->handle);
-        CurrentShaderProgram = program;
-    }
+    UseProgram(program->handle);
 }
 
 ShaderVariableSet* GetShaderProgramShaderVariableSet( const ShaderProgram* program )
@@ -628,7 +1332,7 @@ static int GetUniformIndexByNameHash( const ShaderProgram* program, uint32_t nam
 
 static int GetUniformIndexByName( const ShaderProgram* program, const char* name )
 {
-    return GetUniformIndexByNameHash(program, CalcCrc32ForString(name));
+    return GetUniformIndexByNameHash(program, CalcShaderVariableNameHash(name));
 }
 
 bool HasUniform( const ShaderProgram* program, const char* name )
@@ -636,6 +1340,38 @@ bool HasUniform( const ShaderProgram* program, const char* name )
     return GetUniformIndexByName(program, name) != INVALID_UNIFORM_INDEX;
 }
 
+bool HasUniformByHash( const ShaderProgram* program, uint32_t nameHash )
+{
+    return GetUniformIndexByNameHash(program, nameHash) != INVALID_UNIFORM_INDEX;
+}
+
+bool ShaderProgramSupportsInstancing( const ShaderProgram* program )
+{
+    return program->supportsInstancing;
+}
+
+bool ShaderProgramSupportsMultiDraw( const ShaderProgram* program )
+{
+    return program->supportsMultiDraw;
+}
+
+void SetInstanceTransformations( const InstanceTransformation* instances,
+                                 int instanceCount )
+{
+    assert(instanceCount >= 1 && instanceCount <= MAX_DRAW_INSTANCES);
+    BindBuffer(GL_UNIFORM_BUFFER, InstanceBuffer);
+    // Orphan the old storage, so the driver doesn't need to wait for
+    // previous draw calls, which still use it:
+    glBufferData(GL_UNIFORM_BUFFER,
+                 sizeof(InstanceTransformation)*MAX_DRAW_INSTANCES,
+                 NULL,
+                 GL_STREAM_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER,
+                    0,
+                    sizeof(InstanceTransformation)*instanceCount,
+                    instances);
+}
+
 static bool UniformValuesAreEqual( const UniformDefinition* definition,
                                    const UniformValue* a,
                                    const UniformValue* b )
@@ -691,6 +1427,7 @@ ShaderProgramSet* CreateShaderProgramSet( ShaderProgram* defaultProgram )
     ShaderProgramSet* set = new ShaderProgramSet;
     memset(set, 0, sizeof(ShaderProgramSet));
     InitReferenceCounter(&set->refCounter);
+    InitArray(&set->resolvedPrograms);
     SetShaderProgramFamily(set, "default", defaultProgram);
     return set;
 }
@@ -707,6 +1444,7 @@ static void FreeShaderProgramSet( ShaderProgramSet* set )
             ReleaseShaderProgram(program);
     }
 
+    DestroyArray(&set->resolvedPrograms);
     delete set;
 }
 
@@ -764,45 +1502,42 @@ void SetShaderProgramFamily( ShaderProgramSet* set,
     entry->program = program;
     if(entry->program)
         ReferenceShaderProgram(entry->program);
+
+    // Invalidate cached resolutions:
+    ClearArray(&set->resolvedPrograms);
 }
 
 ShaderProgram* GetShaderProgramByFamilyList( const ShaderProgramSet* set,
                                              const char* familyList )
 {
-    assert(strlen(familyList) <= MAX_PROGRAM_FAMILY_SIZE-1);
+    assert(strlen(familyList) <= MAX_PROGRAM_FAMILY_LIST_SIZE-1);
 
     char family[MAX_PROGRAM_FAMILY_SIZE];
-    char* familyChar = family;
     const char* c = familyList;
     const ShaderProgramSetEntry* entry = NULL;
 
     while(true)
     {
-        bool stop = false;
-        switch(*c)
+        // Extract the next family name:
+        const char* familyEnd = strchr(c, ',');
+        if(!familyEnd)
+            familyEnd = c + strlen(c);
+        const int familyLength = familyEnd - c;
+
+        // Families which don't fit into an entry can't match any:
+        if(familyLength <= MAX_PROGRAM_FAMILY_SIZE-1)
         {
-            case '\0':
-                stop = true;
+            memcpy(family, c, familyLength);
+            family[familyLength] = '\0';
 
-            case ',':
-                *familyChar = '\0';
-
-                entry = FindShaderProgramSetEntry(set, family);
-                if(entry)
-                    return entry->program;
-
-                familyChar = family;
-                break;
-
-            default:
-                *familyChar = *c;
+            entry = FindShaderProgramSetEntry(set, family);
+            if(entry)
+                return entry->program;
         }
 
-        if(stop)
+        if(*familyEnd == '\0')
             break;
-
-        familyChar++;
-        c++;
+        c = familyEnd + 1;
     }
 
     entry = FindShaderProgramSetEntry(set, "default");
@@ -812,22 +1547,229 @@ ShaderProgram* GetShaderProgramByFamilyList( const ShaderProgramSet* set,
         return NULL;
 }
 
+ProgramFamilyListId InternProgramFamilyList( const char* familyList )
+{
+    assert(InSerialPhase());
+
+    REPEAT(ProgramFamilyLists.length, i)
+        if(strcmp(ProgramFamilyLists.data[i].families, familyList) == 0)
+            return i;
+
+    ProgramFamilyList* list = AllocateAtEndOfArray(&ProgramFamilyLists, 1);
+    if(!CopyString(familyList, list->families, sizeof(list->families)))
+        FatalError("Program family list '%s' is too long.", familyList);
+    return ProgramFamilyLists.length-1;
+}
+
+ShaderProgram* GetShaderProgramByFamilyListId( ShaderProgramSet* set,
+                                               ProgramFamilyListId id )
+{
+    assert(id >= 0 && id < ProgramFamilyLists.length);
+
+    Array<ResolvedProgram>* resolvedPrograms = &set->resolvedPrograms;
+    if(id >= resolvedPrograms->length)
+    {
+        const int newEntries = id - resolvedPrograms->length + 1;
+        ResolvedProgram* entries = AllocateAtEndOfArray(resolvedPrograms,
+                                                        newEntries);
+        memset(entries, 0, sizeof(ResolvedProgram)*newEntries);
+    }
+
+    ResolvedProgram* resolvedProgram = &resolvedPrograms->data[id];
+    if(!resolvedProgram->resolved)
+    {
+        resolvedProgram->program =
+            GetShaderProgramByFamilyList(set,
+                                         ProgramFamilyLists.data[id].families);
+        resolvedProgram->resolved = true;
+    }
+    return resolvedProgram->program;
+}
+
 // ---- UniformBuffer ----
 
-UniformBuffer* CreateUniformBuffer()
+static void FreeUniformBuffer( UniformBuffer* buffer );
+static const ShaderVariable* FindConstShaderVariableByNameHash( const ShaderVariableSet* set,
+                                                                uint32_t nameHash );
+
+UniformBuffer* CreateUniformBuffer( const ShaderVariableSet* variableSet )
+{
+    assert(InSerialPhase());
+    UniformBuffer* buffer = new UniformBuffer;
+    memset(buffer, 0, sizeof(UniformBuffer));
+    InitReferenceCounter(&buffer->refCounter);
+    buffer->variableSet = variableSet;
+    buffer->blockId = INVALID_UNIFORM_BLOCK_ID;
+    buffer->dirty = true;
+    return buffer;
+}
+
+static void FreeUniformBufferInRenderThread( void* data )
+{
+    FreeUniformBuffer((UniformBuffer*)data);
+}
+
+static void FreeUniformBuffer( UniformBuffer* buffer )
 {
     assert(InSerialPhase());
-    return NULL; // TODO
+    if(buffer->handle && !InRenderThread())
+    {
+        RunInRenderThread(FreeUniformBufferInRenderThread, buffer);
+        return;
+    }
+
+    FreeReferenceCounter(&buffer->refCounter);
+    if(buffer->handle)
+    {
+        glDeleteBuffers(1, &buffer->handle);
+        ForgetBuffer(buffer->handle);
+    }
+    if(buffer->data)
+        Free(buffer->data);
+    delete buffer;
 }
 
 void ReferenceUniformBuffer( UniformBuffer* buffer )
 {
-    // TODO
+    Reference(&buffer->refCounter);
 }
 
 void ReleaseUniformBuffer( UniformBuffer* buffer )
 {
-    // TODO
+    Release(&buffer->refCounter);
+    if(!HasReferences(&buffer->refCounter))
+        FreeUniformBuffer(buffer);
+}
+
+void UpdateUniformBuffer( UniformBuffer* buffer )
+{
+    buffer->dirty = true;
+}
+
+/**
+ * Copies a value into the buffer data using the members layout.
+ *
+ * @return
+ * Whether the buffer data changed.
+ */
+static bool WriteUniformBufferMember( UniformBuffer* buffer,
+                                      const UniformBlockMember* member,
+                                      const UniformValue* value )
+{
+    int columnCount = 1;
+    int columnSize = 0;
+    switch(member->type)
+    {
+        case INT_UNIFORM:
+        case SAMPLER_UNIFORM:
+        case FLOAT_UNIFORM:
+            columnSize = sizeof(float);
+            break;
+
+        case VEC3_UNIFORM:
+            columnSize = sizeof(Vec3);
+            break;
+
+        case MAT3_UNIFORM:
+            columnCount = 3;
+            columnSize = sizeof(float)*3;
+            break;
+
+        case MAT4_UNIFORM:
+            columnCount = 4;
+            columnSize = sizeof(float)*4;
+            break;
+    }
+
+    bool changed = false;
+    const char* source = (const char*)value;
+    REPEAT(columnCount, i)
+    {
+        char* destination =
+            &buffer->data[member->offset + member->matrixStride*i];
+        assert(destination + columnSize <= buffer->data + buffer->size);
+        if(memcmp(destination, source, columnSize) != 0)
+        {
+            memcpy(destination, source, columnSize);
+            changed = true;
+        }
+        source += columnSize;
+    }
+    return changed;
+}
+
+/**
+ * Refills a dirty buffer from its variable set and uploads it, if something
+ * changed.
+ */
+static void UploadUniformBuffer( UniformBuffer* buffer, int blockId )
+{
+    const UniformBlock* block = &UniformBlocks.data[blockId];
+
+    if(buffer->blockId != blockId)
+    {
+        if(buffer->blockId != INVALID_UNIFORM_BLOCK_ID)
+            FatalError("Uniform buffer %p provides block %s, so it can't be used for block %s.",
+                       buffer,
+                       UniformBlocks.data[buffer->blockId].name,
+                       block->name);
+
+        buffer->blockId = blockId;
+        buffer->size = block->size;
+        buffer->data = (char*)Alloc(block->size);
+        memset(buffer->data, 0, block->size);
+
+        glGenBuffers(1, &buffer->handle);
+        BindBuffer(GL_UNIFORM_BUFFER, buffer->handle);
+        glBufferData(GL_UNIFORM_BUFFER, block->size, buffer->data, GL_DYNAMIC_DRAW);
+    }
+
+    if(!buffer->dirty)
+        return;
+    buffer->dirty = false;
+
+    bool changed = false;
+    REPEAT(block->members.length, i)
+    {
+        const UniformBlockMember* member = &block->members.data[i];
+        const ShaderVariable* var =
+            FindConstShaderVariableByNameHash(buffer->variableSet,
+                                              member->nameHash);
+        if(!var)
+            FatalError("Can\'t set uniform %s of block %s:  Not available in the buffers ShaderVariableSet.",
+                       member->name, block->name);
+
+        switch(var->type)
+        {
+            case UNUSED_VARIABLE:
+                break;
+
+            case UNIFORM_VARIABLE:
+                if(WriteUniformBufferMember(buffer, member, &var->value.uniform.value))
+                    changed = true;
+                break;
+
+            case TEXTURE_VARIABLE:
+            case UNIFORM_BUFFER_VARIABLE:
+                FatalError("Uniform %s of block %s must be a plain uniform.",
+                           member->name, block->name);
+        }
+    }
+
+    if(changed)
+    {
+        BindBuffer(GL_UNIFORM_BUFFER, buffer->handle);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, buffer->size, buffer->data);
+    }
+}
+
+static void BindUniformBuffer( UniformBuffer* buffer, int blockId )
+{
+    UploadUniformBuffer(buffer, blockId);
+
+    BindBufferBase(GL_UNIFORM_BUFFER,
+                   FIRST_UNIFORM_BLOCK_BINDING + blockId,
+                   buffer->handle);
 }
 
 
@@ -876,26 +1818,128 @@ static void FreeShaderVariable( ShaderVariable* var )
 void ClearShaderVariableSet( ShaderVariableSet* set )
 {
     assert(InSerialPhase());
-    REPEAT(MAX_SHADER_VARIABLE_SET_ENTRIES, i)
-        FreeShaderVariable(&set->entries[i]);
+    REPEAT(SHADER_VARIABLE_SET_SLOTS, i)
+        FreeShaderVariable(&set->slots[i]);
+    set->entryCount = 0;
 }
 
-static ShaderVariable* FindShaderVariableByNameHash( ShaderVariableSet* set,
-                                                     uint32_t nameHash )
+static int GetShaderVariableHomeSlot( uint32_t nameHash )
 {
-    REPEAT(MAX_SHADER_VARIABLE_SET_ENTRIES, i)
-        if(set->entries[i].nameHash == nameHash)
-            return &set->entries[i];
-    return NULL;
+    return (int)(nameHash & (SHADER_VARIABLE_SET_SLOTS-1));
+}
+
+static int GetNextShaderVariableSlot( int slot )
+{
+    return (slot+1) & (SHADER_VARIABLE_SET_SLOTS-1);
+}
+
+/**
+ * Probes the set for the given name hash.
+ *
+ * @return
+ * The slot which contains the variable or the empty slot at which the
+ * variable would be inserted.  Since the set is never full, the search
+ * always terminates.
+ */
+static int FindShaderVariableSlot( const ShaderVariableSet* set,
+                                   uint32_t nameHash )
+{
+    assert(nameHash != 0);
+    int slot = GetShaderVariableHomeSlot(nameHash);
+    while(set->slots[slot].nameHash != nameHash &&
+          set->slots[slot].nameHash != 0)
+        slot = GetNextShaderVariableSlot(slot);
+    return slot;
 }
 
 static const ShaderVariable* FindConstShaderVariableByNameHash( const ShaderVariableSet* set,
                                                                 uint32_t nameHash )
 {
-    REPEAT(MAX_SHADER_VARIABLE_SET_ENTRIES, i)
-        if(set->entries[i].nameHash == nameHash)
-            return &set->entries[i];
-    return NULL;
+    const ShaderVariable* var = &set->slots[FindShaderVariableSlot(set, nameHash)];
+    if(var->nameHash)
+        return var;
+    else
+        return NULL;
+}
+
+/**
+ * Frees the variable in the given slot and moves following entries of the
+ * probe sequence back, so no lookups are broken by the empty slot.
+ */
+static void RemoveShaderVariable( ShaderVariableSet* set, int slot )
+{
+    FreeShaderVariable(&set->slots[slot]);
+    set->entryCount--;
+
+    int emptySlot = slot;
+    for(int i = GetNextShaderVariableSlot(slot);
+        set->slots[i].nameHash != 0;
+        i = GetNextShaderVariableSlot(i))
+    {
+        ShaderVariable* var = &set->slots[i];
+        const int homeSlot = GetShaderVariableHomeSlot(var->nameHash);
+
+        // Entries may stay, if their home slot lies cyclically in (emptySlot, i]:
+        const bool canStay = (emptySlot <= i) ?
+            (emptySlot < homeSlot && homeSlot <= i) :
+            (emptySlot < homeSlot || homeSlot <= i);
+        if(!canStay)
+        {
+            set->slots[emptySlot] = *var;
+            memset(var, 0, sizeof(ShaderVariable)); // Value moved, don't release.
+            emptySlot = i;
+        }
+    }
+}
+
+static bool ShaderVariablesAreEqual( const ShaderVariable* a,
+                                     const ShaderVariable* b )
+{
+    if(a->type != b->type)
+        return false;
+
+    switch(a->type)
+    {
+        case UNUSED_VARIABLE:
+            return true;
+
+        case UNIFORM_VARIABLE:
+            return a->value.uniform.type == b->value.uniform.type &&
+                   memcmp(&a->value.uniform.value,
+                          &b->value.uniform.value,
+                          GetUniformSize(a->value.uniform.type)) == 0;
+
+        case TEXTURE_VARIABLE:
+            return a->value.texture == b->value.texture;
+
+        case UNIFORM_BUFFER_VARIABLE:
+            return a->value.uniformBuffer == b->value.uniformBuffer;
+    }
+    FatalError("Unknown ShaderVariableType!");
+    return false;
+}
+
+bool ShaderVariableSetsAreEqual( const ShaderVariableSet* a,
+                                 const ShaderVariableSet* b )
+{
+    if(a == b)
+        return true;
+
+    if(a->entryCount != b->entryCount)
+        return false;
+
+    REPEAT(SHADER_VARIABLE_SET_SLOTS, i)
+    {
+        const ShaderVariable* aVar = &a->slots[i];
+        if(!aVar->nameHash)
+            continue;
+
+        const ShaderVariable* bVar =
+            FindConstShaderVariableByNameHash(b, aVar->nameHash);
+        if(!bVar || !ShaderVariablesAreEqual(aVar, bVar))
+            return false;
+    }
+    return true;
 }
 
 static const ShaderVariable* FindConstShaderVariableInSetsByNameHash( const ShaderVariableSet** set,
@@ -904,6 +1948,8 @@ static const ShaderVariable* FindConstShaderVariableInSetsByNameHash( const Shad
 {
     REPEAT(setCount, i)
     {
+        if(set[i]->entryCount == 0)
+            continue;
         const ShaderVariable* var = FindConstShaderVariableByNameHash(set[i], nameHash);
         if(var)
             return var;
@@ -911,102 +1957,173 @@ static const ShaderVariable* FindConstShaderVariableInSetsByNameHash( const Shad
     return NULL;
 }
 
+uint32_t CalcShaderVariableNameHash( const char* name )
+{
+    return CalcCrc32ForString(name);
+}
+
+uint32_t CalcShaderVariableArrayElementNameHash( uint32_t arrayNameHash,
+                                                 int index )
+{
+    assert(index >= 0);
+
+    // Build the `[index]` suffix backwards:
+    char buffer[16];
+    char* suffix = &buffer[sizeof(buffer)];
+    *--suffix = ']';
+    do
+    {
+        *--suffix = '0' + index % 10;
+        index /= 10;
+    } while(index > 0);
+    *--suffix = '[';
+
+    const int suffixLength = &buffer[sizeof(buffer)] - suffix;
+    return ContinueCrc32(arrayNameHash, suffix, suffixLength);
+}
+
+void InitUniformArrayName( UniformArrayName* arrayName,
+                           const char* name,
+                           int length )
+{
+    assert(length >= 0 && length <= MAX_UNIFORM_ARRAY_SIZE);
+    const uint32_t nameHash = CalcShaderVariableNameHash(name);
+    arrayName->length = length;
+    REPEAT(length, i)
+        arrayName->elementNameHashes[i] =
+            CalcShaderVariableArrayElementNameHash(nameHash, i);
+}
+
 static ShaderVariable* PrepareNewShaderVariable( ShaderVariableSet* set,
-                                                 const char* name,
+                                                 uint32_t nameHash,
                                                  ShaderVariableType type )
 {
-    uint32_t nameHash = CalcCrc32ForString(name);
-    ShaderVariable* var = FindShaderVariableByNameHash(set, nameHash);
-    if(!var)
+    ShaderVariable* var = &set->slots[FindShaderVariableSlot(set, nameHash)];
+    if(!var->nameHash)
     {
-        var = FindShaderVariableByNameHash(set, 0);
-        if(!var)
+        if(set->entryCount >= MAX_SHADER_VARIABLE_SET_ENTRIES)
             FatalError("Too many entries for shader variable set %p.", set);
+        set->entryCount++;
     }
     FreeShaderVariable(var);
 
     var->nameHash = nameHash;
-    CopyString(name, var->name, sizeof(var->name));
     var->type = type;
 
     return var;
 }
 
-void SetUnusedShaderVariable( ShaderVariableSet* set, const char* name )
+void SetUnusedShaderVariableByHash( ShaderVariableSet* set, uint32_t nameHash )
 {
-    PrepareNewShaderVariable(set, name, UNUSED_VARIABLE);
+    PrepareNewShaderVariable(set, nameHash, UNUSED_VARIABLE);
     // No further processing required.
 }
 
+void SetUnusedShaderVariable( ShaderVariableSet* set, const char* name )
+{
+    SetUnusedShaderVariableByHash(set, CalcShaderVariableNameHash(name));
+}
+
 static void SetUniformVariable( ShaderVariableSet* set,
-                                const char* name,
+                                uint32_t nameHash,
                                 UniformType type,
                                 const void* value )
 {
-    ShaderVariable* var = PrepareNewShaderVariable(set, name, UNIFORM_VARIABLE);
+    ShaderVariable* var = PrepareNewShaderVariable(set, nameHash, UNIFORM_VARIABLE);
     var->value.uniform.type = type;
     memcpy(&var->value.uniform.value, value, GetUniformSize(type));
 }
 
+void SetIntUniformByHash( ShaderVariableSet* set, uint32_t nameHash, int value )
+{
+    SetUniformVariable(set, nameHash, INT_UNIFORM, &value);
+}
+
+void SetFloatUniformByHash( ShaderVariableSet* set, uint32_t nameHash, float value )
+{
+    SetUniformVariable(set, nameHash, FLOAT_UNIFORM, &value);
+}
+
+void SetVec3UniformByHash( ShaderVariableSet* set, uint32_t nameHash, Vec3 value )
+{
+    SetUniformVariable(set, nameHash, VEC3_UNIFORM, &value);
+}
+
+void SetMat3UniformByHash( ShaderVariableSet* set, uint32_t nameHash, Mat3 value )
+{
+    SetUniformVariable(set, nameHash, MAT3_UNIFORM, &value);
+}
+
+void SetMat4UniformByHash( ShaderVariableSet* set, uint32_t nameHash, Mat4 value )
+{
+    SetUniformVariable(set, nameHash, MAT4_UNIFORM, &value);
+}
+
 void SetIntUniform( ShaderVariableSet* set, const char* name, int value )
 {
-    SetUniformVariable(set, name, INT_UNIFORM, &value);
+    SetIntUniformByHash(set, CalcShaderVariableNameHash(name), value);
 }
 
 void SetFloatUniform( ShaderVariableSet* set, const char* name, float value )
 {
-    SetUniformVariable(set, name, FLOAT_UNIFORM, &value);
+    SetFloatUniformByHash(set, CalcShaderVariableNameHash(name), value);
 }
 
 void SetVec3Uniform( ShaderVariableSet* set, const char* name, Vec3 value )
 {
-    SetUniformVariable(set, name, VEC3_UNIFORM, &value);
+    SetVec3UniformByHash(set, CalcShaderVariableNameHash(name), value);
 }
 
 void SetMat3Uniform( ShaderVariableSet* set, const char* name, Mat3 value )
 {
-    SetUniformVariable(set, name, MAT3_UNIFORM, &value);
+    SetMat3UniformByHash(set, CalcShaderVariableNameHash(name), value);
 }
 
 void SetMat4Uniform( ShaderVariableSet* set, const char* name, Mat4 value )
 {
-    SetUniformVariable(set, name, MAT4_UNIFORM, &value);
+    SetMat4UniformByHash(set, CalcShaderVariableNameHash(name), value);
 }
 
 void SetTexture( ShaderVariableSet* set, const char* name, Texture* texture )
 {
-    ShaderVariable* var = PrepareNewShaderVariable(set, name, TEXTURE_VARIABLE);
+    ShaderVariable* var = PrepareNewShaderVariable(set,
+                                                   CalcShaderVariableNameHash(name),
+                                                   TEXTURE_VARIABLE);
     ReferenceTexture(texture);
     var->value.texture = texture;
 }
 
 void SetUniformBuffer( ShaderVariableSet* set, const char* name, UniformBuffer* buffer )
 {
-    ShaderVariable* var = PrepareNewShaderVariable(set, name, UNIFORM_BUFFER_VARIABLE);
+    ShaderVariable* var = PrepareNewShaderVariable(set,
+                                                   CalcShaderVariableNameHash(name),
+                                                   UNIFORM_BUFFER_VARIABLE);
     ReferenceUniformBuffer(buffer);
     var->value.uniformBuffer = buffer;
 }
 
 void UnsetShaderVariable( ShaderVariableSet* set, const char* name )
 {
-    uint32_t nameHash = CalcCrc32ForString(name);
-    ShaderVariable* entry = FindShaderVariableByNameHash(set, nameHash);
-    if(entry)
-        FreeShaderVariable(entry);
+    const uint32_t nameHash = CalcShaderVariableNameHash(name);
+    const int slot = FindShaderVariableSlot(set, nameHash);
+    if(set->slots[slot].nameHash)
+        RemoveShaderVariable(set, slot);
 }
 
 void CopyShaderVariablesAsArrayElements( ShaderVariableSet* destinationSet,
                                          const ShaderVariableSet* sourceSet,
                                          int arrayIndex )
 {
-    REPEAT(MAX_SHADER_VARIABLE_SET_ENTRIES, i)
+    REPEAT(SHADER_VARIABLE_SET_SLOTS, i)
     {
-        const ShaderVariable* sourceVar = &sourceSet->entries[i];
+        const ShaderVariable* sourceVar = &sourceSet->slots[i];
         if(sourceVar->nameHash)
         {
-            const char* newName = Format("%s[%d]", sourceVar->name, arrayIndex);
+            const uint32_t newNameHash =
+                CalcShaderVariableArrayElementNameHash(sourceVar->nameHash,
+                                                       arrayIndex);
             ShaderVariable* destinationVar =
-                PrepareNewShaderVariable(destinationSet, newName, sourceVar->type);
+                PrepareNewShaderVariable(destinationSet, newNameHash, sourceVar->type);
             destinationVar->value = sourceVar->value;
         }
     }
@@ -1051,22 +2168,20 @@ void GatherShaderVariableBindings( const ShaderProgram* program,
                                    int variableSetCount )
 {
     memset(bindings, 0, sizeof(ShaderVariableBindings));
-    REPEAT(program->uniformCount, i)
+    REPEAT(program->samplerCount, i)
     {
-        const UniformDefinition* definition = &program->uniformDefinitions[i];
-        if(definition->type == SAMPLER_UNIFORM)
-        {
-            const ShaderVariable* var =
-                FindConstShaderVariableInSetsByNameHash(variableSets,
-                                                        variableSetCount,
-                                                        definition->nameHash);
-            if(!var)
-                FatalError("Can\'t bind uniform %s:  Not available in any ShaderVariableSet.", definition->name);
-
-            assert(var->type == TEXTURE_VARIABLE);
-            AddTextureBinding(bindings,
-                              var->value.texture);
-        }
+        const int uniformIndex = program->samplerUniformIndices[i];
+        const UniformDefinition* definition = &program->uniformDefinitions[uniformIndex];
+        const ShaderVariable* var =
+            FindConstShaderVariableInSetsByNameHash(variableSets,
+                                                    variableSetCount,
+                                                    definition->nameHash);
+        if(!var)
+            FatalError("Can\'t bind uniform %s:  Not available in any ShaderVariableSet.", definition->name);
+
+        assert(var->type == TEXTURE_VARIABLE);
+        AddTextureBinding(bindings,
+                          var->value.texture);
     }
 
     // Sort texture bindings:
@@ -1077,6 +2192,7 @@ void GatherShaderVariableBindings( const ShaderProgram* program,
 }
 
 static int GetTextureUnit( const ShaderVariableBindings* bindings,
+                           const UniformDefinition* definition,
                            const ShaderVariable* var )
 {
     REPEAT(bindings->textureCount, i)
@@ -1084,7 +2200,7 @@ static int GetTextureUnit( const ShaderVariableBindings* bindings,
             return i;
     FatalError("No binding was generated for texture %p from uniform %s.",
                var->value.texture,
-               var->name);
+               definition->name);
     return 0;
 }
 
@@ -1114,7 +2230,7 @@ void SetShaderProgramUniforms( ShaderProgram* program,
 
             case TEXTURE_VARIABLE:
                 UniformValue v;
-                v.i = GetTextureUnit(bindings, var);
+                v.i = GetTextureUnit(bindings, definition, var);
                 SetUniform(program, i, &v);
                 break;
 
@@ -1122,4 +2238,30 @@ void SetShaderProgramUniforms( ShaderProgram* program,
                 FatalError("Uniform blocks are no uniforms.");
         }
     }
+
+    REPEAT(program->uniformBlockCount, i)
+    {
+        const int blockId = program->uniformBlockIds[i];
+        const UniformBlock* block = &UniformBlocks.data[blockId];
+        const ShaderVariable* var =
+            FindConstShaderVariableInSetsByNameHash(variableSets,
+                                                    variableSetCount,
+                                                    block->nameHash);
+        if(!var)
+            FatalError("Can\'t bind uniform block %s:  Not available in any ShaderVariableSet.", block->name);
+
+        switch(var->type)
+        {
+            case UNUSED_VARIABLE:
+                break;
+
+            case UNIFORM_BUFFER_VARIABLE:
+                BindUniformBuffer(var->value.uniformBuffer, blockId);
+                break;
+
+            case UNIFORM_VARIABLE:
+            case TEXTURE_VARIABLE:
+                FatalError("Uniform block %s needs a uniform buffer.", block->name);
+        }
+    }
 }
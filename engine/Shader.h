@@ -1,12 +1,25 @@
 #ifndef __KONSTRUKT_SHADER__
 #define __KONSTRUKT_SHADER__
 
+#include <stdint.h> // uint32_t
+
 #include "Math.h"
+#include "Crc32.h"
 #include "Texture.h"
 
 
 static const int MAX_UNIFORM_NAME_SIZE = 32;
 static const int MAX_PROGRAM_FAMILY_LIST_SIZE = 128;
+static const int MAX_UNIFORM_ARRAY_SIZE = 32;
+static const int INVALID_PROGRAM_FAMILY_LIST_ID = -1;
+
+/**
+ * Maximum number of instances, which can be rendered with one instanced
+ * draw call.
+ *
+ * @see InstanceTransformation
+ */
+static const int MAX_DRAW_INSTANCES = 64;
 
 
 /**
@@ -46,11 +59,24 @@ struct ShaderProgramSet;
 /**
  * Stores uniform variables.
  *
+ * Uniform buffers provide the variables of a #ShaderVariableSet to uniform
+ * blocks.  Unlike plain uniforms, which need to be set for each program,
+ * a buffer is filled once and can then be used by all programs.
+ *
  * This is just a brief summary, the complete documentation is available at
  * https://www.opengl.org/wiki/Uniform_Buffer_Object
  */
 struct UniformBuffer;
 
+/**
+ * Identifies an interned program family list.
+ *
+ * Program sets cache the program, which they resolved for a family list id.
+ *
+ * @see InternProgramFamilyList
+ */
+typedef int ProgramFamilyListId;
+
 /**
  *
  */
@@ -71,19 +97,73 @@ struct ShaderVariableBindings
     Texture* textures[MAX_TEXTURE_UNITS];
 };
 
+/**
+ * Name hashes of the elements of an array uniform.
+ *
+ * Formatting and hashing element names like `lightPosition[3]` is too
+ * expensive for code which runs for every model in each frame.  Such code
+ * should prepare the element names once using #InitUniformArrayName.
+ */
+struct UniformArrayName
+{
+    int length;
+    uint32_t elementNameHashes[MAX_UNIFORM_ARRAY_SIZE];
+};
+
+/**
+ * Per instance data of an instanced draw call.
+ *
+ * Programs which support instancing declare this uniform block:
+ *
+ *     struct Instance
+ *     {
+ *         mat4 Model;
+ *         mat4 ModelView;
+ *         mat4 ModelViewProjection;
+ *     };
+ *
+ *     layout(std140) uniform InstanceTransformations
+ *     {
+ *         Instance Instances[64]; // See MAX_DRAW_INSTANCES
+ *     };
+ *
+ * and use `Instances[gl_InstanceID]` instead of the model uniforms.
+ *
+ * Programs can also declare the vertex attribute `in int InstanceIndex;`
+ * and use `Instances[InstanceIndex]`.  Models with different meshes can
+ * then be drawn using one indirect multi draw call.
+ *
+ * @see ShaderProgramSupportsMultiDraw
+ */
+struct InstanceTransformation
+{
+    Mat4 model;
+    Mat4 modelView;
+    Mat4 modelViewProjection;
+};
+
 
 void InitShader();
 void DestroyShader();
 
 ShaderVariableSet* GetGlobalShaderVariableSet();
 
+/**
+ * Provides the global variables to the uniform block `Global`.
+ *
+ * @see UpdateUniformBuffer
+ */
+UniformBuffer* GetGlobalUniformBuffer();
+
 /**
  * Creates a shader by reading the given `vfsPath`.
  * The shader type is determined by the file extension automatically.
  *
+ * The shader is compiled when it's needed by #LinkShaderProgram, so errors in
+ * the source are reported there.
+ *
  * @return
- * May return `NULL` if the type could not be determined or
- * if the shader source was erroneous.
+ * May return `NULL` if the type could not be determined.
  */
 Shader* LoadShader( const char* vfsPath );
 
@@ -93,6 +173,13 @@ void ReleaseShader( Shader* shader );
 /**
  * Links the given `shaders` into a shader program.
  *
+ * Linked programs are stored in the program cache, which resides in
+ * `shared-state/program-cache`.  Cache entries are keyed by the shader
+ * sources and the driver version.  Programs which are found in the cache
+ * are restored from their binary, so neither compiling nor linking is
+ * necessary.  If the driver rejects a binary the program is built from
+ * source again.  The cache can be disabled with `opengl.program-cache`.
+ *
  * @return
  * `NULL` if and error occured during linkage.
  */
@@ -109,6 +196,32 @@ void BindShaderProgram( ShaderProgram* program );
 ShaderVariableSet* GetShaderProgramShaderVariableSet( const ShaderProgram* program );
 
 bool HasUniform( const ShaderProgram* program, const char* name );
+bool HasUniformByHash( const ShaderProgram* program, uint32_t nameHash );
+
+/**
+ * Whether the program declares the `InstanceTransformations` block.
+ *
+ * Such programs are always rendered using instanced draw calls.
+ *
+ * @see InstanceTransformation
+ */
+bool ShaderProgramSupportsInstancing( const ShaderProgram* program );
+
+/**
+ * Whether the program supports instancing and reads the instance
+ * transformations using the `InstanceIndex` attribute.
+ *
+ * @see InstanceTransformation
+ * @see IndirectMultiDrawIsSupported
+ */
+bool ShaderProgramSupportsMultiDraw( const ShaderProgram* program );
+
+/**
+ * Uploads the transformations, which are used by the next instanced draw
+ * call.
+ */
+void SetInstanceTransformations( const InstanceTransformation* instances,
+                                 int instanceCount );
 
 
 /**
@@ -132,6 +245,8 @@ void SetShaderProgramFamily( ShaderProgramSet* set,
  * 1. If a matching entry is found, the program will be returned.
  * 2. If no family matched, it uses the default #ShaderProgram.
  *
+ * Family names, which are too long to be stored in a set, never match.
+ *
  * @param familyList
  * A list of family names, separated by commas.
  * E.g. `animated,static`
@@ -139,12 +254,55 @@ void SetShaderProgramFamily( ShaderProgramSet* set,
 ShaderProgram* GetShaderProgramByFamilyList( const ShaderProgramSet* set,
                                              const char* familyList );
 
+/**
+ * Returns the id of the given family list.
+ * Equal family lists yield equal ids.
+ *
+ * Interned lists are kept until the shader module is destroyed, so this
+ * should only be called when a family list is assigned - not per frame.
+ */
+ProgramFamilyListId InternProgramFamilyList( const char* familyList );
+
+/**
+ * Like #GetShaderProgramByFamilyList, but the result is cached in the set
+ * until #SetShaderProgramFamily modifies it.
+ */
+ShaderProgram* GetShaderProgramByFamilyListId( ShaderProgramSet* set,
+                                               ProgramFamilyListId id );
 
-UniformBuffer* CreateUniformBuffer();
+
+/**
+ * Creates a buffer, which provides the variables of `variableSet`.
+ *
+ * When a program declares a uniform block, the buffer is looked up by the
+ * blocks name (see #SetUniformBuffer).  The block defines the buffer layout,
+ * so all block members must be available in `variableSet`.
+ *
+ * Since buffers are shared between programs, blocks must use the std140
+ * layout:
+ *
+ *     layout(std140) uniform Camera
+ *     {
+ *         mat4 View;
+ *         mat4 Projection;
+ *     };
+ *
+ * The variable set must stay alive as long as the buffer is used.
+ */
+UniformBuffer* CreateUniformBuffer( const ShaderVariableSet* variableSet );
 
 void ReferenceUniformBuffer( UniformBuffer* buffer );
 void ReleaseUniformBuffer( UniformBuffer* buffer );
 
+/**
+ * Marks the buffer as outdated.
+ *
+ * It's refilled from its variable set when a program uses it the next time.
+ * Only if a value changed, the buffer is uploaded again.  Should be called
+ * once per frame after the variables have been modified.
+ */
+void UpdateUniformBuffer( UniformBuffer* buffer );
+
 
 ShaderVariableSet* CreateShaderVariableSet();
 void FreeShaderVariableSet( ShaderVariableSet* set );
@@ -165,6 +323,53 @@ void UnsetShaderVariable( ShaderVariableSet* set, const char* name );
 
 void ClearShaderVariableSet( ShaderVariableSet* set );
 
+/**
+ * Variants of the setters above, which use a precalculated name hash.
+ *
+ * @see CalcShaderVariableNameHash
+ */
+void SetUnusedShaderVariableByHash( ShaderVariableSet* set, uint32_t nameHash );
+void SetIntUniformByHash(   ShaderVariableSet* set, uint32_t nameHash, int value );
+void SetFloatUniformByHash( ShaderVariableSet* set, uint32_t nameHash, float value );
+void SetVec3UniformByHash(  ShaderVariableSet* set, uint32_t nameHash, Vec3 value );
+void SetMat3UniformByHash(  ShaderVariableSet* set, uint32_t nameHash, Mat3 value );
+void SetMat4UniformByHash(  ShaderVariableSet* set, uint32_t nameHash, Mat4 value );
+
+uint32_t CalcShaderVariableNameHash( const char* name );
+
+/**
+ * Compile time variant of #CalcShaderVariableNameHash for names, which are
+ * defined by the engine.
+ */
+constexpr uint32_t CalcConstShaderVariableNameHash( const char* name )
+{
+    return CalcConstCrc32ForString(name);
+}
+
+/**
+ * Calculates the hash of `arrayName[index]` from the hash of `arrayName`
+ * without building the element name.
+ */
+uint32_t CalcShaderVariableArrayElementNameHash( uint32_t arrayNameHash,
+                                                 int index );
+
+/**
+ * Precalculates the element name hashes of the array uniform `name`.
+ */
+void InitUniformArrayName( UniformArrayName* arrayName,
+                           const char* name,
+                           int length );
+
+/**
+ * Checks whether both sets contain the same variables with equal values.
+ */
+bool ShaderVariableSetsAreEqual( const ShaderVariableSet* a,
+                                 const ShaderVariableSet* b );
+
+/**
+ * Copies each variable `name` of the source set to `name[arrayIndex]` in the
+ * destination set.
+ */
 void CopyShaderVariablesAsArrayElements( ShaderVariableSet* destinationSet,
                                          const ShaderVariableSet* sourceSet,
                                          int arrayIndex );
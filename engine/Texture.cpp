@@ -1,12 +1,19 @@
 #include <assert.h>
 #include <stdlib.h> // NULL
+#include <string.h> // memcpy, memset
+#include <stdint.h> // uintptr_t
 #include <float.h> // FLT_MAX
 
 #include "Common.h"
 #include "Config.h"
+#include "Profiler.h"
 #include "OpenGL.h"
+#include "OpenGLState.h"
+#include "Array.h"
 #include "Image.h"
+#include "JobManager.h"
 #include "Reference.h"
+#include "RenderCommandQueue.h"
 #include "Texture.h"
 
 
@@ -14,6 +21,8 @@ static const GLuint INVALID_TEXTURE_HANDLE = 0;
 
 static const int MAX_CHANNEL_COUNT = 4;
 
+static const int UPLOAD_ROW_ALIGNMENT = 4; // Default of GL_UNPACK_ALIGNMENT
+
 static const int ChannelCountToFormat[MAX_CHANNEL_COUNT] =
 {
     GL_RED,
@@ -31,13 +40,57 @@ static const int ChannelCountToSRGBFormat[MAX_CHANNEL_COUNT] =
 };
 
 
+struct TextureUpload;
+
 struct Texture
 {
     ReferenceCounter refCounter;
     GLenum target;
     GLuint handle;
+    TextureUpload* upload; // Set while a streamed texture is uploaded.
+};
+
+/**
+ * Pixel data of a streamed texture, which still needs to be uploaded.
+ *
+ * Levels are uploaded from the smallest to the largest one, so the texture
+ * becomes usable early and is refined over the following frames.
+ */
+struct TextureUpload
+{
+    Texture* texture; // `NULL` if the texture has been freed meanwhile.
+    JobId mipmapJob; // #INVALID_JOB_ID when the levels are available.
+    int levelCount;
+    Image* levels[MAX_MIPMAP_LEVELS];
+
+    // Position of the next row, which is to be uploaded:
+    int level;
+    int row;
 };
 
+/**
+ * Rows of a texture level, which are uploaded in the current frame.
+ */
+struct TextureUploadChunk
+{
+    Texture* texture;
+    const Image* image;
+    int level;
+    int firstRow;
+    int rowCount;
+    int bufferOffset; // Offset in the pixel unpack buffer.
+};
+
+
+DefineCounter(TextureUploadBytesCounter, "texture upload bytes");
+DefineCounter(PendingTextureUploadsCounter, "pending texture uploads");
+
+static Array<TextureUpload*> PendingTextureUploads;
+static Array<TextureUploadChunk> TextureUploadChunks;
+static int TextureUploadBytesPerFrame = 0;
+static int TextureUploadBufferSize = 0; // Bytes used by the current frame.
+static GLuint TextureUploadBuffer = 0;
+
 
 static int GetImageFormat( int channelCount, bool useSRGB )
 {
@@ -86,6 +139,7 @@ static void SetTextureOptions( int target, int options )
         case GL_TEXTURE_3D:
             glTexParameteri(target, GL_TEXTURE_WRAP_R, wrapMode);
         case GL_TEXTURE_2D:
+        case GL_TEXTURE_2D_ARRAY:
             glTexParameteri(target, GL_TEXTURE_WRAP_T, wrapMode);
         case GL_TEXTURE_1D:
             glTexParameteri(target, GL_TEXTURE_WRAP_S, wrapMode);
@@ -113,17 +167,68 @@ static Texture* CreateTexture( GLenum target, int options )
     Texture* texture = new Texture;
     InitReferenceCounter(&texture->refCounter);
     texture->target = target;
+    texture->upload = NULL;
     glGenTextures(1, &texture->handle);
 
-    glBindTexture(target, texture->handle);
+    BindTextureObject(target, texture->handle);
     SetTextureOptions(target, options);
-    glBindTexture(target, INVALID_TEXTURE_HANDLE);
+    BindTextureObject(target, INVALID_TEXTURE_HANDLE);
 
     return texture;
 }
 
+struct CreateTextureArgs
+{
+    const Image** images;
+    int width;
+    int height;
+    int layerCount;
+    int options;
+    Texture* texture;
+};
+
+static void Create2dTextureInRenderThread( void* data )
+{
+    CreateTextureArgs* args = (CreateTextureArgs*)data;
+    args->texture = Create2dTexture(args->images[0], args->options);
+}
+
+static void CreateCubeTextureInRenderThread( void* data )
+{
+    CreateTextureArgs* args = (CreateTextureArgs*)data;
+    args->texture = CreateCubeTexture(args->images, args->options);
+}
+
+static void CreateArrayTextureInRenderThread( void* data )
+{
+    CreateTextureArgs* args = (CreateTextureArgs*)data;
+    args->texture = CreateArrayTexture(args->images,
+                                       args->layerCount,
+                                       args->width,
+                                       args->height,
+                                       args->options);
+}
+
+static void CreateDepthTextureInRenderThread( void* data )
+{
+    CreateTextureArgs* args = (CreateTextureArgs*)data;
+    args->texture = CreateDepthTexture(args->width, args->height, args->options);
+}
+
+static Texture* CreateStreamed2dTexture( const Image* image, int options );
+
 Texture* Create2dTexture( const Image* image, int options )
 {
+    if(options & TEX_STREAM)
+        return CreateStreamed2dTexture(image, options);
+
+    if(!InRenderThread())
+    {
+        CreateTextureArgs args = {&image, 0, 0, 1, options, NULL};
+        RunInRenderThread(Create2dTextureInRenderThread, &args);
+        return args.texture;
+    }
+
     Texture* texture = CreateTexture(GL_TEXTURE_2D, options);
     if(!texture)
         return NULL;
@@ -134,7 +239,7 @@ Texture* Create2dTexture( const Image* image, int options )
     const int type         = GetImageType(image);
     const void* pixels     = GetImagePixels(image);
 
-    glBindTexture(GL_TEXTURE_2D, texture->handle);
+    BindTextureObject(GL_TEXTURE_2D, texture->handle);
     const int internalFormat = GetImageFormat(channelCount, options & TEX_SRGB);
     const int format         = GetImageFormat(channelCount, false);
     glTexImage2D(GL_TEXTURE_2D,
@@ -148,12 +253,19 @@ Texture* Create2dTexture( const Image* image, int options )
                  pixels);
     if(options & TEX_MIPMAP)
         glGenerateMipmap(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, INVALID_TEXTURE_HANDLE);
+    BindTextureObject(GL_TEXTURE_2D, INVALID_TEXTURE_HANDLE);
     return texture;
 }
 
 Texture* CreateCubeTexture( const Image** images, int options )
 {
+    if(!InRenderThread())
+    {
+        CreateTextureArgs args = {images, 0, 0, 6, options, NULL};
+        RunInRenderThread(CreateCubeTextureInRenderThread, &args);
+        return args.texture;
+    }
+
     // Always uses clamp to edge since its the only option that makes sense here.
     options |= TEX_CLAMP;
 
@@ -161,7 +273,7 @@ Texture* CreateCubeTexture( const Image** images, int options )
     if(!texture)
         return NULL;
 
-    glBindTexture(GL_TEXTURE_CUBE_MAP, texture->handle);
+    BindTextureObject(GL_TEXTURE_CUBE_MAP, texture->handle);
     REPEAT(6, i)
     {
         const Image* image = images[i];
@@ -187,18 +299,82 @@ Texture* CreateCubeTexture( const Image** images, int options )
     }
     if(options & TEX_MIPMAP)
         glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, INVALID_TEXTURE_HANDLE);
+    BindTextureObject(GL_TEXTURE_CUBE_MAP, INVALID_TEXTURE_HANDLE);
+
+    return texture;
+}
+
+Texture* CreateArrayTexture( const Image** images,
+                             int layerCount,
+                             int width,
+                             int height,
+                             int options )
+{
+    if(!InRenderThread())
+    {
+        CreateTextureArgs args = {images, width, height, layerCount, options, NULL};
+        RunInRenderThread(CreateArrayTextureInRenderThread, &args);
+        return args.texture;
+    }
+
+    Ensure(layerCount > 0 && layerCount <= MAX_TEXTURE_ARRAY_LAYERS);
+    const int channelCount = GetImageChannelCount(images[0]);
+    const int type         = GetImageType(images[0]);
+
+    Texture* texture = CreateTexture(GL_TEXTURE_2D_ARRAY, options);
+    if(!texture)
+        return NULL;
 
+    BindTextureObject(GL_TEXTURE_2D_ARRAY, texture->handle);
+    const int internalFormat = GetImageFormat(channelCount, options & TEX_SRGB);
+    const int format         = GetImageFormat(channelCount, false);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY,
+                 0,
+                 internalFormat,
+                 width,
+                 height,
+                 layerCount,
+                 0,
+                 format,
+                 type,
+                 NULL);
+    REPEAT(layerCount, i)
+    {
+        const Image* image = images[i];
+        Ensure(GetImageChannelCount(image) == channelCount);
+        Ensure(GetImageType(image) == type);
+        Ensure(GetImageWidth(image) <= width);
+        Ensure(GetImageHeight(image) <= height);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY,
+                        0,
+                        0, 0, i,
+                        GetImageWidth(image),
+                        GetImageHeight(image),
+                        1,
+                        format,
+                        type,
+                        GetImagePixels(image));
+    }
+    if(options & TEX_MIPMAP)
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    BindTextureObject(GL_TEXTURE_2D_ARRAY, INVALID_TEXTURE_HANDLE);
     return texture;
 }
 
 Texture* CreateDepthTexture( int width, int height, int options )
 {
+    if(!InRenderThread())
+    {
+        CreateTextureArgs args = {NULL, width, height, 1, options, NULL};
+        RunInRenderThread(CreateDepthTextureInRenderThread, &args);
+        return args.texture;
+    }
+
     Texture* texture = CreateTexture(GL_TEXTURE_2D, options);
     if(!texture)
         return NULL;
 
-    glBindTexture(GL_TEXTURE_2D, texture->handle);
+    BindTextureObject(GL_TEXTURE_2D, texture->handle);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
     const float* data = NULL; // TODO: Sure that NULL works here?
     glTexImage2D(GL_TEXTURE_2D,
@@ -212,37 +388,39 @@ Texture* CreateDepthTexture( int width, int height, int options )
                  data);
     if(options & TEX_MIPMAP)
         glGenerateMipmap(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, INVALID_TEXTURE_HANDLE);
+    BindTextureObject(GL_TEXTURE_2D, INVALID_TEXTURE_HANDLE);
     return texture;
 }
 
-static GLenum CurTextureTargets[MAX_TEXTURE_UNITS] =
-{
-    INVALID_TEXTURE_HANDLE,
-    INVALID_TEXTURE_HANDLE,
-    INVALID_TEXTURE_HANDLE,
-    INVALID_TEXTURE_HANDLE
-};
-
 void BindTexture( const Texture* texture, int unit )
 {
-    glActiveTexture(GL_TEXTURE0+unit);
-    if(CurTextureTargets[unit] && (CurTextureTargets[unit] != texture->target))
-    {
-        glBindTexture(CurTextureTargets[unit], INVALID_TEXTURE_HANDLE);
-        CurTextureTargets[unit] = texture->target;
-    }
-    glBindTexture(texture->target, texture->handle);
+    BindTextureToUnit(unit, texture->target, texture->handle);
 }
 
+static void FreeTextureInRenderThread( void* data );
+
 static void FreeTexture( Texture* texture )
 {
     assert(InSerialPhase());
+    if(!InRenderThread())
+    {
+        RunInRenderThread(FreeTextureInRenderThread, texture);
+        return;
+    }
+
     FreeReferenceCounter(&texture->refCounter);
+    if(texture->upload)
+        texture->upload->texture = NULL; // See PrepareTextureUploads
     glDeleteTextures(1, &texture->handle);
+    ForgetTexture(texture->handle);
     delete texture;
 }
 
+static void FreeTextureInRenderThread( void* data )
+{
+    FreeTexture((Texture*)data);
+}
+
 void ReferenceTexture( Texture* texture )
 {
     Reference(&texture->refCounter);
@@ -254,3 +432,324 @@ void ReleaseTexture( Texture* texture )
     if(!HasReferences(&texture->refCounter))
         FreeTexture(texture);
 }
+
+
+// --- Streaming ---
+
+void InitTextureStreaming( TextureStreamingConfig config )
+{
+    assert(InSerialPhase());
+    Ensure(config.bytesPerFrame > 0);
+    InitCounter(TextureUploadBytesCounter);
+    InitCounter(PendingTextureUploadsCounter);
+    InitArray(&PendingTextureUploads);
+    InitArray(&TextureUploadChunks);
+    TextureUploadBytesPerFrame = config.bytesPerFrame;
+    TextureUploadBufferSize = 0;
+    glGenBuffers(1, &TextureUploadBuffer);
+}
+
+static void FreeTextureUpload( TextureUpload* upload )
+{
+    if(upload->mipmapJob != INVALID_JOB_ID)
+    {
+        WaitForJobs(&upload->mipmapJob, 1);
+        RemoveJob(upload->mipmapJob);
+    }
+    REPEAT(upload->levelCount, i)
+        if(upload->levels[i])
+            ReleaseImage(upload->levels[i]);
+    if(upload->texture)
+        upload->texture->upload = NULL;
+    DELETE(upload);
+}
+
+void DestroyTextureStreaming()
+{
+    assert(InSerialPhase());
+    REPEAT(PendingTextureUploads.length, i)
+        FreeTextureUpload(PendingTextureUploads.data[i]);
+    DestroyArray(&PendingTextureUploads);
+    DestroyArray(&TextureUploadChunks);
+    glDeleteBuffers(1, &TextureUploadBuffer);
+    ForgetBuffer(TextureUploadBuffer);
+    TextureUploadBuffer = 0;
+}
+
+struct CreateTextureStorageArgs
+{
+    const Image* image;
+    int levelCount;
+    int options;
+    Texture* texture;
+};
+
+static Texture* Create2dTextureStorage( const Image* image, int levelCount, int options );
+
+static void Create2dTextureStorageInRenderThread( void* data )
+{
+    CreateTextureStorageArgs* args = (CreateTextureStorageArgs*)data;
+    args->texture = Create2dTextureStorage(args->image, args->levelCount, args->options);
+}
+
+/**
+ * Creates a texture which has the size and format of the image, but whose
+ * content is still undefined.
+ */
+static Texture* Create2dTextureStorage( const Image* image, int levelCount, int options )
+{
+    if(!InRenderThread())
+    {
+        CreateTextureStorageArgs args = {image, levelCount, options, NULL};
+        RunInRenderThread(Create2dTextureStorageInRenderThread, &args);
+        return args.texture;
+    }
+
+    Texture* texture = CreateTexture(GL_TEXTURE_2D, options);
+
+    const int channelCount   = GetImageChannelCount(image);
+    const int internalFormat = GetImageFormat(channelCount, options & TEX_SRGB);
+    const int format         = GetImageFormat(channelCount, false);
+    int width  = GetImageWidth(image);
+    int height = GetImageHeight(image);
+
+    BindTextureObject(GL_TEXTURE_2D, texture->handle);
+    REPEAT(levelCount, level)
+    {
+        glTexImage2D(GL_TEXTURE_2D,
+                     level,
+                     internalFormat,
+                     width,
+                     height,
+                     0,
+                     format,
+                     GetImageType(image),
+                     NULL);
+        width  = GetMipmapSize(width);
+        height = GetMipmapSize(height);
+    }
+    // Only levels which have been uploaded completely may be sampled:
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, levelCount-1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount-1);
+    BindTextureObject(GL_TEXTURE_2D, INVALID_TEXTURE_HANDLE);
+    return texture;
+}
+
+static Texture* CreateStreamed2dTexture( const Image* image, int options )
+{
+    assert(InSerialPhase());
+    Ensure(GetImageType(image) == GL_UNSIGNED_BYTE);
+
+    const bool mipmapped = options & TEX_MIPMAP;
+    const int levelCount = mipmapped ? CalcMipmapCount(GetImageWidth(image),
+                                                       GetImageHeight(image))
+                                     : 1;
+    Texture* texture = Create2dTextureStorage(image, levelCount, options);
+
+    TextureUpload* upload = NEW(TextureUpload);
+    memset(upload, 0, sizeof(TextureUpload));
+    upload->texture = texture;
+    upload->levelCount = levelCount;
+    upload->level = levelCount-1;
+    upload->row = 0;
+    if(mipmapped)
+    {
+        upload->mipmapJob = BeginCreatingMipmaps((Image*)image,
+                                                 options & TEX_SRGB);
+    }
+    else
+    {
+        upload->mipmapJob = INVALID_JOB_ID;
+        upload->levels[0] = (Image*)image;
+        ReferenceImage(upload->levels[0]);
+    }
+
+    texture->upload = upload;
+    AppendToArray(&PendingTextureUploads, 1, &upload);
+    return texture;
+}
+
+bool TextureIsComplete( const Texture* texture )
+{
+    return texture->upload == NULL;
+}
+
+static int GetUploadRowSize( const Image* image )
+{
+    const int size = GetImageWidth(image) * GetImageChannelCount(image);
+    return (size + UPLOAD_ROW_ALIGNMENT-1) / UPLOAD_ROW_ALIGNMENT * UPLOAD_ROW_ALIGNMENT;
+}
+
+static bool TextureUploadIsFinished( const TextureUpload* upload )
+{
+    if(upload->texture)
+        return upload->level < 0;
+    else // The texture has been freed, only the job needs to be awaited:
+        return upload->mipmapJob == INVALID_JOB_ID ||
+               GetJobStatus(upload->mipmapJob) == COMPLETED_JOB;
+}
+
+/**
+ * @return
+ * Whether the levels of the upload are available.
+ */
+static bool AcquireMipmaps( TextureUpload* upload )
+{
+    if(upload->mipmapJob == INVALID_JOB_ID)
+        return true;
+    if(GetJobStatus(upload->mipmapJob) != COMPLETED_JOB)
+        return false;
+
+    assert(GetCreatedMipmapCount(upload->mipmapJob) == upload->levelCount);
+    REPEAT(upload->levelCount, i)
+    {
+        upload->levels[i] = GetCreatedMipmap(upload->mipmapJob, i);
+        ReferenceImage(upload->levels[i]);
+    }
+    RemoveJob(upload->mipmapJob);
+    upload->mipmapJob = INVALID_JOB_ID;
+    return true;
+}
+
+/**
+ * Adds chunks for the remaining rows of the upload, till the budget of the
+ * frame is exhausted.
+ */
+static void PlanTextureUpload( TextureUpload* upload, int* budget )
+{
+    while(upload->level >= 0)
+    {
+        const Image* image = upload->levels[upload->level];
+        const int height  = GetImageHeight(image);
+        const int rowSize = GetUploadRowSize(image);
+
+        int rowCount = *budget / rowSize;
+        if(rowCount <= 0)
+        {
+            if(TextureUploadChunks.length > 0)
+                return;
+            rowCount = 1; // Rows which exceed the budget must progress too.
+        }
+        if(rowCount > height - upload->row)
+            rowCount = height - upload->row;
+
+        TextureUploadChunk* chunk = AllocateAtEndOfArray(&TextureUploadChunks, 1);
+        chunk->texture = upload->texture;
+        chunk->image = image;
+        chunk->level = upload->level;
+        chunk->firstRow = upload->row;
+        chunk->rowCount = rowCount;
+        chunk->bufferOffset = TextureUploadBufferSize;
+        TextureUploadBufferSize += rowSize*rowCount;
+        *budget -= rowSize*rowCount;
+
+        upload->row += rowCount;
+        if(upload->row == height)
+        {
+            upload->level--;
+            upload->row = 0;
+        }
+    }
+}
+
+void PrepareTextureUploads()
+{
+    assert(InSerialPhase());
+
+    // Chunks of the last frame have been uploaded by now:
+    ClearArray(&TextureUploadChunks);
+    TextureUploadBufferSize = 0;
+
+    for(int i = 0; i < PendingTextureUploads.length;)
+    {
+        TextureUpload* upload = PendingTextureUploads.data[i];
+        if(TextureUploadIsFinished(upload))
+        {
+            FreeTextureUpload(upload);
+            RemoveFromArray(&PendingTextureUploads, i, 1);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    int budget = TextureUploadBytesPerFrame;
+    REPEAT(PendingTextureUploads.length, i)
+    {
+        TextureUpload* upload = PendingTextureUploads.data[i];
+        if(!upload->texture || !AcquireMipmaps(upload))
+            continue;
+        PlanTextureUpload(upload, &budget);
+        if(budget <= 0)
+            break;
+    }
+
+    SetCounter(TextureUploadBytesCounter, TextureUploadBufferSize);
+    SetCounter(PendingTextureUploadsCounter, PendingTextureUploads.length);
+}
+
+/**
+ * Copies the rows of the chunk into the pixel unpack buffer.
+ * Rows are padded to the unpack alignment.
+ */
+static void StageTextureUploadChunk( const TextureUploadChunk* chunk,
+                                     char* destination )
+{
+    const Image* image = chunk->image;
+    const int imageRowSize = GetImageWidth(image) * GetImageChannelCount(image);
+    const int uploadRowSize = GetUploadRowSize(image);
+    const char* source = (const char*)GetImagePixels(image) +
+                         imageRowSize*chunk->firstRow;
+    REPEAT(chunk->rowCount, i)
+    {
+        memcpy(destination, source, imageRowSize);
+        source += imageRowSize;
+        destination += uploadRowSize;
+    }
+}
+
+void UploadTextures()
+{
+    if(TextureUploadChunks.length == 0)
+        return;
+
+    BindBuffer(GL_PIXEL_UNPACK_BUFFER, TextureUploadBuffer);
+
+    // Orphan the old storage, so pending uploads don't need to be awaited:
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, TextureUploadBufferSize, NULL, GL_STREAM_DRAW);
+    char* mapping = (char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+                                            0,
+                                            TextureUploadBufferSize,
+                                            GL_MAP_WRITE_BIT |
+                                            GL_MAP_INVALIDATE_BUFFER_BIT);
+    REPEAT(TextureUploadChunks.length, i)
+    {
+        const TextureUploadChunk* chunk = &TextureUploadChunks.data[i];
+        StageTextureUploadChunk(chunk, &mapping[chunk->bufferOffset]);
+    }
+    if(!glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER))
+        LogWarning("Texture upload buffer has been corrupted.");
+
+    REPEAT(TextureUploadChunks.length, i)
+    {
+        const TextureUploadChunk* chunk = &TextureUploadChunks.data[i];
+        const Image* image = chunk->image;
+        const int format = GetImageFormat(GetImageChannelCount(image), false);
+
+        BindTextureObject(GL_TEXTURE_2D, chunk->texture->handle);
+        glTexSubImage2D(GL_TEXTURE_2D,
+                        chunk->level,
+                        0,
+                        chunk->firstRow,
+                        GetImageWidth(image),
+                        chunk->rowCount,
+                        format,
+                        GetImageType(image),
+                        (const void*)(uintptr_t)chunk->bufferOffset);
+        if(chunk->firstRow + chunk->rowCount == GetImageHeight(image))
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, chunk->level);
+    }
+    BindTextureObject(GL_TEXTURE_2D, INVALID_TEXTURE_HANDLE);
+    BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
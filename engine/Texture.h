@@ -9,17 +9,83 @@ struct Texture;
 
 static const int MAX_TEXTURE_UNITS = 8;
 
+/**
+ * Layers which texture arrays may have at most.
+ * Every OpenGL 3 implementation supports at least this many.
+ */
+static const int MAX_TEXTURE_ARRAY_LAYERS = 256;
+
 enum TextureOptions
 {
     TEX_MIPMAP = (1 << 0),
     TEX_FILTER = (1 << 1),
     TEX_CLAMP  = (1 << 2),
-    TEX_SRGB   = (1 << 3)
+    TEX_SRGB   = (1 << 3),
+
+    /**
+     * Upload the image over multiple frames, see #PrepareTextureUploads.
+     * Mipmaps are generated by a job instead of the driver.
+     * Only supported by 2d textures.
+     */
+    TEX_STREAM = (1 << 4)
+};
+
+struct TextureStreamingConfig
+{
+    /**
+     * Pixel data which may be uploaded per frame.  Rows which are larger
+     * are uploaded anyway, but nothing else in the same frame.
+     */
+    int bytesPerFrame;
 };
 
 
+void InitTextureStreaming( TextureStreamingConfig config );
+void DestroyTextureStreaming();
+
+/**
+ * Collects the mipmaps of streamed textures, whose jobs have completed, and
+ * decides which rows are uploaded in the current frame.
+ *
+ * Levels are uploaded from the smallest to the largest one.  Each completed
+ * level is made available for sampling right away, so textures are refined
+ * over the following frames.
+ *
+ * Must be called in the serial phase.
+ */
+void PrepareTextureUploads();
+
+/**
+ * Stages the rows, which have been selected by #PrepareTextureUploads, in a
+ * pixel buffer object and uploads them to their textures.
+ *
+ * Must be called in the render thread - before #PrepareTextureUploads is
+ * called again.
+ */
+void UploadTextures();
+
+/**
+ * Whether all levels of a streamed texture have been uploaded.
+ * Textures which are not streamed are always complete.
+ */
+bool TextureIsComplete( const Texture* texture );
+
 Texture* Create2dTexture( const Image* image, int options );
 Texture* CreateCubeTexture( const Image** images, int options );
+
+/**
+ * Creates a `GL_TEXTURE_2D_ARRAY` with one layer per image.
+ *
+ * All images must have the same channel count and must not be larger than
+ * `width` and `height`.  Smaller images are stored in the lower left corner
+ * of their layer.  Use #PackTextureArrays to distribute images to arrays.
+ */
+Texture* CreateArrayTexture( const Image** images,
+                             int layerCount,
+                             int width,
+                             int height,
+                             int options );
+
 Texture* CreateDepthTexture( int width, int height, int options );
 
 void BindTexture( const Texture* texture, int unit );
@@ -0,0 +1,89 @@
+#include "Common.h"
+#include "TextureArray.h"
+
+
+int GetTextureArraySizeClass( int size )
+{
+    Ensure(size > 0);
+    int sizeClass = 1;
+    while(sizeClass < size)
+        sizeClass *= 2;
+    return sizeClass;
+}
+
+/**
+ * Only the last array of a size class can have free layers, since arrays
+ * are appended when the previous one is full.
+ */
+static int FindTextureArray( const TextureArrayPacking* packing,
+                             int width,
+                             int height,
+                             int channelCount )
+{
+    for(int i = packing->arrays.length-1; i >= 0; i--)
+    {
+        const TextureArrayLayout* layout = &packing->arrays.data[i];
+        if(layout->width == width &&
+           layout->height == height &&
+           layout->channelCount == channelCount)
+            return i;
+    }
+    return -1;
+}
+
+void PackTextureArrays( TextureArrayPacking* packing,
+                        const TextureArrayImage* images,
+                        int imageCount,
+                        int maxLayerCount )
+{
+    Ensure(maxLayerCount > 0);
+    InitArray(&packing->arrays);
+    InitArray(&packing->placements);
+
+    TextureArrayPlacement* placements =
+        AllocateAtEndOfArray(&packing->placements, imageCount);
+
+    REPEAT(imageCount, i)
+    {
+        const TextureArrayImage* image = &images[i];
+        const int width  = GetTextureArraySizeClass(image->width);
+        const int height = GetTextureArraySizeClass(image->height);
+
+        int array = FindTextureArray(packing, width, height, image->channelCount);
+        if(array == -1 ||
+           packing->arrays.data[array].layerCount == maxLayerCount)
+        {
+            const TextureArrayLayout layout = {width, height, image->channelCount, 0};
+            AppendToArray(&packing->arrays, 1, &layout);
+            array = packing->arrays.length-1;
+        }
+
+        TextureArrayLayout* layout = &packing->arrays.data[array];
+        TextureArrayPlacement* placement = &placements[i];
+        placement->array = array;
+        placement->layer = layout->layerCount;
+        placement->texCoordScale._[0] = (float)image->width  / (float)width;
+        placement->texCoordScale._[1] = (float)image->height / (float)height;
+        layout->layerCount++;
+    }
+}
+
+void DestroyTextureArrayPacking( TextureArrayPacking* packing )
+{
+    DestroyArray(&packing->arrays);
+    DestroyArray(&packing->placements);
+}
+
+void RemapTexCoords( Vertex* vertices,
+                     int vertexCount,
+                     const TextureArrayPlacement* placement )
+{
+    const float layer = (float)placement->layer;
+    REPEAT(vertexCount, i)
+    {
+        Vertex* vertex = &vertices[i];
+        vertex->texCoord._[0] *= placement->texCoordScale._[0];
+        vertex->texCoord._[1] *= placement->texCoordScale._[1];
+        vertex->textureLayer = layer;
+    }
+}
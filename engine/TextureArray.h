@@ -0,0 +1,86 @@
+#ifndef __KONSTRUKT_TEXTURE_ARRAY__
+#define __KONSTRUKT_TEXTURE_ARRAY__
+
+#include "Math.h"
+#include "Array.h"
+#include "Vertex.h"
+
+
+/**
+ * Dimensions of an image, which shall be packed into a texture array.
+ */
+struct TextureArrayImage
+{
+    int width;
+    int height;
+    int channelCount;
+};
+
+/**
+ * All layers of a texture array have the same size and channel count.
+ */
+struct TextureArrayLayout
+{
+    int width;
+    int height;
+    int channelCount;
+    int layerCount;
+};
+
+/**
+ * Location of an image within the packed texture arrays.
+ *
+ * Images are stored in the lower left corner of their layer.  Texture
+ * coordinates must be scaled by `texCoordScale` to address just the image,
+ * see #RemapTexCoords.
+ */
+struct TextureArrayPlacement
+{
+    int array; // Index in #TextureArrayPacking::arrays
+    int layer;
+    Vec2 texCoordScale;
+};
+
+struct TextureArrayPacking
+{
+    Array<TextureArrayLayout> arrays;
+    Array<TextureArrayPlacement> placements; // One for each image
+};
+
+
+/**
+ * Distributes images to as few texture arrays as possible.
+ *
+ * Images share an array if they have the same channel count and their
+ * dimensions round up to the same powers of two (their size class).  Layers
+ * are assigned in the order in which the images are passed, so the result
+ * only depends on the input.  A new array is started if an array of the size
+ * class already has `maxLayerCount` layers.
+ *
+ * Use #DestroyTextureArrayPacking to free the result.
+ */
+void PackTextureArrays( TextureArrayPacking* packing,
+                        const TextureArrayImage* images,
+                        int imageCount,
+                        int maxLayerCount );
+
+void DestroyTextureArrayPacking( TextureArrayPacking* packing );
+
+/**
+ * Rounds the size up to the next power of two.
+ */
+int GetTextureArraySizeClass( int size );
+
+/**
+ * Makes vertices sample the placed image: The texture coordinates are scaled
+ * to the part of the layer which is covered by the image and the layer index
+ * is stored in the vertices.
+ *
+ * Texture coordinates of images which don't fill their layer must stay
+ * between 0 and 1, since repeating them would sample the unused part.
+ */
+void RemapTexCoords( Vertex* vertices,
+                     int vertexCount,
+                     const TextureArrayPlacement* placement );
+
+#endif
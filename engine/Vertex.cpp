@@ -2,6 +2,8 @@
 
 #include "Common.h" // REPEAT
 #include "OpenGL.h"
+#include "OpenGLState.h"
+#include "Shader.h" // MAX_DRAW_INSTANCES
 #include "Vertex.h"
 
 
@@ -12,14 +14,42 @@ enum
     VERTEX_TEXCOORD,
     VERTEX_NORMAL,
     VERTEX_TANGENT,
-    VERTEX_BITANGENT
+    VERTEX_BITANGENT,
+    VERTEX_TEXTURE_LAYER,
+    INSTANCE_INDEX
 };
 
+static GLuint InstanceIndexBuffer = 0;
+
+
+bool InstanceIndicesAreAvailable()
+{
+    return GLAD_GL_ARB_instanced_arrays != 0;
+}
+
+/**
+ * The instance index attribute reads `baseInstance + gl_InstanceID` from a
+ * buffer which just contains the numbers from 0 to #MAX_DRAW_INSTANCES-1.
+ */
+static void EnableInstanceIndices()
+{
+    GLint indices[MAX_DRAW_INSTANCES];
+    REPEAT(MAX_DRAW_INSTANCES, i)
+        indices[i] = i;
+
+    glGenBuffers(1, &InstanceIndexBuffer);
+    BindBuffer(GL_ARRAY_BUFFER, InstanceIndexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    glVertexAttribIPointer(INSTANCE_INDEX, 1, GL_INT, 0, NULL);
+    glVertexAttribDivisorARB(INSTANCE_INDEX, 1);
+    glEnableVertexAttribArray(INSTANCE_INDEX);
+}
+
 void EnableVertexArrays()
 {
     unsigned int vertexArray = 0;
     glGenVertexArrays(1, &vertexArray);
-    glBindVertexArray(vertexArray);
+    BindVertexArray(vertexArray);
 
     glEnableVertexAttribArray(VERTEX_POSITION);
     glEnableVertexAttribArray(VERTEX_COLOR);
@@ -27,6 +57,10 @@ void EnableVertexArrays()
     glEnableVertexAttribArray(VERTEX_NORMAL);
     glEnableVertexAttribArray(VERTEX_TANGENT);
     glEnableVertexAttribArray(VERTEX_BITANGENT);
+    glEnableVertexAttribArray(VERTEX_TEXTURE_LAYER);
+
+    if(InstanceIndicesAreAvailable())
+        EnableInstanceIndices();
 }
 
 void BindVertexAttributes( unsigned int programHandle )
@@ -37,6 +71,8 @@ void BindVertexAttributes( unsigned int programHandle )
     glBindAttribLocation(programHandle, VERTEX_NORMAL,   "VertexNormal");
     glBindAttribLocation(programHandle, VERTEX_TANGENT,  "VertexTangent");
     glBindAttribLocation(programHandle, VERTEX_BITANGENT,"VertexBitangent");
+    glBindAttribLocation(programHandle, VERTEX_TEXTURE_LAYER, "VertexTextureLayer");
+    glBindAttribLocation(programHandle, INSTANCE_INDEX,  "InstanceIndex");
 }
 
 void SetVertexAttributePointers( const void* data )
@@ -50,6 +86,7 @@ void SetVertexAttributePointers( const void* data )
     AttribPointer(VERTEX_NORMAL,   3,GL_FLOAT,float);
     AttribPointer(VERTEX_TANGENT,  3,GL_FLOAT,float);
     AttribPointer(VERTEX_BITANGENT,3,GL_FLOAT,float);
+    AttribPointer(VERTEX_TEXTURE_LAYER,1,GL_FLOAT,float);
 #undef AttribPointer
 }
 
@@ -15,10 +15,18 @@ struct Vertex
     Vec3 normal;
     Vec3 tangent;
     Vec3 bitangent;
+    float textureLayer; // See #RemapTexCoords
 };
 
 
 void EnableVertexArrays();
+
+/**
+ * Whether programs can use the `InstanceIndex` attribute.
+ *
+ * @see InstanceTransformation
+ */
+bool InstanceIndicesAreAvailable();
 void BindVertexAttributes( unsigned int programHandle );
 void SetVertexAttributePointers( const void* data );
 void CalcTriangleTangents( Vertex* a, Vertex* b, Vertex* c );
@@ -1,4 +1,6 @@
 #include <assert.h>
+#include <string.h> // strcmp
+#include <tinycthread.h>
 
 #include "Common.h"
 #include "Array.h"
@@ -23,8 +25,10 @@ struct VfsFile
 static MountSystem* RealMountSystem;
 static MountSystem* PhysFSMountSystem;
 static Array<Mount> Mounts;
+static mtx_t MountsMutex; // Jobs may look up mounts while files are opened.
 static Array<Path> SearchPaths;
 static Array<VfsFile*> OpenFiles;
+static mtx_t OpenFilesMutex; // Files may be opened by jobs.
 static char TempStateDirectory[MAX_PATH_SIZE];
 static char TempSharedStateDirectory[MAX_PATH_SIZE];
 
@@ -76,6 +80,8 @@ void InitVfs( const char* argv0,
     InitArray(&Mounts);
     InitArray(&SearchPaths);
     InitArray(&OpenFiles);
+    Ensure(mtx_init(&MountsMutex, mtx_plain) == thrd_success);
+    Ensure(mtx_init(&OpenFilesMutex, mtx_plain) == thrd_success);
 
     SetWriteDirectory("state", stateDirectory, TempStateDirectory);
     SetWriteDirectory("shared-state", sharedStateDirectory, TempSharedStateDirectory);
@@ -125,6 +131,8 @@ void DestroyVfs()
     DestroyArray(&Mounts);
     DestroyArray(&SearchPaths);
     DestroyArray(&OpenFiles);
+    mtx_destroy(&MountsMutex);
+    mtx_destroy(&OpenFilesMutex);
 
     RealMountSystem->destroy();
     PhysFSMountSystem->destroy();
@@ -180,6 +188,7 @@ void MountVfsDir( const char* vfsPath,
     else
         mountSystem = PhysFSMountSystem;
 
+    Ensure(mtx_lock(&MountsMutex) == thrd_success);
     Mount* mount = AllocateAtEndOfArray(&Mounts, 1);
     memset(mount, 0, sizeof(Mount));
     mount->mountSystem = mountSystem;
@@ -188,6 +197,7 @@ void MountVfsDir( const char* vfsPath,
     mount->writingAllowed = writingAllowed;
 
     mountSystem->mount(mount);
+    Ensure(mtx_unlock(&MountsMutex) == thrd_success);
 
     LogNotice("Mounted '%s' to '%s'.", realPath, vfsPath);
 }
@@ -195,11 +205,13 @@ void MountVfsDir( const char* vfsPath,
 void UnmountVfsDir( const char* vfsPath )
 {
     assert(InSerialPhase());
+    Ensure(mtx_lock(&MountsMutex) == thrd_success);
     int mountIndex;
     Mount* mount = GetMountByVfsPath(vfsPath, &mountIndex);
     mount->mountSystem->unmount(mount);
     LogNotice("Unmounted '%s' from '%s'.", mount->realPath, mount->vfsPath);
     RemoveFromArray(&Mounts, mountIndex, 1);
+    Ensure(mtx_unlock(&MountsMutex) == thrd_success);
 }
 
 
@@ -336,16 +348,22 @@ VfsFile* OpenVfsFile( const char* vfsPath, VfsOpenMode mode )
     if(!split.subMountPath)
         FatalError("Can't open file '%s'.", vfsPath);
 
+    // The mount must not be moved by #MountVfsDir while it's used:
+    Ensure(mtx_lock(&MountsMutex) == thrd_success);
     const Mount* mount = GetMountByVfsPath(split.mountPoint, NULL);
-    void* handle = mount->mountSystem->openFile(mount, split.subMountPath, mode);
+    const MountSystem* mountSystem = mount->mountSystem;
+    void* handle = mountSystem->openFile(mount, split.subMountPath, mode);
+    Ensure(mtx_unlock(&MountsMutex) == thrd_success);
 
     VfsFile* file = NEW(VfsFile);
-    file->mountSystem = mount->mountSystem;
+    file->mountSystem = mountSystem;
     file->handle = handle;
     CopyString(vfsPath, file->path, MAX_PATH_SIZE);
     file->mode = mode;
 
+    Ensure(mtx_lock(&OpenFilesMutex) == thrd_success);
     AppendToArray(&OpenFiles, 1, &file);
+    Ensure(mtx_unlock(&OpenFilesMutex) == thrd_success);
 
     return file;
 }
@@ -366,7 +384,9 @@ static void RemoveFileFromOpenFileList( const VfsFile* file )
 void CloseVfsFile( VfsFile* file )
 {
     file->mountSystem->closeFile(file->handle);
+    Ensure(mtx_lock(&OpenFilesMutex) == thrd_success);
     RemoveFileFromOpenFileList(file);
+    Ensure(mtx_unlock(&OpenFilesMutex) == thrd_success);
     DELETE(file);
 }
 
@@ -380,6 +400,24 @@ int WriteVfsFile( VfsFile* file, const void* buffer, int size )
     return file->mountSystem->writeFile(file->handle, buffer, size);
 }
 
+char* ReadWholeVfsFile( const char* vfsPath, int* sizeOut )
+{
+    VfsFile* file = OpenVfsFile(vfsPath, VFS_OPEN_READ);
+    const int size = GetVfsFileSize(file);
+    char* data = (char*)Alloc(size+1); // Empty files are allowed too.
+    const bool complete = ReadVfsFile(file, data, size) == size;
+    CloseVfsFile(file);
+
+    if(!complete)
+    {
+        Free(data);
+        return NULL;
+    }
+    data[size] = '\0';
+    *sizeOut = size;
+    return data;
+}
+
 void SetVfsFilePos( VfsFile* file, int position )
 {
     return file->mountSystem->setFilePos(file->handle, position);
@@ -457,6 +495,18 @@ void DeleteVfsFile( const char* vfsPath )
     return mount->mountSystem->deleteFile(mount, split.subMountPath);
 }
 
+void RenameVfsFile( const char* oldVfsPath, const char* newVfsPath )
+{
+    const SplitResult oldSplit = SplitVfsPath(oldVfsPath);
+    const SplitResult newSplit = SplitVfsPath(newVfsPath);
+    if(strcmp(oldSplit.mountPoint, newSplit.mountPoint) != 0)
+        FatalError("Can't move '%s' to another mount.", oldVfsPath);
+    Mount* mount = GetMountByVfsPath(oldSplit.mountPoint, NULL);
+    return mount->mountSystem->renameFile(mount,
+                                          oldSplit.subMountPath,
+                                          newSplit.subMountPath);
+}
+
 void MakeVfsDir( const char* vfsPath )
 {
     const SplitResult split = SplitVfsPath(vfsPath);
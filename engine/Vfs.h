@@ -96,6 +96,9 @@ void MountPackage( const char* reference );
  *
  * @param mode
  * The same mode flags that are accepted by `fopen`.
+ *
+ * Unlike the other functions, opening, using and closing files also works
+ * outside of the serial phase - e.g. in jobs.
  */
 VfsFile* OpenVfsFile( const char* vfsPath, VfsOpenMode mode );
 
@@ -117,6 +120,15 @@ int ReadVfsFile( VfsFile* file, void* buffer, int size );
  */
 int WriteVfsFile( VfsFile* file, const void* buffer, int size );
 
+/**
+ * Reads a complete file.
+ *
+ * @return
+ * A zero terminated buffer, which must be released with `Free`, or `NULL` if
+ * the file couldn't be read completely.
+ */
+char* ReadWholeVfsFile( const char* vfsPath, int* sizeOut );
+
 void SetVfsFilePos( VfsFile* file, int position );
 int  GetVfsFilePos( const VfsFile* file );
 int  GetVfsFileSize( const VfsFile* file );
@@ -147,6 +159,12 @@ FileType GetVfsFileType( const char* vfsPath );
  */
 void DeleteVfsFile( const char* vfsPath );
 
+/**
+ * Moves a regular file, replacing the file at the new path.  Both paths must
+ * be on the same mount.
+ */
+void RenameVfsFile( const char* oldVfsPath, const char* newVfsPath );
+
 void MakeVfsDir( const char* vfsPath );
 
 #endif
@@ -1,10 +1,13 @@
 #include <assert.h>
 #include <stdlib.h> // NULL
+#include <string.h> // strcmp
 
 #include "Common.h"
 #include "Constants.h" // OS_CALLING_CONVENTION
 #include "Config.h"
 #include "OpenGL.h"
+#include "OpenGLState.h"
+#include "NullOpenGL.h"
 #include "Window.h"
 
 #if defined(OS_CALLING_CONVENTION)
@@ -21,6 +24,7 @@
 /****** Variables *******/
 
 static GLFWwindow* g_Window = NULL;
+static bool g_UseNullOpenGL = false; // Window has no OpenGL context
 static int g_WindowWidth  = 0;
 static int g_WindowHeight = 0;
 static int g_FramebufferWidth  = 0;
@@ -70,6 +74,12 @@ void InitWindow()
     const bool debug = GetConfigBool("opengl.debug", false);
     const bool vsync = GetConfigBool("opengl.vsync", true);
 
+    const char* backend = GetConfigString("opengl.backend", "native");
+    if(strcmp(backend, "null") == 0)
+        g_UseNullOpenGL = true;
+    else if(strcmp(backend, "native") != 0)
+        FatalError("Unknown OpenGL backend '%s'.", backend);
+
     LogInfo("Compiled with GLFW %d.%d.%d",
              GLFW_VERSION_MAJOR,
              GLFW_VERSION_MINOR,
@@ -90,6 +100,8 @@ void InitWindow()
     glfwWindowHint(GLFW_SAMPLES, GetConfigInt("opengl.samples", 0));
     glfwWindowHint(GLFW_SRGB_CAPABLE, GL_TRUE);
     glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, debug ? GL_TRUE : GL_FALSE);
+    if(g_UseNullOpenGL)
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 
     g_Window = glfwCreateWindow(width, height, title, NULL, NULL);
     if(!g_Window)
@@ -98,10 +110,29 @@ void InitWindow()
     glfwGetWindowSize(g_Window, &g_WindowWidth, &g_WindowHeight);
     glfwGetFramebufferSize(g_Window, &g_FramebufferWidth, &g_FramebufferHeight);
 
+    glfwSetWindowSizeCallback(g_Window, OnWindowResize);
+    glfwSetFramebufferSizeCallback(g_Window, OnFramebufferResize);
+    glfwSetMouseButtonCallback(g_Window, OnMouseButtonAction);
+    glfwSetScrollCallback(g_Window, OnMouseScroll);
+    glfwSetCursorPosCallback(g_Window, OnCursorMove);
+    glfwSetKeyCallback(g_Window, OnKeyAction);
+
+    glfwSetInputMode(g_Window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+    glfwSetInputMode(g_Window, GLFW_STICKY_KEYS, GL_FALSE);
+    glfwSetInputMode(g_Window, GLFW_STICKY_MOUSE_BUTTONS, GL_FALSE);
+
+    if(g_UseNullOpenGL)
+    {
+        InitNullOpenGL();
+        InitOpenGLState();
+        return;
+    }
+
     glfwMakeContextCurrent(g_Window);
 
     if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
         FatalError("Failed to load OpenGL.");
+    InitOpenGLState();
 
     LogInfo("Using OpenGL %s\n"
             "\tVendor: %s\n"
@@ -125,10 +156,6 @@ void InitWindow()
         glfwSwapInterval(0); // disable vsync
     }
 
-    glfwSetInputMode(g_Window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
-    glfwSetInputMode(g_Window, GLFW_STICKY_KEYS, GL_FALSE);
-    glfwSetInputMode(g_Window, GLFW_STICKY_MOUSE_BUTTONS, GL_FALSE);
-
     if(debug)
     {
         if(!GLAD_GL_ARB_debug_output)
@@ -138,29 +165,44 @@ void InitWindow()
         glDebugMessageCallbackARB(OnDebugEvent, NULL);
         LogInfo("Debug output supported! You may receive debug messages from your OpenGL driver.");
     }
-
-    glfwSetWindowSizeCallback(g_Window, OnWindowResize);
-    glfwSetFramebufferSizeCallback(g_Window, OnFramebufferResize);
-    glfwSetMouseButtonCallback(g_Window, OnMouseButtonAction);
-    glfwSetScrollCallback(g_Window, OnMouseScroll);
-    glfwSetCursorPosCallback(g_Window, OnCursorMove);
-    glfwSetKeyCallback(g_Window, OnKeyAction);
 }
 
 void DestroyWindow()
 {
     assert(InSerialPhase());
     assert(g_Window != NULL);
+    if(g_UseNullOpenGL)
+        DestroyNullOpenGL();
     glfwDestroyWindow(g_Window);
     glfwTerminate();
 }
 
 void SwapBuffers()
 {
-    glfwSwapBuffers(g_Window);
+    if(!g_UseNullOpenGL)
+        glfwSwapBuffers(g_Window);
+    // The contents of the new back buffer are undefined:
+    MarkFramebufferAsDrawn();
+}
+
+void PollWindowEvents()
+{
+    assert(InSerialPhase());
     glfwPollEvents();
 }
 
+void MakeWindowContextCurrent()
+{
+    if(!g_UseNullOpenGL)
+        glfwMakeContextCurrent(g_Window);
+}
+
+void ReleaseWindowContext()
+{
+    if(!g_UseNullOpenGL)
+        glfwMakeContextCurrent(NULL);
+}
+
 void SetWindowTitle( const char* title )
 {
     assert(InSerialPhase());
@@ -14,6 +14,20 @@ void DestroyWindow();
 void FlagWindowForClose();
 bool WindowShouldClose();
 void SwapBuffers();
+
+/**
+ * Processes pending window and input events.
+ * Must be called by the main thread.
+ */
+void PollWindowEvents();
+
+/**
+ * Moves the OpenGL context of the window to the calling thread.
+ * It must have been released by the previous owner before.
+ */
+void MakeWindowContextCurrent();
+void ReleaseWindowContext();
+
 void* GetGLFWwindow();
 void GetFramebufferSize( int* width, int* height );
 
@@ -39,6 +39,8 @@ static int Lua_SetMaxActiveLightCount( lua_State* l )
 {
     LightWorld* world = CheckLightWorldFromLua(l, 1);
     const int count = luaL_checkinteger(l, 2);
+    if(count < 0 || count > MAX_ACTIVE_LIGHTS)
+        return luaL_argerror(l, 2, "Active light count is out of range.");
     SetMaxActiveLightCount(world, count);
     return 0;
 }
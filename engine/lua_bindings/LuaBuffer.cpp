@@ -2,10 +2,6 @@
 #include "../LuaBuffer.h"
 #include "LuaBuffer.h"
 
-#if LUA_VERSION_NUM <= 502
-#define lua_isinteger(...) 0
-#endif
-
 static int Lua_CreateLuaBuffer( lua_State* l )
 {
     static const char* typeNames[] =
@@ -17,40 +13,7 @@ static int Lua_CreateLuaBuffer( lua_State* l )
     const LuaBufferType type = (LuaBufferType)luaL_checkoption(l, 1, NULL, typeNames);
     LuaBuffer* buffer = CreateLuaBuffer(type);
 
-    const int top = lua_gettop(l);
-    for(int i = 2; i < top; i++)
-    {
-        switch(lua_type(l, i))
-        {
-            case LUA_TNIL:
-                AddNilToLuaBuffer(buffer);
-                break;
-
-            case LUA_TBOOLEAN:
-                AddNumberToLuaBuffer(buffer, lua_toboolean(l, i) != 0);
-                break;
-
-            case LUA_TNUMBER:
-                if(lua_isinteger(l, i))
-                    AddIntegerToLuaBuffer(buffer, lua_tointeger(l, i));
-                else
-                    AddNumberToLuaBuffer(buffer, lua_tonumber(l, i));
-                break;
-
-            case LUA_TSTRING:
-            {
-                size_t length;
-                const char* string = lua_tolstring(l, i, &length);
-                AddStringToLuaBuffer(buffer, string, length, 0);
-                break;
-            }
-
-            default:
-                return luaL_error(l, "Can't serialize %s values (parameter %d)",
-                                     lua_typename(l, lua_type(l, i)),
-                                     i);
-        }
-    }
+    AddLuaValuesToLuaBuffer(buffer, l, 2, lua_gettop(l)-1);
 
     PushPointerToLua(l, buffer);
     ReferenceLuaBuffer(buffer);
@@ -1,3 +1,5 @@
+#include <math.h> // sqrt
+
 #include "../Common.h"
 #include "../Lua.h"
 #include "Math.h"
@@ -13,6 +15,428 @@ static Vec3 CreateVec3( float x, float y, float z )
 }
 
 
+// --- Vector ---
+
+static const char* VECTOR_TYPE = "Vector";
+
+/**
+ * Components can be numbers or vectors.  Numbers apply to all components.
+ */
+struct VectorOperand
+{
+    const LuaVector* vector;
+    double scalar;
+};
+
+static VectorOperand CheckVectorOperand( lua_State* l, int stackPosition )
+{
+    VectorOperand operand;
+    operand.vector = (const LuaVector*)luaL_testudata(l, stackPosition, VECTOR_TYPE);
+    if(operand.vector)
+        operand.scalar = 0;
+    else
+        operand.scalar = luaL_checknumber(l, stackPosition);
+    return operand;
+}
+
+static double GetVectorOperandComponent( const VectorOperand* operand, int i )
+{
+    if(operand->vector)
+        return i < operand->vector->size ? operand->vector->_[i] : 0;
+    else
+        return operand->scalar;
+}
+
+static int GetVectorOperandSize( const VectorOperand* operand )
+{
+    return operand->vector ? operand->vector->size : 0;
+}
+
+static int CheckVectorIndex( lua_State* l, int stackPosition )
+{
+    const int index = luaL_checkinteger(l, stackPosition);
+    luaL_argcheck(l, index >= 1 && index <= MAX_LUA_VECTOR_SIZE,
+                  stackPosition, "out of range");
+    return index;
+}
+
+/**
+ * Sets the components from the numbers or the vector, which start at
+ * `stackPosition`.  Raises an error for more than #MAX_LUA_VECTOR_SIZE
+ * numbers.
+ */
+static void SetVectorFromLua( lua_State* l, LuaVector* v, int stackPosition )
+{
+    const LuaVector* source =
+        (const LuaVector*)luaL_testudata(l, stackPosition, VECTOR_TYPE);
+    if(source)
+    {
+        *v = *source;
+        return;
+    }
+
+    const int size = lua_gettop(l) - stackPosition + 1;
+    if(size > MAX_LUA_VECTOR_SIZE)
+        luaL_error(l, "Vectors have at most %d components.", MAX_LUA_VECTOR_SIZE);
+    v->size = size > 0 ? size : 0;
+    REPEAT(v->size, i)
+        v->_[i] = luaL_checknumber(l, stackPosition+i);
+}
+
+static int Lua_CreateVector( lua_State* l )
+{
+    LuaVector* v = CreateVectorInLua(l);
+    SetVectorFromLua(l, v, 1);
+    return 1;
+}
+
+static int Lua_CopyVector( lua_State* l )
+{
+    const LuaVector* source = CheckVectorFromLua(l, 1);
+    CopyUserDataToLua(l, VECTOR_TYPE, sizeof(LuaVector), source);
+    return 1;
+}
+
+static int Lua_SetVector( lua_State* l )
+{
+    LuaVector* v = CheckVectorFromLua(l, 1);
+    SetVectorFromLua(l, v, 2);
+    lua_settop(l, 1);
+    return 1;
+}
+
+/**
+ * `v:unpack(componentCount)` returns exactly `componentCount` components.
+ * Missing ones are zero.
+ */
+static int Lua_UnpackVector( lua_State* l )
+{
+    const LuaVector* v = CheckVectorFromLua(l, 1);
+    const int count = luaL_optinteger(l, 2, v->size);
+    luaL_argcheck(l, count >= 0, 2, "must not be negative");
+    luaL_checkstack(l, count, "too many components");
+    REPEAT(count, i)
+        lua_pushnumber(l, i < v->size ? v->_[i] : 0);
+    return count;
+}
+
+static double VectorDotProduct( const LuaVector* a, const LuaVector* b )
+{
+    const int size = a->size < b->size ? a->size : b->size;
+    double r = 0;
+    REPEAT(size, i)
+        r += a->_[i] * b->_[i];
+    return r;
+}
+
+static int Lua_VectorDotProduct( lua_State* l )
+{
+    const LuaVector* a = CheckVectorFromLua(l, 1);
+    const LuaVector* b = CheckVectorFromLua(l, 2);
+    lua_pushnumber(l, VectorDotProduct(a, b));
+    return 1;
+}
+
+static int Lua_VectorCrossProduct( lua_State* l )
+{
+    const LuaVector* a = CheckVectorFromLua(l, 1);
+    const LuaVector* b = CheckVectorFromLua(l, 2);
+    if(a->size != 3 || b->size != 3)
+        return luaL_error(l, "The cross product needs exactly 3 components.");
+    LuaVector* r = CreateVectorInLua(l);
+    r->size = 3;
+    r->_[0] = a->_[1]*b->_[2] - a->_[2]*b->_[1];
+    r->_[1] = a->_[2]*b->_[0] - a->_[0]*b->_[2];
+    r->_[2] = a->_[0]*b->_[1] - a->_[1]*b->_[0];
+    return 1;
+}
+
+static int Lua_VectorLength( lua_State* l )
+{
+    const LuaVector* v = CheckVectorFromLua(l, 1);
+    lua_pushnumber(l, sqrt(VectorDotProduct(v, v)));
+    return 1;
+}
+
+static int Lua_VectorInverseLength( lua_State* l )
+{
+    const LuaVector* v = CheckVectorFromLua(l, 1);
+    lua_pushnumber(l, 1.0 / sqrt(VectorDotProduct(v, v)));
+    return 1;
+}
+
+static void NormalizeVector( LuaVector* v )
+{
+    const double length = sqrt(VectorDotProduct(v, v));
+    REPEAT(v->size, i)
+        v->_[i] /= length;
+}
+
+static int Lua_NormalizeVector( lua_State* l )
+{
+    const LuaVector* source = CheckVectorFromLua(l, 1);
+    LuaVector* r = CreateVectorInLua(l);
+    *r = *source;
+    NormalizeVector(r);
+    return 1;
+}
+
+static int Lua_NormalizeVectorInPlace( lua_State* l )
+{
+    NormalizeVector(CheckVectorFromLua(l, 1));
+    lua_settop(l, 1);
+    return 1;
+}
+
+enum VectorOperation
+{
+    VECTOR_ADD,
+    VECTOR_SUB,
+    VECTOR_MUL,
+    VECTOR_DIV
+};
+
+static double ApplyVectorOperation( VectorOperation operation, double a, double b )
+{
+    switch(operation)
+    {
+        case VECTOR_ADD: return a + b;
+        case VECTOR_SUB: return a - b;
+        case VECTOR_MUL: return a * b;
+        case VECTOR_DIV: return a / b;
+    }
+    FatalError("Unknown vector operation.");
+    return 0;
+}
+
+/**
+ * Combines the components of `a` and `b`.  The result has as many
+ * components as the larger vector.  `r` may alias `a` or `b`.
+ */
+static void OperateOnVectors( LuaVector* r,
+                              const VectorOperand* a,
+                              const VectorOperand* b,
+                              VectorOperation operation )
+{
+    const int sizeA = GetVectorOperandSize(a);
+    const int sizeB = GetVectorOperandSize(b);
+    const int size = sizeA > sizeB ? sizeA : sizeB;
+    LuaVector result;
+    result.size = size;
+    REPEAT(size, i)
+        result._[i] = ApplyVectorOperation(operation,
+                                           GetVectorOperandComponent(a, i),
+                                           GetVectorOperandComponent(b, i));
+    *r = result;
+}
+
+static int PushVectorOperation( lua_State* l, VectorOperation operation )
+{
+    const VectorOperand a = CheckVectorOperand(l, 1);
+    const VectorOperand b = CheckVectorOperand(l, 2);
+    OperateOnVectors(CreateVectorInLua(l), &a, &b, operation);
+    return 1;
+}
+
+static int ApplyVectorOperationInPlace( lua_State* l, VectorOperation operation )
+{
+    LuaVector* v = CheckVectorFromLua(l, 1);
+    const VectorOperand a = { v, 0 };
+    const VectorOperand b = CheckVectorOperand(l, 2);
+    OperateOnVectors(v, &a, &b, operation);
+    lua_settop(l, 1);
+    return 1;
+}
+
+static int Lua_AddVector( lua_State* l ) { return PushVectorOperation(l, VECTOR_ADD); }
+static int Lua_SubVector( lua_State* l ) { return PushVectorOperation(l, VECTOR_SUB); }
+static int Lua_MulVector( lua_State* l ) { return PushVectorOperation(l, VECTOR_MUL); }
+static int Lua_DivVector( lua_State* l ) { return PushVectorOperation(l, VECTOR_DIV); }
+
+static int Lua_AddVectorInPlace( lua_State* l ) { return ApplyVectorOperationInPlace(l, VECTOR_ADD); }
+static int Lua_SubVectorInPlace( lua_State* l ) { return ApplyVectorOperationInPlace(l, VECTOR_SUB); }
+static int Lua_MulVectorInPlace( lua_State* l ) { return ApplyVectorOperationInPlace(l, VECTOR_MUL); }
+static int Lua_DivVectorInPlace( lua_State* l ) { return ApplyVectorOperationInPlace(l, VECTOR_DIV); }
+
+static int Lua_NegateVector( lua_State* l )
+{
+    const LuaVector* v = CheckVectorFromLua(l, 1);
+    LuaVector* r = CreateVectorInLua(l);
+    r->size = v->size;
+    REPEAT(v->size, i)
+        r->_[i] = -v->_[i];
+    return 1;
+}
+
+enum VectorComparison
+{
+    VECTOR_EQUAL,
+    VECTOR_LESSER,
+    VECTOR_GREATER,
+    VECTOR_LESSER_OR_EQUAL,
+    VECTOR_GREATER_OR_EQUAL
+};
+
+/**
+ * @return
+ * Whether the comparison holds for all components.  Missing components are
+ * zero.
+ */
+static bool CompareVectors( const LuaVector* a,
+                            const LuaVector* b,
+                            VectorComparison comparison )
+{
+    const int size = a->size > b->size ? a->size : b->size;
+    REPEAT(size, i)
+    {
+        const double x = i < a->size ? a->_[i] : 0;
+        const double y = i < b->size ? b->_[i] : 0;
+        bool result = false;
+        switch(comparison)
+        {
+            case VECTOR_EQUAL:            result = x == y; break;
+            case VECTOR_LESSER:           result = x <  y; break;
+            case VECTOR_GREATER:          result = x >  y; break;
+            case VECTOR_LESSER_OR_EQUAL:  result = x <= y; break;
+            case VECTOR_GREATER_OR_EQUAL: result = x >= y; break;
+        }
+        if(!result)
+            return false;
+    }
+    return true;
+}
+
+static int PushVectorComparison( lua_State* l, VectorComparison comparison )
+{
+    const LuaVector* a = CheckVectorFromLua(l, 1);
+    const LuaVector* b = CheckVectorFromLua(l, 2);
+    lua_pushboolean(l, CompareVectors(a, b, comparison));
+    return 1;
+}
+
+static int Lua_VectorsAreEqual( lua_State* l ) { return PushVectorComparison(l, VECTOR_EQUAL); }
+static int Lua_VectorComponentsLesserThan( lua_State* l ) { return PushVectorComparison(l, VECTOR_LESSER); }
+static int Lua_VectorComponentsGreaterThan( lua_State* l ) { return PushVectorComparison(l, VECTOR_GREATER); }
+static int Lua_VectorComponentsLesserOrEqualTo( lua_State* l ) { return PushVectorComparison(l, VECTOR_LESSER_OR_EQUAL); }
+static int Lua_VectorComponentsGreaterOrEqualTo( lua_State* l ) { return PushVectorComparison(l, VECTOR_GREATER_OR_EQUAL); }
+
+/**
+ * Numeric keys return components - or zero if the vector has less
+ * components.  Other keys are looked up in the metatable, so methods can be
+ * added in Lua.
+ */
+static int Lua_IndexVector( lua_State* l )
+{
+    const LuaVector* v = CheckVectorFromLua(l, 1);
+    if(lua_type(l, 2) == LUA_TNUMBER)
+    {
+        const int index = lua_tointeger(l, 2);
+        if(index >= 1 && index <= v->size)
+            lua_pushnumber(l, v->_[index-1]);
+        else
+            lua_pushnumber(l, 0);
+    }
+    else
+    {
+        lua_getmetatable(l, 1);
+        lua_pushvalue(l, 2);
+        lua_rawget(l, -2);
+    }
+    return 1;
+}
+
+/**
+ * Assigning a component beyond the size grows the vector.  Skipped
+ * components become zero.
+ */
+static int Lua_NewIndexVector( lua_State* l )
+{
+    LuaVector* v = CheckVectorFromLua(l, 1);
+    const int index = CheckVectorIndex(l, 2);
+    const double value = luaL_checknumber(l, 3);
+    for(int i = v->size; i < index; i++)
+        v->_[i] = 0;
+    if(v->size < index)
+        v->size = index;
+    v->_[index-1] = value;
+    return 0;
+}
+
+static int Lua_VectorSize( lua_State* l )
+{
+    const LuaVector* v = CheckVectorFromLua(l, 1);
+    lua_pushinteger(l, v->size);
+    return 1;
+}
+
+static int Lua_VectorToString( lua_State* l )
+{
+    const LuaVector* v = CheckVectorFromLua(l, 1);
+    if(v->size == 0)
+    {
+        lua_pushliteral(l, "");
+        return 1;
+    }
+
+    luaL_checkstack(l, v->size*2, "too many components");
+    REPEAT(v->size, i)
+    {
+        if(i > 0)
+            lua_pushliteral(l, ",");
+        lua_pushnumber(l, v->_[i]);
+    }
+    lua_concat(l, v->size*2 - 1); // Formats numbers like `tostring`.
+    return 1;
+}
+
+static const luaL_Reg VectorMethods[] =
+{
+    {"__index", Lua_IndexVector},
+    {"__newindex", Lua_NewIndexVector},
+    {"__len", Lua_VectorSize},
+    {"__eq", Lua_VectorsAreEqual},
+    {"__add", Lua_AddVector},
+    {"__sub", Lua_SubVector},
+    {"__mul", Lua_MulVector},
+    {"__div", Lua_DivVector},
+    {"__unm", Lua_NegateVector},
+    {"__tostring", Lua_VectorToString},
+    {"clone", Lua_CopyVector},
+    {"set", Lua_SetVector},
+    {"unpack", Lua_UnpackVector},
+    {"dot", Lua_VectorDotProduct},
+    {"cross", Lua_VectorCrossProduct},
+    {"length", Lua_VectorLength},
+    {"inverseLength", Lua_VectorInverseLength},
+    {"normalize", Lua_NormalizeVector},
+    {"normalizeInPlace", Lua_NormalizeVectorInPlace},
+    {"addInPlace", Lua_AddVectorInPlace},
+    {"subInPlace", Lua_SubVectorInPlace},
+    {"mulInPlace", Lua_MulVectorInPlace},
+    {"divInPlace", Lua_DivVectorInPlace},
+    {"componentsLesserThan", Lua_VectorComponentsLesserThan},
+    {"componentsGreaterThan", Lua_VectorComponentsGreaterThan},
+    {"componentsLesserOrEqualTo", Lua_VectorComponentsLesserOrEqualTo},
+    {"componentsGreaterOrEqualTo", Lua_VectorComponentsGreaterOrEqualTo},
+    {NULL, NULL}
+};
+
+LuaVector* CreateVectorInLua( lua_State* l )
+{
+    return (LuaVector*)PushUserDataToLua(l, VECTOR_TYPE, sizeof(LuaVector));
+}
+
+LuaVector* GetVectorFromLua( lua_State* l, int stackPosition )
+{
+    return (LuaVector*)GetUserDataFromLua(l, stackPosition, VECTOR_TYPE);
+}
+
+LuaVector* CheckVectorFromLua( lua_State* l, int stackPosition )
+{
+    return (LuaVector*)CheckUserDataFromLua(l, stackPosition, VECTOR_TYPE);
+}
+
+
 // --- Quaternion ---
 
 static const char* QUATERNION_TYPE = "Quaternion";
@@ -49,6 +473,14 @@ static int Lua_NormalizeQuaternion( lua_State* l )
     return 1;
 }
 
+static int Lua_NormalizeQuaternionInPlace( lua_State* l )
+{
+    Quat* q = CheckQuaternionFromLua(l, 1);
+    *q = NormalizeQuat(*q);
+    lua_settop(l, 1);
+    return 1;
+}
+
 static int Lua_QuaternionConjugate( lua_State* l )
 {
     const Quat* source = CheckQuaternionFromLua(l, 1);
@@ -74,6 +506,15 @@ static int Lua_MultiplyQuaternion( lua_State* l )
     return 1;
 }
 
+static int Lua_MultiplyQuaternionInPlace( lua_State* l )
+{
+    Quat* a = CheckQuaternionFromLua(l, 1);
+    const Quat* b = CheckQuaternionFromLua(l, 2);
+    *a = MulQuat(*a, *b);
+    lua_settop(l, 1);
+    return 1;
+}
+
 static int Lua_QuaternionXVector3( lua_State* l )
 {
     const Quat* a = CheckQuaternionFromLua(l, 1);
@@ -137,6 +578,15 @@ static int Lua_MultiplyMatrix4( lua_State* l )
     return 1;
 }
 
+static int Lua_MultiplyMatrix4InPlace( lua_State* l )
+{
+    Mat4* a = CheckMatrix4FromLua(l, 1);
+    const Mat4* b = CheckMatrix4FromLua(l, 2);
+    *a = MulMat4(*a, *b);
+    lua_settop(l, 1);
+    return 1;
+}
+
 static int Lua_TranslateMatrix4( lua_State* l )
 {
     const Mat4* a = CheckMatrix4FromLua(l, 1);
@@ -149,6 +599,17 @@ static int Lua_TranslateMatrix4( lua_State* l )
     return 1;
 }
 
+static int Lua_TranslateMatrix4InPlace( lua_State* l )
+{
+    Mat4* a = CheckMatrix4FromLua(l, 1);
+    const Vec3 t = CreateVec3(luaL_checknumber(l, 2),
+                              luaL_checknumber(l, 3),
+                              luaL_checknumber(l, 4));
+    *a = TranslateMat4(*a, t);
+    lua_settop(l, 1);
+    return 1;
+}
+
 static int Lua_ScaleMatrix4( lua_State* l )
 {
     const Mat4* a = CheckMatrix4FromLua(l, 1);
@@ -161,6 +622,17 @@ static int Lua_ScaleMatrix4( lua_State* l )
     return 1;
 }
 
+static int Lua_ScaleMatrix4InPlace( lua_State* l )
+{
+    Mat4* a = CheckMatrix4FromLua(l, 1);
+    const Vec3 s = CreateVec3(luaL_checknumber(l, 2),
+                              luaL_checknumber(l, 3),
+                              luaL_checknumber(l, 4));
+    *a = ScaleMat4(*a, s);
+    lua_settop(l, 1);
+    return 1;
+}
+
 static int Lua_RotateMatrix4( lua_State* l )
 {
     const Mat4* a = CheckMatrix4FromLua(l, 1);
@@ -176,6 +648,18 @@ static int Lua_RotateMatrix4( lua_State* l )
     return 1;
 }
 
+static int Lua_RotateMatrix4InPlace( lua_State* l )
+{
+    Mat4* a = CheckMatrix4FromLua(l, 1);
+    const float angle = luaL_checknumber(l, 2);
+    const Vec3 axis = CreateVec3(luaL_checknumber(l, 3),
+                                 luaL_checknumber(l, 4),
+                                 luaL_checknumber(l, 5));
+    *a = RotateMat4ByAngleAndAxis(*a, angle, axis);
+    lua_settop(l, 1);
+    return 1;
+}
+
 static int Lua_Matrix4TransformVector( lua_State* l )
 {
     const Mat4* a = CheckMatrix4FromLua(l, 1);
@@ -236,27 +720,39 @@ Mat4* CheckMatrix4FromLua( lua_State* l, int stackPosition )
 
 // --- Register in Lua ---
 
+// The functions only touch the calling Lua state, so they're all thread-safe.
+// Otherwise each operation would have to wait for the serial phase.
+
 void RegisterMathInLua()
 {
+    RegisterLuaTypeWithMethods(VECTOR_TYPE, NULL, VectorMethods);
+    RegisterThreadSafeLuaFunction("CreateVector", Lua_CreateVector);
+
     RegisterUserDataTypeInLua(QUATERNION_TYPE, NULL);
-    RegisterFunctionInLua("CreateQuaternion", Lua_CreateQuaternion);
-    RegisterFunctionInLua("CreateQuaternionByAngleAndAxis", Lua_CreateQuaternionByAngleAndAxis);
-    RegisterFunctionInLua("CopyQuaternion", Lua_CopyQuaternion);
-    RegisterFunctionInLua("NormalizeQuaternion", Lua_NormalizeQuaternion);
-    RegisterFunctionInLua("QuaternionConjugate", Lua_QuaternionConjugate);
-    RegisterFunctionInLua("InvertQuaternion", Lua_InvertQuaternion);
-    RegisterFunctionInLua("MultiplyQuaternion", Lua_MultiplyQuaternion);
-    RegisterFunctionInLua("QuaternionXVector3", Lua_QuaternionXVector3);
+    RegisterThreadSafeLuaFunction("CreateQuaternion", Lua_CreateQuaternion);
+    RegisterThreadSafeLuaFunction("CreateQuaternionByAngleAndAxis", Lua_CreateQuaternionByAngleAndAxis);
+    RegisterThreadSafeLuaFunction("CopyQuaternion", Lua_CopyQuaternion);
+    RegisterThreadSafeLuaFunction("NormalizeQuaternion", Lua_NormalizeQuaternion);
+    RegisterThreadSafeLuaFunction("NormalizeQuaternionInPlace", Lua_NormalizeQuaternionInPlace);
+    RegisterThreadSafeLuaFunction("QuaternionConjugate", Lua_QuaternionConjugate);
+    RegisterThreadSafeLuaFunction("InvertQuaternion", Lua_InvertQuaternion);
+    RegisterThreadSafeLuaFunction("MultiplyQuaternion", Lua_MultiplyQuaternion);
+    RegisterThreadSafeLuaFunction("MultiplyQuaternionInPlace", Lua_MultiplyQuaternionInPlace);
+    RegisterThreadSafeLuaFunction("QuaternionXVector3", Lua_QuaternionXVector3);
 
     RegisterUserDataTypeInLua(MATRIX_TYPE, NULL);
-    RegisterFunctionInLua("CreateMatrix4", Lua_CreateMatrix4);
-    RegisterFunctionInLua("CreateMatrix4FromQuaternion", Lua_CreateMatrix4FromQuaternion);
-    RegisterFunctionInLua("CopyMatrix4", Lua_CopyMatrix4);
-    RegisterFunctionInLua("MultiplyMatrix4", Lua_MultiplyMatrix4);
-    RegisterFunctionInLua("TranslateMatrix4", Lua_TranslateMatrix4);
-    RegisterFunctionInLua("ScaleMatrix4", Lua_ScaleMatrix4);
-    RegisterFunctionInLua("RotateMatrix4", Lua_RotateMatrix4);
-    RegisterFunctionInLua("Matrix4TransformVector", Lua_Matrix4TransformVector);
-    RegisterFunctionInLua("CreateLookAtMatrix", Lua_CreateLookAtMatrix);
-    RegisterFunctionInLua("ClipTranslationOfMatrix4", Lua_ClipTranslationOfMatrix4);
+    RegisterThreadSafeLuaFunction("CreateMatrix4", Lua_CreateMatrix4);
+    RegisterThreadSafeLuaFunction("CreateMatrix4FromQuaternion", Lua_CreateMatrix4FromQuaternion);
+    RegisterThreadSafeLuaFunction("CopyMatrix4", Lua_CopyMatrix4);
+    RegisterThreadSafeLuaFunction("MultiplyMatrix4", Lua_MultiplyMatrix4);
+    RegisterThreadSafeLuaFunction("MultiplyMatrix4InPlace", Lua_MultiplyMatrix4InPlace);
+    RegisterThreadSafeLuaFunction("TranslateMatrix4", Lua_TranslateMatrix4);
+    RegisterThreadSafeLuaFunction("TranslateMatrix4InPlace", Lua_TranslateMatrix4InPlace);
+    RegisterThreadSafeLuaFunction("ScaleMatrix4", Lua_ScaleMatrix4);
+    RegisterThreadSafeLuaFunction("ScaleMatrix4InPlace", Lua_ScaleMatrix4InPlace);
+    RegisterThreadSafeLuaFunction("RotateMatrix4", Lua_RotateMatrix4);
+    RegisterThreadSafeLuaFunction("RotateMatrix4InPlace", Lua_RotateMatrix4InPlace);
+    RegisterThreadSafeLuaFunction("Matrix4TransformVector", Lua_Matrix4TransformVector);
+    RegisterThreadSafeLuaFunction("CreateLookAtMatrix", Lua_CreateLookAtMatrix);
+    RegisterThreadSafeLuaFunction("ClipTranslationOfMatrix4", Lua_ClipTranslationOfMatrix4);
 }
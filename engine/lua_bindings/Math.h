@@ -5,6 +5,26 @@
 
 struct lua_State;
 
+/**
+ * Unlike the table based vectors of `core/Vector.lua` native vectors can't
+ * grow beyond this.
+ */
+static const int MAX_LUA_VECTOR_SIZE = 4;
+
+/**
+ * Vectors have a fixed size in memory, so they fit into the pools of the
+ * #LuaAllocator.  `size` is the number of used components.
+ */
+struct LuaVector
+{
+    int size;
+    double _[MAX_LUA_VECTOR_SIZE];
+};
+
+LuaVector* CreateVectorInLua( lua_State* l );
+LuaVector* GetVectorFromLua( lua_State* l, int stackPosition );
+LuaVector* CheckVectorFromLua( lua_State* l, int stackPosition );
+
 Mat4* CreateMatrix4InLua( lua_State* l );
 Mat4* GetMatrix4FromLua( lua_State* l, int stackPosition );
 Mat4* CheckMatrix4FromLua( lua_State* l, int stackPosition );
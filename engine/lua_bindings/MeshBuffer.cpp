@@ -46,6 +46,7 @@ static int Lua_BeginMeshBufferPostprocessing( lua_State* l )
         "indices",
         "normals",
         "tangents",
+        "lods",
         NULL
     };
 
@@ -53,7 +54,8 @@ static int Lua_BeginMeshBufferPostprocessing( lua_State* l )
     {
         MESH_BUFFER_INDEX,
         MESH_BUFFER_CALC_NORMALS,
-        MESH_BUFFER_CALC_TANGENTS
+        MESH_BUFFER_CALC_TANGENTS,
+        MESH_BUFFER_GENERATE_LODS
     };
 
     int options = 0;
@@ -113,6 +115,7 @@ static int Lua_AppendVertexToMeshBuffer( lua_State* l )
 
     vertex.tangent   = Vec3Zero;
     vertex.bitangent = Vec3Zero;
+    vertex.textureLayer = 0;
 
     AddVertexToMeshBuffer(targetBuffer, &vertex);
     return 0;
@@ -5,8 +5,10 @@
 #include "../Lua.h"
 #include "../Mesh.h"
 #include "../MeshChunkGenerator.h"
+#include "../TextureArray.h"
 #include "Math.h"
 #include "MeshBuffer.h"
+#include "Texture.h"
 #include "VoxelVolume.h"
 #include "JobManager.h"
 #include "MeshChunkGenerator.h"
@@ -44,15 +46,6 @@ static int Lua_CreateBlockVoxelMesh( lua_State* l )
 
     const int materialId = luaL_checkinteger(l, 2);
 
-    const int conditionCount = lua_rawlen(l, 3);
-    BitCondition* conditions = (BitCondition*)Alloc(sizeof(BitCondition)*conditionCount);
-    REPEAT(conditionCount, i)
-    {
-        lua_rawgeti(l, 3, i+1);
-        GetBitConditionFromLua(l, &conditions[i]);
-        lua_pop(l, 1);
-    }
-
     const bool transparent = (bool)lua_toboolean(l, 4);
 
     MeshBuffer* meshBuffers[BLOCK_VOXEL_MATERIAL_BUFFER_COUNT];
@@ -74,15 +67,31 @@ static int Lua_CreateBlockVoxelMesh( lua_State* l )
         lua_pop(l, 1);
     }
 
+    TextureArrayPlacement texturePlacement;
+    const bool hasTexturePlacement =
+        GetTextureArrayPlacementFromLua(l, 7, &texturePlacement);
+
+    // Conditions are read last and stored in user data, so nothing leaks
+    // when one of them raises an error:
+    luaL_checktype(l, 3, LUA_TTABLE);
+    const int conditionCount = lua_rawlen(l, 3);
+    BitCondition* conditions =
+        (BitCondition*)lua_newuserdata(l, sizeof(BitCondition)*conditionCount);
+    REPEAT(conditionCount, i)
+    {
+        lua_rawgeti(l, 3, i+1);
+        GetBitConditionFromLua(l, &conditions[i]);
+        lua_pop(l, 1);
+    }
+
     CreateBlockVoxelMesh(generator,
                          materialId,
+                         hasTexturePlacement ? &texturePlacement : NULL,
                          conditions,
                          conditionCount,
                          transparent,
                          meshBuffers,
                          transformations);
-
-    Free(conditions);
     return 0;
 }
 
@@ -1,6 +1,8 @@
+#include "../Common.h"
 #include "../Lua.h"
 #include "../Image.h"
 #include "../Texture.h"
+#include "../TextureArray.h"
 #include "Image.h"
 #include "Texture.h"
 
@@ -13,6 +15,7 @@ static int ReadTextureOption( lua_State* l, int stackPosition )
         "filter",
         "clamp",
         "srgb",
+        "stream",
         NULL
     };
 
@@ -21,7 +24,8 @@ static int ReadTextureOption( lua_State* l, int stackPosition )
         TEX_MIPMAP,
         TEX_FILTER,
         TEX_CLAMP,
-        TEX_SRGB
+        TEX_SRGB,
+        TEX_STREAM
     };
 
     const int index = luaL_checkoption(l, stackPosition, NULL, optionNames);
@@ -81,6 +85,87 @@ static int Lua_CreateCubeTexture( lua_State* l )
     }
 }
 
+static void PushTextureArrayPlacementToLua( lua_State* l,
+                                            const TextureArrayPlacement* placement )
+{
+    lua_createtable(l, 4, 0);
+    lua_pushinteger(l, placement->array+1);
+    lua_rawseti(l, -2, 1);
+    lua_pushinteger(l, placement->layer);
+    lua_rawseti(l, -2, 2);
+    lua_pushnumber(l, placement->texCoordScale._[0]);
+    lua_rawseti(l, -2, 3);
+    lua_pushnumber(l, placement->texCoordScale._[1]);
+    lua_rawseti(l, -2, 4);
+}
+
+/**
+ * Packs the images into as few texture arrays as possible.
+ *
+ * @return
+ * A list of textures and a placement for each image.
+ */
+static int Lua_CreateTextureArrays( lua_State* l )
+{
+    luaL_checktype(l, 1, LUA_TTABLE);
+    const int imageCount = lua_rawlen(l, 1);
+    const int options = ReadTextureOptions(l, 2);
+
+    // Scratch memory is allocated as user data, so it's collected when one
+    // of the checks below raises an error:
+    const Image** images =
+        (const Image**)lua_newuserdata(l, sizeof(Image*)*imageCount);
+    const Image** layers =
+        (const Image**)lua_newuserdata(l, sizeof(Image*)*imageCount);
+    TextureArrayImage* sizes =
+        (TextureArrayImage*)lua_newuserdata(l, sizeof(TextureArrayImage)*imageCount);
+    REPEAT(imageCount, i)
+    {
+        lua_rawgeti(l, 1, i+1);
+        images[i] = CheckImageFromLua(l, -1);
+        lua_pop(l, 1);
+        sizes[i].width        = GetImageWidth(images[i]);
+        sizes[i].height       = GetImageHeight(images[i]);
+        sizes[i].channelCount = GetImageChannelCount(images[i]);
+    }
+
+    TextureArrayPacking packing;
+    PackTextureArrays(&packing, sizes, imageCount, MAX_TEXTURE_ARRAY_LAYERS);
+
+    lua_createtable(l, packing.arrays.length, 0);
+    REPEAT(packing.arrays.length, i)
+    {
+        const TextureArrayLayout* layout = &packing.arrays.data[i];
+        REPEAT(imageCount, j)
+        {
+            const TextureArrayPlacement* placement = &packing.placements.data[j];
+            if(placement->array == i)
+                layers[placement->layer] = images[j];
+        }
+
+        Texture* texture = CreateArrayTexture(layers,
+                                              layout->layerCount,
+                                              layout->width,
+                                              layout->height,
+                                              options);
+        if(!texture)
+            FatalError("Failed to create texture array!");
+        PushPointerToLua(l, texture);
+        ReferenceTexture(texture);
+        lua_rawseti(l, -2, i+1);
+    }
+
+    lua_createtable(l, imageCount, 0);
+    REPEAT(imageCount, i)
+    {
+        PushTextureArrayPlacementToLua(l, &packing.placements.data[i]);
+        lua_rawseti(l, -2, i+1);
+    }
+
+    DestroyTextureArrayPacking(&packing);
+    return 2;
+}
+
 static int Lua_DestroyTexture( lua_State* l )
 {
     Texture* texture = CheckTextureFromLua(l, 1);
@@ -98,9 +183,29 @@ Texture* CheckTextureFromLua( lua_State* l, int stackPosition )
     return (Texture*)CheckPointerFromLua(l, stackPosition);
 }
 
+bool GetTextureArrayPlacementFromLua( lua_State* l,
+                                      int stackPosition,
+                                      TextureArrayPlacement* placement )
+{
+    if(lua_isnoneornil(l, stackPosition))
+        return false;
+    luaL_checktype(l, stackPosition, LUA_TTABLE);
+    lua_rawgeti(l, stackPosition, 1);
+    placement->array = luaL_checkinteger(l, -1) - 1;
+    lua_rawgeti(l, stackPosition, 2);
+    placement->layer = luaL_checkinteger(l, -1);
+    lua_rawgeti(l, stackPosition, 3);
+    placement->texCoordScale._[0] = luaL_checknumber(l, -1);
+    lua_rawgeti(l, stackPosition, 4);
+    placement->texCoordScale._[1] = luaL_checknumber(l, -1);
+    lua_pop(l, 4);
+    return true;
+}
+
 void RegisterTextureInLua()
 {
     RegisterFunctionInLua("Create2dTexture", Lua_Create2dTexture);
     RegisterFunctionInLua("CreateCubeTexture", Lua_CreateCubeTexture);
+    RegisterFunctionInLua("CreateTextureArrays", Lua_CreateTextureArrays);
     RegisterFunctionInLua("DestroyTexture", Lua_DestroyTexture);
 }
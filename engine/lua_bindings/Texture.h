@@ -3,10 +3,21 @@
 
 struct lua_State;
 struct Texture;
+struct TextureArrayPlacement;
 
 Texture* GetTextureFromLua( lua_State* l, int stackPosition );
 Texture* CheckTextureFromLua( lua_State* l, int stackPosition );
 
+/**
+ * Reads a placement table as returned by `CreateTextureArrays`.
+ *
+ * @return
+ * `false` if the value is `nil`.
+ */
+bool GetTextureArrayPlacementFromLua( lua_State* l,
+                                      int stackPosition,
+                                      TextureArrayPlacement* placement );
+
 void RegisterTextureInLua();
 
 #endif
@@ -1,19 +1,59 @@
+#include <string.h> // memcpy
+
 #include "../Common.h"
+#include "../Array.h"
 #include "../Lua.h"
 #include "../Vfs.h"
 #include "Vfs.h"
+#include "JobManager.h"
 
 
-static int Lua_ReadFile( lua_State* l )
+struct LuaFileJob
 {
-    const char* vfsPath = luaL_checkstring(l, 1);
-    VfsFile* file = OpenVfsFile(vfsPath, VFS_OPEN_READ);
+    char vfsPath[MAX_PATH_SIZE];
+    VfsOpenMode mode;
+    char* content;
+    int contentSize;
+};
+
+/**
+ * File jobs which were started, but not completed by Lua yet.
+ */
+static Array<JobId> PendingFileJobs;
 
-    const int fileSize = GetVfsFileSize(file);
-    char* fileContent = (char*)Alloc(fileSize);
-    ReadVfsFile(file, fileContent, fileSize);
+
+static void WriteWholeVfsFile( const char* vfsPath,
+                               VfsOpenMode mode,
+                               const char* content,
+                               int contentSize )
+{
+    VfsFile* file = OpenVfsFile(vfsPath, mode);
+    if(content)
+        WriteVfsFile(file, content, contentSize);
     CloseVfsFile(file);
+}
+
+static VfsOpenMode CheckWriteModeFromLua( lua_State* l, int stackPosition )
+{
+    const char* modeStr = luaL_checkstring(l, stackPosition);
+    if(modeStr[0] == 'w')
+        return VFS_OPEN_WRITE;
+    else if(modeStr[0] == 'a')
+        return VFS_OPEN_APPEND;
+    else
+    {
+        FatalError("Unknown mode '%c'.", modeStr[0]);
+        return VFS_OPEN_WRITE;
+    }
+}
 
+static int Lua_ReadFile( lua_State* l )
+{
+    const char* vfsPath = luaL_checkstring(l, 1);
+    int fileSize;
+    char* fileContent = ReadWholeVfsFile(vfsPath, &fileSize);
+    if(!fileContent)
+        return luaL_error(l, "Can't read %s", vfsPath);
     lua_pushlstring(l, fileContent, fileSize);
     Free(fileContent);
     return 1;
@@ -24,27 +64,128 @@ static int Lua_WriteFile( lua_State* l )
     const char* vfsPath = luaL_checkstring(l, 1);
     size_t contentSize;
     const char* content = lua_tolstring(l, 2, &contentSize);
-    const char* modeStr = luaL_checkstring(l, 3);
+    const VfsOpenMode mode = CheckWriteModeFromLua(l, 3);
+    WriteWholeVfsFile(vfsPath, mode, content, (int)contentSize);
+    return 0;
+}
 
-    VfsOpenMode mode;
-    if(modeStr[0] == 'w')
-        mode = VFS_OPEN_WRITE;
-    else if(modeStr[0] == 'a')
-        mode = VFS_OPEN_APPEND;
+
+// --- File jobs ---
+
+static void ProcessLuaFileJob( void* _job )
+{
+    LuaFileJob* job = (LuaFileJob*)_job;
+    if(job->mode == VFS_OPEN_READ)
+        job->content = ReadWholeVfsFile(job->vfsPath, &job->contentSize);
     else
+        WriteWholeVfsFile(job->vfsPath, job->mode, job->content, job->contentSize);
+}
+
+static void DestroyLuaFileJob( void* _job )
+{
+    LuaFileJob* job = (LuaFileJob*)_job;
+    if(job->content)
+        Free(job->content);
+    DELETE(job);
+}
+
+static JobId BeginLuaFileJob( const char* name, LuaFileJob* job )
+{
+    const JobId id = CreateJob({name,
+                                ProcessLuaFileJob,
+                                DestroyLuaFileJob,
+                                job});
+    AppendToArray(&PendingFileJobs, 1, &id);
+    return id;
+}
+
+static int Lua_BeginReadFile( lua_State* l )
+{
+    const char* vfsPath = luaL_checkstring(l, 1);
+
+    LuaFileJob* job = NEW(LuaFileJob);
+    CopyString(vfsPath, job->vfsPath, MAX_PATH_SIZE);
+    job->mode = VFS_OPEN_READ;
+
+    PushJobToLua(l, BeginLuaFileJob("ReadFile", job));
+    return 1;
+}
+
+/**
+ * The content is copied, so the job doesn't depend on the Lua state.
+ */
+static int Lua_BeginWriteFile( lua_State* l )
+{
+    const char* vfsPath = luaL_checkstring(l, 1);
+    size_t contentSize;
+    const char* content = lua_tolstring(l, 2, &contentSize);
+    const VfsOpenMode mode = CheckWriteModeFromLua(l, 3);
+
+    LuaFileJob* job = NEW(LuaFileJob);
+    CopyString(vfsPath, job->vfsPath, MAX_PATH_SIZE);
+    job->mode = mode;
+    if(content)
     {
-        FatalError("Unknown mode '%c'.", modeStr[0]);
-        mode = VFS_OPEN_WRITE;
+        job->content = (char*)Alloc(contentSize);
+        job->contentSize = (int)contentSize;
+        memcpy(job->content, content, contentSize);
     }
 
-    VfsFile* file = OpenVfsFile(vfsPath, mode);
+    PushJobToLua(l, BeginLuaFileJob("WriteFile", job));
+    return 1;
+}
 
-    if(content)
-        WriteVfsFile(file, content, (int)contentSize);
-    CloseVfsFile(file);
-    return 0;
+static int FindPendingFileJob( JobId id )
+{
+    REPEAT(PendingFileJobs.length, i)
+        if(PendingFileJobs.data[i] == id)
+            return i;
+    return -1;
+}
+
+/**
+ * Removes a completed file job.  Read jobs return the file content.
+ */
+static int Lua_CompleteFileJob( lua_State* l )
+{
+    const JobId id = CheckJobFromLua(l, 1);
+    const int index = FindPendingFileJob(id);
+    luaL_argcheck(l, index != -1, 1, "not a pending file job");
+    luaL_argcheck(l, GetJobStatus(id) == COMPLETED_JOB, 1, "job is not completed yet");
+
+    const LuaFileJob* job = (const LuaFileJob*)GetJobData(id);
+    int resultCount = 0;
+    bool failed = false;
+    if(job->mode == VFS_OPEN_READ)
+    {
+        if(job->content)
+            lua_pushlstring(l, job->content, job->contentSize);
+        else
+            failed = true;
+        resultCount = 1;
+    }
+
+    char vfsPath[MAX_PATH_SIZE];
+    CopyString(job->vfsPath, vfsPath, MAX_PATH_SIZE);
+    RemoveFromArray(&PendingFileJobs, index, 1);
+    RemoveJob(id);
+
+    if(failed)
+        return luaL_error(l, "Can't read %s", vfsPath);
+    return resultCount;
 }
 
+void CompleteLuaFileJobs()
+{
+    WaitForJobs(PendingFileJobs.data, PendingFileJobs.length);
+    REPEAT(PendingFileJobs.length, i)
+        RemoveJob(PendingFileJobs.data[i]);
+    DestroyArray(&PendingFileJobs);
+}
+
+
+// --- File system access ---
+
 static int Lua_GetDirEntries( lua_State* l )
 {
     const char* vfsPath = luaL_checkstring(l, 1);
@@ -103,8 +244,13 @@ static int Lua_MakeDir( lua_State* l )
 
 void RegisterVfsInLua()
 {
+    InitArray(&PendingFileJobs);
+
     RegisterFunctionInLua("ReadFile", Lua_ReadFile);
     RegisterFunctionInLua("WriteFile", Lua_WriteFile);
+    RegisterFunctionInLua("BeginReadFile", Lua_BeginReadFile);
+    RegisterFunctionInLua("BeginWriteFile", Lua_BeginWriteFile);
+    RegisterFunctionInLua("CompleteFileJob", Lua_CompleteFileJob);
     RegisterFunctionInLua("GetDirEntries", Lua_GetDirEntries);
     RegisterFunctionInLua("GetFileType", Lua_GetFileType);
     RegisterFunctionInLua("DeleteFile", Lua_DeleteFile);
@@ -3,4 +3,10 @@
 
 void RegisterVfsInLua();
 
+/**
+ * Waits for file jobs, which were started by Lua but never completed, and
+ * removes them.  Call this after #DestroyLua, so no write gets lost.
+ */
+void CompleteLuaFileJobs();
+
 #endif
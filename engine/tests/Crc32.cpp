@@ -11,6 +11,23 @@ InlineTest("CalcCrc32For*")
     Require(CalcCrc32ForString(buffer)    == checksum);
 }
 
+InlineTest("ContinueCrc32")
+{
+    InitCrc32();
+    const uint32_t prefixChecksum = CalcCrc32ForString("foo");
+    Require(ContinueCrc32(prefixChecksum, "bar", 3) ==
+            CalcCrc32ForString("foobar"));
+}
+
+InlineTest("CalcConstCrc32ForString")
+{
+    static_assert(CalcConstCrc32ForString("foobar") == 0x9EF61F95,
+                  "Compile time checksum is wrong.");
+    Require(CalcConstCrc32ForString("") == CalcCrc32ForString(""));
+    Require(CalcConstCrc32ForString("ModelViewProjection") ==
+            CalcCrc32ForString("ModelViewProjection"));
+}
+
 int main( int argc, char** argv )
 {
     InitTests(argc, argv);
@@ -0,0 +1,340 @@
+#include <string.h> // memset
+
+#include "../DrawList.h"
+#include "../Shader.h"
+#include "TestTools.h"
+
+
+// Draw keys only compare pointers, so fake objects are sufficient:
+static const ShaderProgram* ProgramA = (const ShaderProgram*)1;
+static const ShaderProgram* ProgramB = (const ShaderProgram*)2;
+static const Mesh* MeshA = (const Mesh*)1;
+static const Mesh* MeshB = (const Mesh*)2;
+static const Texture* TextureA = (const Texture*)1;
+static const Texture* TextureB = (const Texture*)2;
+
+static DrawKey CreateKey( const ShaderProgram* program,
+                          const Mesh* mesh,
+                          bool instanced )
+{
+    DrawKey key;
+    memset(&key, 0, sizeof(key));
+    key.program = program;
+    key.mesh = mesh;
+    key.instanced = instanced;
+    return key;
+}
+
+static void RequireCommand( const DrawCommandList* commands,
+                            int index,
+                            DrawCommandType type,
+                            int firstEntry,
+                            int entryCount )
+{
+    Require(index < commands->length);
+    const DrawCommand* command = &commands->data[index];
+    Require(command->type == type);
+    Require(command->firstEntry == firstEntry);
+    Require(command->entryCount == entryCount);
+}
+
+
+InlineTest("Keys which are not instanced are never merged")
+{
+    const DrawKey keys[] = {CreateKey(ProgramA, MeshA, false),
+                            CreateKey(ProgramA, MeshA, false),
+                            CreateKey(ProgramA, MeshA, false)};
+
+    DrawCommandList commands;
+    InitArray(&commands);
+    GenerateDrawCommands(&commands, keys, 3, MAX_DRAW_INSTANCES);
+
+    Require(commands.length == 3);
+    RequireCommand(&commands, 0, DRAW_COMMAND, 0, 1);
+    RequireCommand(&commands, 1, DRAW_COMMAND, 1, 1);
+    RequireCommand(&commands, 2, DRAW_COMMAND, 2, 1);
+    DestroyArray(&commands);
+}
+
+InlineTest("Equal instanced keys are merged")
+{
+    const DrawKey keys[] = {CreateKey(ProgramA, MeshA, true),
+                            CreateKey(ProgramA, MeshA, true),
+                            CreateKey(ProgramA, MeshA, true),
+                            CreateKey(ProgramA, MeshB, true),
+                            CreateKey(ProgramB, MeshB, true),
+                            CreateKey(ProgramB, MeshB, false)};
+
+    DrawCommandList commands;
+    InitArray(&commands);
+    GenerateDrawCommands(&commands, keys, 6, MAX_DRAW_INSTANCES);
+
+    Require(commands.length == 4);
+    RequireCommand(&commands, 0, DRAW_INSTANCED_COMMAND, 0, 3);
+    RequireCommand(&commands, 1, DRAW_INSTANCED_COMMAND, 3, 1);
+    RequireCommand(&commands, 2, DRAW_INSTANCED_COMMAND, 4, 1);
+    RequireCommand(&commands, 3, DRAW_COMMAND, 5, 1);
+    DestroyArray(&commands);
+}
+
+InlineTest("Differing textures and overlay levels split instanced runs")
+{
+    DrawKey keys[] = {CreateKey(ProgramA, MeshA, true),
+                      CreateKey(ProgramA, MeshA, true),
+                      CreateKey(ProgramA, MeshA, true),
+                      CreateKey(ProgramA, MeshA, true)};
+    keys[0].textureCount = 1;
+    keys[0].textures[0]  = TextureA;
+    keys[1].textureCount = 1;
+    keys[1].textures[0]  = TextureB;
+    keys[2].textureCount = 1;
+    keys[2].textures[0]  = TextureB;
+    keys[3].textureCount = 1;
+    keys[3].textures[0]  = TextureB;
+    keys[3].overlayLevel = 1;
+
+    DrawCommandList commands;
+    InitArray(&commands);
+    GenerateDrawCommands(&commands, keys, 4, MAX_DRAW_INSTANCES);
+
+    Require(commands.length == 3);
+    RequireCommand(&commands, 0, DRAW_INSTANCED_COMMAND, 0, 1);
+    RequireCommand(&commands, 1, DRAW_INSTANCED_COMMAND, 1, 2);
+    RequireCommand(&commands, 2, DRAW_INSTANCED_COMMAND, 3, 1);
+    DestroyArray(&commands);
+}
+
+InlineTest("Model variables split instanced runs only if they differ")
+{
+    ShaderVariableSet* a = CreateShaderVariableSet();
+    ShaderVariableSet* b = CreateShaderVariableSet();
+    ShaderVariableSet* c = CreateShaderVariableSet();
+    SetFloatUniform(a, "Glow", 1);
+    SetFloatUniform(b, "Glow", 1);
+    SetFloatUniform(c, "Glow", 2);
+
+    DrawKey keys[] = {CreateKey(ProgramA, MeshA, true),
+                      CreateKey(ProgramA, MeshA, true),
+                      CreateKey(ProgramA, MeshA, true),
+                      CreateKey(ProgramA, MeshA, true)};
+    keys[0].variableSet = a;
+    keys[1].variableSet = b;
+    keys[2].variableSet = c;
+    keys[3].variableSet = NULL;
+
+    DrawCommandList commands;
+    InitArray(&commands);
+    GenerateDrawCommands(&commands, keys, 4, MAX_DRAW_INSTANCES);
+
+    Require(commands.length == 3);
+    RequireCommand(&commands, 0, DRAW_INSTANCED_COMMAND, 0, 2);
+    RequireCommand(&commands, 1, DRAW_INSTANCED_COMMAND, 2, 1);
+    RequireCommand(&commands, 2, DRAW_INSTANCED_COMMAND, 3, 1);
+    DestroyArray(&commands);
+
+    FreeShaderVariableSet(a);
+    FreeShaderVariableSet(b);
+    FreeShaderVariableSet(c);
+}
+
+InlineTest("Differing lights split instanced runs")
+{
+    ShaderVariableSet* a = CreateShaderVariableSet();
+    ShaderVariableSet* b = CreateShaderVariableSet();
+    ShaderVariableSet* c = CreateShaderVariableSet();
+    SetIntUniform(a, "LightCount", 1);
+    SetIntUniform(b, "LightCount", 1);
+    SetIntUniform(c, "LightCount", 2);
+
+    DrawKey keys[] = {CreateKey(ProgramA, MeshA, true),
+                      CreateKey(ProgramA, MeshA, true),
+                      CreateKey(ProgramA, MeshA, true)};
+    keys[0].lightVariableSet = a;
+    keys[1].lightVariableSet = b;
+    keys[2].lightVariableSet = c;
+
+    DrawCommandList commands;
+    InitArray(&commands);
+    GenerateDrawCommands(&commands, keys, 3, MAX_DRAW_INSTANCES);
+
+    Require(commands.length == 2);
+    RequireCommand(&commands, 0, DRAW_INSTANCED_COMMAND, 0, 2);
+    RequireCommand(&commands, 1, DRAW_INSTANCED_COMMAND, 2, 1);
+    DestroyArray(&commands);
+
+    FreeShaderVariableSet(a);
+    FreeShaderVariableSet(b);
+    FreeShaderVariableSet(c);
+}
+
+InlineTest("Detail levels of a mesh are multi drawn instead of instanced")
+{
+    DrawKey keys[] = {CreateKey(ProgramA, MeshA, true),
+                      CreateKey(ProgramA, MeshA, true),
+                      CreateKey(ProgramA, MeshA, true)};
+    keys[2].lod = 1;
+
+    DrawCommandList commands;
+    InitArray(&commands);
+
+    GenerateDrawCommands(&commands, keys, 3, MAX_DRAW_INSTANCES);
+    Require(commands.length == 2);
+    RequireCommand(&commands, 0, DRAW_INSTANCED_COMMAND, 0, 2);
+    RequireCommand(&commands, 1, DRAW_INSTANCED_COMMAND, 2, 1);
+
+    REPEAT(3, i)
+        keys[i].multiDrawGroup = 1;
+    GenerateDrawCommands(&commands, keys, 3, MAX_DRAW_INSTANCES);
+    Require(commands.length == 1);
+    RequireCommand(&commands, 0, DRAW_MULTI_COMMAND, 0, 3);
+
+    DestroyArray(&commands);
+}
+
+InlineTest("Instanced runs are limited by the maximum instance count")
+{
+    DrawKey keys[7];
+    REPEAT(7, i)
+        keys[i] = CreateKey(ProgramA, MeshA, true);
+
+    DrawCommandList commands;
+    InitArray(&commands);
+    GenerateDrawCommands(&commands, keys, 7, 3);
+
+    Require(commands.length == 3);
+    RequireCommand(&commands, 0, DRAW_INSTANCED_COMMAND, 0, 3);
+    RequireCommand(&commands, 1, DRAW_INSTANCED_COMMAND, 3, 3);
+    RequireCommand(&commands, 2, DRAW_INSTANCED_COMMAND, 6, 1);
+    DestroyArray(&commands);
+}
+
+InlineTest("Keys with meshes of the same group are multi drawn")
+{
+    DrawKey keys[] = {CreateKey(ProgramA, MeshA, true),
+                      CreateKey(ProgramA, MeshA, true),
+                      CreateKey(ProgramA, MeshB, true),
+                      CreateKey(ProgramA, MeshB, true),
+                      CreateKey(ProgramB, MeshB, true)};
+    REPEAT(5, i)
+        keys[i].multiDrawGroup = 1;
+
+    DrawCommandList commands;
+    InitArray(&commands);
+    GenerateDrawCommands(&commands, keys, 5, MAX_DRAW_INSTANCES);
+
+    Require(commands.length == 2);
+    RequireCommand(&commands, 0, DRAW_MULTI_COMMAND, 0, 4);
+    RequireCommand(&commands, 1, DRAW_INSTANCED_COMMAND, 4, 1);
+    DestroyArray(&commands);
+}
+
+InlineTest("Differing multi draw groups split multi draw runs")
+{
+    const Mesh* meshC = (const Mesh*)3;
+    const Mesh* meshD = (const Mesh*)4;
+    DrawKey keys[] = {CreateKey(ProgramA, MeshA, true),
+                      CreateKey(ProgramA, MeshB, true),
+                      CreateKey(ProgramA, meshC, true),
+                      CreateKey(ProgramA, meshD, true),
+                      CreateKey(ProgramA, MeshA, true)};
+    keys[0].multiDrawGroup = 1;
+    keys[1].multiDrawGroup = 1;
+    keys[2].multiDrawGroup = 2;
+    keys[3].multiDrawGroup = 0; // Can't be multi drawn at all
+    keys[4].multiDrawGroup = 1;
+
+    DrawCommandList commands;
+    InitArray(&commands);
+    GenerateDrawCommands(&commands, keys, 5, MAX_DRAW_INSTANCES);
+
+    Require(commands.length == 4);
+    RequireCommand(&commands, 0, DRAW_MULTI_COMMAND, 0, 2);
+    RequireCommand(&commands, 1, DRAW_INSTANCED_COMMAND, 2, 1);
+    RequireCommand(&commands, 2, DRAW_INSTANCED_COMMAND, 3, 1);
+    RequireCommand(&commands, 3, DRAW_INSTANCED_COMMAND, 4, 1);
+    DestroyArray(&commands);
+}
+
+InlineTest("Differing lights split multi draw runs")
+{
+    ShaderVariableSet* a = CreateShaderVariableSet();
+    ShaderVariableSet* b = CreateShaderVariableSet();
+    SetIntUniform(a, "LightCount", 1);
+    SetIntUniform(b, "LightCount", 2);
+
+    const Mesh* meshC = (const Mesh*)3;
+    DrawKey keys[] = {CreateKey(ProgramA, MeshA, true),
+                      CreateKey(ProgramA, MeshB, true),
+                      CreateKey(ProgramA, meshC, true)};
+    REPEAT(3, i)
+        keys[i].multiDrawGroup = 1;
+    keys[0].lightVariableSet = a;
+    keys[1].lightVariableSet = a;
+    keys[2].lightVariableSet = b;
+
+    DrawCommandList commands;
+    InitArray(&commands);
+    GenerateDrawCommands(&commands, keys, 3, MAX_DRAW_INSTANCES);
+
+    Require(commands.length == 2);
+    RequireCommand(&commands, 0, DRAW_MULTI_COMMAND, 0, 2);
+    RequireCommand(&commands, 1, DRAW_INSTANCED_COMMAND, 2, 1);
+    DestroyArray(&commands);
+
+    FreeShaderVariableSet(a);
+    FreeShaderVariableSet(b);
+}
+
+InlineTest("Multi draw runs are limited by the maximum instance count")
+{
+    DrawKey keys[5];
+    REPEAT(5, i)
+    {
+        keys[i] = CreateKey(ProgramA, (i % 2) ? MeshA : MeshB, true);
+        keys[i].multiDrawGroup = 1;
+    }
+
+    DrawCommandList commands;
+    InitArray(&commands);
+    GenerateDrawCommands(&commands, keys, 5, 2);
+
+    Require(commands.length == 3);
+    RequireCommand(&commands, 0, DRAW_MULTI_COMMAND, 0, 2);
+    RequireCommand(&commands, 1, DRAW_MULTI_COMMAND, 2, 2);
+    RequireCommand(&commands, 2, DRAW_INSTANCED_COMMAND, 4, 1);
+    DestroyArray(&commands);
+}
+
+InlineTest("Indirect commands merge consecutive equal ranges")
+{
+    const MeshDrawRange ranges[] = {{0,   6, 0},
+                                    {0,   6, 0},
+                                    {6,  12, 4},
+                                    {0,   6, 0},
+                                    {18,  3, 10},
+                                    {18,  3, 10},
+                                    {18,  3, 10}};
+
+    IndirectDrawCommand commands[7];
+    const int commandCount = GenerateIndirectDrawCommands(commands, ranges, 7);
+
+    Require(commandCount == 4);
+    const IndirectDrawCommand expected[] = {{6,  2, 0,  0,  0},
+                                            {12, 1, 6,  4,  2},
+                                            {6,  1, 0,  0,  3},
+                                            {3,  3, 18, 10, 4}};
+    REPEAT(4, i)
+    {
+        Require(commands[i].count         == expected[i].count);
+        Require(commands[i].instanceCount == expected[i].instanceCount);
+        Require(commands[i].firstIndex    == expected[i].firstIndex);
+        Require(commands[i].baseVertex    == expected[i].baseVertex);
+        Require(commands[i].baseInstance  == expected[i].baseInstance);
+    }
+}
+
+int main( int argc, char** argv )
+{
+    InitTests(argc, argv);
+    return RunTests();
+}
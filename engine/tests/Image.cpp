@@ -181,6 +181,39 @@ InlineTest("CreateResizedImage")
     ReleaseImage(resizedImage);
 }
 
+InlineTest("CreateMipmaps")
+{
+    Require(CalcMipmapCount(32, 32) == 6);
+    Require(CalcMipmapCount(32, 8) == 6);
+    Require(CalcMipmapCount(1, 1) == 1);
+    Require(CalcMipmapCount(5, 3) == 3); // 5x3, 2x1, 1x1
+
+    Image* image = LoadImage("data/Image/checker.png");
+
+    const JobId job = BeginCreatingMipmaps(image, false);
+    WaitForJobs(&job, 1);
+    Require(GetCreatedMipmapCount(job) == 6);
+    Require(GetCreatedMipmap(job, 0) == image);
+
+    int size = 32;
+    REPEAT(6, i)
+    {
+        const Image* level = GetCreatedMipmap(job, i);
+        Require(GetImageWidth(level) == size);
+        Require(GetImageHeight(level) == size);
+        Require(GetImageChannelCount(level) == 3);
+        size /= 2;
+    }
+
+    // Box filtering averages each 2x2 block of the checker board:
+    const Image* level = GetCreatedMipmap(job, 1);
+    Require(GetPixel(level,  0,  0) == 0x808080);
+    Require(GetPixel(level, 15, 15) == 0x808080);
+
+    RemoveJob(job);
+    ReleaseImage(image);
+}
+
 
 int main( int argc, char** argv )
 {
@@ -0,0 +1,119 @@
+#include <math.h> // INFINITY
+
+#include "../Common.h"
+#include "../NullOpenGL.h"
+#include "../RenderCommandQueue.h"
+#include "../Shader.h"
+#include "../LightWorld.h"
+#include "TestTools.h"
+
+
+static const Vec3 Origin = {{0, 0, 0}};
+static const Vec3 FarAway = {{1000, 0, 0}};
+
+static void InitLightWorldTest()
+{
+    InitNullOpenGL();
+    InitShader();
+    InitRenderCommandQueue({false, NULL, NULL});
+}
+
+static void DestroyLightWorldTest()
+{
+    DestroyRenderCommandQueue();
+    DestroyShader();
+    DestroyNullOpenGL();
+}
+
+static LightWorld* CreateTestLightWorld()
+{
+    LightWorld* world = CreateLightWorld("lightCount", "lightPosition");
+    ReferenceLightWorld(world);
+    SetMaxActiveLightCount(world, 1);
+    return world;
+}
+
+static Light* CreatePointLight( LightWorld* world,
+                                Vec3 position,
+                                float value )
+{
+    Light* light = CreateLight(world, POINT_LIGHT);
+    ReferenceLight(light);
+    SetLightTransformation(light, TranslateMat4(Mat4Identity, position));
+    SetLightValue(light, value);
+    return light;
+}
+
+/**
+ * Whether the only light of the world is selected for the given object.
+ */
+static bool SelectsLight( const LightWorld* world,
+                          Vec3 lightPosition,
+                          Vec3 objectPosition,
+                          float objectRadius )
+{
+    ShaderVariableSet* generated = CreateShaderVariableSet();
+    ShaderVariableSet* expected = CreateShaderVariableSet();
+
+    GenerateLightShaderVariables(world, generated, objectPosition, objectRadius);
+    SetIntUniform(expected, "lightCount", 1);
+    SetVec3Uniform(expected, "lightPosition[0]", lightPosition);
+    const bool selected = ShaderVariableSetsAreEqual(generated, expected);
+
+    FreeShaderVariableSet(generated);
+    FreeShaderVariableSet(expected);
+    return selected;
+}
+
+InlineTest("Point lights are only selected by objects in nearby grid cells")
+{
+    InitLightWorldTest();
+    LightWorld* world = CreateTestLightWorld();
+    Light* light = CreatePointLight(world, Origin, 1);
+    UpdateLights(world);
+
+    Require(SelectsLight(world, Origin, Origin, 1));
+    Require(!SelectsLight(world, Origin, FarAway, 1));
+
+    // Objects which cover too many cells consider all lights:
+    Require(SelectsLight(world, Origin, FarAway, 10000));
+    Require(SelectsLight(world, Origin, FarAway, INFINITY));
+    Require(SelectsLight(world, Origin, FarAway, NAN));
+
+    ReleaseLight(light);
+    ReleaseLightWorld(world);
+    DestroyLightWorldTest();
+}
+
+InlineTest("Lights which would cover too many grid cells are unbound")
+{
+    InitLightWorldTest();
+    LightWorld* world = CreateTestLightWorld();
+    Light* light = CreatePointLight(world, Origin, 1e12f);
+    UpdateLights(world);
+    Require(SelectsLight(world, Origin, FarAway, 1));
+
+    // Radii, whose grid coordinates don't fit into an int:
+    SetLightValue(light, 1e30f);
+    UpdateLights(world);
+    Require(SelectsLight(world, Origin, FarAway, 1));
+
+    SetLightValue(light, INFINITY);
+    UpdateLights(world);
+    Require(SelectsLight(world, Origin, FarAway, 1));
+
+    SetLightValue(light, 1);
+    SetLightRange(light, INFINITY);
+    UpdateLights(world);
+    Require(SelectsLight(world, Origin, FarAway, 1));
+
+    ReleaseLight(light);
+    ReleaseLightWorld(world);
+    DestroyLightWorldTest();
+}
+
+int main( int argc, char** argv )
+{
+    InitTests(argc, argv);
+    return RunTests();
+}
@@ -1,5 +1,9 @@
-#include <string.h> // memset
+#include <string.h> // memset, strlen, strstr
+#include <atomic> // std::atomic
+#include <tinycthread.h> // thrd_*
+#include "../Common.h"
 #include "../JobManager.h"
+#include "../Vfs.h"
 #include "../Lua.h"
 #include "TestTools.h"
 
@@ -14,7 +18,7 @@ static int Lua_AddOne( lua_State* l )
 InlineTest("can be initialized and destroyed")
 {
     InitJobManager({1});
-    InitLua();
+    InitLua(GetTestLuaConfig());
 
     SetLuaWorkerCount(1);
 
@@ -25,7 +29,7 @@ InlineTest("can be initialized and destroyed")
 InlineTest("can register functions")
 {
     InitJobManager({1});
-    InitLua();
+    InitLua(GetTestLuaConfig());
 
     REGISTER_LUA_FUNCTION(AddOne);
 
@@ -35,6 +39,576 @@ InlineTest("can register functions")
     DestroyJobManager();
 }
 
+static void WriteTestFile( const char* vfsPath, const char* content, int size )
+{
+    VfsFile* file = OpenVfsFile(vfsPath, VFS_OPEN_WRITE);
+    WriteVfsFile(file, content, size);
+    CloseVfsFile(file);
+}
+
+/**
+ * @return
+ * Number of files in the cache directory.  Writes the path of the last one
+ * to `vfsPath`.
+ */
+static int CountLuaCacheFiles( char* vfsPath )
+{
+    int count = 0;
+    PathList entries = GetVfsDirEntries("shared-state/lua-cache");
+    REPEAT(entries.length, i)
+    {
+        Require(strstr(entries.data[i].str, ".tmp") == NULL);
+        FormatBuffer(vfsPath, MAX_PATH_SIZE, "shared-state/lua-cache/%s",
+                     entries.data[i].str);
+        count++;
+    }
+    DestroyPathList(&entries);
+    return count;
+}
+
+static void RequireScriptResult( const char* vfsPath, int expectedResult )
+{
+    lua_State* l = luaL_newstate();
+    Require(LoadLuaScript(l, vfsPath));
+    lua_call(l, 0, 1);
+    Require(lua_tointeger(l, -1) == expectedResult);
+    lua_close(l);
+}
+
+InlineTest("corrupted bytecode cache files are replaced")
+{
+    InitVfs("test", NULL, NULL);
+    LuaConfig config = GetTestLuaConfig();
+    config.bytecodeCache = true;
+    InitLua(config);
+
+    const char* source = "local a = 20\nreturn a + 22\n";
+    WriteTestFile("state/script.lua", source, strlen(source));
+
+    RequireScriptResult("state/script.lua", 42); // compiles and fills the cache
+    char cachePath[MAX_PATH_SIZE];
+    Require(CountLuaCacheFiles(cachePath) == 1);
+    RequireScriptResult("state/script.lua", 42); // loads from the cache
+
+    // Flip a byte in the bytecode, but keep header and size intact:
+    int size = 0;
+    char* cache = ReadWholeVfsFile(cachePath, &size);
+    Require(cache != NULL);
+    cache[size-1] ^= 0xFF;
+    WriteTestFile(cachePath, cache, size);
+    Free(cache);
+
+    RequireScriptResult("state/script.lua", 42); // recompiles
+    Require(CountLuaCacheFiles(cachePath) == 1);
+    RequireScriptResult("state/script.lua", 42);
+
+    DestroyLua();
+    DestroyVfs();
+}
+
+// --- Worker tests ---
+
+static const int TEST_WORKER_COUNT = 4;
+
+static int CheckedMessageFrames;
+
+static int Lua_CheckMessages( lua_State* l )
+{
+    const int frame = luaL_checkinteger(l, 1);
+    luaL_checktype(l, 2, LUA_TTABLE);
+
+    // Each worker sent three messages:
+    Require(lua_rawlen(l, 2) == TEST_WORKER_COUNT*3);
+    REPEAT(TEST_WORKER_COUNT*3, i)
+    {
+        lua_rawgeti(l, 2, i+1);
+        const int message = lua_gettop(l);
+        Require(lua_rawlen(l, message) == 4);
+
+        lua_rawgeti(l, message, 1);
+        Require(lua_tointeger(l, -1) == i/3); // sender
+        lua_rawgeti(l, message, 2);
+        Require(lua_tointeger(l, -1) == frame);
+        lua_rawgeti(l, message, 3);
+        Require(lua_tointeger(l, -1) == i%3+1); // sent in this order
+
+        lua_rawgeti(l, message, 4);
+        Require(lua_rawlen(l, -1) == 2);
+        lua_rawgeti(l, -1, 1);
+        Require(lua_tonumber(l, -1) == 0.5);
+        lua_rawgeti(l, -2, 2);
+        Require(lua_tonumber(l, -1) == 9223372036854775808.0);
+
+        lua_settop(l, 2);
+    }
+    CheckedMessageFrames++;
+    return 0;
+}
+
+InlineTest("messages are delivered ordered by sender")
+{
+    InitLuaWorkerTest("core/test/Messages.lua", GetTestLuaConfig());
+    REGISTER_LUA_FUNCTION(CheckMessages);
+    SetLuaWorkerCount(TEST_WORKER_COUNT);
+
+    CheckedMessageFrames = 0;
+    RunLuaWorkerFrames(3);
+    Require(CheckedMessageFrames == 3);
+
+    DestroyLuaWorkerTest();
+}
+
+enum TestEventType
+{
+    FIRST_TEST_EVENT,
+    LAST_TEST_EVENT,
+    ACCUMULATED_TEST_EVENT,
+    MANY_TEST_EVENT,
+    LIMITED_TEST_EVENT,
+    LIMITED_LAST_TEST_EVENT,
+    TEST_EVENT_TYPE_COUNT
+};
+
+// Policies are set by core/test/Events.lua:
+static const char* TEST_EVENT_NAMES[TEST_EVENT_TYPE_COUNT] =
+{
+    "first",
+    "last",
+    "accumulate",
+    "many",
+    "limited",
+    "limited-last"
+};
+
+static const int MANY_TEST_EVENT_KEYS = 100; // Enough to resize the table.
+static const int LIMITED_TEST_EVENTS = 5;
+static const int MAX_LIMITED_TEST_EVENTS = 2;
+
+static LuaEventListener TestEventListeners[TEST_EVENT_TYPE_COUNT];
+static int CheckedEventFrames;
+
+static int Lua_CreateTestEventListeners( lua_State* l )
+{
+    REPEAT(TEST_EVENT_TYPE_COUNT, i)
+        TestEventListeners[i] = GetLuaEventListener(l, TEST_EVENT_NAMES[i]);
+    return 0;
+}
+
+static void QueueTestEvent( TestEventType type, double a, double b )
+{
+    const double values[2] = {a, b};
+    QueueLuaEvent(TestEventListeners[type], values, 2);
+}
+
+static int Lua_QueueTestEvents( lua_State* l )
+{
+    QueueTestEvent(FIRST_TEST_EVENT, 1, 10);
+    QueueTestEvent(FIRST_TEST_EVENT, 2, 20);
+    QueueTestEvent(FIRST_TEST_EVENT, 1, 11);
+
+    QueueTestEvent(LAST_TEST_EVENT, 1, 10);
+    QueueTestEvent(LAST_TEST_EVENT, 2, 20);
+    QueueTestEvent(LAST_TEST_EVENT, 1, 11);
+
+    QueueTestEvent(ACCUMULATED_TEST_EVENT, 1, 10);
+    QueueTestEvent(ACCUMULATED_TEST_EVENT, 2, 20);
+    QueueTestEvent(ACCUMULATED_TEST_EVENT, 1, 11);
+
+    // Both values form the key:
+    REPEAT(2, i)
+        REPEAT(MANY_TEST_EVENT_KEYS, j)
+            QueueTestEvent(MANY_TEST_EVENT, j, -j);
+    QueueTestEvent(MANY_TEST_EVENT, 0, 1);
+
+    REPEAT(LIMITED_TEST_EVENTS, i)
+        QueueTestEvent(LIMITED_TEST_EVENT, i, 0);
+
+    // Only the first key passes the limit:
+    QueueTestEvent(LIMITED_LAST_TEST_EVENT, 1, 10);
+    QueueTestEvent(LIMITED_LAST_TEST_EVENT, 2, 20);
+    QueueTestEvent(LIMITED_LAST_TEST_EVENT, 1, 11);
+    QueueTestEvent(LIMITED_LAST_TEST_EVENT, 2, 21);
+    return 0;
+}
+
+/**
+ * Reads the numeric event at `index` (starting at one) of the event list,
+ * which is at stack position one.
+ *
+ * @return
+ * Number of values.
+ */
+static int ReadTestEvent( lua_State* l,
+                          int index,
+                          int* count,
+                          double* values,
+                          int maxValueCount )
+{
+    lua_rawgeti(l, 1, index);
+    const int event = lua_gettop(l);
+    Require(lua_rawlen(l, event) == 2);
+
+    lua_rawgeti(l, event, 1);
+    *count = lua_tointeger(l, -1);
+
+    lua_rawgeti(l, event, 2);
+    const int array = lua_gettop(l);
+    lua_len(l, array);
+    const int valueCount = lua_tointeger(l, -1);
+    Require(valueCount <= maxValueCount);
+    REPEAT(valueCount, i)
+    {
+        lua_pushinteger(l, i+1);
+        lua_gettable(l, array);
+        values[i] = lua_tonumber(l, -1);
+        lua_pop(l, 1);
+    }
+
+    lua_settop(l, event-1);
+    return valueCount;
+}
+
+/**
+ * Checks the event at `*index` in the event list and advances the index.
+ */
+static void RequireTestEvent( lua_State* l,
+                              int* index,
+                              int count,
+                              double a,
+                              double b )
+{
+    (*index)++;
+    int eventCount = 0;
+    double values[2];
+    Require(ReadTestEvent(l, *index, &eventCount, values, 2) == 2);
+    Require(eventCount == count);
+    Require(values[0] == a);
+    Require(values[1] == b);
+}
+
+static int Lua_CheckTestEvents( lua_State* l )
+{
+    if(lua_isnoneornil(l, 1))
+        return 0; // No events were queued before the first frame.
+    luaL_checktype(l, 1, LUA_TTABLE);
+
+    // Filters are flushed in the order in which they were created.  Their
+    // events keep the order in which the keys were seen first.
+    int index = 0;
+    RequireTestEvent(l, &index, 2, 1, 10);
+    RequireTestEvent(l, &index, 1, 2, 20);
+
+    RequireTestEvent(l, &index, 2, 1, 11);
+    RequireTestEvent(l, &index, 1, 2, 20);
+
+    RequireTestEvent(l, &index, 2, 1, 21);
+    RequireTestEvent(l, &index, 1, 2, 20);
+
+    REPEAT(MANY_TEST_EVENT_KEYS, i)
+        RequireTestEvent(l, &index, 2, i, -i);
+    RequireTestEvent(l, &index, 1, 0, 1);
+
+    REPEAT(MAX_LIMITED_TEST_EVENTS, i)
+        RequireTestEvent(l, &index, 1, i, 0);
+
+    RequireTestEvent(l, &index, 2, 1, 11);
+
+    Require((int)lua_rawlen(l, 1) == index);
+    CheckedEventFrames++;
+    return 0;
+}
+
+InlineTest("events are coalesced and limited according to their policy")
+{
+    InitLuaWorkerTest("core/test/Events.lua", GetTestLuaConfig());
+    REGISTER_LUA_FUNCTION(CreateTestEventListeners);
+    RegisterThreadSafeLuaFunction("QueueTestEvents", Lua_QueueTestEvents);
+    RegisterThreadSafeLuaFunction("CheckTestEvents", Lua_CheckTestEvents);
+    SetLuaWorkerCount(1);
+
+    CheckedEventFrames = 0;
+    REPEAT(3, i)
+    {
+        RunLuaWorkerFrames(1);
+        const LuaStatistics statistics = GetLuaStatistics();
+        // Dropped events aren't counted as coalesced:
+        Require(statistics.coalescedEventCount == 3 + MANY_TEST_EVENT_KEYS + 1);
+        Require(statistics.droppedEventCount ==
+                LIMITED_TEST_EVENTS - MAX_LIMITED_TEST_EVENTS + 2);
+    }
+    Require(CheckedEventFrames == 2);
+
+    DestroyLuaWorkerTest();
+}
+
+static const int PRODUCER_COUNT = 4;
+static const int EVENTS_PER_PRODUCER = 2000;
+static const int MAX_LIMITED_PRODUCER_EVENTS = 10; // per frame
+
+enum ProducerTestEventType
+{
+    ORDERED_PRODUCER_EVENT,
+    LATEST_PRODUCER_EVENT,
+    LIMITED_PRODUCER_EVENT,
+    PRODUCER_EVENT_TYPE_COUNT
+};
+
+// Policies are set by core/test/Producers.lua:
+static const char* PRODUCER_EVENT_NAMES[PRODUCER_EVENT_TYPE_COUNT] =
+{
+    "ordered",
+    "latest",
+    "limited"
+};
+
+static LuaEventListener ProducerEventListeners[PRODUCER_EVENT_TYPE_COUNT];
+static std::atomic<int> FinishedProducerCount;
+
+/**
+ * What the worker received from each producer so far.
+ */
+struct ReceivedProducerEvents
+{
+    int count[PRODUCER_EVENT_TYPE_COUNT]; // Delivered events
+    int lastSequence[PRODUCER_EVENT_TYPE_COUNT];
+    int latestFrame; // In which a `latest` event was delivered.
+    int latestEventCount; // Events represented by the `latest` events
+};
+static ReceivedProducerEvents ReceivedEvents[PRODUCER_COUNT];
+static int ReceivedEventFrame;
+
+static int Lua_CreateProducerTestListeners( lua_State* l )
+{
+    REPEAT(PRODUCER_EVENT_TYPE_COUNT, i)
+        ProducerEventListeners[i] = GetLuaEventListener(l, PRODUCER_EVENT_NAMES[i]);
+    return 0;
+}
+
+static int ProduceTestEvents( void* producer_ )
+{
+    const int producer = (int)(intptr_t)producer_;
+    REPEAT(EVENTS_PER_PRODUCER, i)
+    {
+        REPEAT(PRODUCER_EVENT_TYPE_COUNT, type)
+        {
+            const double values[3] = {(double)type, (double)producer, (double)i};
+            QueueLuaEvent(ProducerEventListeners[type], values, 3);
+        }
+        if(i % 100 == 0)
+            thrd_yield(); // Spread the events over multiple frames.
+    }
+    FinishedProducerCount++;
+    return 0;
+}
+
+static int Lua_RecordProducerTestEvents( lua_State* l )
+{
+    ReceivedEventFrame++;
+    if(lua_isnoneornil(l, 1))
+        return 0;
+    luaL_checktype(l, 1, LUA_TTABLE);
+
+    int limitedEventCount = 0;
+    const int eventCount = lua_rawlen(l, 1);
+    REPEAT(eventCount, i)
+    {
+        int count = 0;
+        double values[3];
+        Require(ReadTestEvent(l, i+1, &count, values, 3) == 3);
+        const int type = (int)values[0];
+        const int producer = (int)values[1];
+        const int sequence = (int)values[2];
+        Require(type >= 0 && type < PRODUCER_EVENT_TYPE_COUNT);
+        Require(producer >= 0 && producer < PRODUCER_COUNT);
+
+        ReceivedProducerEvents* received = &ReceivedEvents[producer];
+        switch(type)
+        {
+            case ORDERED_PRODUCER_EVENT:
+                // Nothing is lost or reordered:
+                Require(sequence == received->lastSequence[type]+1);
+                break;
+
+            case LATEST_PRODUCER_EVENT:
+                // One event per producer and frame:
+                Require(received->latestFrame != ReceivedEventFrame);
+                received->latestFrame = ReceivedEventFrame;
+                received->latestEventCount += count;
+                Require(sequence > received->lastSequence[type]);
+                break;
+
+            case LIMITED_PRODUCER_EVENT:
+                limitedEventCount++;
+                Require(sequence > received->lastSequence[type]);
+                break;
+        }
+        received->count[type]++;
+        received->lastSequence[type] = sequence;
+    }
+    Require(limitedEventCount <= MAX_LIMITED_PRODUCER_EVENTS);
+    return 0;
+}
+
+InlineTest("events of concurrent producers keep their order")
+{
+    InitLuaWorkerTest("core/test/Producers.lua", GetTestLuaConfig());
+    REGISTER_LUA_FUNCTION(CreateProducerTestListeners);
+    RegisterThreadSafeLuaFunction("RecordProducerTestEvents",
+                                  Lua_RecordProducerTestEvents);
+    SetLuaWorkerCount(1);
+
+    memset(ReceivedEvents, 0, sizeof(ReceivedEvents));
+    REPEAT(PRODUCER_COUNT, i)
+        REPEAT(PRODUCER_EVENT_TYPE_COUNT, type)
+            ReceivedEvents[i].lastSequence[type] = -1;
+    ReceivedEventFrame = 0;
+    FinishedProducerCount = 0;
+
+    thrd_t producers[PRODUCER_COUNT];
+    REPEAT(PRODUCER_COUNT, i)
+        Ensure(thrd_create(&producers[i],
+                           ProduceTestEvents,
+                           (void*)(intptr_t)i) == thrd_success);
+
+    int coalescedEventCount = 0;
+    int droppedEventCount = 0;
+    int remainingFrames = 2; // One merges the last events, one delivers them.
+    while(remainingFrames > 0)
+    {
+        if(FinishedProducerCount == PRODUCER_COUNT)
+            remainingFrames--;
+        RunLuaWorkerFrames(1);
+        const LuaStatistics statistics = GetLuaStatistics();
+        coalescedEventCount += statistics.coalescedEventCount;
+        droppedEventCount   += statistics.droppedEventCount;
+    }
+
+    REPEAT(PRODUCER_COUNT, i)
+        Ensure(thrd_join(producers[i], NULL) == thrd_success);
+
+    int latestEventCount = 0;
+    int limitedEventCount = 0;
+    REPEAT(PRODUCER_COUNT, i)
+    {
+        const ReceivedProducerEvents* received = &ReceivedEvents[i];
+        Require(received->count[ORDERED_PRODUCER_EVENT] == EVENTS_PER_PRODUCER);
+        Require(received->lastSequence[LATEST_PRODUCER_EVENT] == EVENTS_PER_PRODUCER-1);
+        Require(received->latestEventCount == EVENTS_PER_PRODUCER);
+        latestEventCount  += received->count[LATEST_PRODUCER_EVENT];
+        limitedEventCount += received->count[LIMITED_PRODUCER_EVENT];
+    }
+    Require(coalescedEventCount ==
+            PRODUCER_COUNT*EVENTS_PER_PRODUCER - latestEventCount);
+    Require(droppedEventCount ==
+            PRODUCER_COUNT*EVENTS_PER_PRODUCER - limitedEventCount);
+
+    DestroyLuaWorkerTest();
+}
+
+static LuaEventListener ShortLivedProducerListener;
+
+static int Lua_RunTest( lua_State* l )
+{
+    ShortLivedProducerListener = GetLuaEventListener(l, "short-lived");
+    return 0;
+}
+
+static int ProduceShortLivedTestEvent( void* producer_ )
+{
+    const double value = (double)(intptr_t)producer_;
+    QueueLuaEvent(ShortLivedProducerListener, &value, 1);
+    return 0;
+}
+
+InlineTest("producer slots are released when their thread exits")
+{
+    InitLuaWorkerTest("core/test/Call.lua", GetTestLuaConfig());
+    REGISTER_LUA_FUNCTION(RunTest);
+    SetLuaWorkerCount(1);
+
+    // More threads than producer slots, but only one at a time:
+    REPEAT(100, i)
+    {
+        thrd_t producer;
+        Ensure(thrd_create(&producer,
+                           ProduceShortLivedTestEvent,
+                           (void*)(intptr_t)i) == thrd_success);
+        Ensure(thrd_join(producer, NULL) == thrd_success);
+        if(i % 10 == 0)
+            RunLuaWorkerFrames(1);
+    }
+    RunLuaWorkerFrames(1);
+
+    DestroyLuaWorkerTest();
+}
+
+static bool FullGcRequested;
+
+static int Lua_ShouldCollectGarbage( lua_State* l )
+{
+    lua_pushboolean(l, FullGcRequested);
+    FullGcRequested = false;
+    return 1;
+}
+
+static void InitGarbageTest( double gcTimeBudget, float gcPace )
+{
+    LuaConfig config = GetTestLuaConfig();
+    config.gcTimeBudget = gcTimeBudget;
+    config.gcPace = gcPace;
+    InitLuaWorkerTest("core/test/Garbage.lua", config);
+    REGISTER_LUA_FUNCTION(ShouldCollectGarbage);
+    FullGcRequested = false;
+    SetLuaWorkerCount(1);
+}
+
+static LuaStatistics RunGarbageTestFrame()
+{
+    RunLuaWorkerFrames(1);
+    return GetLuaStatistics();
+}
+
+InlineTest("garbage collection stops when the time budget is used up")
+{
+    InitGarbageTest(0, 1000);
+    REPEAT(10, i)
+        Require(RunGarbageTestFrame().gcStepCount == 1); // At least one step
+    DestroyLuaWorkerTest();
+}
+
+InlineTest("garbage collection keeps pace with the allocations")
+{
+    // Little work per allocated kilobyte:
+    InitGarbageTest(10, 0.001f);
+    REPEAT(10, i)
+        Require(RunGarbageTestFrame().gcStepCount == 1);
+    DestroyLuaWorkerTest();
+
+    // Much work per allocated kilobyte:
+    InitGarbageTest(10, 1000);
+    int stepCount = 0;
+    REPEAT(10, i)
+        stepCount += RunGarbageTestFrame().gcStepCount;
+    Require(stepCount > 10);
+    DestroyLuaWorkerTest();
+}
+
+InlineTest("CollectGarbage forces a full collection cycle")
+{
+    InitGarbageTest(10, 0.001f); // Lets garbage pile up.
+    int64_t memory = 0;
+    REPEAT(10, i)
+        memory = RunGarbageTestFrame().memory;
+
+    FullGcRequested = true;
+    RunGarbageTestFrame(); // The serial phase requests the collection.
+    const LuaStatistics statistics = RunGarbageTestFrame();
+    Require(statistics.gcStepCount == 0);
+    Require(statistics.memory < memory);
+
+    DestroyLuaWorkerTest();
+}
+
 int main( int argc, char** argv )
 {
     InitTests(argc, argv);
@@ -0,0 +1,80 @@
+#include <string.h> // memset
+#include "../LuaAllocator.h"
+#include "TestTools.h"
+
+
+InlineTest("Freed blocks are reused")
+{
+    LuaAllocator allocator;
+    InitLuaAllocator(&allocator);
+
+    void* a = ReallocLuaMemory(&allocator, NULL, 0, 20);
+    void* b = ReallocLuaMemory(&allocator, NULL, 0, 32);
+    Require(a != b);
+    Require(allocator.usedBytes == 52);
+    Require(allocator.pooledBytes == 64);
+    Require(allocator.reservedBytes == LUA_POOL_SLAB_SIZE);
+
+    Require(ReallocLuaMemory(&allocator, a, 20, 0) == NULL);
+    Require(ReallocLuaMemory(&allocator, NULL, 0, 30) == a);
+    Require(allocator.pooledBytes == 64);
+
+    ReallocLuaMemory(&allocator, a, 30, 0);
+    ReallocLuaMemory(&allocator, b, 32, 0);
+    Require(allocator.usedBytes == 0);
+    Require(allocator.pooledBytes == 0);
+
+    DestroyLuaAllocator(&allocator);
+}
+
+InlineTest("Object type is ignored for new allocations")
+{
+    LuaAllocator allocator;
+    InitLuaAllocator(&allocator);
+
+    // Lua passes the type of new objects (e.g. LUA_TTABLE) as old size:
+    void* a = ReallocLuaMemory(&allocator, NULL, 5, 16);
+    Require(allocator.usedBytes == 16);
+    ReallocLuaMemory(&allocator, a, 16, 0);
+
+    DestroyLuaAllocator(&allocator);
+}
+
+InlineTest("Contents are preserved when growing")
+{
+    LuaAllocator allocator;
+    InitLuaAllocator(&allocator);
+
+    char* data = (char*)ReallocLuaMemory(&allocator, NULL, 0, 8);
+    memset(data, 'a', 8);
+
+    // Stays in its block:
+    Require(ReallocLuaMemory(&allocator, data, 8, 16) == data);
+
+    // Moves to another pool:
+    data = (char*)ReallocLuaMemory(&allocator, data, 16, 100);
+    memset(data+16, 'b', 84);
+
+    // Moves out of the pools:
+    data = (char*)ReallocLuaMemory(&allocator, data, 100, 1000);
+    Require(allocator.largeBytes == 1000);
+    Require(allocator.pooledBytes == 0);
+    Require(data[0] == 'a' && data[7] == 'a');
+    Require(data[16] == 'b' && data[99] == 'b');
+
+    // And back in again:
+    data = (char*)ReallocLuaMemory(&allocator, data, 1000, 8);
+    Require(allocator.largeBytes == 0);
+    Require(data[0] == 'a' && data[7] == 'a');
+
+    ReallocLuaMemory(&allocator, data, 8, 0);
+    Require(allocator.usedBytes == 0);
+
+    DestroyLuaAllocator(&allocator);
+}
+
+int main( int argc, char** argv )
+{
+    InitTests(argc, argv);
+    return RunTests();
+}
@@ -0,0 +1,123 @@
+#include <stdlib.h> // srand, rand, realloc, free
+#include <time.h> // clock
+
+#include "../Common.h"
+#include "../Config.h"
+#include "../LuaAllocator.h"
+#include "TestTools.h"
+
+
+int LoopCount;
+int ObjectCount;
+float LargeObjectChance;
+
+
+struct Object
+{
+    void* pointer;
+    size_t size;
+};
+
+typedef void* (*ReallocFn)( void* userData,
+                            void* pointer,
+                            size_t oldSize,
+                            size_t newSize );
+
+/**
+ * Like the allocator of `luaL_newstate`.
+ */
+static void* ReallocWithLibC( void* userData,
+                              void* pointer,
+                              size_t oldSize,
+                              size_t newSize )
+{
+    if(newSize == 0)
+    {
+        free(pointer);
+        return NULL;
+    }
+    else
+    {
+        return realloc(pointer, newSize);
+    }
+}
+
+/**
+ * Most Lua objects are small: strings, closures, table headers and
+ * vectors.  Few are large, like the array part of big tables.
+ */
+static size_t GetRandomObjectSize()
+{
+    if(rand() < (int)(LargeObjectChance * (float)RAND_MAX))
+        return 257 + rand() % 4096;
+    else
+        return 16 + rand() % 112;
+}
+
+/**
+ * Replaces random objects, so the heap is fragmented like a long running
+ * Lua state.
+ *
+ * @return
+ * CPU time in seconds.
+ */
+static double MeasureAllocations( ReallocFn reallocFn, void* userData )
+{
+    srand(42);
+    Object* objects = NEW_ARRAY(Object, ObjectCount);
+
+    const clock_t startTime = clock();
+    REPEAT(ObjectCount, i)
+    {
+        Object* object = &objects[i];
+        object->size = GetRandomObjectSize();
+        object->pointer = reallocFn(userData, NULL, 0, object->size);
+    }
+    REPEAT(LoopCount, i)
+    {
+        Object* object = &objects[rand() % ObjectCount];
+        const size_t newSize = GetRandomObjectSize();
+        if(rand() % 4 == 0) // Grow or shrink like table arrays do.
+        {
+            object->pointer = reallocFn(userData, object->pointer, object->size, newSize);
+        }
+        else
+        {
+            reallocFn(userData, object->pointer, object->size, 0);
+            object->pointer = reallocFn(userData, NULL, 0, newSize);
+        }
+        object->size = newSize;
+    }
+    REPEAT(ObjectCount, i)
+        reallocFn(userData, objects[i].pointer, objects[i].size, 0);
+    const clock_t endTime = clock();
+
+    DELETE_ARRAY(objects, ObjectCount);
+    return (double)(endTime - startTime) / (double)CLOCKS_PER_SEC;
+}
+
+InlineTest("Pooled allocator vs. libc")
+{
+    const double libcTime = MeasureAllocations(ReallocWithLibC, NULL);
+
+    LuaAllocator allocator;
+    InitLuaAllocator(&allocator);
+    const double pooledTime = MeasureAllocations(ReallocLuaMemory, &allocator);
+    const int reservedBytes = allocator.reservedBytes;
+    const int allocationCount = allocator.allocationCount;
+    DestroyLuaAllocator(&allocator);
+
+    LogNotice("%d objects, %d allocations:", ObjectCount, allocationCount);
+    LogNotice("libc: %.3f ms", libcTime*1000.0);
+    LogNotice("Pooled: %.3f ms", pooledTime*1000.0);
+    LogNotice("Pool reserve: %d KiB", reservedBytes/1024);
+}
+
+int main( int argc, char** argv )
+{
+    InitTests(argc, argv);
+    LoopCount = GetConfigInt("test.loop-count", 1000);
+    ObjectCount = GetConfigInt("test.object-count", 1000);
+    LargeObjectChance = GetConfigFloat("test.large-object-chance", 0.05);
+    return RunTests();
+}
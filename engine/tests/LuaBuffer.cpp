@@ -1,3 +1,6 @@
+#include <string.h> // strcmp
+#include <math.h> // signbit, isinf, isnan, INFINITY, NAN
+#include "../Common.h" // REPEAT, FormatBuffer
 #include "../Lua.h"
 #include "../LuaBuffer.h"
 #include "TestTools.h"
@@ -56,6 +59,277 @@ InlineTest("Basic Test")
     lua_close(l);
 }
 
+static int Lua_TestCopies( lua_State* l )
+{
+    Require(lua_gettop(l) == 100);
+    REPEAT(100, i)
+    {
+        char expected[16];
+        FormatBuffer(expected, sizeof(expected), "string %d", i);
+        Require(strcmp(lua_tostring(l, i+1), expected) == 0);
+    }
+    return 0;
+}
+
+InlineTest("Copied strings stay valid while the buffer grows")
+{
+    lua_State* l = luaL_newstate();
+    lua_gc(l, LUA_GCSTOP, 0); // only collect manually
+
+    LuaBuffer* buffer = CreateLuaBuffer(NATIVE_LUA_BUFFER);
+    ReferenceLuaBuffer(buffer);
+
+    REPEAT(100, i)
+    {
+        char string[16];
+        FormatBuffer(string, sizeof(string), "string %d", i);
+        AddStringToLuaBuffer(buffer, string, 0, 0);
+    }
+
+    lua_pushcfunction(l, Lua_TestCopies);
+    const int args = PushLuaBufferToLua(buffer, l);
+    lua_call(l, args, 0);
+
+    ReleaseLuaBuffer(buffer);
+    lua_close(l);
+}
+
+static int Lua_TestValues( lua_State* l )
+{
+    Require(lua_gettop(l) == 3);
+    Require(lua_toboolean(l, 1) == true);
+    Require(lua_tonumber(l, 2) == 0.5);
+    Require(lua_type(l, 3) == LUA_TTABLE);
+    Require(lua_rawlen(l, 3) == 2);
+    lua_rawgeti(l, 3, 1);
+    Require(strcmp(lua_tostring(l, -1), "foo") == 0);
+    lua_rawgeti(l, 3, 2);
+    Require(lua_tointeger(l, -1) == 42);
+    lua_pop(l, 2);
+    return 0;
+}
+
+InlineTest("Lua values can be copied")
+{
+    lua_State* l = luaL_newstate();
+    lua_gc(l, LUA_GCSTOP, 0); // only collect manually
+
+    LuaBuffer* buffer = CreateLuaBuffer(NATIVE_LUA_BUFFER);
+    ReferenceLuaBuffer(buffer);
+
+    lua_pushboolean(l, true);
+    lua_pushnumber(l, 0.5);
+    lua_createtable(l, 2, 0);
+    lua_pushstring(l, "foo");
+    lua_rawseti(l, -2, 1);
+    lua_pushinteger(l, 42);
+    lua_rawseti(l, -2, 2);
+    AddLuaValuesToLuaBuffer(buffer, l, 1, 3);
+    lua_settop(l, 0);
+
+    lua_pushcfunction(l, Lua_TestValues);
+    const int args = PushLuaBufferToLua(buffer, l);
+    lua_call(l, args, 0);
+
+    ReleaseLuaBuffer(buffer);
+    lua_close(l);
+}
+
+static const lua_Number NumbersToCopy[] =
+{
+    42,
+    -7,
+    0.5,
+    -0.0,
+    9007199254740992.0, // 2^53
+    9223372036854775808.0, // 2^63 - beyond the lua_Integer range
+    -1e300,
+    INFINITY,
+    -INFINITY
+};
+static const int NUMBER_TO_COPY_COUNT = sizeof(NumbersToCopy)/sizeof(lua_Number);
+
+static int Lua_TestNumbers( lua_State* l )
+{
+    Require(lua_gettop(l) == NUMBER_TO_COPY_COUNT+1);
+    REPEAT(NUMBER_TO_COPY_COUNT, i)
+    {
+        const lua_Number number = lua_tonumber(l, i+1);
+        Require(number == NumbersToCopy[i]);
+        Require(signbit(number) == signbit(NumbersToCopy[i]));
+    }
+    Require(isnan(lua_tonumber(l, NUMBER_TO_COPY_COUNT+1)));
+    return 0;
+}
+
+InlineTest("Numbers keep their value and sign")
+{
+    lua_State* l = luaL_newstate();
+    lua_gc(l, LUA_GCSTOP, 0); // only collect manually
+
+    LuaBuffer* buffer = CreateLuaBuffer(NATIVE_LUA_BUFFER);
+    ReferenceLuaBuffer(buffer);
+
+    REPEAT(NUMBER_TO_COPY_COUNT, i)
+        lua_pushnumber(l, NumbersToCopy[i]);
+    lua_pushnumber(l, NAN);
+    AddLuaValuesToLuaBuffer(buffer, l, 1, NUMBER_TO_COPY_COUNT+1);
+    lua_settop(l, 0);
+
+    lua_pushcfunction(l, Lua_TestNumbers);
+    const int args = PushLuaBufferToLua(buffer, l);
+    lua_call(l, args, 0);
+
+    ReleaseLuaBuffer(buffer);
+    lua_close(l);
+}
+
+static LuaBuffer* RejectedValueBuffer;
+
+static int Lua_AddRejectedValue( lua_State* l )
+{
+    AddLuaValuesToLuaBuffer(RejectedValueBuffer, l, 1, 1);
+    return 0;
+}
+
+/**
+ * Whether adding the value on top of the stack raises an error.  The value
+ * is popped.
+ */
+static bool IsValueRejected( lua_State* l, LuaBuffer* buffer )
+{
+    RejectedValueBuffer = buffer;
+    lua_pushcfunction(l, Lua_AddRejectedValue);
+    lua_insert(l, -2);
+    const bool rejected = lua_pcall(l, 1, 0, 0) != LUA_OK;
+    if(rejected)
+        lua_pop(l, 1); // pop error message
+    return rejected;
+}
+
+static void PushNestedTables( lua_State* l, int depth )
+{
+    lua_newtable(l);
+    REPEAT(depth-1, i)
+    {
+        lua_newtable(l);
+        lua_insert(l, -2);
+        lua_rawseti(l, -2, 1);
+    }
+}
+
+InlineTest("Cyclic and too deeply nested tables are rejected")
+{
+    lua_State* l = luaL_newstate();
+    LuaBuffer* buffer = CreateLuaBuffer(NATIVE_LUA_BUFFER);
+    ReferenceLuaBuffer(buffer);
+
+    lua_newtable(l);
+    lua_pushvalue(l, -1);
+    lua_rawseti(l, -2, 1);
+    Require(IsValueRejected(l, buffer));
+
+    PushNestedTables(l, 100000);
+    Require(IsValueRejected(l, buffer));
+
+    PushNestedTables(l, 10);
+    Require(!IsValueRejected(l, buffer));
+
+    ReleaseLuaBuffer(buffer);
+    lua_close(l);
+}
+
+static int Lua_TestArrays( lua_State* l )
+{
+    Require(lua_gettop(l) == 2);
+
+    Require(lua_type(l, 1) == LUA_TUSERDATA);
+    lua_len(l, 1);
+    Require(lua_tointeger(l, -1) == 3);
+    lua_pop(l, 1);
+    lua_pushinteger(l, 3);
+    lua_gettable(l, 1);
+    Require(lua_tonumber(l, -1) == 0.5);
+    lua_pop(l, 1);
+
+    lua_getfield(l, 2, "recordCount");
+    Require(lua_tointeger(l, -1) == 2);
+    lua_getfield(l, 2, "recordSize");
+    Require(lua_tointeger(l, -1) == 2);
+    lua_pushinteger(l, 4);
+    lua_gettable(l, 2);
+    Require(lua_tointeger(l, -1) == -4);
+    lua_pop(l, 3);
+    return 0;
+}
+
+InlineTest("Packed arrays can be indexed")
+{
+    lua_State* l = luaL_newstate();
+    lua_gc(l, LUA_GCSTOP, 0); // only collect manually
+
+    LuaBuffer* buffer = CreateLuaBuffer(NATIVE_LUA_BUFFER);
+    ReferenceLuaBuffer(buffer);
+
+    const float floats[] = {1.5, 2.5, 0.5};
+    const int32_t records[] = {-1, -2, -3, -4};
+    AddFloatArrayToLuaBuffer(buffer, floats, 3);
+    AddRecordsToLuaBuffer(buffer, LUA_BUFFER_INT32_ARRAY, records, 2, 2);
+
+    lua_pushcfunction(l, Lua_TestArrays);
+    const int args = PushLuaBufferToLua(buffer, l);
+    lua_call(l, args, 0);
+
+    ReleaseLuaBuffer(buffer);
+    lua_close(l);
+}
+
+static int Lua_TestAppended( lua_State* l )
+{
+    Require(lua_gettop(l) == 1);
+    Require(lua_rawlen(l, 1) == 3);
+    lua_rawgeti(l, 1, 1);
+    Require(strcmp(lua_tostring(l, -1), "first") == 0);
+    lua_rawgeti(l, 1, 2);
+    Require(lua_rawlen(l, -1) == 2);
+    lua_rawgeti(l, -1, 2);
+    Require(strcmp(lua_tostring(l, -1), "nested") == 0);
+    lua_rawgeti(l, 1, 3);
+    Require(lua_tointeger(l, -1) == 42);
+    lua_pop(l, 4);
+    return 0;
+}
+
+InlineTest("Buffers can be appended to open lists")
+{
+    lua_State* l = luaL_newstate();
+    lua_gc(l, LUA_GCSTOP, 0); // only collect manually
+
+    LuaBuffer* buffer = CreateLuaBuffer(NATIVE_LUA_BUFFER);
+    LuaBuffer* source = CreateLuaBuffer(NATIVE_LUA_BUFFER);
+    ReferenceLuaBuffer(buffer);
+    ReferenceLuaBuffer(source);
+
+    AddStringToLuaBuffer(source, "first", 0, 0);
+    BeginListInLuaBuffer(source);
+    AddNilToLuaBuffer(source);
+    AddStringToLuaBuffer(source, "nested", 0, 0);
+    EndListInLuaBuffer(source);
+
+    BeginListInLuaBuffer(buffer);
+    AppendLuaBuffer(buffer, source);
+    ReleaseLuaBuffer(source); // The copies must not refer to it.
+    AddIntegerToLuaBuffer(buffer, 42);
+    EndListInLuaBuffer(buffer);
+
+    lua_pushcfunction(l, Lua_TestAppended);
+    const int args = PushLuaBufferToLua(buffer, l);
+    lua_call(l, args, 0);
+
+    ReleaseLuaBuffer(buffer);
+    lua_close(l);
+}
+
 int main( int argc, char** argv )
 {
     InitTests(argc, argv);
@@ -1,5 +1,5 @@
 #include <stdlib.h> // srand, rand, RAND_MAX
-#include <time.h> // time
+#include <time.h> // time, clock
 
 #include "../Lua.h"
 #include "../LuaBuffer.h"
@@ -13,6 +13,7 @@ int InnerLoopCount;
 int ValueCount;
 int ListStartChance;
 int ListEndChance;
+int EventCount;
 
 
 static int Lua_Test( lua_State* l )
@@ -75,6 +76,82 @@ InlineTest("Basic Test")
     }
 }
 
+static int Lua_ConsumeEvents( lua_State* l )
+{
+    Require(lua_gettop(l) == 1);
+    Require(lua_rawlen(l, 1) == (size_t)EventCount);
+    return 0;
+}
+
+/**
+ * Fills the buffer with collision-like events - either as a list of numbers
+ * or as packed arrays.
+ *
+ * @return
+ * CPU time in seconds.
+ */
+static double MeasureEvents( bool packed )
+{
+    lua_State* l = luaL_newstate();
+    lua_gc(l, LUA_GCSTOP, 0); // only collect manually
+
+    LuaBuffer* buffer = CreateLuaBuffer(NATIVE_LUA_BUFFER);
+    ReferenceLuaBuffer(buffer);
+
+    const uint32_t solids[2] = {1, 2};
+    float values[13];
+    REPEAT(13, i)
+        values[i] = (float)i;
+
+    const clock_t startTime = clock();
+    REPEAT(OuterLoopCount, i)
+    {
+        BeginListInLuaBuffer(buffer);
+        REPEAT(EventCount, j)
+        {
+            BeginListInLuaBuffer(buffer);
+            if(packed)
+            {
+                AddUInt32ArrayToLuaBuffer(buffer, solids, 2);
+                AddFloatArrayToLuaBuffer(buffer, values, 13);
+            }
+            else
+            {
+                REPEAT(2, k)
+                    AddIntegerToLuaBuffer(buffer, solids[k]);
+                REPEAT(13, k)
+                    AddNumberToLuaBuffer(buffer, values[k]);
+            }
+            EndListInLuaBuffer(buffer);
+        }
+        EndListInLuaBuffer(buffer);
+
+        lua_pushcfunction(l, Lua_ConsumeEvents);
+        const int args = PushLuaBufferToLua(buffer, l);
+        lua_call(l, args, 0);
+
+        ClearLuaBuffer(buffer);
+        lua_gc(l, LUA_GCCOLLECT, 0);
+    }
+    const clock_t endTime = clock();
+
+    ReleaseLuaBuffer(buffer);
+    lua_close(l);
+
+    return (double)(endTime - startTime) /
+           (double)CLOCKS_PER_SEC /
+           (double)OuterLoopCount;
+}
+
+InlineTest("Packed arrays vs. lists")
+{
+    const double listTime = MeasureEvents(false);
+    const double packedTime = MeasureEvents(true);
+    LogNotice("%d events per frame:", EventCount);
+    LogNotice("Lists: %.3f ms", listTime*1000.0);
+    LogNotice("Packed arrays: %.3f ms", packedTime*1000.0);
+}
+
 int main( int argc, char** argv )
 {
     InitTests(argc, argv);
@@ -83,6 +160,7 @@ int main( int argc, char** argv )
     ValueCount = GetConfigInt("test.value-count", 1);
     ListStartChance = (int)((double)GetConfigFloat("test.list-start-chance", 0) * (double)RAND_MAX);
     ListEndChance   = (int)((double)GetConfigFloat("test.list-end-chance", 0.1) * (double)RAND_MAX);
+    EventCount = GetConfigInt("test.event-count", 1000);
     srand((int)time(NULL));
     return RunTests();
 }
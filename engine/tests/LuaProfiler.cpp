@@ -0,0 +1,100 @@
+#include <string.h> // strstr
+#include "../LuaProfiler.h"
+#include "TestTools.h"
+
+
+static const char* SCRIPT =
+    "local function busy()\n"
+    "    local x = 0\n"
+    "    for i = 1, 200000 do x = x + i end\n"
+    "    return x\n"
+    "end\n"
+    "local function caller()\n"
+    "    return busy()+busy()\n"
+    "end\n"
+    "caller()\n";
+
+static const LuaProfilerFunction* FindFunction( const LuaProfiler* profiler,
+                                                const char* name )
+{
+    REPEAT(profiler->functions.length, i)
+    {
+        const LuaProfilerFunction* function = profiler->functions.data[i];
+        if(strstr(function->name, name))
+            return function;
+    }
+    return NULL;
+}
+
+InlineTest("Samples are attributed to the running functions")
+{
+    lua_State* l = luaL_newstate();
+    LuaProfiler profiler;
+    InitLuaProfiler(&profiler, l, 100, "test");
+
+    Require(luaL_loadbuffer(l, SCRIPT, strlen(SCRIPT), "=script") == LUA_OK);
+    ResumeLuaProfiler(&profiler);
+    lua_call(l, 0, 0);
+    Require(profiler.sampleCount > 0);
+
+    const LuaProfilerFunction* busy = FindFunction(&profiler, "script:1");
+    const LuaProfilerFunction* caller = FindFunction(&profiler, "script:6");
+    Require(busy != NULL);
+    Require(caller != NULL);
+    Require(busy->sampleCount > caller->sampleCount);
+    Require(busy->selfTime <= busy->totalTime);
+    Require(caller->totalTime >= busy->totalTime);
+
+    Array<char> report;
+    InitArray(&report);
+    FormatLuaProfilerReport(&profiler, "test", &report);
+    Require(report.length > 0);
+    DestroyArray(&report);
+
+    DestroyLuaProfiler(&profiler, false);
+    lua_close(l);
+}
+
+#if defined(KONSTRUKT_PROFILER_ENABLED)
+/**
+ * Runs the script once and publishes the counters.
+ *
+ * @return
+ * Counter of the `busy` function.
+ */
+static const LuaProfilerCounter* ProfileScript( lua_State* l, LuaProfiler* profiler )
+{
+    Require(luaL_loadbuffer(l, SCRIPT, strlen(SCRIPT), "=script") == LUA_OK);
+    ResumeLuaProfiler(profiler);
+    lua_call(l, 0, 0);
+    PublishLuaProfilerCounters(profiler);
+
+    const LuaProfilerFunction* busy = FindFunction(profiler, "script:1");
+    Require(busy != NULL);
+    Require(busy->counter != NULL);
+    return busy->counter;
+}
+
+InlineTest("Counters outlive their profiler and are reused")
+{
+    lua_State* l = luaL_newstate();
+    LuaProfiler profiler;
+
+    InitLuaProfiler(&profiler, l, 100, "test");
+    const LuaProfilerCounter* counter = ProfileScript(l, &profiler);
+    DestroyLuaProfiler(&profiler, false);
+
+    InitLuaProfiler(&profiler, l, 100, "test");
+    Require(ProfileScript(l, &profiler) == counter);
+    DestroyLuaProfiler(&profiler, false);
+
+    lua_close(l);
+    DestroyLuaProfilerCounters();
+}
+#endif
+
+int main( int argc, char** argv )
+{
+    InitTests(argc, argv);
+    return RunTests();
+}
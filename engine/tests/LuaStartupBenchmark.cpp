@@ -0,0 +1,99 @@
+#include <string.h> // strlen, strcmp
+#include <time.h> // clock
+
+#include "../Common.h"
+#include "../Config.h"
+#include "../Array.h"
+#include "../Vfs.h"
+#include "../Lua.h"
+#include "TestTools.h"
+
+
+int LoopCount;
+static Array<Path> Scripts;
+
+
+static void CollectScripts( const char* vfsPath )
+{
+    PathList entries = GetVfsDirEntries(vfsPath);
+    REPEAT(entries.length, i)
+    {
+        Path path;
+        FormatBuffer(path.str, sizeof(path.str), "%s/%s", vfsPath, entries.data[i].str);
+
+        const int length = strlen(path.str);
+        switch(GetVfsFileType(path.str))
+        {
+            case FILE_TYPE_DIRECTORY:
+                CollectScripts(path.str);
+                break;
+
+            case FILE_TYPE_REGULAR:
+                if(length > 4 && strcmp(path.str+length-4, ".lua") == 0)
+                    AppendToArray(&Scripts, 1, &path);
+                break;
+
+            default:
+                break;
+        }
+    }
+    DestroyPathList(&entries);
+}
+
+/**
+ * Loads all core scripts like each new worker does.
+ *
+ * @return
+ * CPU time per iteration in seconds.
+ */
+static double MeasureStartup( bool bytecodeCache )
+{
+    LuaConfig config = GetTestLuaConfig();
+    config.bytecodeCache = bytecodeCache;
+    InitLua(config);
+
+    const clock_t startTime = clock();
+    REPEAT(LoopCount, i)
+    {
+        lua_State* l = luaL_newstate();
+        REPEAT(Scripts.length, j)
+        {
+            Require(LoadLuaScript(l, Scripts.data[j].str));
+            lua_pop(l, 1);
+        }
+        lua_close(l);
+    }
+    const clock_t endTime = clock();
+
+    DestroyLua();
+
+    return (double)(endTime - startTime) /
+           (double)CLOCKS_PER_SEC /
+           (double)LoopCount;
+}
+
+InlineTest("Startup with and without bytecode cache")
+{
+    InitArray(&Scripts);
+    CollectScripts("core");
+    Require(Scripts.length > 0);
+
+    const double uncachedTime = MeasureStartup(false);
+    MeasureStartup(true); // Fill the cache.
+    const double cachedTime = MeasureStartup(true);
+
+    LogNotice("%d scripts, %d iterations:", Scripts.length, LoopCount);
+    LogNotice("Compiling from source: %.3f ms", uncachedTime*1000.0);
+    LogNotice("Loading from cache: %.3f ms", cachedTime*1000.0);
+
+    DestroyArray(&Scripts);
+}
+
+int main( int argc, char** argv )
+{
+    InitTests(argc, argv);
+    InitTestVfs(argv[0]);
+    MountVfsDir("core", "../../core", false);
+    LoopCount = GetConfigInt("test.loop-count", 1);
+    return RunTests();
+}
@@ -0,0 +1,199 @@
+#include "../Common.h"
+#include "../Lua.h"
+#include "../lua_bindings/Math.h"
+#include "TestTools.h"
+
+
+static bool TestHasRun;
+
+static void PushTestVector( lua_State* l,
+                            int size,
+                            double x, double y, double z, double w )
+{
+    LuaVector* v = CreateVectorInLua(l);
+    v->size = size;
+    v->_[0] = x;
+    v->_[1] = y;
+    v->_[2] = z;
+    v->_[3] = w;
+}
+
+static void RequireVector( lua_State* l,
+                           int stackPosition,
+                           int size,
+                           double x, double y, double z, double w )
+{
+    const LuaVector* v = GetVectorFromLua(l, stackPosition);
+    Require(v != NULL);
+    Require(v->size == size);
+    const double expected[MAX_LUA_VECTOR_SIZE] = {x, y, z, w};
+    REPEAT(size, i)
+        Require(v->_[i] == expected[i]);
+}
+
+static void RequireArithmetic( lua_State* l,
+                               int a,
+                               int b,
+                               int operation,
+                               int size,
+                               double x, double y, double z, double w )
+{
+    lua_pushvalue(l, a);
+    lua_pushvalue(l, b);
+    lua_arith(l, operation);
+    RequireVector(l, -1, size, x, y, z, w);
+    lua_pop(l, 1);
+}
+
+/**
+ * Pushes the result of `self:name(argument)`.
+ */
+static void CallVectorMethod( lua_State* l, int self, const char* name, int argument )
+{
+    lua_getfield(l, self, name);
+    lua_pushvalue(l, self);
+    lua_pushvalue(l, argument);
+    lua_call(l, 2, 1);
+}
+
+static bool VectorComparisonHolds( lua_State* l, int a, const char* name, int b )
+{
+    CallVectorMethod(l, a, name, b);
+    const bool result = lua_toboolean(l, -1) != 0;
+    lua_pop(l, 1);
+    return result;
+}
+
+static int Lua_SetTooManyComponents( lua_State* l )
+{
+    lua_getfield(l, 1, "set");
+    lua_pushvalue(l, 1);
+    REPEAT(MAX_LUA_VECTOR_SIZE+1, i)
+        lua_pushnumber(l, i);
+    lua_call(l, MAX_LUA_VECTOR_SIZE+2, 0);
+    return 0;
+}
+
+static int Lua_AssignBeyondLastComponent( lua_State* l )
+{
+    lua_pushinteger(l, MAX_LUA_VECTOR_SIZE+1);
+    lua_pushnumber(l, 1);
+    lua_settable(l, 1);
+    return 0;
+}
+
+static int Lua_RunTest( lua_State* l )
+{
+    lua_settop(l, 0);
+
+    // Operators:
+    PushTestVector(l, 2, 1, 2, 0, 0); // 1
+    PushTestVector(l, 3, 3, 4, 5, 0); // 2
+    lua_pushnumber(l, 2);             // 3
+
+    RequireArithmetic(l, 1, 2, LUA_OPADD, 3, 4, 6, 5, 0);
+    RequireArithmetic(l, 1, 2, LUA_OPSUB, 3, -2, -2, -5, 0);
+    RequireArithmetic(l, 1, 2, LUA_OPMUL, 3, 3, 8, 0, 0);
+    RequireArithmetic(l, 2, 3, LUA_OPMUL, 3, 6, 8, 10, 0);
+    RequireArithmetic(l, 3, 1, LUA_OPMUL, 2, 2, 4, 0, 0);
+    RequireArithmetic(l, 2, 3, LUA_OPDIV, 3, 1.5, 2, 2.5, 0);
+
+    lua_pushvalue(l, 1);
+    lua_arith(l, LUA_OPUNM);
+    RequireVector(l, -1, 2, -1, -2, 0, 0);
+    lua_pop(l, 1);
+
+    // Comparisons treat missing components as zero:
+    PushTestVector(l, 3, 1, 2, 0, 0); // 4
+    PushTestVector(l, 2, 1, 3, 0, 0); // 5
+    Require(lua_compare(l, 1, 4, LUA_OPEQ));
+    Require(!lua_compare(l, 1, 5, LUA_OPEQ));
+    Require(!VectorComparisonHolds(l, 1, "componentsLesserThan", 5));
+    Require(VectorComparisonHolds(l, 1, "componentsLesserOrEqualTo", 5));
+    Require(VectorComparisonHolds(l, 5, "componentsGreaterOrEqualTo", 1));
+    Require(!VectorComparisonHolds(l, 5, "componentsGreaterThan", 1));
+
+    // In-place operations return the modified vector:
+    PushTestVector(l, 2, 1, 2, 0, 0); // 6
+    CallVectorMethod(l, 6, "addInPlace", 2);
+    Require(lua_rawequal(l, -1, 6));
+    lua_pop(l, 1);
+    RequireVector(l, 6, 3, 4, 6, 5, 0);
+
+    CallVectorMethod(l, 6, "mulInPlace", 3);
+    lua_pop(l, 1);
+    RequireVector(l, 6, 3, 8, 12, 10, 0);
+
+    CallVectorMethod(l, 6, "subInPlace", 2);
+    lua_pop(l, 1);
+    RequireVector(l, 6, 3, 5, 8, 5, 0);
+
+    CallVectorMethod(l, 6, "divInPlace", 3);
+    lua_pop(l, 1);
+    RequireVector(l, 6, 3, 2.5, 4, 2.5, 0);
+
+    // set copies vectors and takes up to four numbers:
+    CallVectorMethod(l, 6, "set", 2);
+    lua_pop(l, 1);
+    RequireVector(l, 6, 3, 3, 4, 5, 0);
+
+    lua_getfield(l, 6, "set");
+    lua_pushvalue(l, 6);
+    lua_pushnumber(l, 3);
+    lua_pushnumber(l, 4);
+    lua_call(l, 3, 0);
+    RequireVector(l, 6, 2, 3, 4, 0, 0);
+
+    lua_getfield(l, 6, "length");
+    lua_pushvalue(l, 6);
+    lua_call(l, 1, 1);
+    Require(lua_tonumber(l, -1) == 5);
+    lua_pop(l, 1);
+
+    lua_getfield(l, 6, "inverseLength");
+    lua_pushvalue(l, 6);
+    lua_call(l, 1, 1);
+    Require(lua_tonumber(l, -1) == 1.0/5.0);
+    lua_pop(l, 1);
+
+    lua_getfield(l, 6, "normalizeInPlace");
+    lua_pushvalue(l, 6);
+    lua_call(l, 1, 1);
+    Require(lua_rawequal(l, -1, 6));
+    lua_pop(l, 1);
+    RequireVector(l, 6, 2, 0.6, 0.8, 0, 0);
+
+    // Native vectors have at most four components:
+    lua_pushcfunction(l, Lua_SetTooManyComponents);
+    lua_pushvalue(l, 6);
+    Require(lua_pcall(l, 1, 0, 0) != LUA_OK);
+    lua_pop(l, 1);
+    RequireVector(l, 6, 2, 0.6, 0.8, 0, 0);
+
+    lua_pushcfunction(l, Lua_AssignBeyondLastComponent);
+    lua_pushvalue(l, 6);
+    Require(lua_pcall(l, 1, 0, 0) != LUA_OK);
+    lua_pop(l, 1);
+
+    TestHasRun = true;
+    return 0;
+}
+
+InlineTest("native vectors")
+{
+    InitLuaWorkerTest("core/test/Call.lua", GetTestLuaConfig());
+    RegisterMathInLua();
+    REGISTER_LUA_FUNCTION(RunTest);
+
+    TestHasRun = false;
+    SetLuaWorkerCount(1);
+    Require(TestHasRun);
+
+    DestroyLuaWorkerTest();
+}
+
+int main( int argc, char** argv )
+{
+    InitTests(argc, argv);
+    return RunTests();
+}
@@ -0,0 +1,57 @@
+#include <string.h> // strcmp
+#include "../Common.h"
+#include "../JobManager.h"
+#include "../Lua.h"
+#include "../lua_bindings/JobManager.h"
+#include "../lua_bindings/Vfs.h"
+#include "TestTools.h"
+
+
+static const int TEST_FILE_COUNT = 16; // See core/test/FileJobs.lua
+static int CheckedFileCount;
+
+static int Lua_WaitForTestJob( lua_State* l )
+{
+    const JobId job = CheckJobFromLua(l, 1);
+    WaitForJobs(&job, 1);
+    return 0;
+}
+
+/**
+ * Each file must contain its own index, so content which was written to
+ * the wrong file is detected.
+ */
+static int Lua_CheckTestFile( lua_State* l )
+{
+    const int index = luaL_checkinteger(l, 1);
+    const char* content = luaL_checkstring(l, 2);
+
+    char expected[32];
+    FormatBuffer(expected, sizeof(expected), "%d appended", index);
+    Require(strcmp(content, expected) == 0);
+    CheckedFileCount++;
+    return 0;
+}
+
+InlineTest("file jobs write and read files concurrently")
+{
+    InitLuaWorkerTest("core/test/FileJobs.lua", GetTestLuaConfig());
+    RegisterJobManagerInLua();
+    RegisterVfsInLua();
+    REGISTER_LUA_FUNCTION(WaitForTestJob);
+    REGISTER_LUA_FUNCTION(CheckTestFile);
+    SetLuaWorkerCount(1);
+
+    CheckedFileCount = 0;
+    RunLuaWorkerFrames(1);
+    Require(CheckedFileCount == TEST_FILE_COUNT);
+
+    CompleteLuaFileJobs();
+    DestroyLuaWorkerTest();
+}
+
+int main( int argc, char** argv )
+{
+    InitTests(argc, argv);
+    return RunTests();
+}
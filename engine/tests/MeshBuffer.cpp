@@ -1,5 +1,8 @@
 #include <string.h> // memset
+#include "../Common.h" // REPEAT
+#include "../JobManager.h"
 #include "../MeshBuffer.h"
+#include "../TextureArray.h"
 #include "TestTools.h"
 
 
@@ -123,6 +126,30 @@ InlineTest("can be appended to another buffer while transforming it")
     FreeMeshBuffer(b);
 }
 
+InlineTest("can remap the texture coordinates of appended vertices")
+{
+    MeshBuffer* buffer = CreateMeshBuffer();
+
+    Vertex* vertex = CreateVertex(0,0,0);
+    vertex->texCoord._[0] = 1;
+    vertex->texCoord._[1] = 1;
+    AddVertexToMeshBuffer(buffer, vertex);
+    AddVertexToMeshBuffer(buffer, vertex);
+
+    const TextureArrayPlacement placement = {0, 2, {{0.5f, 0.5f}}};
+    RemapMeshBufferTexCoords(buffer, 1, &placement);
+
+    const Vertex* vertices = GetMeshBufferVertices(buffer);
+    const Vec2 original = {{1, 1}};
+    const Vec2 remapped = {{0.5f, 0.5f}};
+    Require(ArraysAreEqual(vertices[0].texCoord._, original._, 2));
+    Require(vertices[0].textureLayer == 0);
+    Require(ArraysAreEqual(vertices[1].texCoord._, remapped._, 2));
+    Require(vertices[1].textureLayer == 2);
+
+    FreeMeshBuffer(buffer);
+}
+
 InlineTest("can generate indices")
 {
     dummyAbortTest(DUMMY_FAIL_TEST, "test not implemented");
@@ -138,8 +165,138 @@ InlineTest("can generate tangents from normals")
     dummyAbortTest(DUMMY_FAIL_TEST, "test not implemented");
 }
 
+static const int GRID_SIZE = 9; // Vertices per side.
+
+/**
+ * Planar grid with a slight bump, so the quadrics don't vanish.
+ */
+static MeshBuffer* CreateGridMeshBuffer()
+{
+    MeshBuffer* buffer = CreateMeshBuffer();
+    ReferenceMeshBuffer(buffer); // Postprocessing jobs reference it too.
+    REPEAT(GRID_SIZE, z)
+    REPEAT(GRID_SIZE, x)
+    {
+        const float y = (x == GRID_SIZE/2 && z == GRID_SIZE/2) ? 0.1f : 0;
+        AddVertexToMeshBuffer(buffer, CreateVertex(x, y, z));
+    }
+    REPEAT(GRID_SIZE-1, z)
+    REPEAT(GRID_SIZE-1, x)
+    {
+        const VertexIndex a = z*GRID_SIZE + x;
+        const VertexIndex b = a + 1;
+        const VertexIndex c = a + GRID_SIZE;
+        const VertexIndex d = c + 1;
+        AddIndexToMeshBuffer(buffer, a);
+        AddIndexToMeshBuffer(buffer, c);
+        AddIndexToMeshBuffer(buffer, b);
+        AddIndexToMeshBuffer(buffer, b);
+        AddIndexToMeshBuffer(buffer, c);
+        AddIndexToMeshBuffer(buffer, d);
+    }
+    return buffer;
+}
+
+static void PostprocessMeshBuffer( MeshBuffer* buffer, int options )
+{
+    const JobId job = BeginMeshBufferPostprocessing(buffer, options);
+    WaitForJobs(&job, 1);
+    RemoveJob(job);
+}
+
+static bool LodUsesVertex( const MeshBuffer* buffer, int lod, VertexIndex vertex )
+{
+    int firstIndex, indexCount;
+    GetMeshBufferLodRange(buffer, lod, &firstIndex, &indexCount);
+    const VertexIndex* indices = GetMeshBufferIndices(buffer);
+    REPEAT(indexCount, i)
+        if(indices[firstIndex+i] == vertex)
+            return true;
+    return false;
+}
+
+InlineTest("can generate detail levels")
+{
+    MeshBuffer* buffer = CreateGridMeshBuffer();
+    const int baseIndexCount = GetMeshBufferIndexCount(buffer);
+    PostprocessMeshBuffer(buffer, MESH_BUFFER_GENERATE_LODS);
+
+    const int lodCount = GetMeshBufferLodCount(buffer);
+    Require(lodCount >= 2);
+
+    int firstIndex, indexCount;
+    GetMeshBufferLodRange(buffer, 0, &firstIndex, &indexCount);
+    Require(firstIndex == 0);
+    Require(indexCount == baseIndexCount);
+
+    // Levels are stored one after another and get coarser each time:
+    int nextFirstIndex = baseIndexCount;
+    int previousIndexCount = baseIndexCount;
+    for(int lod = 1; lod < lodCount; lod++)
+    {
+        GetMeshBufferLodRange(buffer, lod, &firstIndex, &indexCount);
+        Require(firstIndex == nextFirstIndex);
+        Require(indexCount > 0);
+        Require(indexCount % 3 == 0);
+        Require(indexCount <= previousIndexCount * 4 / 5);
+        nextFirstIndex += indexCount;
+        previousIndexCount = indexCount;
+    }
+    Require(nextFirstIndex == GetMeshBufferIndexCount(buffer));
+    GetMeshBufferLodRange(buffer, 1, &firstIndex, &indexCount);
+    Require(indexCount <= baseIndexCount / 2);
+
+    const int vertexCount = GetMeshBufferVertexCount(buffer);
+    const VertexIndex* indices = GetMeshBufferIndices(buffer);
+    REPEAT(GetMeshBufferIndexCount(buffer), i)
+        Require(indices[i] < vertexCount);
+
+    // Border vertices stay in place:
+    const VertexIndex corners[] = {0,
+                                   GRID_SIZE-1,
+                                   GRID_SIZE*(GRID_SIZE-1),
+                                   GRID_SIZE*GRID_SIZE-1};
+    REPEAT(lodCount, lod)
+    REPEAT(4, i)
+        Require(LodUsesVertex(buffer, lod, corners[i]));
+
+    ReleaseMeshBuffer(buffer);
+}
+
+InlineTest("detail levels are deterministic")
+{
+    MeshBuffer* a = CreateGridMeshBuffer();
+    MeshBuffer* b = CreateGridMeshBuffer();
+    PostprocessMeshBuffer(a, MESH_BUFFER_GENERATE_LODS);
+    PostprocessMeshBuffer(b, MESH_BUFFER_GENERATE_LODS);
+
+    Require(GetMeshBufferLodCount(a) == GetMeshBufferLodCount(b));
+    Require(GetMeshBufferIndexCount(a) == GetMeshBufferIndexCount(b));
+    Require(memcmp(GetMeshBufferIndices(a),
+                   GetMeshBufferIndices(b),
+                   sizeof(VertexIndex)*GetMeshBufferIndexCount(a)) == 0);
+
+    ReleaseMeshBuffer(a);
+    ReleaseMeshBuffer(b);
+}
+
+InlineTest("detail levels are discarded when indices are added")
+{
+    MeshBuffer* buffer = CreateGridMeshBuffer();
+    const int baseIndexCount = GetMeshBufferIndexCount(buffer);
+    PostprocessMeshBuffer(buffer, MESH_BUFFER_GENERATE_LODS);
+    Require(GetMeshBufferLodCount(buffer) >= 2);
+
+    AddIndexToMeshBuffer(buffer, 0);
+    Require(GetMeshBufferLodCount(buffer) == 1);
+    Require(GetMeshBufferIndexCount(buffer) == baseIndexCount+1);
+
+    ReleaseMeshBuffer(buffer);
+}
+
 int main( int argc, char** argv )
 {
     InitTests(argc, argv);
+    InitTestJobManager();
     return RunTests();
 }
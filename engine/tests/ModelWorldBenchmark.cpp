@@ -0,0 +1,192 @@
+#include <string.h> // memset
+#include <time.h> // clock
+
+#include "../Common.h"
+#include "../Config.h"
+#include "../Vfs.h"
+#include "../NullOpenGL.h"
+#include "../OpenGLState.h"
+#include "../RenderCommandQueue.h"
+#include "../Shader.h"
+#include "../MeshBuffer.h"
+#include "../Mesh.h"
+#include "../ModelWorld.h"
+#include "../Camera.h"
+#include "TestTools.h"
+
+
+static const int MODELS_PER_WORLD = 64; // See MAX_MODELS in ModelWorld.cpp
+
+static const Vec3 Colors[] =
+{
+    {{1, 0, 0}},
+    {{0, 1, 0}},
+    {{0, 0, 1}},
+    {{1, 1, 1}}
+};
+static const int COLOR_COUNT = sizeof(Colors)/sizeof(Vec3);
+
+int ModelCount;
+int FrameCount;
+int MeshCount;
+float InstancedModelRatio;
+MeshArenaConfig MeshArena;
+
+
+static Mesh* CreateTriangleMesh( int seed )
+{
+    MeshBuffer* buffer = CreateMeshBuffer();
+    ReferenceMeshBuffer(buffer);
+    REPEAT(3, i)
+    {
+        Vertex vertex;
+        memset(&vertex, 0, sizeof(vertex));
+        vertex.position._[0] = (float)(i == 1);
+        vertex.position._[1] = (float)(i == 2);
+        vertex.position._[2] = (float)seed;
+        vertex.normal._[2] = 1;
+        AddVertexToMeshBuffer(buffer, &vertex);
+        AddIndexToMeshBuffer(buffer, i); // Chunk meshes are indexed too.
+    }
+    Mesh* mesh = CreateMesh(buffer);
+    ReferenceMesh(mesh);
+    ReleaseMeshBuffer(buffer);
+    return mesh;
+}
+
+static ShaderProgram* LinkBenchmarkProgram( const char* vertexShaderPath )
+{
+    Shader* shaders[2] = {LoadShader(vertexShaderPath),
+                          LoadShader("shaders/Model.frag")};
+    REPEAT(2, i)
+        ReferenceShader(shaders[i]);
+    ShaderProgram* program = LinkShaderProgram(shaders, 2);
+    Require(program != NULL);
+    ReferenceShaderProgram(program);
+    REPEAT(2, i)
+        ReleaseShader(shaders[i]);
+    return program;
+}
+
+InlineTest("DrawModelWorld")
+{
+    InitNullOpenGL();
+    InitShader();
+    InitRenderCommandQueue({false, NULL, NULL});
+    InitMeshArena(MeshArena);
+
+    ShaderProgram* staticProgram = LinkBenchmarkProgram("shaders/Model.vert");
+    ShaderProgram* instancedProgram = LinkBenchmarkProgram("shaders/Instanced.vert");
+    Require(!ShaderProgramSupportsInstancing(staticProgram));
+    Require(ShaderProgramSupportsInstancing(instancedProgram));
+
+    ShaderProgramSet* programSet = CreateShaderProgramSet(staticProgram);
+    ReferenceShaderProgramSet(programSet);
+    SetShaderProgramFamily(programSet, "instanced", instancedProgram);
+
+    Mesh** meshes = new Mesh*[MeshCount];
+    REPEAT(MeshCount, i)
+        meshes[i] = CreateTriangleMesh(i);
+
+    const int worldCount = (ModelCount + MODELS_PER_WORLD - 1) / MODELS_PER_WORLD;
+    ModelWorld** worlds = new ModelWorld*[worldCount];
+    REPEAT(worldCount, i)
+    {
+        worlds[i] = CreateModelWorld();
+        ReferenceModelWorld(worlds[i]);
+    }
+
+    Camera** cameras = new Camera*[worldCount];
+    REPEAT(worldCount, i)
+    {
+        cameras[i] = CreateCamera(worlds[i], NULL);
+        ReferenceCamera(cameras[i]);
+        const Vec3 position = {{0, (float)i, -10}};
+        SetCameraViewTransformation(cameras[i], TranslateMat4(Mat4Identity, position));
+    }
+
+    const int instancedModelCount = (int)((float)ModelCount * InstancedModelRatio);
+    Model** models = new Model*[ModelCount];
+    REPEAT(ModelCount, i)
+    {
+        Model* model = CreateModel(worlds[i / MODELS_PER_WORLD]);
+        ReferenceModel(model);
+        SetModelMesh(model, meshes[i % MeshCount]);
+        SetModelProgramFamilyList(model, (i < instancedModelCount) ? "instanced" : "static");
+        const Vec3 position = {{(float)i, 0, 0}};
+        SetModelTransformation(model, TranslateMat4(Mat4Identity, position));
+        // Draw entries aren't sorted by model variables, so models which
+        // should be instanced together get the same color:
+        SetVec3Uniform(GetModelShaderVariableSet(model),
+                       "Color",
+                       Colors[(i / MODELS_PER_WORLD) % COLOR_COUNT]);
+        models[i] = model;
+    }
+
+    clock_t startTime = 0;
+    // The first frame creates buffers, so it's not measured:
+    REPEAT(FrameCount+1, frame)
+    {
+        if(frame == 1)
+        {
+            ResetNullOpenGLStatistics();
+            ResetOpenGLStateStatistics();
+            startTime = clock();
+        }
+        FenceMeshArena();
+        SetFloatUniform(GetGlobalShaderVariableSet(), "Time", (float)frame);
+        UpdateUniformBuffer(GetGlobalUniformBuffer());
+        REPEAT(worldCount, i)
+            DrawCameraView(cameras[i], programSet);
+    }
+    const clock_t endTime = clock();
+
+    const NullOpenGLStatistics* statistics = GetNullOpenGLStatistics();
+    const double frameTime = (double)(endTime - startTime) /
+                             (double)CLOCKS_PER_SEC /
+                             (double)FrameCount;
+    LogNotice("%d models in %d worlds, %d frames:", ModelCount, worldCount, FrameCount);
+    LogNotice("CPU time per frame: %.3f ms", frameTime*1000.0);
+    LogNotice("Draw calls per frame: %d", statistics->drawCalls / FrameCount);
+    LogNotice("State changes per frame: %d", statistics->stateChanges / FrameCount);
+    LogNotice("Filtered state changes per frame: %d",
+              GetOpenGLStateStatistics()->filteredChanges / FrameCount);
+    LogNotice("Uniform uploads per frame: %d", statistics->uniformUploads / FrameCount);
+    LogNotice("Buffer uploads per frame: %d", statistics->bufferUploads / FrameCount);
+    LogNotice("OpenGL calls per frame: %d", statistics->calls / FrameCount);
+
+    REPEAT(ModelCount, i)
+        ReleaseModel(models[i]);
+    delete[] models;
+    REPEAT(worldCount, i)
+        ReleaseCamera(cameras[i]);
+    delete[] cameras;
+    REPEAT(worldCount, i)
+        ReleaseModelWorld(worlds[i]);
+    delete[] worlds;
+    REPEAT(MeshCount, i)
+        ReleaseMesh(meshes[i]);
+    delete[] meshes;
+    ReleaseShaderProgramSet(programSet);
+    ReleaseShaderProgram(staticProgram);
+    ReleaseShaderProgram(instancedProgram);
+
+    DestroyMeshArena();
+    DestroyRenderCommandQueue();
+    DestroyShader();
+    DestroyNullOpenGL();
+}
+
+int main( int argc, char** argv )
+{
+    InitTests(argc, argv);
+    InitTestVfs(argv[0]);
+    MountVfsDir("shaders", "data/ModelWorldBenchmark", false);
+    ModelCount = GetConfigInt("test.model-count", 64);
+    FrameCount = GetConfigInt("test.frame-count", 1);
+    MeshCount = GetConfigInt("test.mesh-count", 4);
+    InstancedModelRatio = GetConfigFloat("test.instanced-model-ratio", 0.5);
+    MeshArena.vertexCount = GetConfigInt("test.mesh-arena-vertices", 65536);
+    MeshArena.indexCount = GetConfigInt("test.mesh-arena-indices", 65536);
+    return RunTests();
+}
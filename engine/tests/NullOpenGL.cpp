@@ -0,0 +1,194 @@
+#include <string.h> // strcmp
+
+#include "../Common.h" // REPEAT
+#include "../OpenGL.h"
+#include "../NullOpenGL.h"
+#include "TestTools.h"
+
+
+static const char* VertexShaderSource =
+    "#version 150\n"
+    "// uniform float Commented;\n"
+    "struct Instance\n"
+    "{\n"
+    "    mat4 Model;\n"
+    "    vec3 Color;\n"
+    "};\n"
+    "layout(std140) uniform Instances\n"
+    "{\n"
+    "    Instance InstanceList[4];\n"
+    "};\n"
+    "uniform mat4 ModelViewProjection;\n"
+    "uniform vec3 LightPositions[8];\n"
+    "void main()\n"
+    "{\n"
+    "    int notAUniform = 0;\n"
+    "}\n";
+
+static const char* FragmentShaderSource =
+    "#version 150\n"
+    "uniform mat4 ModelViewProjection; /* shared with the vertex shader */\n"
+    "uniform sampler2D DiffuseSampler;\n"
+    "void main() {}\n";
+
+static GLuint CreateNullShader( GLenum type, const char* source )
+{
+    const GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    return shader;
+}
+
+InlineTest("Uniforms are read from shader sources")
+{
+    InitNullOpenGL();
+
+    const GLuint vertexShader =
+        CreateNullShader(GL_VERTEX_SHADER, VertexShaderSource);
+    const GLuint fragmentShader =
+        CreateNullShader(GL_FRAGMENT_SHADER, FragmentShaderSource);
+    const GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+
+    GLint uniformCount = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+    Require(uniformCount == 3);
+
+    char name[32];
+    GLint size = 0;
+    GLenum type = GL_NONE;
+    glGetActiveUniform(program, 1, sizeof(name), NULL, &size, &type, name);
+    Require(strcmp(name, "LightPositions[0]") == 0);
+    Require(size == 8);
+    Require(type == GL_FLOAT_VEC3);
+
+    Require(glGetUniformLocation(program, "ModelViewProjection") == 0);
+    Require(glGetUniformLocation(program, "LightPositions[0]") == 1);
+    Require(glGetUniformLocation(program, "LightPositions[7]") == 8);
+    Require(glGetUniformLocation(program, "DiffuseSampler") == 9);
+    Require(glGetUniformLocation(program, "Commented") == -1);
+    Require(glGetUniformLocation(program, "notAUniform") == -1);
+
+    const GLuint blockIndex = glGetUniformBlockIndex(program, "Instances");
+    Require(blockIndex == 0);
+    Require(glGetUniformBlockIndex(program, "Missing") == GL_INVALID_INDEX);
+    GLint blockSize = 0;
+    glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+    Require(blockSize == (64+16)*4);
+
+    glDeleteProgram(program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    DestroyNullOpenGL();
+}
+
+InlineTest("Uniform block members are reported")
+{
+    InitNullOpenGL();
+
+    const GLuint shader = CreateNullShader(GL_VERTEX_SHADER,
+        "layout(std140) uniform Camera\n"
+        "{\n"
+        "    float Time;\n"
+        "    mat4 View;\n"
+        "    vec3 Positions[2];\n"
+        "    mat3 Normal;\n"
+        "};\n"
+        "uniform float Other;\n");
+    const GLuint program = glCreateProgram();
+    glAttachShader(program, shader);
+    glLinkProgram(program);
+
+    GLint uniformCount = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+    Require(uniformCount == 5);
+    Require(glGetUniformLocation(program, "View") == -1);
+    Require(glGetUniformLocation(program, "Other") == 0);
+
+    const GLuint blockIndex = glGetUniformBlockIndex(program, "Camera");
+    GLint blockSize = 0;
+    glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+    Require(blockSize == 160);
+
+    GLint memberCount = 0;
+    glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &memberCount);
+    Require(memberCount == 4);
+
+    GLint indices[4];
+    glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, indices);
+    GLuint members[4];
+    REPEAT(4, i)
+        members[i] = indices[i];
+
+    GLint offsets[4];
+    GLint arrayStrides[4];
+    GLint matrixStrides[4];
+    glGetActiveUniformsiv(program, 4, members, GL_UNIFORM_OFFSET, offsets);
+    glGetActiveUniformsiv(program, 4, members, GL_UNIFORM_ARRAY_STRIDE, arrayStrides);
+    glGetActiveUniformsiv(program, 4, members, GL_UNIFORM_MATRIX_STRIDE, matrixStrides);
+    Require(offsets[0] == 0);
+    Require(offsets[1] == 16);
+    Require(offsets[2] == 80);
+    Require(offsets[3] == 112);
+    Require(arrayStrides[2] == 16);
+    Require(matrixStrides[1] == 16);
+    Require(matrixStrides[3] == 16);
+
+    glDeleteProgram(program);
+    glDeleteShader(shader);
+    DestroyNullOpenGL();
+}
+
+InlineTest("Vertex attributes are read from vertex shaders")
+{
+    InitNullOpenGL();
+
+    const GLuint vertexShader = CreateNullShader(GL_VERTEX_SHADER,
+        "in vec3 VertexPosition;\n"
+        "layout(location = 3) in int InstanceIndex;\n"
+        "float Helper( in float notAnAttribute ) { return 0.0; }\n");
+    const GLuint fragmentShader = CreateNullShader(GL_FRAGMENT_SHADER,
+        "in vec3 Normal;\n");
+    const GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+
+    Require(glGetAttribLocation(program, "VertexPosition") != -1);
+    Require(glGetAttribLocation(program, "InstanceIndex") != -1);
+    Require(glGetAttribLocation(program, "notAnAttribute") == -1);
+    Require(glGetAttribLocation(program, "Normal") == -1);
+
+    glDeleteProgram(program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    DestroyNullOpenGL();
+}
+
+InlineTest("Calls are counted")
+{
+    InitNullOpenGL();
+    ResetNullOpenGLStatistics();
+
+    glUseProgram(0);
+    glUniform1i(0, 0);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_STATIC_DRAW);
+
+    const NullOpenGLStatistics* statistics = GetNullOpenGLStatistics();
+    Require(statistics->calls == 4);
+    Require(statistics->stateChanges == 1);
+    Require(statistics->uniformUploads == 1);
+    Require(statistics->drawCalls == 1);
+    Require(statistics->bufferUploads == 1);
+
+    DestroyNullOpenGL();
+}
+
+int main( int argc, char** argv )
+{
+    InitTests(argc, argv);
+    return RunTests();
+}
@@ -0,0 +1,138 @@
+#include "../Common.h"
+#include "../OpenGL.h"
+#include "../NullOpenGL.h"
+#include "../OpenGLState.h"
+#include "TestTools.h"
+
+
+static void InitOpenGLStateTest()
+{
+    InitNullOpenGL();
+    ResetNullOpenGLStatistics();
+    ResetOpenGLStateStatistics();
+}
+
+InlineTest("Redundant state changes are filtered")
+{
+    InitOpenGLStateTest();
+
+    REPEAT(3, i)
+    {
+        SetCapability(GL_DEPTH_TEST, true);
+        SetBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
+        BindBuffer(GL_ARRAY_BUFFER, 1);
+        UseProgram(2);
+    }
+    SetCapability(GL_DEPTH_TEST, false);
+
+    Require(GetNullOpenGLStatistics()->stateChanges == 5);
+    const OpenGLStateStatistics* statistics = GetOpenGLStateStatistics();
+    Require(statistics->issuedChanges == 5);
+    Require(statistics->filteredChanges == 8);
+
+    DestroyNullOpenGL();
+}
+
+InlineTest("State is unknown after a reset")
+{
+    InitOpenGLStateTest();
+
+    SetDepthMask(true);
+    ResetOpenGLState();
+    SetDepthMask(true);
+
+    Require(GetNullOpenGLStatistics()->stateChanges == 2);
+
+    DestroyNullOpenGL();
+}
+
+InlineTest("Deleted objects are unbound")
+{
+    InitOpenGLStateTest();
+
+    BindBufferBase(GL_UNIFORM_BUFFER, 1, 3);
+    BindBuffer(GL_UNIFORM_BUFFER, 3); // Bound by BindBufferBase already.
+    ForgetBuffer(3);
+    BindBuffer(GL_UNIFORM_BUFFER, 0);
+    BindBufferBase(GL_UNIFORM_BUFFER, 1, 0);
+    Require(GetNullOpenGLStatistics()->stateChanges == 1);
+
+    BindTextureToUnit(1, GL_TEXTURE_2D, 4);
+    ForgetTexture(4);
+    ResetNullOpenGLStatistics();
+    BindTextureToUnit(1, GL_TEXTURE_2D, 4);
+    Require(GetNullOpenGLStatistics()->stateChanges == 1);
+
+    UseProgram(5);
+    ForgetProgram(5);
+    UseProgram(5); // May be a new program with the same name.
+    Require(GetNullOpenGLStatistics()->stateChanges == 3);
+
+    DestroyNullOpenGL();
+}
+
+InlineTest("Textures are bound to one target per unit")
+{
+    InitOpenGLStateTest();
+
+    BindTextureToUnit(0, GL_TEXTURE_2D, 1);
+    BindTextureToUnit(1, GL_TEXTURE_2D, 2);
+    ResetNullOpenGLStatistics();
+
+    // Unbinds the 2D texture and binds the cube map:
+    BindTextureToUnit(0, GL_TEXTURE_CUBE_MAP, 3);
+    Require(GetNullOpenGLStatistics()->stateChanges == 3);
+
+    // Creating a texture on the active unit doesn't disturb other units:
+    BindTextureObject(GL_TEXTURE_2D, 4);
+    BindTextureObject(GL_TEXTURE_2D, 0);
+    ResetNullOpenGLStatistics();
+    BindTextureToUnit(1, GL_TEXTURE_2D, 2);
+    Require(GetNullOpenGLStatistics()->stateChanges == 1); // glActiveTexture
+
+    DestroyNullOpenGL();
+}
+
+InlineTest("Buffers are only cleared after they were drawn to")
+{
+    InitOpenGLStateTest();
+
+    // Scissored clears aren't remembered:
+    SetCapability(GL_SCISSOR_TEST, true);
+    ClearFramebuffer(GL_DEPTH_BUFFER_BIT);
+    ClearFramebuffer(GL_DEPTH_BUFFER_BIT);
+    Require(GetNullOpenGLStatistics()->clears == 2);
+    SetCapability(GL_SCISSOR_TEST, false);
+    ResetNullOpenGLStatistics();
+    ResetOpenGLStateStatistics();
+
+    SetDepthMask(false);
+    ClearFramebuffer(GL_DEPTH_BUFFER_BIT);
+    ClearFramebuffer(GL_DEPTH_BUFFER_BIT);
+    Require(GetNullOpenGLStatistics()->clears == 1);
+
+    MarkFramebufferAsDrawn();
+    ClearFramebuffer(GL_DEPTH_BUFFER_BIT);
+    Require(GetNullOpenGLStatistics()->clears == 2);
+
+    // Only the color buffer is left:
+    ClearFramebuffer(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    Require(GetNullOpenGLStatistics()->clears == 3);
+
+    // Depth writes must be enabled for clearing the depth buffer:
+    ResetNullOpenGLStatistics();
+    SetDepthMask(true);
+    Require(GetNullOpenGLStatistics()->stateChanges == 0);
+
+    const OpenGLStateStatistics* statistics = GetOpenGLStateStatistics();
+    Require(statistics->issuedClears == 3);
+    Require(statistics->filteredClears == 1);
+
+    DestroyNullOpenGL();
+}
+
+int main( int argc, char** argv )
+{
+    InitTests(argc, argv);
+    return RunTests();
+}
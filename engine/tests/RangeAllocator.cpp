@@ -0,0 +1,150 @@
+#include "../RangeAllocator.h"
+#include "TestTools.h"
+
+
+InlineTest("Ranges are allocated until the allocator is full")
+{
+    RangeAllocator allocator;
+    InitRangeAllocator(&allocator, 100);
+
+    Require(AllocateRange(&allocator, 30) == 0);
+    Require(AllocateRange(&allocator, 30) == 30);
+    Require(AllocateRange(&allocator, 40) == 60);
+    Require(allocator.freeSize == 0);
+    Require(AllocateRange(&allocator, 1) == INVALID_RANGE_OFFSET);
+    Require(GetLargestFreeRange(&allocator) == 0);
+
+    DestroyRangeAllocator(&allocator);
+}
+
+InlineTest("Allocations which are larger than any free range fail")
+{
+    RangeAllocator allocator;
+    InitRangeAllocator(&allocator, 100);
+
+    const int a = AllocateRange(&allocator, 25);
+    const int b = AllocateRange(&allocator, 25);
+    const int c = AllocateRange(&allocator, 25);
+    Require(a != INVALID_RANGE_OFFSET);
+    Require(b != INVALID_RANGE_OFFSET);
+    Require(c != INVALID_RANGE_OFFSET);
+    FreeRange(&allocator, b, 25);
+
+    // 50 units are free, but they aren't contiguous:
+    Require(allocator.freeSize == 50);
+    Require(GetLargestFreeRange(&allocator) == 25);
+    Require(AllocateRange(&allocator, 30) == INVALID_RANGE_OFFSET);
+
+    DestroyRangeAllocator(&allocator);
+}
+
+InlineTest("Freed ranges are merged with their neighbours")
+{
+    RangeAllocator allocator;
+    InitRangeAllocator(&allocator, 100);
+
+    const int a = AllocateRange(&allocator, 20);
+    const int b = AllocateRange(&allocator, 20);
+    const int c = AllocateRange(&allocator, 20);
+    const int d = AllocateRange(&allocator, 20);
+    const int e = AllocateRange(&allocator, 20);
+
+    // Isolated:
+    FreeRange(&allocator, b, 20);
+    FreeRange(&allocator, d, 20);
+    Require(allocator.freeRanges.length == 2);
+
+    // Merged with both neighbours:
+    FreeRange(&allocator, c, 20);
+    Require(allocator.freeRanges.length == 1);
+    Require(GetLargestFreeRange(&allocator) == 60);
+
+    // Merged with the following range:
+    FreeRange(&allocator, a, 20);
+    Require(allocator.freeRanges.length == 1);
+    Require(GetLargestFreeRange(&allocator) == 80);
+
+    // Merged with the preceding range:
+    FreeRange(&allocator, e, 20);
+    Require(allocator.freeRanges.length == 1);
+    Require(GetLargestFreeRange(&allocator) == 100);
+    Require(allocator.freeSize == 100);
+
+    Require(AllocateRange(&allocator, 100) == 0);
+
+    DestroyRangeAllocator(&allocator);
+}
+
+InlineTest("The smallest fitting range is used")
+{
+    RangeAllocator allocator;
+    InitRangeAllocator(&allocator, 100);
+
+    const int a = AllocateRange(&allocator, 30);
+    AllocateRange(&allocator, 10);
+    const int b = AllocateRange(&allocator, 10);
+    AllocateRange(&allocator, 10);
+    // Remaining: 40 units at the end
+
+    FreeRange(&allocator, a, 30);
+    FreeRange(&allocator, b, 10);
+
+    Require(AllocateRange(&allocator, 10) == b);
+    Require(AllocateRange(&allocator, 25) == a);
+    Require(AllocateRange(&allocator, 35) == 60);
+
+    DestroyRangeAllocator(&allocator);
+}
+
+InlineTest("Random allocations don't leak space")
+{
+    static const int RANGE_COUNT = 64;
+    RangeAllocator allocator;
+    InitRangeAllocator(&allocator, 4096);
+
+    int offsets[RANGE_COUNT];
+    int sizes[RANGE_COUNT];
+    REPEAT(RANGE_COUNT, i)
+        offsets[i] = INVALID_RANGE_OFFSET;
+
+    // Deterministic pseudo random sequence:
+    unsigned int seed = 1;
+    REPEAT(10000, step)
+    {
+        seed = seed*1103515245 + 12345;
+        const int i = (seed >> 16) % RANGE_COUNT;
+        if(offsets[i] == INVALID_RANGE_OFFSET)
+        {
+            sizes[i] = 1 + (seed >> 8) % 100;
+            offsets[i] = AllocateRange(&allocator, sizes[i]);
+            if(offsets[i] != INVALID_RANGE_OFFSET)
+            {
+                // Must not overlap any other allocated range:
+                REPEAT(RANGE_COUNT, j)
+                    if(j != i && offsets[j] != INVALID_RANGE_OFFSET)
+                        Require(offsets[i] + sizes[i] <= offsets[j] ||
+                                offsets[j] + sizes[j] <= offsets[i]);
+            }
+        }
+        else
+        {
+            FreeRange(&allocator, offsets[i], sizes[i]);
+            offsets[i] = INVALID_RANGE_OFFSET;
+        }
+    }
+
+    REPEAT(RANGE_COUNT, i)
+        if(offsets[i] != INVALID_RANGE_OFFSET)
+            FreeRange(&allocator, offsets[i], sizes[i]);
+
+    Require(allocator.freeSize == 4096);
+    Require(allocator.freeRanges.length == 1);
+
+    DestroyRangeAllocator(&allocator);
+}
+
+int main( int argc, char** argv )
+{
+    InitTests(argc, argv);
+    return RunTests();
+}
@@ -0,0 +1,140 @@
+#include "../RenderCommandQueue.h"
+#include "../Common.h"
+#include "TestTools.h"
+
+
+struct Work
+{
+    int index;
+    int* processedCount; // shared by all work items
+    int processingOrder;
+    bool destructorCalled;
+};
+
+static void DoWork( void* data )
+{
+    Work* work = (Work*)data;
+    work->processingOrder = *work->processedCount;
+    (*work->processedCount)++;
+}
+
+static void Destructor( void* data )
+{
+    Work* work = (Work*)data;
+    Require(!work->destructorCalled);
+    work->destructorCalled = true;
+}
+
+static void InitWork( Work* work, int index, int* processedCount )
+{
+    work->index = index;
+    work->processedCount = processedCount;
+    work->processingOrder = -1;
+    work->destructorCalled = false;
+}
+
+static void TestProcessingOrder( bool useRenderThread )
+{
+    InitRenderCommandQueue({useRenderThread, NULL, NULL});
+
+    static const int COMMAND_COUNT = 16;
+    int processedCount = 0;
+    Work work[COMMAND_COUNT];
+    RenderCommandId commands[COMMAND_COUNT];
+    REPEAT(COMMAND_COUNT, i)
+    {
+        InitWork(&work[i], i, &processedCount);
+        commands[i] = CreateRenderCommand({"worker", DoWork, Destructor, &work[i]});
+    }
+
+    WaitForRenderCommands(commands, COMMAND_COUNT);
+
+    REPEAT(COMMAND_COUNT, i)
+    {
+        Require(GetRenderCommandStatus(commands[i]) == COMPLETED_RENDER_COMMAND);
+        Require(GetRenderCommandData(commands[i]) == &work[i]);
+        Require(work[i].processingOrder == i);
+        Require(!work[i].destructorCalled);
+        RemoveRenderCommand(commands[i]);
+        Require(work[i].destructorCalled);
+    }
+
+    DestroyRenderCommandQueue();
+}
+
+static bool RenderThreadStarted;
+static bool RenderThreadStopped;
+
+static void OnRenderThreadStart()
+{
+    RenderThreadStarted = true;
+}
+
+static void OnRenderThreadStop()
+{
+    RenderThreadStopped = true;
+}
+
+static void CheckThread( void* data )
+{
+    bool* inRenderThread = (bool*)data;
+    *inRenderThread = InRenderThread();
+}
+
+
+InlineTest("commands are processed in order (render thread)")
+{
+    TestProcessingOrder(true);
+}
+
+InlineTest("commands are processed in order (no render thread)")
+{
+    TestProcessingOrder(false);
+}
+
+InlineTest("thread callbacks are called")
+{
+    RenderThreadStarted = false;
+    RenderThreadStopped = false;
+    InitRenderCommandQueue({true, OnRenderThreadStart, OnRenderThreadStop});
+    Require(!InRenderThread());
+    DestroyRenderCommandQueue();
+    Require(RenderThreadStarted);
+    Require(RenderThreadStopped);
+}
+
+InlineTest("remaining commands are processed on destruction")
+{
+    InitRenderCommandQueue({true, NULL, NULL});
+
+    int processedCount = 0;
+    Work work;
+    InitWork(&work, 0, &processedCount);
+    CreateRenderCommand({"worker", DoWork, Destructor, &work});
+
+    DestroyRenderCommandQueue();
+
+    Require(processedCount == 1);
+    Require(work.destructorCalled);
+}
+
+InlineTest("RunInRenderThread")
+{
+    InitRenderCommandQueue({true, NULL, NULL});
+    bool inRenderThread = false;
+    RunInRenderThread(CheckThread, &inRenderThread);
+    Require(inRenderThread);
+    DestroyRenderCommandQueue();
+
+    InitRenderCommandQueue({false, NULL, NULL});
+    inRenderThread = false;
+    RunInRenderThread(CheckThread, &inRenderThread);
+    Require(inRenderThread);
+    DestroyRenderCommandQueue();
+}
+
+int main( int argc, char** argv )
+{
+    InitTests(argc, argv);
+    return RunTests();
+}
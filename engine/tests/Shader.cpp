@@ -0,0 +1,251 @@
+#include <string.h> // memset
+
+#include "../Common.h" // Format, REPEAT
+#include "../Vfs.h"
+#include "../NullOpenGL.h"
+#include "../RenderCommandQueue.h"
+#include "../Shader.h"
+#include "TestTools.h"
+
+
+InlineTest("CalcShaderVariableArrayElementNameHash")
+{
+    const uint32_t arrayNameHash = CalcShaderVariableNameHash("lightPosition");
+    Require(CalcShaderVariableArrayElementNameHash(arrayNameHash, 0) ==
+            CalcShaderVariableNameHash("lightPosition[0]"));
+    Require(CalcShaderVariableArrayElementNameHash(arrayNameHash, 7) ==
+            CalcShaderVariableNameHash("lightPosition[7]"));
+    Require(CalcShaderVariableArrayElementNameHash(arrayNameHash, 31) ==
+            CalcShaderVariableNameHash("lightPosition[31]"));
+}
+
+InlineTest("InitUniformArrayName")
+{
+    UniformArrayName arrayName;
+    InitUniformArrayName(&arrayName, "lightColor", 3);
+    Require(arrayName.length == 3);
+    Require(arrayName.elementNameHashes[0] == CalcShaderVariableNameHash("lightColor[0]"));
+    Require(arrayName.elementNameHashes[2] == CalcShaderVariableNameHash("lightColor[2]"));
+}
+
+InlineTest("Setters which use name hashes")
+{
+    ShaderVariableSet* a = CreateShaderVariableSet();
+    ShaderVariableSet* b = CreateShaderVariableSet();
+
+    SetFloatUniform(a, "intensity[2]", 4);
+    SetFloatUniformByHash(b, CalcShaderVariableNameHash("intensity[2]"), 4);
+    Require(ShaderVariableSetsAreEqual(a, b));
+
+    SetFloatUniform(a, "intensity[2]", 5);
+    Require(!ShaderVariableSetsAreEqual(a, b));
+
+    FreeShaderVariableSet(a);
+    FreeShaderVariableSet(b);
+}
+
+InlineTest("CopyShaderVariablesAsArrayElements")
+{
+    ShaderVariableSet* source = CreateShaderVariableSet();
+    ShaderVariableSet* destination = CreateShaderVariableSet();
+    ShaderVariableSet* expected = CreateShaderVariableSet();
+
+    SetFloatUniform(source, "intensity", 1);
+    SetIntUniform(source, "mode", 2);
+    CopyShaderVariablesAsArrayElements(destination, source, 12);
+
+    SetFloatUniform(expected, "intensity[12]", 1);
+    SetIntUniform(expected, "mode[12]", 2);
+    Require(ShaderVariableSetsAreEqual(destination, expected));
+
+    FreeShaderVariableSet(source);
+    FreeShaderVariableSet(destination);
+    FreeShaderVariableSet(expected);
+}
+
+InlineTest("Many variables can be set and unset")
+{
+    ShaderVariableSet* set = CreateShaderVariableSet();
+    ShaderVariableSet* expected = CreateShaderVariableSet();
+
+    // Fill the set completely, to provoke collisions:
+    REPEAT(32, i)
+        SetIntUniform(set, Format("value%d", i), i);
+
+    // Remove every second variable, which shifts colliding entries:
+    REPEAT(32, i)
+    {
+        if(i % 2 == 0)
+            UnsetShaderVariable(set, Format("value%d", i));
+        else
+            SetIntUniform(expected, Format("value%d", i), i);
+    }
+    Require(ShaderVariableSetsAreEqual(set, expected));
+
+    // Removed variables can be added again:
+    REPEAT(32, i)
+        if(i % 2 == 0)
+            SetIntUniform(set, Format("value%d", i), i);
+    REPEAT(32, i)
+        if(i % 2 == 0)
+            SetIntUniform(expected, Format("value%d", i), i);
+    Require(ShaderVariableSetsAreEqual(set, expected));
+
+    FreeShaderVariableSet(set);
+    FreeShaderVariableSet(expected);
+}
+
+InlineTest("InternProgramFamilyList")
+{
+    const ProgramFamilyListId a = InternProgramFamilyList("animated,static");
+    const ProgramFamilyListId b = InternProgramFamilyList("static");
+    Require(a != INVALID_PROGRAM_FAMILY_LIST_ID);
+    Require(b != INVALID_PROGRAM_FAMILY_LIST_ID);
+    Require(a != b);
+    Require(InternProgramFamilyList("animated,static") == a);
+    Require(InternProgramFamilyList("static") == b);
+}
+
+static ShaderProgram* LinkCameraProgram( const char* fragmentShaderPath )
+{
+    Shader* shaders[2] = {LoadShader("data/Shader/Camera.vert"),
+                          LoadShader(fragmentShaderPath)};
+    REPEAT(2, i)
+        ReferenceShader(shaders[i]);
+    ShaderProgram* program = LinkShaderProgram(shaders, 2);
+    Require(program != NULL);
+    ReferenceShaderProgram(program);
+    REPEAT(2, i)
+        ReleaseShader(shaders[i]);
+    return program;
+}
+
+InlineTest("Uniform buffers are shared and only uploaded on changes")
+{
+    InitNullOpenGL();
+    InitShader();
+    InitRenderCommandQueue({false, NULL, NULL});
+
+    ShaderProgram* a = LinkCameraProgram("data/Shader/Camera.frag");
+    ShaderProgram* b = LinkCameraProgram("data/Shader/Camera.frag");
+    Require(!HasUniform(a, "View")); // Block members are no plain uniforms.
+
+    ShaderVariableSet* set = CreateShaderVariableSet();
+    UniformBuffer* buffer = CreateUniformBuffer(set);
+    ReferenceUniformBuffer(buffer);
+    SetUniformBuffer(set, "Camera", buffer);
+    SetMat4Uniform(set, "View", Mat4Identity);
+    SetFloatUniform(set, "Scale", 1);
+
+    const ShaderVariableSet* sets[] = {set};
+    ShaderVariableBindings bindings;
+    memset(&bindings, 0, sizeof(bindings));
+    const NullOpenGLStatistics* statistics = GetNullOpenGLStatistics();
+
+    SetShaderProgramUniforms(a, sets, 1, &bindings);
+    SetShaderProgramUniforms(b, sets, 1, &bindings);
+    Require(statistics->uniformUploads == 0);
+
+    // Unchanged values aren't uploaded again:
+    ResetNullOpenGLStatistics();
+    UpdateUniformBuffer(buffer);
+    SetShaderProgramUniforms(a, sets, 1, &bindings);
+    SetShaderProgramUniforms(b, sets, 1, &bindings);
+    Require(statistics->bufferUploads == 0);
+    Require(statistics->stateChanges == 0); // Buffer is still bound.
+
+    // Changes are uploaded once for all programs:
+    SetFloatUniform(set, "Scale", 2);
+    UpdateUniformBuffer(buffer);
+    SetShaderProgramUniforms(a, sets, 1, &bindings);
+    SetShaderProgramUniforms(b, sets, 1, &bindings);
+    Require(statistics->bufferUploads == 1);
+
+    ReleaseShaderProgram(a);
+    ReleaseShaderProgram(b);
+    FreeShaderVariableSet(set);
+    ReleaseUniformBuffer(buffer);
+    DestroyRenderCommandQueue();
+    DestroyShader();
+    DestroyNullOpenGL();
+}
+
+InlineTest("Families which are too long never match")
+{
+    InitNullOpenGL();
+    InitShader();
+    InitRenderCommandQueue({false, NULL, NULL});
+
+    ShaderProgram* defaultProgram = LinkCameraProgram("data/Shader/Camera.frag");
+    ShaderProgram* staticProgram = LinkCameraProgram("data/Shader/Camera.frag");
+    ShaderProgramSet* set = CreateShaderProgramSet(defaultProgram);
+    ReferenceShaderProgramSet(set);
+    SetShaderProgramFamily(set, "static", staticProgram);
+
+    char familyList[MAX_PROGRAM_FAMILY_LIST_SIZE];
+    memset(familyList, 'x', sizeof(familyList));
+    familyList[sizeof(familyList)-1] = '\0';
+    Require(GetShaderProgramByFamilyList(set, familyList) == defaultProgram);
+
+    FormatBuffer(familyList + 100, sizeof(familyList) - 100, ",static");
+    Require(GetShaderProgramByFamilyList(set, familyList) == staticProgram);
+
+    ReleaseShaderProgramSet(set);
+    ReleaseShaderProgram(defaultProgram);
+    ReleaseShaderProgram(staticProgram);
+    DestroyRenderCommandQueue();
+    DestroyShader();
+    DestroyNullOpenGL();
+}
+
+InlineTest("Linked programs are restored from the program cache")
+{
+    InitNullOpenGL();
+    InitShader();
+    InitRenderCommandQueue({false, NULL, NULL});
+    const NullOpenGLStatistics* statistics = GetNullOpenGLStatistics();
+
+    ShaderProgram* a = LinkCameraProgram("data/Shader/Tinted.frag");
+
+    // Same sources - the shaders don't need to be compiled:
+    ResetNullOpenGLStatistics();
+    ShaderProgram* b = LinkCameraProgram("data/Shader/Tinted.frag");
+    Require(statistics->shaderCompilations == 0);
+    Require(HasUniform(b, "Tint"));
+    Require(!HasUniform(b, "View"));
+
+    ReleaseShaderProgram(a);
+    ReleaseShaderProgram(b);
+    DestroyRenderCommandQueue();
+    DestroyShader();
+    DestroyNullOpenGL();
+
+    // Binaries of the previous backend instance are rejected:
+    InitNullOpenGL();
+    InitShader();
+    InitRenderCommandQueue({false, NULL, NULL});
+    statistics = GetNullOpenGLStatistics();
+
+    ShaderProgram* c = LinkCameraProgram("data/Shader/Tinted.frag");
+    Require(statistics->shaderCompilations == 2);
+    Require(HasUniform(c, "Tint"));
+
+    // The rejected binary has been replaced:
+    ResetNullOpenGLStatistics();
+    ShaderProgram* d = LinkCameraProgram("data/Shader/Tinted.frag");
+    Require(statistics->shaderCompilations == 0);
+
+    ReleaseShaderProgram(c);
+    ReleaseShaderProgram(d);
+    DestroyRenderCommandQueue();
+    DestroyShader();
+    DestroyNullOpenGL();
+}
+
+int main( int argc, char** argv )
+{
+    InitTests(argc, argv);
+    InitTestVfs(argv[0]);
+    MountVfsDir("data", "data", false);
+    return RunTests();
+}
@@ -1,6 +1,6 @@
 #include <assert.h>
 #include <stdlib.h> // atexit
-#include <string.h> // strrchr, strncpy
+#include <string.h> // strrchr, strncpy, memset
 #include <stdio.h> // stdout
 #include <dummy/tap_reporter.h>
 
@@ -8,6 +8,7 @@
 #include "../Vfs.h"
 #include "../Config.h"
 #include "../JobManager.h"
+#include "../Lua.h"
 
 #include "TestTools.h"
 
@@ -87,3 +88,49 @@ void InitTestJobManager()
     InitJobManager(managerConfig);
     atexit(DestroyJobManager);
 }
+
+LuaConfig GetTestLuaConfig()
+{
+    LuaConfig config;
+    memset(&config, 0, sizeof(config));
+    config.gcTimeBudget = 0.001;
+    config.gcPace = 2;
+    config.bytecodeCache = false;
+    config.profilerInterval = 0;
+    config.profileFile = NULL;
+    return config;
+}
+
+static const char* LuaWorkerTestScript;
+
+static int Lua_GetWorkerTestScript( lua_State* l )
+{
+    lua_pushstring(l, LuaWorkerTestScript);
+    return 1;
+}
+
+void InitLuaWorkerTest( const char* script, LuaConfig config )
+{
+    InitVfs("test", NULL, NULL);
+    MountVfsDir("core", "data/LuaWorker/core", false);
+    InitJobManager({3});
+    InitLua(config);
+    LuaWorkerTestScript = script;
+    REGISTER_LUA_FUNCTION(GetWorkerTestScript);
+}
+
+void DestroyLuaWorkerTest()
+{
+    DestroyLua();
+    DestroyJobManager();
+    DestroyVfs();
+}
+
+void RunLuaWorkerFrames( int frameCount )
+{
+    REPEAT(frameCount, i)
+    {
+        BeginLuaUpdate();
+        CompleteLuaUpdate();
+    }
+}
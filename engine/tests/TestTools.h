@@ -10,9 +10,28 @@
 #define AddTest(Name, Function) dummyAddTest(Name, dummySignalSandbox, Function)
 #define InlineTest(Name) DUMMY_INLINE_TEST(Name, dummySignalSandbox)
 
+struct LuaConfig;
+
 void InitTests( int argc, char const * const * argv );
 void InitTestVfs( const char* argv0 );
 void InitTestJobManager();
+
+/**
+ * Small garbage collection budget, no bytecode cache and no profiler.
+ * Tests which need other settings change the fields by name.
+ */
+LuaConfig GetTestLuaConfig();
+
+/**
+ * Initializes Vfs, job manager and Lua for tests which run Lua workers.
+ *
+ * Workers are bootstrapped by `data/LuaWorker/core/bootstrap/init.lua`,
+ * which only loads `script`.  Functions which are used by the script must
+ * be registered before the workers are created with #SetLuaWorkerCount.
+ */
+void InitLuaWorkerTest( const char* script, LuaConfig config );
+void DestroyLuaWorkerTest();
+void RunLuaWorkerFrames( int frameCount );
 int RunTests();
 
 #endif
@@ -0,0 +1,149 @@
+#include "../Common.h" // REPEAT
+#include "../Vfs.h"
+#include "../JobManager.h"
+#include "../NullOpenGL.h"
+#include "../RenderCommandQueue.h"
+#include "../Image.h"
+#include "../Texture.h"
+#include "TestTools.h"
+
+
+static Image* LoadImage( const char* vfsPath )
+{
+    const JobId job = BeginLoadingImage(vfsPath);
+    WaitForJobs(&job, 1);
+    Image* image = GetCreatedImage(job);
+    ReferenceImage(image);
+    RemoveJob(job);
+    return image;
+}
+
+static void InitTextureTest( int bytesPerFrame )
+{
+    InitNullOpenGL();
+    InitRenderCommandQueue({false, NULL, NULL});
+    InitTextureStreaming({bytesPerFrame});
+}
+
+static void DestroyTextureTest()
+{
+    DestroyTextureStreaming();
+    DestroyRenderCommandQueue();
+    DestroyNullOpenGL();
+}
+
+/**
+ * @return
+ * Bytes which have been uploaded in this frame.
+ */
+static int UploadTexturesOfFrame()
+{
+    ResetNullOpenGLStatistics();
+    PrepareTextureUploads();
+    UploadTextures();
+    return GetNullOpenGLStatistics()->textureUploadBytes;
+}
+
+InlineTest("Streamed textures are uploaded within the frame budget")
+{
+    InitTextureTest(1024);
+
+    Image* image = LoadImage("data/Image/checker.png"); // 32x32 RGB
+    Texture* texture = Create2dTexture(image, TEX_MIPMAP|TEX_STREAM);
+    ReferenceTexture(texture);
+    ReleaseImage(image);
+    Require(!TextureIsComplete(texture));
+
+    int uploadedBytes = 0;
+    int frameCount = 0;
+    while(!TextureIsComplete(texture))
+    {
+        const int frameBytes = UploadTexturesOfFrame();
+        Require(frameBytes <= 1024);
+        if(frameBytes == 0)
+        {
+            // Give the workers time to create the mipmaps:
+            UnlockJobManager();
+            Sleep(0.001);
+            LockJobManager();
+        }
+        uploadedBytes += frameBytes;
+        frameCount++;
+        if(frameCount == 10000)
+            FatalError("Texture upload doesn't progress.");
+    }
+
+    // Rows are padded to 4 bytes: 32*96 + 16*48 + 8*24 + 4*12 + 2*8 + 1*4
+    Require(uploadedBytes == 4100);
+
+    ReleaseTexture(texture);
+    DestroyTextureTest();
+}
+
+InlineTest("Rows which exceed the frame budget are uploaded one by one")
+{
+    InitTextureTest(64);
+
+    Image* image = LoadImage("data/Image/checker.png"); // 96 bytes per row
+    Texture* texture = Create2dTexture(image, TEX_STREAM);
+    ReferenceTexture(texture);
+    ReleaseImage(image);
+
+    REPEAT(32, i)
+    {
+        Require(!TextureIsComplete(texture));
+        Require(UploadTexturesOfFrame() == 96);
+    }
+    Require(UploadTexturesOfFrame() == 0);
+    Require(TextureIsComplete(texture));
+
+    ReleaseTexture(texture);
+    DestroyTextureTest();
+}
+
+InlineTest("Textures may be released while they are streamed")
+{
+    InitTextureTest(1024);
+
+    Image* image = LoadImage("data/Image/checker.png");
+    Texture* a = Create2dTexture(image, TEX_MIPMAP|TEX_STREAM);
+    Texture* b = Create2dTexture(image, TEX_MIPMAP|TEX_STREAM);
+    ReferenceTexture(a);
+    ReferenceTexture(b);
+    ReleaseImage(image);
+
+    UploadTexturesOfFrame();
+    ReleaseTexture(a); // Mipmap job may still be running.
+    UploadTexturesOfFrame();
+    ReleaseTexture(b); // Upload may be in progress.
+    UploadTexturesOfFrame();
+
+    DestroyTextureTest();
+}
+
+InlineTest("Array textures store each image in its own layer")
+{
+    InitTextureTest(1024);
+
+    Image* image = LoadImage("data/Image/checker.png"); // 32x32 RGB
+    const Image* layers[3] = {image, image, image};
+
+    ResetNullOpenGLStatistics();
+    Texture* texture = CreateArrayTexture(layers, 3, 64, 32, TEX_MIPMAP);
+    ReferenceTexture(texture);
+    Require(GetNullOpenGLStatistics()->textureUploadBytes == 3*32*96);
+    Require(TextureIsComplete(texture));
+
+    ReleaseTexture(texture);
+    ReleaseImage(image);
+    DestroyTextureTest();
+}
+
+int main( int argc, char** argv )
+{
+    InitTests(argc, argv);
+    InitTestVfs(argv[0]);
+    InitTestJobManager();
+    MountVfsDir("data", "data", false);
+    return RunTests();
+}
@@ -0,0 +1,136 @@
+#include <string.h> // memset
+#include "../TextureArray.h"
+#include "TestTools.h"
+
+
+static const TextureArrayPlacement* GetPlacement( const TextureArrayPacking* packing,
+                                                  int image )
+{
+    return &packing->placements.data[image];
+}
+
+InlineTest("Size classes are powers of two")
+{
+    Require(GetTextureArraySizeClass(1) == 1);
+    Require(GetTextureArraySizeClass(2) == 2);
+    Require(GetTextureArraySizeClass(5) == 8);
+    Require(GetTextureArraySizeClass(64) == 64);
+    Require(GetTextureArraySizeClass(65) == 128);
+}
+
+InlineTest("Images of the same size class share an array")
+{
+    const TextureArrayImage images[] =
+    {
+        {16, 16, 3},
+        {32, 16, 3},
+        {16, 16, 4}, // Different channel count
+        {16, 16, 3}
+    };
+
+    TextureArrayPacking packing;
+    PackTextureArrays(&packing, images, 4, 256);
+
+    Require(packing.arrays.length == 3);
+    Require(packing.placements.length == 4);
+
+    const TextureArrayLayout* layout = &packing.arrays.data[0];
+    Require(layout->width == 16);
+    Require(layout->height == 16);
+    Require(layout->channelCount == 3);
+    Require(layout->layerCount == 2);
+    Require(packing.arrays.data[1].width == 32);
+    Require(packing.arrays.data[1].layerCount == 1);
+    Require(packing.arrays.data[2].channelCount == 4);
+
+    Require(GetPlacement(&packing, 0)->array == 0);
+    Require(GetPlacement(&packing, 0)->layer == 0);
+    Require(GetPlacement(&packing, 1)->array == 1);
+    Require(GetPlacement(&packing, 1)->layer == 0);
+    Require(GetPlacement(&packing, 2)->array == 2);
+    Require(GetPlacement(&packing, 2)->layer == 0);
+    Require(GetPlacement(&packing, 3)->array == 0);
+    Require(GetPlacement(&packing, 3)->layer == 1);
+
+    DestroyTextureArrayPacking(&packing);
+}
+
+InlineTest("Images which don't fill their layer get scaled texture coordinates")
+{
+    const TextureArrayImage images[] =
+    {
+        {16, 16, 3},
+        {12, 16, 3},
+        {16,  3, 3}
+    };
+
+    TextureArrayPacking packing;
+    PackTextureArrays(&packing, images, 3, 256);
+
+    Require(packing.arrays.length == 2);
+    Require(GetPlacement(&packing, 1)->array == 0);
+    Require(GetPlacement(&packing, 1)->layer == 1);
+    Require(GetPlacement(&packing, 2)->array == 1);
+    Require(packing.arrays.data[1].height == 4);
+
+    const Vec2 fullScale  = {{1, 1}};
+    const Vec2 narrowScale = {{0.75f, 1}};
+    const Vec2 flatScale   = {{1, 0.75f}};
+    Require(ArraysAreEqual(GetPlacement(&packing, 0)->texCoordScale._, fullScale._, 2));
+    Require(ArraysAreEqual(GetPlacement(&packing, 1)->texCoordScale._, narrowScale._, 2));
+    Require(ArraysAreEqual(GetPlacement(&packing, 2)->texCoordScale._, flatScale._, 2));
+
+    DestroyTextureArrayPacking(&packing);
+}
+
+InlineTest("Full arrays are continued in a new one")
+{
+    TextureArrayImage images[5];
+    REPEAT(5, i)
+    {
+        images[i].width = 8;
+        images[i].height = 8;
+        images[i].channelCount = 4;
+    }
+
+    TextureArrayPacking packing;
+    PackTextureArrays(&packing, images, 5, 2);
+
+    Require(packing.arrays.length == 3);
+    Require(packing.arrays.data[0].layerCount == 2);
+    Require(packing.arrays.data[1].layerCount == 2);
+    Require(packing.arrays.data[2].layerCount == 1);
+    REPEAT(5, i)
+    {
+        Require(GetPlacement(&packing, i)->array == i/2);
+        Require(GetPlacement(&packing, i)->layer == i%2);
+    }
+
+    DestroyTextureArrayPacking(&packing);
+}
+
+InlineTest("RemapTexCoords")
+{
+    Vertex vertices[2];
+    memset(vertices, 0, sizeof(vertices));
+    vertices[0].texCoord._[0] = 1;
+    vertices[0].texCoord._[1] = 1;
+    vertices[1].texCoord._[0] = 0.5f;
+    vertices[1].texCoord._[1] = 0;
+
+    const TextureArrayPlacement placement = {0, 3, {{0.5f, 0.25f}}};
+    RemapTexCoords(vertices, 2, &placement);
+
+    const Vec2 a = {{0.5f, 0.25f}};
+    const Vec2 b = {{0.25f, 0}};
+    Require(ArraysAreEqual(vertices[0].texCoord._, a._, 2));
+    Require(ArraysAreEqual(vertices[1].texCoord._, b._, 2));
+    Require(vertices[0].textureLayer == 3);
+    Require(vertices[1].textureLayer == 3);
+}
+
+int main( int argc, char** argv )
+{
+    InitTests(argc, argv);
+    return RunTests();
+}
@@ -28,7 +28,15 @@ static void TestReadTextFile( const char* path )
     Require(HasVfsFileEnded(file));
 
     CloseVfsFile(file);
+
+    int size = 0;
+    char* content = ReadWholeVfsFile(path, &size);
+    Require(content != NULL);
+    Require(size == 12);
+    Require(strcmp(content, "hello world\n") == 0);
+    Free(content);
 }
+
 static bool IsEntryInPathList( const PathList list, const char* entry )
 {
     REPEAT(list.length, i)
@@ -0,0 +1,14 @@
+--- @script core.bootstrap.init
+--- Minimal bootstrap for the Lua worker tests in `tests/Lua.cpp`.
+--- It only loads the script, which the test selected.
+
+local modules, engine = ...
+
+engine.SetCallback.fn('error', function( message )
+    return debug.traceback(message, 2)
+end)
+
+engine.SetCallback.fn('shutdown', function() end)
+
+local script = assert(engine.LoadScript.fn(engine.GetWorkerTestScript.fn()))
+script(engine)
@@ -0,0 +1,8 @@
+--- Calls the test function once, while the worker is created.
+
+local engine = ...
+
+engine.SetCallback.fn('parallel', function() end)
+engine.SetCallback.fn('serial', function() end)
+
+engine.RunTest.fn()
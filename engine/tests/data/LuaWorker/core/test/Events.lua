@@ -0,0 +1,19 @@
+--- Sets a policy for each test event name.  The test queues events in
+--- the parallel phase and checks them when they arrive in the next frame.
+
+local engine = ...
+
+engine.SetEventPolicy.fn('first', 'first', 1)
+engine.SetEventPolicy.fn('last', 'last', 1)
+engine.SetEventPolicy.fn('accumulate', 'accumulate', 1)
+engine.SetEventPolicy.fn('many', 'first', 2)
+engine.SetEventPolicy.fn('limited', 'all', 0, 2)
+engine.SetEventPolicy.fn('limited-last', 'last', 1, 1)
+engine.CreateTestEventListeners.fn()
+
+engine.SetCallback.fn('parallel', function( events )
+    engine.CheckTestEvents.fn(events)
+    engine.QueueTestEvents.fn()
+end)
+
+engine.SetCallback.fn('serial', function() end)
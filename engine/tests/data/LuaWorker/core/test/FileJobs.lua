@@ -0,0 +1,44 @@
+--- Writes files with concurrent jobs, reads them back the same way and
+--- passes their content to the test.
+
+local engine = ...
+
+local FILE_COUNT = 16
+
+local function WaitForFileJobs( jobs )
+    for _, job in ipairs(jobs) do
+        engine.WaitForTestJob.fn(job)
+    end
+end
+
+local function WriteFiles( mode, contentSuffix )
+    local jobs = {}
+    for i = 1, FILE_COUNT do
+        local path = string.format('state/FileJob%d.txt', i)
+        jobs[i] = engine.BeginWriteFile.fn(path, tostring(i)..contentSuffix, mode)
+    end
+    WaitForFileJobs(jobs)
+    for i = 1, FILE_COUNT do
+        assert(select('#', engine.CompleteFileJob.fn(jobs[i])) == 0)
+    end
+end
+
+local function ReadFiles()
+    local jobs = {}
+    for i = 1, FILE_COUNT do
+        local path = string.format('state/FileJob%d.txt', i)
+        jobs[i] = engine.BeginReadFile.fn(path)
+    end
+    WaitForFileJobs(jobs)
+    for i = 1, FILE_COUNT do
+        engine.CheckTestFile.fn(i, engine.CompleteFileJob.fn(jobs[i]))
+    end
+end
+
+engine.SetCallback.fn('parallel', function() end)
+
+engine.SetCallback.fn('serial', function()
+    WriteFiles('w', '')
+    WriteFiles('a', ' appended')
+    ReadFiles()
+end)
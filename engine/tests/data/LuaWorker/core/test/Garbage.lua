@@ -0,0 +1,16 @@
+--- Creates garbage each frame and requests full collections when the test
+--- asks for them.
+
+local engine = ...
+
+engine.SetCallback.fn('parallel', function()
+    for i = 1, 2000 do
+        local garbage = {i, i, i, i, i, i, i, i}
+    end
+end)
+
+engine.SetCallback.fn('serial', function()
+    if engine.ShouldCollectGarbage.fn() then
+        engine.CollectGarbage.fn()
+    end
+end)
@@ -0,0 +1,20 @@
+--- Each worker sends numbered messages to the first worker, which passes
+--- them to the test.
+
+local engine = ...
+
+local index = engine.GetLuaWorkerIndex.fn()
+local frame = 0
+
+engine.SetCallback.fn('parallel', function()
+    frame = frame + 1
+    for i = 1, 3 do
+        engine.SendLuaMessage.fn(0, frame, i, {0.5, 2^63})
+    end
+end)
+
+engine.SetCallback.fn('serial', function( messages )
+    if index == 0 then
+        engine.CheckMessages.fn(frame, messages)
+    end
+end)
@@ -0,0 +1,14 @@
+--- Receives the events, which the producer threads of the test create, and
+--- passes them back to the test.
+
+local engine = ...
+
+engine.SetEventPolicy.fn('latest', 'last', 2)
+engine.SetEventPolicy.fn('limited', 'all', 0, 10)
+engine.CreateProducerTestListeners.fn()
+
+engine.SetCallback.fn('parallel', function( events )
+    engine.RecordProducerTestEvents.fn(events)
+end)
+
+engine.SetCallback.fn('serial', function() end)
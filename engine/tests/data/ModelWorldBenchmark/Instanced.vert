@@ -0,0 +1,26 @@
+#version 150
+
+struct Instance
+{
+    mat4 Model;
+    mat4 ModelView;
+    mat4 ModelViewProjection;
+};
+
+layout(std140) uniform InstanceTransformations
+{
+    Instance Instances[64];
+};
+
+in vec3 VertexPosition;
+in vec3 VertexNormal;
+in int InstanceIndex;
+
+out vec3 Normal;
+
+void main()
+{
+    Instance instance = Instances[InstanceIndex];
+    Normal = (instance.Model * vec4(VertexNormal, 0.0)).xyz;
+    gl_Position = instance.ModelViewProjection * vec4(VertexPosition, 1.0);
+}
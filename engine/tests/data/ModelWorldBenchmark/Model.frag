@@ -0,0 +1,25 @@
+#version 150
+
+layout(std140) uniform Global
+{
+    float Time;
+};
+
+layout(std140) uniform Camera
+{
+    mat4 View;
+    mat4 Projection;
+};
+
+uniform vec3 Color;
+
+in vec3 Normal;
+
+out vec4 FragColor;
+
+void main()
+{
+    vec3 lightDirection = transpose(mat3(View)) * vec3(0.0, 0.0, 1.0);
+    float light = max(dot(normalize(Normal), lightDirection), 0.2);
+    FragColor = vec4(Color * light * (1.0 + 0.1*sin(Time)), 1.0);
+}
@@ -0,0 +1,15 @@
+#version 150
+
+uniform mat4 Model;
+uniform mat4 ModelViewProjection;
+
+in vec3 VertexPosition;
+in vec3 VertexNormal;
+
+out vec3 Normal;
+
+void main()
+{
+    Normal = (Model * vec4(VertexNormal, 0.0)).xyz;
+    gl_Position = ModelViewProjection * vec4(VertexPosition, 1.0);
+}
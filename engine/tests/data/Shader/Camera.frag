@@ -0,0 +1,14 @@
+#version 150
+
+layout(std140) uniform Camera
+{
+    mat4 View;
+    float Scale;
+};
+
+out vec4 FragColor;
+
+void main()
+{
+    FragColor = vec4(Scale);
+}
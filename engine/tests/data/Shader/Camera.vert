@@ -0,0 +1,14 @@
+#version 150
+
+layout(std140) uniform Camera
+{
+    mat4 View;
+    float Scale;
+};
+
+in vec3 VertexPosition;
+
+void main()
+{
+    gl_Position = View * vec4(VertexPosition * Scale, 1.0);
+}
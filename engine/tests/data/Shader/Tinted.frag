@@ -0,0 +1,16 @@
+#version 150
+
+layout(std140) uniform Camera
+{
+    mat4 View;
+    float Scale;
+};
+
+uniform vec3 Tint;
+
+out vec4 FragColor;
+
+void main()
+{
+    FragColor = vec4(Tint * Scale, 1.0);
+}
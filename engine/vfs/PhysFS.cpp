@@ -55,7 +55,9 @@ static void* OpenVfsFile_PhysFS( const Mount* mount,
     if(mode != VFS_OPEN_READ)
         FatalError("Can't write to files mounted as read-only.");
 
-    const char* path = Format("%s/%s", mount->vfsPath, subMountPath);
+    // Files may be opened by jobs, so #Format can't be used here:
+    char path[MAX_PATH_SIZE];
+    FormatBuffer(path, sizeof(path), "%s/%s", mount->vfsPath, subMountPath);
     PHYSFS_File* file = PHYSFS_openRead(path);
     if(!file)
         FatalError("PHYSFS_openRead: %s", GetPhysFSError());
@@ -173,6 +175,13 @@ static void DeleteVfsFile_PhysFS( Mount* mount, const char* subMountPath )
     FatalError("Mount is read only.");
 }
 
+static void RenameVfsFile_PhysFS( Mount* mount,
+                                  const char* oldSubMountPath,
+                                  const char* newSubMountPath )
+{
+    FatalError("Mount is read only.");
+}
+
 static void MakeVfsDir_PhysFS( Mount* mount, const char* subMountPath )
 {
     FatalError("Mount is read only.");
@@ -208,6 +217,7 @@ MountSystem* InitVfs_PhysFS( const char* argv0 )
     sys.getDirEntries = GetVfsDirEntries_PhysFS;
     sys.getFileType   = GetVfsFileType_PhysFS;
     sys.deleteFile    = DeleteVfsFile_PhysFS;
+    sys.renameFile    = RenameVfsFile_PhysFS;
     sys.makeDir       = MakeVfsDir_PhysFS;
     return &sys;
 }
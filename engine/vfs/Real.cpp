@@ -26,14 +26,11 @@ static void UnmountVfsDir_Real( const Mount* mount )
     // Nothing to do here.
 }
 
-static const char* TranslatePathSeparators( const char* path,
-                                            char oldSeparator,
-                                            char newSeparator )
+static void TranslatePathSeparators( const char* path,
+                                     char oldSeparator,
+                                     char newSeparator,
+                                     char* result )
 {
-    if(oldSeparator == newSeparator)
-        return path;
-
-    static char result[MAX_PATH_SIZE];
     for(int i = 0; i < MAX_PATH_SIZE; i++)
     {
         char c = path[i];
@@ -41,9 +38,9 @@ static const char* TranslatePathSeparators( const char* path,
             c = newSeparator;
         result[i] = c;
         if(c == '\0')
-            break;
+            return;
     }
-    return result;
+    result[MAX_PATH_SIZE-1] = '\0';
 }
 
 static const char* VfsOpenModeToString( VfsOpenMode mode )
@@ -64,17 +61,29 @@ static const char* VfsOpenModeToString( VfsOpenMode mode )
     return NULL;
 }
 
+/**
+ * Writes to a buffer, which is provided by the caller, as files may be
+ * opened by jobs.
+ *
+ * @param path
+ * Must be able to hold #MAX_PATH_SIZE bytes.
+ */
 static const char* GetRealPath( const Mount* mount,
-                                const char* subMountPath )
+                                const char* subMountPath,
+                                char* path )
 {
     if(subMountPath)
     {
-        return Format("%s%c%s",
-                      mount->realPath,
-                      NATIVE_DIR_SEP,
-                      TranslatePathSeparators(subMountPath,
-                                              '/',
-                                              NATIVE_DIR_SEP));
+        char translatedPath[MAX_PATH_SIZE];
+        TranslatePathSeparators(subMountPath,
+                                '/',
+                                NATIVE_DIR_SEP,
+                                translatedPath);
+        FormatBuffer(path, MAX_PATH_SIZE, "%s%c%s",
+                     mount->realPath,
+                     NATIVE_DIR_SEP,
+                     translatedPath);
+        return path;
     }
     else
     {
@@ -89,7 +98,8 @@ static void* OpenVfsFile_Real( const Mount* mount,
     if(!subMountPath)
         FatalError("Can't open file '%s'.", mount->vfsPath);
 
-    const char* path = GetRealPath(mount, subMountPath);
+    char pathBuffer[MAX_PATH_SIZE];
+    const char* path = GetRealPath(mount, subMountPath, pathBuffer);
     FILE* file = fopen(path, VfsOpenModeToString(mode));
     if(!file)
         FatalError("Can't open file '%s/%s': %s",
@@ -147,25 +157,40 @@ static bool HasVfsFileEnded_Real( const void* file )
 
 static PathList GetVfsDirEntries_Real( const Mount* mount, const char* subMountPath )
 {
-    const char* path = GetRealPath(mount, subMountPath);
+    char pathBuffer[MAX_PATH_SIZE];
+    const char* path = GetRealPath(mount, subMountPath, pathBuffer);
     return GetDirEntries(path);
 }
 
 static FileType GetVfsFileType_Real( const Mount* mount, const char* subMountPath )
 {
-    const char* path = GetRealPath(mount, subMountPath);
+    char pathBuffer[MAX_PATH_SIZE];
+    const char* path = GetRealPath(mount, subMountPath, pathBuffer);
     return GetFileType(path);
 }
 
 static void DeleteVfsFile_Real( Mount* mount, const char* subMountPath )
 {
-    const char* path = GetRealPath(mount, subMountPath);
+    char pathBuffer[MAX_PATH_SIZE];
+    const char* path = GetRealPath(mount, subMountPath, pathBuffer);
     RemoveFile(path);
 }
 
+static void RenameVfsFile_Real( Mount* mount,
+                                const char* oldSubMountPath,
+                                const char* newSubMountPath )
+{
+    char oldPathBuffer[MAX_PATH_SIZE];
+    char newPathBuffer[MAX_PATH_SIZE];
+    const char* oldPath = GetRealPath(mount, oldSubMountPath, oldPathBuffer);
+    const char* newPath = GetRealPath(mount, newSubMountPath, newPathBuffer);
+    RenameFile(oldPath, newPath);
+}
+
 static void MakeVfsDir_Real( Mount* mount, const char* subMountPath )
 {
-    const char* path = GetRealPath(mount, subMountPath);
+    char pathBuffer[MAX_PATH_SIZE];
+    const char* path = GetRealPath(mount, subMountPath, pathBuffer);
     CreateDirectory(path);
 }
 
@@ -186,6 +211,7 @@ MountSystem* InitVfs_Real()
     sys.getDirEntries = GetVfsDirEntries_Real;
     sys.getFileType   = GetVfsFileType_Real;
     sys.deleteFile    = DeleteVfsFile_Real;
+    sys.renameFile    = RenameVfsFile_Real;
     sys.makeDir       = MakeVfsDir_Real;
     return &sys;
 }
@@ -33,6 +33,9 @@ struct MountSystem
     PathList (*getDirEntries)( const Mount* mount, const char* subMountPath );
     FileType (*getFileType)( const Mount* mount, const char* subMountPath );
     void (*deleteFile)( Mount* mount, const char* subMountPath );
+    void (*renameFile)( Mount* mount,
+                        const char* oldSubMountPath,
+                        const char* newSubMountPath );
     void (*makeDir)( Mount* mount, const char* subMountPath );
 };
 